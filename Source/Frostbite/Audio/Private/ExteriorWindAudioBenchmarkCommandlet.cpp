@@ -0,0 +1,343 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "ExteriorWindAudioBenchmarkCommandlet.h"
+#include "ExteriorWindAudioComponent.h"
+#include "LogCategories.h"
+
+#include "Engine/CollisionProfile.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+
+/** Allocator proxy that counts the allocations made on the game thread while counting is enabled. All calls are forwarded to the original allocator. */
+class FExteriorWindBenchmarkMalloc final : public FMalloc
+{
+public:
+	explicit FExteriorWindBenchmarkMalloc(FMalloc* InInnerMalloc)
+		: InnerMalloc(InInnerMalloc)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->Malloc(Count, Alignment);
+	}
+
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->TryMalloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if(Count > 0) {CountAllocation(); }
+		return InnerMalloc->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if(Count > 0) {CountAllocation(); }
+		return InnerMalloc->TryRealloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override {InnerMalloc->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override {return InnerMalloc->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override {return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override {InnerMalloc->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override {InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override {InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void UpdateStats() override {InnerMalloc->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override {InnerMalloc->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override {InnerMalloc->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override {return InnerMalloc->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override {return InnerMalloc->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptorName() const override {return TEXT("ExteriorWindBenchmarkMalloc"); }
+
+	/** Enables or disables counting. */
+	FORCEINLINE void SetCounting(const bool Value) {IsCounting = Value; }
+
+	/** Returns the number of counted allocations and resets the counter. */
+	FORCEINLINE uint64 ConsumeAllocationCount()
+	{
+		const uint64 Count {AllocationCount};
+		AllocationCount = 0;
+		return Count;
+	}
+
+private:
+	FORCEINLINE void CountAllocation()
+	{
+		/** Only game thread allocations are counted, as those are the ones the component is responsible for. */
+		if(IsCounting && IsInGameThread())
+		{
+			++AllocationCount;
+		}
+	}
+
+	FMalloc* InnerMalloc;
+	bool IsCounting {false};
+	uint64 AllocationCount {0};
+};
+
+/** The allocator proxy that is installed while a benchmark is running. */
+static FExteriorWindBenchmarkMalloc* BenchmarkMalloc {nullptr};
+
+UExteriorWindAudioBenchmarkCommandlet::UExteriorWindAudioBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UExteriorWindAudioBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ModeName;
+	float Duration {120.0f};
+	int32 Seed {1337};
+	int32 NumObstacles {400};
+	FString CsvPath;
+	FString ClassPath;
+	FParse::Value(*Params, TEXT("Mode="), ModeName);
+	FParse::Value(*Params, TEXT("Seconds="), Duration);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Obstacles="), NumObstacles);
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+	FParse::Value(*Params, TEXT("Class="), ClassPath);
+	const bool EnableCache {!FParse::Param(*Params, TEXT("NoCache"))};
+
+	TArray<EWindPollMode> PollModes {EWindPollMode::Synchronous, EWindPollMode::Asynchronous, EWindPollMode::TimeSliced};
+	if(!ModeName.IsEmpty())
+	{
+		const int64 ModeValue {StaticEnum<EWindPollMode>()->GetValueByNameString(ModeName)};
+		if(ModeValue == INDEX_NONE)
+		{
+			UE_LOG(LogExteriorWindAudio, Error, TEXT("Unknown poll mode %s."), *ModeName);
+			return 1;
+		}
+		PollModes = {static_cast<EWindPollMode>(ModeValue)};
+	}
+
+	/** A Blueprint subclass can be passed to include its sound and parameter mapping in the measurement. */
+	TSubclassOf<UExteriorWindAudioComponent> ComponentClass {UExteriorWindAudioBenchmarkComponent::StaticClass()};
+	if(!ClassPath.IsEmpty())
+	{
+		ComponentClass = LoadClass<UExteriorWindAudioComponent>(nullptr, *ClassPath);
+		if(!ComponentClass || ComponentClass->HasAnyClassFlags(CLASS_Abstract))
+		{
+			UE_LOG(LogExteriorWindAudio, Error, TEXT("%s is not a concrete exterior wind audio component class."), *ClassPath);
+			return 1;
+		}
+	}
+
+	/** Create a transient game world that is ticked manually. */
+	UWorld* World {UWorld::CreateWorld(EWorldType::Game, false, TEXT("ExteriorWindAudioBenchmark"))};
+	FWorldContext& WorldContext {GEngine->CreateNewWorldContext(EWorldType::Game)};
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	constexpr float FieldExtent {6000.0f};
+	const FRandomStream Random {Seed};
+	SpawnObstacleField(World, Random, NumObstacles, FieldExtent);
+
+	TArray<FExteriorWindBenchmarkResult> Results;
+	{
+		/** Install the allocator proxy for the duration of the benchmark. The original allocator is restored however this scope is left.
+		 *	The proxy is intentionally leaked, as other threads may still hold a pointer to it. */
+		FMalloc* const InnerMalloc {GMalloc};
+		BenchmarkMalloc = new FExteriorWindBenchmarkMalloc(InnerMalloc);
+		GMalloc = BenchmarkMalloc;
+		ON_SCOPE_EXIT
+		{
+			GMalloc = InnerMalloc;
+		};
+
+		for (const EWindPollMode PollMode : PollModes)
+		{
+			Results.Add(RunBenchmark(World, ComponentClass, PollMode, Duration, FieldExtent, EnableCache));
+		}
+	}
+
+	ReportResults(Results, CsvPath);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return 0;
+}
+
+void UExteriorWindAudioBenchmarkCommandlet::SpawnObstacleField(UWorld* World, const FRandomStream& Random, const int32 NumObstacles, const float FieldExtent)
+{
+	UStaticMesh* CubeMesh {LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"))};
+	if(!CubeMesh)
+	{
+		UE_LOG(LogExteriorWindAudio, Error, TEXT("Failed to load the cube mesh for the benchmark obstacle field."));
+		return;
+	}
+
+	const auto SpawnBox {[World, CubeMesh](const FVector& Location, const FRotator& Rotation, const FVector& Scale)
+	{
+		AStaticMeshActor* Box {World->SpawnActor<AStaticMeshActor>(Location, Rotation)};
+		if(!Box) {return; }
+		UStaticMeshComponent* MeshComponent {Box->GetStaticMeshComponent()};
+		MeshComponent->SetMobility(EComponentMobility::Movable);
+		MeshComponent->SetStaticMesh(CubeMesh);
+		MeshComponent->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		Box->SetActorScale3D(Scale);
+	}};
+
+	/** The cube mesh is 100 units wide, so the scale is expressed in meters. */
+	SpawnBox(FVector(0.0, 0.0, -50.0), FRotator::ZeroRotator, FVector(FieldExtent * 0.02f, FieldExtent * 0.02f, 1.0f));
+
+	for (int32 i {0}; i < NumObstacles; i++)
+	{
+		const FVector Location {Random.FRandRange(-FieldExtent, FieldExtent), Random.FRandRange(-FieldExtent, FieldExtent), 0.0f};
+		const FRotator Rotation {0.0f, Random.FRandRange(0.0f, 360.0f), 0.0f};
+
+		/** Mix walls, pillars and elevated slabs, so that the path passes through open, enclosed and covered areas. */
+		const float Type {Random.FRand()};
+		if(Type < 0.5f)
+		{
+			const FVector Scale {Random.FRandRange(2.0f, 12.0f), Random.FRandRange(0.2f, 0.5f), Random.FRandRange(2.0f, 8.0f)};
+			SpawnBox(Location + FVector(0.0, 0.0, Scale.Z * 50.0f), Rotation, Scale);
+		}
+		else if(Type < 0.8f)
+		{
+			const FVector Scale {Random.FRandRange(0.5f, 2.0f), Random.FRandRange(0.5f, 2.0f), Random.FRandRange(3.0f, 20.0f)};
+			SpawnBox(Location + FVector(0.0, 0.0, Scale.Z * 50.0f), Rotation, Scale);
+		}
+		else
+		{
+			const FVector Scale {Random.FRandRange(4.0f, 10.0f), Random.FRandRange(4.0f, 10.0f), 0.3f};
+			SpawnBox(Location + FVector(0.0, 0.0, Random.FRandRange(300.0f, 600.0f)), Rotation, Scale);
+		}
+	}
+}
+
+FVector UExteriorWindAudioBenchmarkCommandlet::GetPathLocation(const float Distance, const float FieldExtent)
+{
+	/** A figure eight that crosses the center of the field twice per loop. */
+	const float Radius {FieldExtent * 0.8f};
+	const float Angle {Distance / Radius};
+	return FVector(Radius * FMath::Sin(Angle), Radius * 0.5f * FMath::Sin(2.0f * Angle), 170.0f);
+}
+
+FExteriorWindBenchmarkResult UExteriorWindAudioBenchmarkCommandlet::RunBenchmark(UWorld* World, const TSubclassOf<UExteriorWindAudioComponent> ComponentClass, const EWindPollMode PollMode,
+	const float Duration, const float FieldExtent, const bool EnableCache)
+{
+	FExteriorWindBenchmarkResult Result;
+	Result.ModeName = StaticEnum<EWindPollMode>()->GetNameStringByValue(static_cast<int64>(PollMode));
+
+	/** The owner stands in for the player character. The wind component adds its own audio component to it, which stays silent when running with -nosound. */
+	AActor* Owner {World->SpawnActor<AActor>(GetPathLocation(0.0f, FieldExtent), FRotator::ZeroRotator)};
+	USceneComponent* Root {NewObject<USceneComponent>(Owner, TEXT("Root"))};
+	Owner->SetRootComponent(Root);
+	Root->RegisterComponent();
+
+	UExteriorWindAudioComponent* Component {NewObject<UExteriorWindAudioComponent>(Owner, ComponentClass, TEXT("ExteriorWindAudioComponent"))};
+	Component->PollMode = PollMode;
+	Component->IsPollCacheEnabled = EnableCache;
+	Component->RegisterComponent();
+
+	/** The component is ticked manually, so that only its own work is measured. */
+	Component->SetComponentTickEnabled(false);
+
+	constexpr float DeltaTime {1.0f / 60.0f};
+	constexpr float WalkSpeed {300.0f};
+	constexpr float SprintSpeed {700.0f};
+	const int32 NumFrames {FMath::CeilToInt32(Duration / DeltaTime)};
+
+	TArray<double> PollMicroseconds;
+	PollMicroseconds.Reserve(NumFrames);
+	double PendingSeconds {0.0};
+	float Distance {0.0f};
+	uint32 LastPollCount {Component->GetCompletedPollCount()};
+	const uint32 StartPollCount {LastPollCount};
+	const uint32 StartTraceCount {Component->GetIssuedTraceCount()};
+	BenchmarkMalloc->ConsumeAllocationCount();
+
+	for (int32 Frame {0}; Frame < NumFrames; Frame++)
+	{
+		/** Alternate between walking and sprinting every ten seconds. */
+		const float Speed {(Frame / 600) % 2 == 0 ? WalkSpeed : SprintSpeed};
+		Distance += Speed * DeltaTime;
+		const FVector Location {GetPathLocation(Distance, FieldExtent)};
+		Root->ComponentVelocity = (Location - Owner->GetActorLocation()) / DeltaTime;
+		Owner->SetActorLocation(Location);
+
+		/** The world tick completes the async traces of the previous frame. */
+		World->Tick(LEVELTICK_All, DeltaTime);
+
+		BenchmarkMalloc->SetCounting(true);
+		const double StartTime {FPlatformTime::Seconds()};
+		Component->TickComponent(DeltaTime, LEVELTICK_All, &Component->PrimaryComponentTick);
+		PendingSeconds += FPlatformTime::Seconds() - StartTime;
+		BenchmarkMalloc->SetCounting(false);
+
+		/** The time spent ticking since the last completed poll is attributed to the polls that completed this frame. */
+		const uint32 PollCount {Component->GetCompletedPollCount()};
+		if(PollCount != LastPollCount)
+		{
+			const double MicrosecondsPerPoll {PendingSeconds * 1000000.0 / (PollCount - LastPollCount)};
+			for (uint32 i {LastPollCount}; i < PollCount; i++)
+			{
+				PollMicroseconds.Add(MicrosecondsPerPoll);
+			}
+			PendingSeconds = 0.0;
+			LastPollCount = PollCount;
+		}
+	}
+
+	Result.PollCount = Component->GetCompletedPollCount() - StartPollCount;
+	Result.TraceCount = Component->GetIssuedTraceCount() - StartTraceCount;
+	Result.AllocationCount = BenchmarkMalloc->ConsumeAllocationCount();
+	Result.SimulatedSeconds = NumFrames * DeltaTime;
+
+	if(PollMicroseconds.Num() > 0)
+	{
+		PollMicroseconds.Sort();
+		Result.MedianMicroseconds = PollMicroseconds[(PollMicroseconds.Num() - 1) / 2];
+		Result.P99Microseconds = PollMicroseconds[FMath::FloorToInt32((PollMicroseconds.Num() - 1) * 0.99)];
+	}
+
+	Owner->Destroy();
+	return Result;
+}
+
+void UExteriorWindAudioBenchmarkCommandlet::ReportResults(const TArray<FExteriorWindBenchmarkResult>& Results, const FString& CsvPath)
+{
+	const FString Timestamp {FDateTime::Now().ToString()};
+	FString CsvRows;
+	for (const FExteriorWindBenchmarkResult& Result : Results)
+	{
+		const double Polls {static_cast<double>(FMath::Max(Result.PollCount, 1u))};
+		const double TracesPerPoll {Result.TraceCount / Polls};
+		const double AllocationsPerPoll {Result.AllocationCount / Polls};
+		const double PollsPerMinute {Result.PollCount * 60.0 / FMath::Max(Result.SimulatedSeconds, 1.0)};
+
+		UE_LOG(LogExteriorWindAudio, Display, TEXT("%-12s polls: %u (%.1f/min), traces/poll: %.2f, us/poll p50: %.2f p99: %.2f, allocations/poll: %.2f"),
+			*Result.ModeName, Result.PollCount, PollsPerMinute, TracesPerPoll, Result.MedianMicroseconds, Result.P99Microseconds, AllocationsPerPoll);
+
+		CsvRows += FString::Printf(TEXT("%s,%s,%u,%.2f,%.3f,%.3f,%.3f,%.3f\n"), *Timestamp, *Result.ModeName, Result.PollCount, PollsPerMinute,
+			TracesPerPoll, Result.MedianMicroseconds, Result.P99Microseconds, AllocationsPerPoll);
+	}
+
+	UE_LOG(LogExteriorWindAudio, Display, TEXT("Asynchronous trace completion runs inside the world tick and is not included in the per poll time. See the Poll Processing stat."));
+
+	/** Results are appended, so that runs can be compared over time. */
+	if(CsvPath.IsEmpty()) {return; }
+	if(!FPaths::FileExists(CsvPath))
+	{
+		CsvRows = TEXT("Timestamp,Mode,Polls,PollsPerMinute,TracesPerPoll,MicrosecondsP50,MicrosecondsP99,AllocationsPerPoll\n") + CsvRows;
+	}
+	FFileHelper::SaveStringToFile(CsvRows, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
@@ -3,11 +3,44 @@
 // This source code is part of the project Frostbite
 
 #include "ExteriorWindAudioComponent.h"
+#include "ExteriorWindFieldData.h"
+#include "ExteriorWindParameterMapping.h"
+#include "StatCategories.h"
+#include "LogCategories.h"
 
 #include "GameFramework/Actor.h"
 #include "MetasoundSource.h"
 #include "Components/AudioComponent.h"
 
+DECLARE_CYCLE_STAT(TEXT("Baked Poll"), STAT_WindBakedPoll, STATGROUP_ExteriorWindAudio);
+DECLARE_CYCLE_STAT(TEXT("Synchronous Poll"), STAT_WindSynchronousPoll, STATGROUP_ExteriorWindAudio);
+DECLARE_CYCLE_STAT(TEXT("Asynchronous Poll Submit"), STAT_WindAsynchronousPollSubmit, STATGROUP_ExteriorWindAudio);
+DECLARE_CYCLE_STAT(TEXT("Time Sliced Poll"), STAT_WindTimeSlicedPoll, STATGROUP_ExteriorWindAudio);
+DECLARE_CYCLE_STAT(TEXT("Poll Processing"), STAT_WindPollProcessing, STATGROUP_ExteriorWindAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Poll Cache Hits"), STAT_WindPollCacheHits, STATGROUP_ExteriorWindAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Poll Cache Misses"), STAT_WindPollCacheMisses, STATGROUP_ExteriorWindAudio);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Poll Cache Hit Rate (%)"), STAT_WindPollCacheHitRate, STATGROUP_ExteriorWindAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Poll Cache Entries"), STAT_WindPollCacheEntries, STATGROUP_ExteriorWindAudio);
+DECLARE_MEMORY_STAT(TEXT("Poll Cache Memory"), STAT_WindPollCacheMemory, STATGROUP_ExteriorWindAudio);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Polls Per Minute"), STAT_WindPollsPerMinute, STATGROUP_ExteriorWindAudio);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Adaptive Poll Distance"), STAT_WindAdaptivePollDistance, STATGROUP_ExteriorWindAudio);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Traces This Frame"), STAT_WindTracesThisFrame, STATGROUP_ExteriorWindAudio);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Asynchronous Poll Latency (ms)"), STAT_WindAsynchronousPollLatency, STATGROUP_ExteriorWindAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Asynchronous Poll Latency (frames)"), STAT_WindAsynchronousPollLatencyFrames, STATGROUP_ExteriorWindAudio);
+
+/** The user data of an async trace stores the trace index in the lowest byte, a flag for occlusion traces and the poll identifier in the upper 16 bits. */
+static constexpr uint32 AsyncTraceIndexMask {0xFF};
+static constexpr uint32 AsyncTraceOcclusionFlag {1 << 8};
+static constexpr uint32 AsyncTracePollIdShift {16};
+
+/** The offsets of the occlusion traces on the grid perpendicular to the wind direction, in rows from bottom to top. */
+static constexpr int32 OcclusionTraceOffsets[UExteriorWindAudioComponent::OcclusionTraceCount][2]
+{
+	{-1, -1}, {0, -1}, {1, -1},
+	{-1, 0}, {0, 0}, {1, 0},
+	{-1, 1}, {0, 1}, {1, 1}
+};
+
 /** Sets default values for this component's properties. */
 UExteriorWindAudioComponent::UExteriorWindAudioComponent()
 {
@@ -24,9 +57,29 @@ void UExteriorWindAudioComponent::BeginPlay()
 /** Called when the component is initialized. */
 void UExteriorWindAudioComponent::InitializeComponent()
 {
-	/** Initialize the trace vector arrays. */
-	PopulateTerrainTraceVectors(TerrainTraceEndVectors, WindDirection, CollisionTraceLength, 8);
-	PopulateOcclusionTraceVectors(OcclusionTraceStartVectors, OcclusionTraceEndVectors, WindDirection, CollisionTraceLength, 250);
+	/** Initialize the trace vector arrays. The terrain pattern does not depend on the wind direction, the occlusion pattern is precomputed for every quantized direction. */
+	PopulateTerrainTraceVectors(TerrainTraceEndVectors, WindDirection, CollisionTraceLength, TerrainTraceCount);
+	PopulateOcclusionTraceTable();
+	WindDirectionIndex = UExteriorWindFieldData::GetDirectionIndex(WindDirection, WindDirectionCount);
+
+	AsyncTraceDelegate.BindUObject(this, &UExteriorWindAudioComponent::HandleAsyncTraceCompleted);
+
+	/** Allocate the poll cache up front, so polls never allocate. */
+	if(IsPollCacheEnabled)
+	{
+		const int32 Stride {TerrainTraceCount + OcclusionTraceCount};
+		const int32 MaxEntries {static_cast<int32>(PollCacheMemoryBudget * 1024 / FExteriorWindPollCache::GetBytesPerEntry(Stride))};
+		PollCache.Initialize(MaxEntries, Stride);
+		SET_MEMORY_STAT(STAT_WindPollCacheMemory, PollCache.GetAllocatedSize());
+	}
+
+	/** The poll results are only copied for Blueprint if the poll event is actually implemented. */
+	IsPollEventImplemented = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UExteriorWindAudioComponent, EventOnPoll));
+	
+	if(!ParameterMappingAsset.IsNull())
+	{
+		ParameterMapping = ParameterMappingAsset.LoadSynchronous();
+	}
 	
 	if(GetOwner())
 	{
@@ -36,6 +89,22 @@ void UExteriorWindAudioComponent::InitializeComponent()
 	{
 		AudioComponent->SetSound(MetaSoundAsset.LoadSynchronous());
 	}
+
+	/** Load the baked wind field. An invalid field is ignored and every poll will be performed using collision queries. */
+	if(!WindFieldAsset.IsNull())
+	{
+		WindField = WindFieldAsset.LoadSynchronous();
+		if(WindField && (!WindField->IsValidField() || WindField->TerrainTraceCount != TerrainTraceCount || WindField->OcclusionTraceCount != OcclusionTraceCount))
+		{
+			UE_LOG(LogExteriorWindAudio, Warning, TEXT("Baked wind field %s is invalid and will be ignored. Rebake the wind field."), *WindField->GetName());
+			WindField = nullptr;
+		}
+		else if(WindField && !FMath::IsNearlyEqual(WindField->TraceLength, CollisionTraceLength))
+		{
+			UE_LOG(LogExteriorWindAudio, Warning, TEXT("Baked wind field %s was baked with a trace length of %f, but %s uses %f."),
+				*WindField->GetName(), WindField->TraceLength, *GetName(), CollisionTraceLength);
+		}
+	}
 	
 	Super::InitializeComponent();
 }
@@ -47,8 +116,14 @@ void UExteriorWindAudioComponent::SetWindDirection(const FRotator& Rotation)
 		return;
 	}
 	WindDirection = Rotation;
-	PopulateTerrainTraceVectors(TerrainTraceEndVectors, WindDirection, CollisionTraceLength, 8);
-	PopulateOcclusionTraceVectors(OcclusionTraceStartVectors, OcclusionTraceEndVectors, WindDirection, CollisionTraceLength, 250);
+
+	/** Selecting a precomputed trace pattern is constant time and does not allocate, so the direction can be animated every frame. */
+	const int32 NewDirectionIndex {UExteriorWindFieldData::GetDirectionIndex(WindDirection, WindDirectionCount)};
+	if(NewDirectionIndex == WindDirectionIndex)
+	{
+		return;
+	}
+	WindDirectionIndex = NewDirectionIndex;
 	EventOnWindDirectionChanged(Rotation);
 }
 
@@ -56,72 +131,436 @@ void UExteriorWindAudioComponent::SetWindDirection(const FRotator& Rotation)
 void UExteriorWindAudioComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-	if(GetOwner() && (GetOwner()->GetActorLocation() - LastPollLocation).SquaredLength() > 62500)
+	if(!GetOwner()) {return; }
+
+	/** A time sliced sweep that is in progress is completed before a new poll is started. */
+	if(TimeSlicedTraceIndex != INDEX_NONE)
+	{
+		ContinueTimeSlicedPoll();
+		return;
+	}
+	
+	const FVector Location {GetOwner()->GetActorLocation()};
+	const float Time {GetWorld()->GetTimeSeconds()};
+	bool IsRefresh {false};
+	if(ShouldPoll(Location, Time, IsRefresh))
 	{
-		LastPollLocation = GetOwner()->GetActorLocation();
-		if(GetOwner())
+		LastPollLocation = Location;
+		RecordPoll(Time);
+
+		/** A refresh is meant to pick up changes in the level, which the cache cannot know about. It is traced and replaces the cached entry. */
+		if(PerformBakedPoll(LastPollLocation) || (!IsRefresh && PerformCachedPoll(LastPollLocation)))
 		{
-			const TArray<float> TerrainTraceResults {DoTerrainCollisionQuery(LastPollLocation)};
-			const TArray<float> OcclusionTraceResults {DoOcclusionCollisionQuery(LastPollLocation)};
-			EventOnPoll(TerrainTraceResults, OcclusionTraceResults);
+			return;
+		}
+		
+		TracedPollLocation = LastPollLocation;
+		TracedPollDirectionIndex = WindDirectionIndex;
+		switch(PollMode)
+		{
+		case EWindPollMode::Synchronous: PerformSynchronousPoll(LastPollLocation);
+			break;
+		case EWindPollMode::Asynchronous: SubmitAsynchronousPoll(LastPollLocation);
+			break;
+		case EWindPollMode::TimeSliced: StartTimeSlicedPoll(LastPollLocation);
+			break;
 		}
 	}
 }
 
-TArray<float> UExteriorWindAudioComponent::DoTerrainCollisionQuery(const FVector& Location)
+bool UExteriorWindAudioComponent::ShouldPoll(const FVector& Location, const float Time, bool& OutIsRefresh) const
 {
-	TArray<float> TraceLengths;
-	for (int i {0}; i < TerrainTraceEndVectors.Num(); i++)
+	OutIsRefresh = false;
+	const float DistanceSquared {static_cast<float>((Location - LastPollLocation).SquaredLength())};
+	if(!IsAdaptivePollingEnabled)
 	{
-		const FVector TraceStart {GetOwner()->GetActorLocation()};
-		const FVector TraceEnd {GetOwner()->GetActorLocation() + TerrainTraceEndVectors[i]}; 
+		return DistanceSquared > FMath::Square(PollDistance);
+	}
+	if(!HasCompletedPoll && PendingAsyncTraceCount == 0) {return true; }
+
+	const float ElapsedTime {Time - LastPollTime};
+	if(ElapsedTime < MinPollInterval) {return false; }
+
+	/** Unstable environments are refreshed more often, so that changes in the wind direction or the level are picked up while standing still. */
+	const float Staleness {FMath::Lerp(MaxStaleness * 0.25f, MaxStaleness, Stability)};
+	if(DistanceSquared > FMath::Square(GetAdaptivePollDistance())) {return true; }
+	OutIsRefresh = ElapsedTime >= Staleness;
+	return OutIsRefresh;
+}
 
-		FHitResult HitResult;
-		FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
-		Params.bTraceComplex = false;
-		Params.bReturnPhysicalMaterial = false;
+float UExteriorWindAudioComponent::GetAdaptivePollDistance() const
+{
+	const float Speed {static_cast<float>(GetOwner()->GetVelocity().Size())};
+	const float SpeedAlpha {FMath::Clamp(Speed / HighSpeed, 0.0f, 1.0f)};
+	const float Distance {FMath::Lerp(MinPollDistance, MaxPollDistance, Stability) * FMath::Lerp(1.0f, HighSpeedDistanceScale, SpeedAlpha)};
+	SET_FLOAT_STAT(STAT_WindAdaptivePollDistance, Distance);
+	return Distance;
+}
 
-		if (GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECC_Visibility, Params))
+void UExteriorWindAudioComponent::UpdateStability()
+{
+	if(!HasCompletedPoll)
+	{
+		/** Without a previous poll there is nothing to compare against, so the environment is treated as unstable. */
+		Stability = 0.0f;
+		HasCompletedPoll = true;
+	}
+	else
+	{
+		const float Change {FMath::Max3(FMath::Abs(WindFeatures.Openness - PreviousWindFeatures.Openness),
+			FMath::Abs(WindFeatures.Occlusion - PreviousWindFeatures.Occlusion),
+			FMath::Abs(WindFeatures.OcclusionPan - PreviousWindFeatures.OcclusionPan) * 0.5f)};
+		Stability = 1.0f - FMath::Clamp(Change / ChangeThreshold, 0.0f, 1.0f);
+	}
+	PreviousWindFeatures = WindFeatures;
+}
+
+void UExteriorWindAudioComponent::RecordPoll(const float Time)
+{
+	LastPollTime = Time;
+	++WindowPollCount;
+
+	/** The poll rate is measured over a short window, so that it responds to changes in movement within a few seconds. */
+	constexpr float WindowDuration {10.0f};
+	const float ElapsedTime {Time - WindowStartTime};
+	if(ElapsedTime >= WindowDuration)
+	{
+		PollsPerMinute = WindowPollCount * 60.0f / ElapsedTime;
+		WindowPollCount = 0;
+		WindowStartTime = Time;
+		SET_FLOAT_STAT(STAT_WindPollsPerMinute, PollsPerMinute);
+	}
+}
+
+bool UExteriorWindAudioComponent::PerformBakedPoll(const FVector& Location)
+{
+	if(!WindField || !WindField->IsInsideBounds(Location)) {return false; }
+	
+	SCOPE_CYCLE_COUNTER(STAT_WindBakedPoll);
+	
+	TerrainResults.SetNumUninitialized(TerrainTraceCount);
+	OcclusionResults.SetNumUninitialized(OcclusionTraceCount);
+	const int32 DirectionIndex {UExteriorWindFieldData::GetDirectionIndex(WindDirection, WindField->DirectionCount)};
+	if(!WindField->SampleTerrain(Location, TerrainResults) || !WindField->SampleOcclusion(Location, DirectionIndex, OcclusionResults))
+	{
+		return false;
+	}
+	
+	/** A baked poll supersedes any async poll that is still in flight. */
+	++AsyncPollId;
+	PendingAsyncTraceCount = 0;
+	
+	FinishPoll();
+	return true;
+}
+
+bool UExteriorWindAudioComponent::PerformCachedPoll(const FVector& Location)
+{
+	if(!IsPollCacheEnabled || PollCache.GetMaxEntries() == 0) {return false; }
+
+	float CachedResults[TerrainTraceCount + OcclusionTraceCount];
+	const bool IsHit {PollCache.Find(GetPollCacheKey(Location, WindDirectionIndex), CachedResults)};
+
+	SET_DWORD_STAT(STAT_WindPollCacheHits, PollCache.GetHitCount());
+	SET_DWORD_STAT(STAT_WindPollCacheMisses, PollCache.GetMissCount());
+	SET_FLOAT_STAT(STAT_WindPollCacheHitRate, PollCache.GetHitRate() * 100.0f);
+	if(!IsHit) {return false; }
+
+	TerrainResults.SetNumUninitialized(TerrainTraceCount);
+	OcclusionResults.SetNumUninitialized(OcclusionTraceCount);
+	FMemory::Memcpy(TerrainResults.GetData(), CachedResults, TerrainTraceCount * sizeof(float));
+	FMemory::Memcpy(OcclusionResults.GetData(), CachedResults + TerrainTraceCount, OcclusionTraceCount * sizeof(float));
+
+	/** A cached poll supersedes any async poll that is still in flight. */
+	++AsyncPollId;
+	PendingAsyncTraceCount = 0;
+	
+	FinishPoll();
+	return true;
+}
+
+void UExteriorWindAudioComponent::StoreTracedPollInCache()
+{
+	if(!IsPollCacheEnabled || PollCache.GetMaxEntries() == 0) {return; }
+	if(TerrainResults.Num() != TerrainTraceCount || OcclusionResults.Num() != OcclusionTraceCount) {return; }
+
+	float Results[TerrainTraceCount + OcclusionTraceCount];
+	FMemory::Memcpy(Results, TerrainResults.GetData(), TerrainTraceCount * sizeof(float));
+	FMemory::Memcpy(Results + TerrainTraceCount, OcclusionResults.GetData(), OcclusionTraceCount * sizeof(float));
+	PollCache.Add(GetPollCacheKey(TracedPollLocation, TracedPollDirectionIndex), Results);
+
+	SET_DWORD_STAT(STAT_WindPollCacheEntries, PollCache.Num());
+}
+
+FExteriorWindPollCacheKey UExteriorWindAudioComponent::GetPollCacheKey(const FVector& Location, const int32 DirectionIndex) const
+{
+	const FVector Cell {Location / PollCacheCellSize};
+	return FExteriorWindPollCacheKey(FIntVector(FMath::FloorToInt32(Cell.X), FMath::FloorToInt32(Cell.Y), FMath::FloorToInt32(Cell.Z)), DirectionIndex);
+}
+
+void UExteriorWindAudioComponent::ClearPollCache()
+{
+	PollCache.Empty();
+	SET_DWORD_STAT(STAT_WindPollCacheEntries, 0);
+}
+
+float UExteriorWindAudioComponent::GetPollCacheHitRate() const
+{
+	return PollCache.GetHitRate();
+}
+
+void UExteriorWindAudioComponent::PerformSynchronousPoll(const FVector& Location)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WindSynchronousPoll);
+	
+	TerrainResults.SetNumUninitialized(TerrainTraceCount);
+	OcclusionResults.SetNumUninitialized(OcclusionTraceCount);
+	for (int32 i {0}; i < TerrainResults.Num(); i++)
+	{
+		TerrainResults[i] = DoSingleTrace(Location, Location + TerrainTraceEndVectors[i]);
+	}
+	for (int32 i {0}; i < OcclusionResults.Num(); i++)
+	{
+		OcclusionResults[i] = DoSingleTrace(Location + GetOcclusionTraceStart(i), Location + GetOcclusionTraceEnd(i));
+	}
+	INC_DWORD_STAT_BY(STAT_WindTracesThisFrame, TerrainResults.Num() + OcclusionResults.Num());
+	IssuedTraceCount += TerrainResults.Num() + OcclusionResults.Num();
+	StoreTracedPollInCache();
+	FinishPoll();
+}
+
+void UExteriorWindAudioComponent::SubmitAsynchronousPoll(const FVector& Location)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WindAsynchronousPollSubmit);
+	
+	UWorld* World {GetWorld()};
+	if(!World) {return; }
+
+	/** Starting a new poll supersedes any poll that is still in flight. */
+	++AsyncPollId;
+	const uint32 PollIdBits {static_cast<uint32>(AsyncPollId) << AsyncTracePollIdShift};
+
+	TerrainResults.SetNumUninitialized(TerrainTraceCount);
+	OcclusionResults.SetNumUninitialized(OcclusionTraceCount);
+	PendingAsyncTraceCount = TerrainResults.Num() + OcclusionResults.Num();
+	AsyncPollStartTime = FPlatformTime::Seconds();
+	AsyncPollStartFrame = GFrameCounter;
+	INC_DWORD_STAT_BY(STAT_WindTracesThisFrame, PendingAsyncTraceCount);
+	IssuedTraceCount += PendingAsyncTraceCount;
+
+	FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
+	Params.bTraceComplex = false;
+	Params.bReturnPhysicalMaterial = false;
+
+	for (int32 i {0}; i < TerrainTraceCount; i++)
+	{
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Location, Location + TerrainTraceEndVectors[i], ECC_Visibility,
+			Params, FCollisionResponseParams::DefaultResponseParam, &AsyncTraceDelegate, PollIdBits | i);
+	}
+	for (int32 i {0}; i < OcclusionTraceCount; i++)
+	{
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Location + GetOcclusionTraceStart(i), Location + GetOcclusionTraceEnd(i), ECC_Visibility,
+			Params, FCollisionResponseParams::DefaultResponseParam, &AsyncTraceDelegate, PollIdBits | AsyncTraceOcclusionFlag | i);
+	}
+}
+
+void UExteriorWindAudioComponent::StartTimeSlicedPoll(const FVector& Location)
+{
+	TimeSlicedPollLocation = Location;
+	TimeSlicedTraceIndex = 0;
+	TimeSlicedTerrainTraceCount = TerrainTraceCount;
+	TimeSlicedOcclusionTraceCount = OcclusionTraceCount;
+
+	/** Resizing keeps the results of the previous sweep, which are replaced as the new sweep progresses. */
+	TerrainResults.SetNumZeroed(TimeSlicedTerrainTraceCount);
+	OcclusionResults.SetNumZeroed(TimeSlicedOcclusionTraceCount);
+
+	/** Spend the budget of this frame right away. */
+	ContinueTimeSlicedPoll();
+}
+
+void UExteriorWindAudioComponent::ContinueTimeSlicedPoll()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WindTimeSlicedPoll);
+	
+	const int32 NumTerrainTraces {TimeSlicedTerrainTraceCount};
+	const int32 NumTraces {NumTerrainTraces + TimeSlicedOcclusionTraceCount};
+	const int32 LastTraceIndex {FMath::Min(TimeSlicedTraceIndex + FMath::Max(TraceBudgetPerFrame, 1), NumTraces)};
+	INC_DWORD_STAT_BY(STAT_WindTracesThisFrame, LastTraceIndex - TimeSlicedTraceIndex);
+	IssuedTraceCount += LastTraceIndex - TimeSlicedTraceIndex;
+
+	const FVector& Location {TimeSlicedPollLocation};
+	for (; TimeSlicedTraceIndex < LastTraceIndex; TimeSlicedTraceIndex++)
+	{
+		if(TimeSlicedTraceIndex < NumTerrainTraces)
 		{
-			const float TraceLength {static_cast<float>((HitResult.ImpactPoint - TraceStart).Size())};
-			TraceLengths.Add(TraceLength);
+			const int32 i {TimeSlicedTraceIndex};
+			TerrainResults[i] = DoSingleTrace(Location, Location + TerrainTraceEndVectors[i]);
 		}
 		else
 		{
-			const float TraceLength {static_cast<float>((TraceEnd - TraceStart).Size())};
-			TraceLengths.Add(TraceLength);
+			const int32 i {TimeSlicedTraceIndex - NumTerrainTraces};
+			OcclusionResults[i] = DoSingleTrace(Location + GetOcclusionTraceStart(i), Location + GetOcclusionTraceEnd(i));
 		}
 	}
-	return TraceLengths;
+
+	if(TimeSlicedTraceIndex >= NumTraces)
+	{
+		TimeSlicedTraceIndex = INDEX_NONE;
+		StoreTracedPollInCache();
+		FinishPoll();
+	}
 }
 
-TArray<float> UExteriorWindAudioComponent::DoOcclusionCollisionQuery(const FVector& Location)
+void UExteriorWindAudioComponent::HandleAsyncTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
 {
-	TArray<float> TraceLengths;
-	for (int i {0}; i < OcclusionTraceStartVectors.Num(); i++)
+	/** Discard results of polls that have been superseded in the meantime. */
+	if(static_cast<uint16>(TraceDatum.UserData >> AsyncTracePollIdShift) != AsyncPollId || PendingAsyncTraceCount <= 0)
+	{
+		return;
+	}
+	
+	const FHitResult* HitResult {TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit ? &TraceDatum.OutHits[0] : nullptr};
+	const float TraceLength {GetTraceLength(TraceDatum.Start, TraceDatum.End, HitResult)};
+	
+	const int32 Index {static_cast<int32>(TraceDatum.UserData & AsyncTraceIndexMask)};
+	const TArrayView<float> Results {TraceDatum.UserData & AsyncTraceOcclusionFlag ? TArrayView<float>(OcclusionResults) : TArrayView<float>(TerrainResults)};
+	if(Results.IsValidIndex(Index))
 	{
-		const FVector TraceStart {GetOwner()->GetActorLocation() + OcclusionTraceStartVectors[i]};
-		const FVector TraceEnd {GetOwner()->GetActorLocation() + OcclusionTraceEndVectors[i]};
+		Results[Index] = TraceLength;
+	}
 
-		FHitResult HitResult;
-		FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
-		Params.bTraceComplex = false;
-		Params.bReturnPhysicalMaterial = false;
+	if(--PendingAsyncTraceCount == 0)
+	{
+		SET_FLOAT_STAT(STAT_WindAsynchronousPollLatency, (FPlatformTime::Seconds() - AsyncPollStartTime) * 1000.0);
+		SET_DWORD_STAT(STAT_WindAsynchronousPollLatencyFrames, GFrameCounter - AsyncPollStartFrame);
+		StoreTracedPollInCache();
+		FinishPoll();
+	}
+}
 
-		if (GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECC_Visibility, Params))
+void UExteriorWindAudioComponent::FinishPoll()
+{
+	++CompletedPollCount;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WindPollProcessing);
+		WindFeatures = ComputeWindFeatures(TerrainResults, OcclusionResults, CollisionTraceLength);
+		UpdateStability();
+		if(ParameterMapping)
 		{
-			const float TraceLength {static_cast<float>((HitResult.ImpactPoint - TraceStart).Size())};
-			TraceLengths.Add(TraceLength);
+			ParameterMapping->ApplyToAudioComponent(AudioComponent, WindFeatures);
 		}
-		else
+	}
+
+	if(IsPollEventImplemented)
+	{
+		/** Reset keeps the allocation of the previous poll, so this only allocates the first time. */
+		BlueprintTerrainResults.Reset();
+		BlueprintTerrainResults.Append(TerrainResults.GetData(), TerrainResults.Num());
+		BlueprintOcclusionResults.Reset();
+		BlueprintOcclusionResults.Append(OcclusionResults.GetData(), OcclusionResults.Num());
+		EventOnPoll(BlueprintTerrainResults, BlueprintOcclusionResults);
+	}
+}
+
+FExteriorWindFeatures UExteriorWindAudioComponent::ComputeWindFeatures(TArrayView<const float> TerrainLengths, TArrayView<const float> OcclusionLengths, const float TraceLength)
+{
+	FExteriorWindFeatures Features;
+	if(TraceLength <= 0.0f) {return Features; }
+	const float InverseTraceLength {1.0f / TraceLength};
+
+	/** Returns the mean and variance of a set of normalized trace lengths. */
+	auto GetMeanAndVariance = [InverseTraceLength](TArrayView<const float> Lengths, float& OutMean, float& OutVariance)
+	{
+		OutMean = 0.0f;
+		OutVariance = 0.0f;
+		if(Lengths.Num() == 0) {return; }
+		
+		float Sum {0.0f};
+		float SquaredSum {0.0f};
+		for(const float Length : Lengths)
+		{
+			const float Value {Length * InverseTraceLength};
+			Sum += Value;
+			SquaredSum += Value * Value;
+		}
+		OutMean = Sum / Lengths.Num();
+		OutVariance = FMath::Max(SquaredSum / Lengths.Num() - OutMean * OutMean, 0.0f);
+	};
+
+	float OcclusionMean {0.0f};
+	GetMeanAndVariance(TerrainLengths, Features.Openness, Features.OpennessVariance);
+	GetMeanAndVariance(OcclusionLengths, OcclusionMean, Features.OcclusionVariance);
+	Features.Occlusion = 1.0f - OcclusionMean;
+
+	/** The pan is the difference in occlusion between the right and left column of the occlusion grid. */
+	if(OcclusionLengths.Num() == OcclusionTraceCount)
+	{
+		float LeftOpenness {0.0f};
+		float RightOpenness {0.0f};
+		for (int32 i {0}; i < OcclusionTraceCount; i++)
 		{
-			const float TraceLength {static_cast<float>((TraceEnd - TraceStart).Size())};
-			TraceLengths.Add(TraceLength);
+			const int32 Column {OcclusionTraceOffsets[i][0]};
+			if(Column < 0)
+			{
+				LeftOpenness += OcclusionLengths[i] * InverseTraceLength;
+			}
+			else if(Column > 0)
+			{
+				RightOpenness += OcclusionLengths[i] * InverseTraceLength;
+			}
 		}
+		Features.OcclusionPan = FMath::Clamp((LeftOpenness - RightOpenness) / 3.0f, -1.0f, 1.0f);
+	}
+	return Features;
+}
+
+TArray<float> UExteriorWindAudioComponent::DoTerrainCollisionQuery(const FVector& Location)
+{
+	TArray<float> TraceLengths;
+	TraceLengths.Reserve(TerrainTraceEndVectors.Num());
+	for (int i {0}; i < TerrainTraceEndVectors.Num(); i++)
+	{
+		TraceLengths.Add(DoSingleTrace(Location, Location + TerrainTraceEndVectors[i]));
+	}
+	INC_DWORD_STAT_BY(STAT_WindTracesThisFrame, TraceLengths.Num());
+	IssuedTraceCount += TraceLengths.Num();
+	return TraceLengths;
+}
+
+TArray<float> UExteriorWindAudioComponent::DoOcclusionCollisionQuery(const FVector& Location)
+{
+	TArray<float> TraceLengths;
+	TraceLengths.Reserve(OcclusionTraceCount);
+	for (int i {0}; i < OcclusionTraceCount; i++)
+	{
+		TraceLengths.Add(DoSingleTrace(Location + GetOcclusionTraceStart(i), Location + GetOcclusionTraceEnd(i)));
 	}
+	INC_DWORD_STAT_BY(STAT_WindTracesThisFrame, TraceLengths.Num());
+	IssuedTraceCount += TraceLengths.Num();
 	return TraceLengths;
 }
 
+float UExteriorWindAudioComponent::DoSingleTrace(const FVector& TraceStart, const FVector& TraceEnd) const
+{
+	FHitResult HitResult;
+	FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
+	Params.bTraceComplex = false;
+	Params.bReturnPhysicalMaterial = false;
+
+	const bool IsHit {GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECC_Visibility, Params)};
+	return GetTraceLength(TraceStart, TraceEnd, IsHit ? &HitResult : nullptr);
+}
+
+float UExteriorWindAudioComponent::GetTraceLength(const FVector& TraceStart, const FVector& TraceEnd, const FHitResult* HitResult)
+{
+	if(HitResult)
+	{
+		return static_cast<float>((HitResult->ImpactPoint - TraceStart).Size());
+	}
+	return static_cast<float>((TraceEnd - TraceStart).Size());
+}
+
 float UExteriorWindAudioComponent::GetAverageOfFloatArray(const TArray<float>& Array) const
 {
 	float Sum {0.0f};
@@ -133,10 +572,30 @@ float UExteriorWindAudioComponent::GetAverageOfFloatArray(const TArray<float>& A
 	return Sum;
 }
 
+void UExteriorWindAudioComponent::PopulateOcclusionTraceTable()
+{
+	WindDirectionCount = FMath::Max(WindDirectionCount, 1);
+	OcclusionTraceStartTable.Reset(WindDirectionCount * OcclusionTraceCount);
+	OcclusionTraceEndTable.Reset(WindDirectionCount * OcclusionTraceCount);
+
+	TArray<FVector> StartVectors;
+	TArray<FVector> EndVectors;
+	for (int32 Direction {0}; Direction < WindDirectionCount; Direction++)
+	{
+		PopulateOcclusionTraceVectors(StartVectors, EndVectors, UExteriorWindFieldData::GetDirectionRotation(Direction, WindDirectionCount),
+			CollisionTraceLength, OcclusionTraceSpacing);
+		OcclusionTraceStartTable.Append(StartVectors);
+		OcclusionTraceEndTable.Append(EndVectors);
+	}
+}
+
 /** Populates the terrain trace array. */
 void UExteriorWindAudioComponent::PopulateTerrainTraceVectors(TArray<FVector>& Array, const FRotator& Rotation, const float Radius, const float NumPoints)
 {
 	const float AngleIncrement {2.f * PI / NumPoints};
+
+	/** Empty the array, so repeated calls do not grow the trace pattern. */
+	Array.Reset(NumPoints);
 	
 	for (int i = 0; i < NumPoints; i++)
 	{
@@ -155,22 +614,13 @@ void UExteriorWindAudioComponent::PopulateOcclusionTraceVectors(TArray<FVector>&
 	ArrayA.Empty();
 	ArrayB.Empty();
 	
-	/** Create an array of occlusion trace offsets. */
-	TArray<FVector2D> Offsets {FVector2D()};
-	Offsets.Add(FVector2D(-1, -1));
-	Offsets.Add(FVector2D(0, -1));
-	Offsets.Add(FVector2D(1, -1));
-	Offsets.Add(FVector2D(-1, 0));
-	Offsets.Add(FVector2D(0, 0));
-	Offsets.Add(FVector2D(1, 0));
-	Offsets.Add(FVector2D(-1, 1));
-	Offsets.Add(FVector2D(0, 1));
-	Offsets.Add(FVector2D(1, 1));
+	ArrayA.Reserve(OcclusionTraceCount);
+	ArrayB.Reserve(OcclusionTraceCount);
 
 	/** Populate Array A. */
-	for (const FVector2D Offset : Offsets)
+	for (const auto& Offset : OcclusionTraceOffsets)
 	{
-		const FVector Vector {Rotation.RotateVector(FVector(0, Offset.X * Spacing,Offset.Y * Spacing))};
+		const FVector Vector {Rotation.RotateVector(FVector(0, Offset[0] * Spacing, Offset[1] * Spacing))};
 		ArrayA.Add(Vector);
 	}
 
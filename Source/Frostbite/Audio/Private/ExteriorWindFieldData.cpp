@@ -0,0 +1,100 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "ExteriorWindFieldData.h"
+
+bool UExteriorWindFieldData::IsValidField() const
+{
+	const int32 NumPoints {Resolution.X * Resolution.Y * Resolution.Z};
+	return NumPoints > 0 && DirectionCount > 0 && CellSize > 0.0f
+		&& TerrainSamples.Num() == NumPoints * TerrainTraceCount
+		&& OcclusionSamples.Num() == NumPoints * DirectionCount * OcclusionTraceCount;
+}
+
+bool UExteriorWindFieldData::IsInsideBounds(const FVector& Location) const
+{
+	const FVector Extent {FVector(Resolution - FIntVector(1)) * CellSize};
+	const FVector Local {Location - Origin};
+	return Local.X >= 0.0 && Local.Y >= 0.0 && Local.Z >= 0.0
+		&& Local.X <= Extent.X && Local.Y <= Extent.Y && Local.Z <= Extent.Z;
+}
+
+bool UExteriorWindFieldData::SampleTerrain(const FVector& Location, TArrayView<float> OutLengths) const
+{
+	return SampleChannels(TerrainSamples, TerrainTraceCount, 0, Location, OutLengths, TerrainTraceCount);
+}
+
+bool UExteriorWindFieldData::SampleOcclusion(const FVector& Location, const int32 DirectionIndex, TArrayView<float> OutLengths) const
+{
+	if(DirectionIndex < 0 || DirectionIndex >= DirectionCount) {return false; }
+	return SampleChannels(OcclusionSamples, DirectionCount * OcclusionTraceCount, DirectionIndex * OcclusionTraceCount, Location, OutLengths, OcclusionTraceCount);
+}
+
+bool UExteriorWindFieldData::SampleChannels(const TArray<uint8>& Samples, const int32 Stride, const int32 Offset, const FVector& Location,
+	TArrayView<float> OutLengths, const int32 NumChannels) const
+{
+	if(!IsValidField() || !IsInsideBounds(Location) || OutLengths.Num() < NumChannels) {return false; }
+
+	/** Find the grid cell that contains the location and the fractional position within that cell. */
+	const FVector Local {(Location - Origin) / CellSize};
+	int32 Cell[3];
+	float Alpha[3];
+	for (int32 Axis {0}; Axis < 3; Axis++)
+	{
+		const int32 MaxCell {FMath::Max(Resolution[Axis] - 2, 0)};
+		Cell[Axis] = FMath::Clamp(FMath::FloorToInt32(Local[Axis]), 0, MaxCell);
+		Alpha[Axis] = Resolution[Axis] > 1 ? FMath::Clamp(static_cast<float>(Local[Axis]) - Cell[Axis], 0.0f, 1.0f) : 0.0f;
+	}
+
+	for (int32 Channel {0}; Channel < NumChannels; Channel++)
+	{
+		OutLengths[Channel] = 0.0f;
+	}
+
+	/** Accumulate the weighted contribution of the eight corners of the cell. */
+	for (int32 Corner {0}; Corner < 8; Corner++)
+	{
+		const int32 DX {Corner & 1};
+		const int32 DY {(Corner >> 1) & 1};
+		const int32 DZ {(Corner >> 2) & 1};
+		const float Weight {(DX ? Alpha[0] : 1.0f - Alpha[0]) * (DY ? Alpha[1] : 1.0f - Alpha[1]) * (DZ ? Alpha[2] : 1.0f - Alpha[2])};
+		if(Weight <= 0.0f) {continue; }
+
+		const int32 X {FMath::Min(Cell[0] + DX, Resolution.X - 1)};
+		const int32 Y {FMath::Min(Cell[1] + DY, Resolution.Y - 1)};
+		const int32 Z {FMath::Min(Cell[2] + DZ, Resolution.Z - 1)};
+		const uint8* PointSamples {Samples.GetData() + GetPointIndex(X, Y, Z) * Stride + Offset};
+		for (int32 Channel {0}; Channel < NumChannels; Channel++)
+		{
+			OutLengths[Channel] += Weight * PointSamples[Channel];
+		}
+	}
+
+	const float Scale {TraceLength / 255.0f};
+	for (int32 Channel {0}; Channel < NumChannels; Channel++)
+	{
+		OutLengths[Channel] *= Scale;
+	}
+	return true;
+}
+
+int32 UExteriorWindFieldData::GetDirectionIndex(const FRotator& Rotation, const int32 NumDirections)
+{
+	if(NumDirections <= 0) {return 0; }
+	const float Step {360.0f / NumDirections};
+	const int32 Index {FMath::RoundToInt32(static_cast<float>(FRotator::ClampAxis(Rotation.Yaw)) / Step)};
+	return Index % NumDirections;
+}
+
+FRotator UExteriorWindFieldData::GetDirectionRotation(const int32 DirectionIndex, const int32 NumDirections)
+{
+	if(NumDirections <= 0) {return FRotator::ZeroRotator; }
+	return FRotator(0.0, DirectionIndex * 360.0 / NumDirections, 0.0);
+}
+
+uint8 UExteriorWindFieldData::QuantizeTraceLength(const float Length, const float MaxLength)
+{
+	if(MaxLength <= 0.0f) {return 0; }
+	return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Length / MaxLength * 255.0f), 0, 255));
+}
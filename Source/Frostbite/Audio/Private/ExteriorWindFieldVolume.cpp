@@ -0,0 +1,129 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "ExteriorWindFieldVolume.h"
+#include "ExteriorWindAudioComponent.h"
+#include "ExteriorWindFieldData.h"
+#include "LogCategories.h"
+
+#include "Components/BoxComponent.h"
+#include "Misc/ScopedSlowTask.h"
+
+/** Sets default values for this actor's properties. */
+AExteriorWindFieldVolume::AExteriorWindFieldVolume()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	
+	Bounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bounds"));
+	Bounds->SetBoxExtent(FVector(2500.0, 2500.0, 500.0));
+	Bounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Bounds->SetGenerateOverlapEvents(false);
+	Bounds->bIsEditorOnly = true;
+	RootComponent = Bounds;
+	
+	bIsEditorOnlyActor = true;
+}
+
+#if WITH_EDITOR
+void AExteriorWindFieldVolume::BakeWindField()
+{
+	UWorld* World {GetWorld()};
+	if(!World || !WindField)
+	{
+		UE_LOG(LogExteriorWindAudio, Warning, TEXT("Could not bake wind field for %s: no world or no wind field asset assigned."), *GetName());
+		return;
+	}
+
+	/** The grid is axis aligned and spans the world space bounds of the box. */
+	const FBox Box {Bounds->Bounds.GetBox()};
+	const FVector Size {Box.GetSize()};
+	const FIntVector Resolution {
+		FMath::Max(FMath::FloorToInt32(Size.X / CellSize) + 1, 1),
+		FMath::Max(FMath::FloorToInt32(Size.Y / CellSize) + 1, 1),
+		FMath::Max(FMath::FloorToInt32(Size.Z / CellSize) + 1, 1)};
+	const int32 NumPoints {Resolution.X * Resolution.Y * Resolution.Z};
+
+	/** Build the trace patterns. The terrain pattern is independent of the wind direction. */
+	TArray<FVector> TerrainTraceEndVectors;
+	UExteriorWindAudioComponent::PopulateTerrainTraceVectors(TerrainTraceEndVectors, FRotator::ZeroRotator, TraceLength, UExteriorWindAudioComponent::TerrainTraceCount);
+
+	TArray<TArray<FVector>> OcclusionTraceStartVectors;
+	TArray<TArray<FVector>> OcclusionTraceEndVectors;
+	OcclusionTraceStartVectors.SetNum(DirectionCount);
+	OcclusionTraceEndVectors.SetNum(DirectionCount);
+	for (int32 Direction {0}; Direction < DirectionCount; Direction++)
+	{
+		UExteriorWindAudioComponent::PopulateOcclusionTraceVectors(OcclusionTraceStartVectors[Direction], OcclusionTraceEndVectors[Direction],
+			UExteriorWindFieldData::GetDirectionRotation(Direction, DirectionCount), TraceLength, UExteriorWindAudioComponent::OcclusionTraceSpacing);
+	}
+	const int32 OcclusionTraceCount {OcclusionTraceStartVectors.Num() > 0 ? OcclusionTraceStartVectors[0].Num() : 0};
+
+	WindField->Modify();
+	WindField->Origin = Box.Min;
+	WindField->Resolution = Resolution;
+	WindField->CellSize = CellSize;
+	WindField->DirectionCount = DirectionCount;
+	WindField->TraceLength = TraceLength;
+	WindField->TerrainTraceCount = TerrainTraceEndVectors.Num();
+	WindField->OcclusionTraceCount = OcclusionTraceCount;
+	WindField->TerrainSamples.SetNumZeroed(NumPoints * TerrainTraceEndVectors.Num());
+	WindField->OcclusionSamples.SetNumZeroed(NumPoints * DirectionCount * OcclusionTraceCount);
+
+	FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
+	Params.bTraceComplex = false;
+	Params.bReturnPhysicalMaterial = false;
+
+	/** Returns the quantized length of a single trace. */
+	auto QuantizedTrace = [&](const FVector& TraceStart, const FVector& TraceEnd) -> uint8
+	{
+		FHitResult HitResult;
+		const float Length {World->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECC_Visibility, Params)
+			? static_cast<float>((HitResult.ImpactPoint - TraceStart).Size())
+			: static_cast<float>((TraceEnd - TraceStart).Size())};
+		return UExteriorWindFieldData::QuantizeTraceLength(Length, TraceLength);
+	};
+
+	FScopedSlowTask SlowTask {static_cast<float>(NumPoints), FText::FromString(TEXT("Baking exterior wind field..."))};
+	SlowTask.MakeDialog(true);
+
+	int32 PointIndex {0};
+	for (int32 Z {0}; Z < Resolution.Z; Z++)
+	{
+		for (int32 Y {0}; Y < Resolution.Y; Y++)
+		{
+			for (int32 X {0}; X < Resolution.X; X++, PointIndex++)
+			{
+				if(SlowTask.ShouldCancel())
+				{
+					UE_LOG(LogExteriorWindAudio, Warning, TEXT("Wind field bake for %s was cancelled, the asset is incomplete."), *GetName());
+					return;
+				}
+				SlowTask.EnterProgressFrame(1.0f);
+				
+				const FVector Location {Box.Min + FVector(X, Y, Z) * CellSize};
+
+				uint8* TerrainSamples {WindField->TerrainSamples.GetData() + PointIndex * TerrainTraceEndVectors.Num()};
+				for (int32 i {0}; i < TerrainTraceEndVectors.Num(); i++)
+				{
+					TerrainSamples[i] = QuantizedTrace(Location, Location + TerrainTraceEndVectors[i]);
+				}
+
+				uint8* OcclusionSamples {WindField->OcclusionSamples.GetData() + PointIndex * DirectionCount * OcclusionTraceCount};
+				for (int32 Direction {0}; Direction < DirectionCount; Direction++)
+				{
+					for (int32 i {0}; i < OcclusionTraceCount; i++)
+					{
+						OcclusionSamples[Direction * OcclusionTraceCount + i] = QuantizedTrace(Location + OcclusionTraceStartVectors[Direction][i],
+							Location + OcclusionTraceEndVectors[Direction][i]);
+					}
+				}
+			}
+		}
+	}
+
+	WindField->MarkPackageDirty();
+	UE_LOG(LogExteriorWindAudio, Log, TEXT("Baked wind field for %s: %d points, %d directions, %d bytes."), *GetName(), NumPoints, DirectionCount,
+		WindField->TerrainSamples.Num() + WindField->OcclusionSamples.Num());
+}
+#endif
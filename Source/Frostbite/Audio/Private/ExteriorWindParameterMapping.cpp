@@ -0,0 +1,36 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "ExteriorWindParameterMapping.h"
+
+#include "Components/AudioComponent.h"
+
+float FExteriorWindFeatures::GetFeature(const EExteriorWindFeature Feature) const
+{
+	switch(Feature)
+	{
+	case EExteriorWindFeature::Openness: return Openness;
+	case EExteriorWindFeature::OpennessVariance: return OpennessVariance;
+	case EExteriorWindFeature::Occlusion: return Occlusion;
+	case EExteriorWindFeature::OcclusionVariance: return OcclusionVariance;
+	case EExteriorWindFeature::OcclusionPan: return OcclusionPan;
+	default: return 0.0f;
+	}
+}
+
+void UExteriorWindParameterMapping::ApplyToAudioComponent(UAudioComponent* AudioComponent, const FExteriorWindFeatures& Features) const
+{
+	if(!AudioComponent)
+	{
+		return;
+	}
+
+	for(const FExteriorWindParameterBinding& Binding : Bindings)
+	{
+		if(Binding.ParameterName.IsNone()) {continue; }
+
+		const float Value {static_cast<float>(FMath::GetMappedRangeValueClamped(Binding.InputRange, Binding.OutputRange, Features.GetFeature(Binding.Feature)))};
+		AudioComponent->SetFloatParameter(Binding.ParameterName, Value);
+	}
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "ExteriorWindPollCache.h"
+
+void FExteriorWindPollCache::Initialize(const int32 MaxEntries, const int32 Stride)
+{
+	EntryStride = FMath::Max(Stride, 0);
+	const int32 NumSlots {FMath::Max(MaxEntries, 0)};
+
+	SlotMap.Empty(NumSlots);
+	SlotKeys.SetNum(NumSlots);
+	SlotResults.SetNumZeroed(NumSlots * EntryStride);
+	PreviousSlots.Init(INDEX_NONE, NumSlots);
+	NextSlots.Init(INDEX_NONE, NumSlots);
+	MostRecentSlot = INDEX_NONE;
+	LeastRecentSlot = INDEX_NONE;
+	NumUsedSlots = 0;
+	HitCount = 0;
+	MissCount = 0;
+}
+
+void FExteriorWindPollCache::Empty()
+{
+	SlotMap.Reset();
+	for (int32 Slot {0}; Slot < SlotKeys.Num(); Slot++)
+	{
+		PreviousSlots[Slot] = INDEX_NONE;
+		NextSlots[Slot] = INDEX_NONE;
+	}
+	MostRecentSlot = INDEX_NONE;
+	LeastRecentSlot = INDEX_NONE;
+	NumUsedSlots = 0;
+}
+
+bool FExteriorWindPollCache::Find(const FExteriorWindPollCacheKey& Key, TArrayView<float> OutResults)
+{
+	const int32* Slot {SlotMap.Find(Key)};
+	if(!Slot || OutResults.Num() < EntryStride)
+	{
+		++MissCount;
+		return false;
+	}
+	++HitCount;
+
+	FMemory::Memcpy(OutResults.GetData(), SlotResults.GetData() + *Slot * EntryStride, EntryStride * sizeof(float));
+	Unlink(*Slot);
+	LinkAsMostRecent(*Slot);
+	return true;
+}
+
+void FExteriorWindPollCache::Add(const FExteriorWindPollCacheKey& Key, TArrayView<const float> Results)
+{
+	if(SlotKeys.Num() == 0 || Results.Num() < EntryStride) {return; }
+
+	int32 Slot {INDEX_NONE};
+	if(const int32* ExistingSlot {SlotMap.Find(Key)})
+	{
+		Slot = *ExistingSlot;
+		Unlink(Slot);
+	}
+	else if(NumUsedSlots < SlotKeys.Num())
+	{
+		Slot = NumUsedSlots++;
+		SlotMap.Add(Key, Slot);
+	}
+	else
+	{
+		/** The cache is full, so the least recently used entry is replaced. */
+		Slot = LeastRecentSlot;
+		Unlink(Slot);
+		SlotMap.Remove(SlotKeys[Slot]);
+		SlotMap.Add(Key, Slot);
+	}
+
+	SlotKeys[Slot] = Key;
+	FMemory::Memcpy(SlotResults.GetData() + Slot * EntryStride, Results.GetData(), EntryStride * sizeof(float));
+	LinkAsMostRecent(Slot);
+}
+
+void FExteriorWindPollCache::Unlink(const int32 Slot)
+{
+	const int32 Previous {PreviousSlots[Slot]};
+	const int32 Next {NextSlots[Slot]};
+	if(Previous != INDEX_NONE)
+	{
+		NextSlots[Previous] = Next;
+	}
+	else if(MostRecentSlot == Slot)
+	{
+		MostRecentSlot = Next;
+	}
+	if(Next != INDEX_NONE)
+	{
+		PreviousSlots[Next] = Previous;
+	}
+	else if(LeastRecentSlot == Slot)
+	{
+		LeastRecentSlot = Previous;
+	}
+	PreviousSlots[Slot] = INDEX_NONE;
+	NextSlots[Slot] = INDEX_NONE;
+}
+
+void FExteriorWindPollCache::LinkAsMostRecent(const int32 Slot)
+{
+	NextSlots[Slot] = MostRecentSlot;
+	if(MostRecentSlot != INDEX_NONE)
+	{
+		PreviousSlots[MostRecentSlot] = Slot;
+	}
+	MostRecentSlot = Slot;
+	if(LeastRecentSlot == INDEX_NONE)
+	{
+		LeastRecentSlot = Slot;
+	}
+}
+
+SIZE_T FExteriorWindPollCache::GetBytesPerEntry(const int32 Stride)
+{
+	/** Slot storage, plus an estimate of the hash map overhead for the key, the slot index and the hash bucket. */
+	return sizeof(FExteriorWindPollCacheKey) + Stride * sizeof(float) + 2 * sizeof(int32)
+		+ sizeof(FExteriorWindPollCacheKey) + sizeof(int32) + 4 * sizeof(int32);
+}
+
+SIZE_T FExteriorWindPollCache::GetAllocatedSize() const
+{
+	return SlotMap.GetAllocatedSize() + SlotKeys.GetAllocatedSize() + SlotResults.GetAllocatedSize()
+		+ PreviousSlots.GetAllocatedSize() + NextSlots.GetAllocatedSize();
+}
+
+float FExteriorWindPollCache::GetHitRate() const
+{
+	const uint64 LookupCount {HitCount + MissCount};
+	return LookupCount > 0 ? static_cast<float>(static_cast<double>(HitCount) / LookupCount) : 0.0f;
+}
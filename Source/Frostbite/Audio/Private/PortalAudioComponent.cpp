@@ -0,0 +1,83 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "PortalAudioComponent.h"
+#include "PortalAudioSubsystem.h"
+
+UPortalAudioComponent::UPortalAudioComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UPortalAudioComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/** The component is moved to the apparent location of the sound, so the source location is stored relative to the attach parent. */
+	SourceRelativeLocation = GetRelativeLocation();
+	if(!GetAttachParent())
+	{
+		SourceRelativeLocation = GetComponentLocation();
+	}
+	SetUsingAbsoluteLocation(true);
+	BaseVolumeMultiplier = VolumeMultiplier;
+
+	if(UPortalAudioSubsystem* Subsystem {GetWorld() ? GetWorld()->GetSubsystem<UPortalAudioSubsystem>() : nullptr})
+	{
+		Subsystem->RegisterComponent(this);
+	}
+}
+
+void UPortalAudioComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UPortalAudioSubsystem* Subsystem {GetWorld() ? GetWorld()->GetSubsystem<UPortalAudioSubsystem>() : nullptr})
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+FVector UPortalAudioComponent::GetSourceLocation() const
+{
+	if(!IsUsingAbsoluteLocation()) {return GetComponentLocation(); }
+	const USceneComponent* Parent {GetAttachParent()};
+	return Parent ? Parent->GetComponentTransform().TransformPosition(SourceRelativeLocation) : SourceRelativeLocation;
+}
+
+void UPortalAudioComponent::ApplyPropagation(const FPortalAudioPropagation& Propagation)
+{
+	if(!IsPortalPropagationEnabled || Propagation.PortalCount == 0)
+	{
+		ApplyDirect();
+		return;
+	}
+	IsPropagating = true;
+
+	if(Propagation.PortalCount == INDEX_NONE || Propagation.PortalCount > MaxPortalCount)
+	{
+		SetVolumeMultiplier(0.0f);
+		return;
+	}
+
+	/** Every portal attenuates and low-passes the sound, and the path length low-passes it further. */
+	const float PortalVolume {FMath::Pow(PortalVolumeScale, Propagation.PortalCount)};
+	const float PortalFrequency {MaxLowPassFrequency * FMath::Pow(PortalLowPassScale, Propagation.PortalCount)};
+	const float PathLengthScale {FMath::Pow(0.5f, Propagation.PathLength / PathLengthLowPassDistance)};
+	const float Frequency {FMath::Clamp(PortalFrequency * PathLengthScale, MinLowPassFrequency, MaxLowPassFrequency)};
+
+	SetWorldLocation(Propagation.ApparentLocation);
+	SetVolumeMultiplier(BaseVolumeMultiplier * PortalVolume);
+	SetLowPassFilterEnabled(true);
+	SetLowPassFilterFrequency(Frequency);
+}
+
+void UPortalAudioComponent::ApplyDirect()
+{
+	SetWorldLocation(GetSourceLocation());
+	if(!IsPropagating) {return; }
+
+	SetVolumeMultiplier(BaseVolumeMultiplier);
+	SetLowPassFilterEnabled(false);
+	IsPropagating = false;
+}
@@ -0,0 +1,221 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "PortalAudioSubsystem.h"
+#include "PortalAudioComponent.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
+#include "StatCategories.h"
+
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Portal Audio Tick"), STAT_PortalAudioTick, STATGROUP_PortalAudio);
+DECLARE_CYCLE_STAT(TEXT("Portal Audio Path Cache Fill"), STAT_PortalAudioPathCacheFill, STATGROUP_PortalAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Portal Audio Sources"), STAT_PortalAudioSources, STATGROUP_PortalAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Portal Audio Propagating Sources"), STAT_PortalAudioPropagatingSources, STATGROUP_PortalAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Portal Audio Cached Listener Rooms"), STAT_PortalAudioCachedListenerRooms, STATGROUP_PortalAudio);
+
+bool UPortalAudioSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPortalAudioSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** The cache is reset once the membership index has been rebuilt for the new graph, as the listener and source rooms are looked up in it. */
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.AddUObject(this, &UPortalAudioSubsystem::ResetPathCache);
+		RoomMembership->OnRoomMembershipChanged.AddDynamic(this, &UPortalAudioSubsystem::HandleRoomMembershipChanged);
+	}
+}
+
+void UPortalAudioSubsystem::Deinitialize()
+{
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.RemoveAll(this);
+		RoomMembership->OnRoomMembershipChanged.RemoveDynamic(this, &UPortalAudioSubsystem::HandleRoomMembershipChanged);
+	}
+	PathCache.Empty();
+	Sources.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UPortalAudioSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPortalAudioSubsystem, STATGROUP_PortalAudio);
+}
+
+void UPortalAudioSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalAudioTick);
+	if(Sources.Num() == 0 || !RoomMembership) {return; }
+
+	const APlayerController* PlayerController {GetWorld()->GetFirstPlayerController()};
+	if(!PlayerController) {return; }
+
+	FVector ListenerLocation {FVector::ZeroVector};
+	FVector ListenerFront {FVector::ForwardVector};
+	FVector ListenerRight {FVector::RightVector};
+	PlayerController->GetAudioListenerPosition(ListenerLocation, ListenerFront, ListenerRight);
+
+	int32 PropagatingSources {0};
+	for (int32 i {Sources.Num() - 1}; i >= 0; i--)
+	{
+		UPortalAudioComponent* Component {Sources[i].Component.Get()};
+		if(!Component)
+		{
+			Sources.RemoveAtSwap(i);
+			continue;
+		}
+		if(!Component->IsPlaying()) {continue; }
+		if(!Component->IsPortalPropagationEnabled)
+		{
+			Component->ApplyDirect();
+			continue;
+		}
+
+		/** The previous room of the source is tested first, which makes the lookup constant time for sources that stay in their room. */
+		const FVector SourceLocation {Component->GetSourceLocation()};
+		Sources[i].RoomId = RoomMembership->FindRoomId(SourceLocation, Sources[i].RoomId);
+
+		FPortalAudioPropagation Propagation;
+		if(GetPropagation(SourceLocation, Sources[i].RoomId, ListenerLocation, Propagation))
+		{
+			++PropagatingSources;
+		}
+		Component->ApplyPropagation(Propagation);
+	}
+	SET_DWORD_STAT(STAT_PortalAudioSources, Sources.Num());
+	SET_DWORD_STAT(STAT_PortalAudioPropagatingSources, PropagatingSources);
+}
+
+void UPortalAudioSubsystem::RegisterComponent(UPortalAudioComponent* Component)
+{
+	if(!Component || Sources.ContainsByPredicate([Component](const FPortalAudioSource& Source) {return Source.Component.Get() == Component; })) {return; }
+
+	FPortalAudioSource& Source {Sources.AddDefaulted_GetRef()};
+	Source.Component = Component;
+	Source.RoomId = RoomMembership ? RoomMembership->FindRoomId(Component->GetSourceLocation()) : INDEX_NONE;
+}
+
+void UPortalAudioSubsystem::UnregisterComponent(UPortalAudioComponent* Component)
+{
+	const int32 Index {Sources.IndexOfByPredicate([Component](const FPortalAudioSource& Source) {return Source.Component.Get() == Component; })};
+	if(Index != INDEX_NONE)
+	{
+		Sources.RemoveAtSwap(Index);
+	}
+}
+
+bool UPortalAudioSubsystem::GetPropagation(const FVector& SourceLocation, const int32 SourceRoomId, const FVector& ListenerLocation, FPortalAudioPropagation& OutPropagation)
+{
+	OutPropagation.PortalCount = 0;
+	OutPropagation.PathLength = FVector::Dist(SourceLocation, ListenerLocation);
+	OutPropagation.ApparentLocation = SourceLocation;
+
+	/** Sounds in the same room as the listener, and sounds or listeners outside of any room, reach the listener directly. */
+	if(!RoomGraph || SourceRoomId == ListenerRoomId || !RoomGraph->IsValidRoomId(SourceRoomId) || !RoomGraph->IsValidRoomId(ListenerRoomId)) {return false; }
+
+	const FPortalAudioPath& Path {GetPathsToListenerRoom(ListenerRoomId)[SourceRoomId]};
+	OutPropagation.PortalCount = Path.PortalCount;
+	if(Path.PortalCount == INDEX_NONE) {return true; }
+
+	const float ListenerPortalDistance {static_cast<float>(FVector::Dist(Path.ListenerPortal, ListenerLocation))};
+	OutPropagation.PathLength = FVector::Dist(SourceLocation, Path.SourcePortal) + Path.PortalPathLength + ListenerPortalDistance;
+
+	/** The sound is placed in the direction of the portal closest to the listener, at the full path length, so that distance attenuation matches the travelled path. */
+	const FVector PortalDirection {ListenerPortalDistance > KINDA_SMALL_NUMBER ? (Path.ListenerPortal - ListenerLocation) / ListenerPortalDistance : FVector::ZeroVector};
+	OutPropagation.ApparentLocation = ListenerLocation + PortalDirection * OutPropagation.PathLength;
+	return true;
+}
+
+void UPortalAudioSubsystem::ResetPathCache()
+{
+	PathCache.Reset();
+	if(RoomGraph)
+	{
+		PathCache.SetNum(RoomGraph->GetRoomCount());
+	}
+	SET_DWORD_STAT(STAT_PortalAudioCachedListenerRooms, 0);
+
+	const UPlayerSubsystem* PlayerSubsystem {GetWorld()->GetSubsystem<UPlayerSubsystem>()};
+	ListenerRoomId = PlayerSubsystem && RoomMembership ? RoomMembership->GetActorRoomId(PlayerSubsystem->GetPlayerCharacter()) : INDEX_NONE;
+
+	/** Room IDs are only valid until the graph is rebuilt, so the rooms of all sources are looked up again. */
+	for (FPortalAudioSource& Source : Sources)
+	{
+		const UPortalAudioComponent* Component {Source.Component.Get()};
+		Source.RoomId = Component && RoomMembership ? RoomMembership->FindRoomId(Component->GetSourceLocation()) : INDEX_NONE;
+	}
+}
+
+const TArray<FPortalAudioPath>& UPortalAudioSubsystem::GetPathsToListenerRoom(const int32 RoomId)
+{
+	TArray<FPortalAudioPath>& Paths {PathCache[RoomId]};
+	if(Paths.Num() > 0) {return Paths; }
+
+	SCOPE_CYCLE_COUNTER(STAT_PortalAudioPathCacheFill);
+	const int32 RoomCount {RoomGraph->GetRoomCount()};
+	Paths.SetNum(RoomCount);
+
+	TArray<int32> RoomPath;
+	TArray<FVector> Portals;
+	for (int32 SourceRoomId {0}; SourceRoomId < RoomCount; SourceRoomId++)
+	{
+		FPortalAudioPath& Path {Paths[SourceRoomId]};
+		if(SourceRoomId == RoomId)
+		{
+			Path.PortalCount = 0;
+			continue;
+		}
+		if(!RoomGraph->GetPath(SourceRoomId, RoomId, RoomPath)) {continue; }
+
+		/** Every connection on the path is a portal the sound passes through. */
+		Portals.Reset(RoomPath.Num() - 1);
+		for (int32 i {0}; i < RoomPath.Num() - 1; i++)
+		{
+			FVector Portal {FVector::ZeroVector};
+			RoomGraph->GetPortalLocation(RoomPath[i], RoomPath[i + 1], Portal);
+			Portals.Add(Portal);
+		}
+		if(Portals.Num() == 0) {continue; }
+
+		Path.PortalCount = Portals.Num();
+		Path.SourcePortal = Portals[0];
+		Path.ListenerPortal = Portals.Last();
+		for (int32 i {1}; i < Portals.Num(); i++)
+		{
+			Path.PortalPathLength += FVector::Dist(Portals[i - 1], Portals[i]);
+		}
+	}
+
+	int32 CachedListenerRooms {0};
+	for (const TArray<FPortalAudioPath>& Row : PathCache)
+	{
+		CachedListenerRooms += Row.Num() > 0 ? 1 : 0;
+	}
+	SET_DWORD_STAT(STAT_PortalAudioCachedListenerRooms, CachedListenerRooms);
+	return Paths;
+}
+
+void UPortalAudioSubsystem::HandleRoomMembershipChanged(AActor* Actor, ARoomVolume* PreviousRoom, ARoomVolume* NewRoom)
+{
+	if(!RoomGraph || !Actor || !Actor->IsA<APlayerCharacter>()) {return; }
+
+	/** Paths are only computed when the listener enters a room it has not been in before. Otherwise, the cached paths are reused. */
+	ListenerRoomId = RoomGraph->GetRoomId(NewRoom);
+	if(RoomGraph->IsValidRoomId(ListenerRoomId) && PathCache.IsValidIndex(ListenerRoomId))
+	{
+		GetPathsToListenerRoom(ListenerRoomId);
+	}
+}
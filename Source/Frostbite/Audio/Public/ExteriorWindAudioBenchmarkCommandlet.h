@@ -0,0 +1,64 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ExteriorWindAudioComponent.h"
+#include "ExteriorWindAudioBenchmarkCommandlet.generated.h"
+
+/** Struct containing the measured cost of the exterior wind audio component for a single poll mode. */
+struct FExteriorWindBenchmarkResult
+{
+	FString ModeName;
+	uint32 PollCount {0};
+	uint32 TraceCount {0};
+	uint64 AllocationCount {0};
+	double MedianMicroseconds {0.0};
+	double P99Microseconds {0.0};
+	double SimulatedSeconds {0.0};
+};
+
+/** The exterior wind audio component is abstract. This minimal concrete class is benchmarked when no component class is passed to the commandlet.
+ *	@Brief Concrete exterior wind audio component without sound or parameter mapping, used by the benchmark commandlet.
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class UExteriorWindAudioBenchmarkComponent : public UExteriorWindAudioComponent
+{
+	GENERATED_BODY()
+};
+
+/** Commandlet that measures the cost of the exterior wind audio component.
+ *	The component is moved along a scripted path through a procedurally generated obstacle field in a transient world.
+ *	For every poll mode, the traces per poll, the game thread time per poll and the allocations per poll are reported.
+ *	Run with: UnrealEditor-Cmd Frostbite -run=ExteriorWindAudioBenchmark -nullrhi -nosound [-Mode=Synchronous|Asynchronous|TimeSliced] [-Seconds=120] [-Seed=1337] [-Obstacles=400] [-NoCache] [-Csv=Path]
+ *	[-Class=/Game/Path/BP_WindComponent.BP_WindComponent_C]
+ *	@Brief Headless benchmark for the exterior wind audio component.
+ */
+UCLASS()
+class UExteriorWindAudioBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	/** Constructor with default values. */
+	UExteriorWindAudioBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** Spawns a field of randomly placed and scaled boxes around the path. */
+	static void SpawnObstacleField(UWorld* World, const FRandomStream& Random, const int32 NumObstacles, const float FieldExtent);
+
+	/** Returns the location on the scripted path at a distance along the path. The path is a closed loop that passes through the obstacle field. */
+	static FVector GetPathLocation(const float Distance, const float FieldExtent);
+
+	/** Runs the benchmark for a single poll mode. */
+	static FExteriorWindBenchmarkResult RunBenchmark(UWorld* World, const TSubclassOf<UExteriorWindAudioComponent> ComponentClass, const EWindPollMode PollMode,
+		const float Duration, const float FieldExtent, const bool EnableCache);
+
+	/** Writes the results of all runs to the log and optionally to a CSV file. */
+	static void ReportResults(const TArray<FExteriorWindBenchmarkResult>& Results, const FString& CsvPath);
+};
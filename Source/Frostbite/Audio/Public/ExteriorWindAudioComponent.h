@@ -6,9 +6,23 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "WorldCollision.h"
+#include "ExteriorWindParameterMapping.h"
+#include "ExteriorWindPollCache.h"
 #include "ExteriorWindAudioComponent.generated.h"
 
 class UMetaSoundSource;
+class UExteriorWindFieldData;
+class UExteriorWindParameterMapping;
+
+/** Enum for defining how the collision queries of a poll are performed. */
+UENUM(BlueprintType)
+enum class EWindPollMode : uint8
+{
+	Synchronous		UMETA(DisplayName = "Synchronous", ToolTip = "All traces of a poll are performed on the game thread in the frame the poll is triggered."),
+	Asynchronous	UMETA(DisplayName = "Asynchronous", ToolTip = "All traces of a poll are submitted as one batch to the async trace interface and gathered in the next frame."),
+	TimeSliced		UMETA(DisplayName = "Time Sliced", ToolTip = "The traces of a poll are spread over multiple frames, limited by a per-frame trace budget."),
+};
 
 UCLASS(Abstract, Blueprintable, BlueprintType, ClassGroup = (Audio), Meta = (BlueprintSpawnableComponent) )
 class UExteriorWindAudioComponent : public UActorComponent
@@ -16,14 +30,86 @@ class UExteriorWindAudioComponent : public UActorComponent
 	GENERATED_BODY()
 
 public:
+	/** The number of terrain traces performed per poll. */
+	static constexpr int32 TerrainTraceCount {8};
+
+	/** The number of occlusion traces performed per poll. The traces are laid out on a 3x3 grid perpendicular to the wind direction. */
+	static constexpr int32 OcclusionTraceCount {9};
+
+	/** The spacing between the occlusion traces performed per poll. */
+	static constexpr float OcclusionTraceSpacing {250.0f};
+	
 	/** The direction of the wind component, This will dictate in which direction the collision queries will be performed. Treat this value as the world rotation of this component. */
 	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Direction"))
 	FRotator WindDirection {FRotator(0, 0, 0)};
 
+	/** The number of quantized wind directions to precompute the occlusion trace pattern for. Only the yaw of the wind direction is taken into account. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Wind Direction Count", ClampMin = "1", ClampMax = "360", UIMin = "1", UIMax = "360"))
+	int32 WindDirectionCount {64};
+
 	/** The trace length for the collision queries. */
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Collision Trace Length"))
 	float CollisionTraceLength {3000};
 
+	/** Defines how the collision queries of a poll are performed. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Poll Mode"))
+	EWindPollMode PollMode {EWindPollMode::Asynchronous};
+
+	/** The distance the owner has to move from the last poll location before a new poll is performed. Only used when adaptive polling is disabled. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Poll Distance", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float PollDistance {250.0f};
+
+	/** The maximum number of traces performed per frame when using the time sliced poll mode.
+	 *	A poll is complete once all terrain and occlusion traces have been performed. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Trace Budget Per Frame", EditCondition = "PollMode == EWindPollMode::TimeSliced", ClampMin = "1", UIMin = "1"))
+	int32 TraceBudgetPerFrame {4};
+
+	/** When enabled, the distance and time between polls adapt to the speed of the owner and to how much the wind features changed between the last two polls.
+	 *	Changing environments such as doorways are polled densely, while stable environments such as open fields are polled sparsely. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "Enable Adaptive Polling"))
+	bool IsAdaptivePollingEnabled {true};
+
+	/** The poll distance used when the wind features changed significantly between the last two polls. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "Min Poll Distance", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float MinPollDistance {100.0f};
+
+	/** The poll distance used when the wind features did not change between the last two polls. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "Max Poll Distance", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float MaxPollDistance {800.0f};
+
+	/** The change in wind features between two polls at which the environment is considered fully unstable. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "Change Threshold", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "0.01", UIMin = "0.01", UIMax = "1"))
+	float ChangeThreshold {0.2f};
+
+	/** The speed at which the poll distance is scaled by the high speed distance scale. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "High Speed", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "1", UIMin = "1", Units = "cm/s"))
+	float HighSpeed {600.0f};
+
+	/** The scale applied to the poll distance when the owner moves at high speed. Fast movement is polled more densely so that transitions stay tight. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "High Speed Distance Scale", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "0.1", ClampMax = "1", UIMin = "0.1", UIMax = "1"))
+	float HighSpeedDistanceScale {0.5f};
+
+	/** The minimum time between two polls. This caps the poll rate at very high speeds. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "Min Poll Interval", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "0", UIMin = "0", Units = "s"))
+	float MinPollInterval {0.1f};
+
+	/** The maximum time a poll result may be used before a new poll is performed, even if the owner did not move.
+	 *	This is shortened in unstable environments, so that changes in the wind direction or the level are picked up. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ExteriorWindAudioComponent|Scheduling", Meta = (DisplayName = "Max Staleness", EditCondition = "IsAdaptivePollingEnabled", ClampMin = "0.1", UIMin = "0.1", Units = "s"))
+	float MaxStaleness {4.0f};
+
+	/** When enabled, poll results are cached per location cell and wind direction. Polls that hit the cache skip all collision queries. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "ExteriorWindAudioComponent|Cache", Meta = (DisplayName = "Enable Poll Cache"))
+	bool IsPollCacheEnabled {true};
+
+	/** The size of a location cell of the poll cache. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "ExteriorWindAudioComponent|Cache", Meta = (DisplayName = "Cache Cell Size", EditCondition = "IsPollCacheEnabled", ClampMin = "50", UIMin = "50", Units = "cm"))
+	float PollCacheCellSize {250.0f};
+
+	/** The maximum amount of memory the poll cache may use. This determines the number of entries the cache can hold. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "ExteriorWindAudioComponent|Cache", Meta = (DisplayName = "Cache Memory Budget", EditCondition = "IsPollCacheEnabled", ClampMin = "1", UIMin = "1", Units = "KB"))
+	int32 PollCacheMemoryBudget {256};
+
 private:
 	/** The AudioComponent that is added to the owner of this actor to play wind audio on. */
 	UPROPERTY(BlueprintGetter = GetAudioComponent, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Audio Component"))
@@ -33,19 +119,109 @@ private:
 	UPROPERTY(EditAnywhere, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "MetaSound Asset"))
 	TSoftObjectPtr<UMetaSoundSource> MetaSoundAsset;
 
+	/** The baked wind field to sample instead of performing collision queries. Polls outside of the baked bounds fall back to collision queries. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Baked Wind Field"))
+	TSoftObjectPtr<UExteriorWindFieldData> WindFieldAsset;
+
+	/** Pointer to the loaded baked wind field. */
+	UPROPERTY()
+	UExteriorWindFieldData* WindField;
+
+	/** The mapping of wind features to MetaSound parameters. The mapped parameters are sent to the audio component after every poll. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Parameter Mapping"))
+	TSoftObjectPtr<UExteriorWindParameterMapping> ParameterMappingAsset;
+
+	/** Pointer to the loaded parameter mapping. */
+	UPROPERTY()
+	UExteriorWindParameterMapping* ParameterMapping;
+
+	/** The aggregate features of the last completed poll. */
+	UPROPERTY(BlueprintGetter = GetWindFeatures, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Wind Features"))
+	FExteriorWindFeatures WindFeatures;
+
 	/** The last poll location of the component. */
 	UPROPERTY()
 	FVector LastPollLocation;
 
+	/** The world time at which the last poll was started. */
+	float LastPollTime {0.0f};
+
+	/** The features of the poll before the last completed poll. Used to determine how much the environment changes. */
+	FExteriorWindFeatures PreviousWindFeatures;
+
+	/** How stable the environment is, derived from the change between the last two polls. 0 is fully unstable, 1 is fully stable. */
+	float Stability {0.0f};
+
+	/** Whether at least one poll has been completed. */
+	bool HasCompletedPoll {false};
+
+	/** The number of polls started in the current measurement window, and the start time of that window. */
+	int32 WindowPollCount {0};
+	float WindowStartTime {0.0f};
+
+	/** The number of polls per minute, measured over the last completed measurement window. */
+	float PollsPerMinute {0.0f};
+
+	/** The total number of completed polls and issued traces since the component was initialized. */
+	uint32 CompletedPollCount {0};
+	uint32 IssuedTraceCount {0};
+
 	/** The array of vectors to use for the terrain poll trace. */
 	UPROPERTY()
 	TArray<FVector> TerrainTraceEndVectors;
 
-	/** The arrays of vectors to use for the wind occlusion query. */
-	UPROPERTY()
-	TArray<FVector> OcclusionTraceStartVectors;
-	UPROPERTY()
-	TArray<FVector> OcclusionTraceEndVectors;
+	/** The precomputed occlusion trace patterns for every quantized wind direction, stored as [Direction][Trace]. */
+	TArray<FVector> OcclusionTraceStartTable;
+	TArray<FVector> OcclusionTraceEndTable;
+
+	/** The index of the quantized wind direction whose occlusion trace pattern is currently in use. */
+	int32 WindDirectionIndex {0};
+
+	/** The results of the terrain and occlusion traces of the current poll. These are fixed capacity buffers that never allocate,
+	 *	so a poll only ever uses the first TerrainTraceCount and OcclusionTraceCount trace vectors.
+	 *	When time slicing, these act as a rolling buffer in which the results of the current sweep replace those of the previous one. */
+	TArray<float, TFixedAllocator<TerrainTraceCount>> TerrainResults;
+	TArray<float, TFixedAllocator<OcclusionTraceCount>> OcclusionResults;
+
+	/** Copies of the poll results that are passed to the Blueprint poll event. These are only filled when the event is implemented. */
+	TArray<float> BlueprintTerrainResults;
+	TArray<float> BlueprintOcclusionResults;
+
+	/** Cache of poll results keyed by location cell and wind direction. */
+	FExteriorWindPollCache PollCache;
+
+	/** The location and wind direction of the traced poll that is currently in progress. Used to store its results in the poll cache. */
+	FVector TracedPollLocation {FVector::ZeroVector};
+	int32 TracedPollDirectionIndex {0};
+
+	/** Whether the Blueprint poll event is implemented by the class of this component. */
+	bool IsPollEventImplemented {false};
+
+	/** The delegate that is called by the async trace interface when one of the traces of an async poll completes. */
+	FTraceDelegate AsyncTraceDelegate;
+
+	/** The number of async traces that have not yet returned for the current poll. */
+	int32 PendingAsyncTraceCount {0};
+
+	/** Identifier of the current async poll. Results of superseded polls are discarded. */
+	uint16 AsyncPollId {0};
+
+	/** The time in seconds at which the current async poll was submitted. */
+	double AsyncPollStartTime {0.0};
+
+	/** The frame number in which the current async poll was submitted. */
+	uint64 AsyncPollStartFrame {0};
+
+	/** The location of the time sliced sweep that is currently in progress. */
+	FVector TimeSlicedPollLocation {FVector::ZeroVector};
+
+	/** The index of the next trace of the time sliced sweep. INDEX_NONE if no sweep is in progress. */
+	int32 TimeSlicedTraceIndex {INDEX_NONE};
+
+	/** The number of terrain and occlusion traces of the time sliced sweep, taken when the sweep started.
+	 *	The trace vectors can change while a sweep is in progress, which must not change the layout of the results. */
+	int32 TimeSlicedTerrainTraceCount {0};
+	int32 TimeSlicedOcclusionTraceCount {0};
 	
 public:	
 	/** Sets default values for this component's properties. */
@@ -54,11 +230,28 @@ public:
 	/** Called every frame. */
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
-	/** Called when a poll is performed. */
+	/** Called when a poll is performed. This is an optional hook, the results are only copied for Blueprint if the event is implemented. */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "On Poll"))
 	void EventOnPoll(const TArray<float>& TerrainTraceResults, const TArray<float>& OcclusionTraceResults);
 
-	/** Sets the wind direction. */
+	/** Removes all entries from the poll cache. Call this when the level geometry has changed, for example when a large door opens. */
+	UFUNCTION(BlueprintCallable, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Clear Poll Cache"))
+	void ClearPollCache();
+
+	/** Returns the number of polls per minute, measured over the last few seconds. */
+	UFUNCTION(BlueprintPure, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Get Polls Per Minute"))
+	FORCEINLINE float GetPollsPerMinute() const {return PollsPerMinute; }
+
+	/** Returns the total number of completed polls and issued traces. Used for profiling. */
+	FORCEINLINE uint32 GetCompletedPollCount() const {return CompletedPollCount; }
+	FORCEINLINE uint32 GetIssuedTraceCount() const {return IssuedTraceCount; }
+
+	/** Returns the fraction of polls that were answered by the poll cache. */
+	UFUNCTION(BlueprintPure, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Get Poll Cache Hit Rate"))
+	float GetPollCacheHitRate() const;
+
+	/** Sets the wind direction. This selects a precomputed trace pattern and can safely be called every frame.
+	 *	EventOnWindDirectionChanged is only called when the quantized direction changes. */
 	UFUNCTION(BlueprintCallable, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Set Wind Direction"))
 	void SetWindDirection(const FRotator& Rotation);
 
@@ -84,11 +277,75 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "ExteriorWindAudioComponent", meta = (Displayname = "Get Average Of Float Array.", BlueprintProtected))
 	float GetAverageOfFloatArray(const TArray<float>& Array) const;
 
-	/** Called when the wind direction is updated. */
+	/** Called when the quantized wind direction is updated. */
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "On Wind Direction Changed"))
 	void EventOnWindDirectionChanged(const FRotator& Rotation);
 
 private:
+	/** Samples the baked wind field for a poll and finishes the poll immediately.
+	 *	@Return Whether the location could be sampled. If false, the poll should be performed using collision queries.
+	 */
+	bool PerformBakedPoll(const FVector& Location);
+
+	/** Returns whether a new poll should be started this frame.
+	 *	@Param OutIsRefresh Whether the poll is only triggered because the last result became stale, rather than by movement. */
+	bool ShouldPoll(const FVector& Location, const float Time, bool& OutIsRefresh) const;
+
+	/** Returns the distance the owner has to move before a new poll is performed, taking the current speed and the stability of the environment into account. */
+	float GetAdaptivePollDistance() const;
+
+	/** Updates the stability of the environment from the change in wind features between the last two polls. */
+	void UpdateStability();
+
+	/** Records that a poll was started, for the polls per minute statistic. */
+	void RecordPoll(const float Time);
+
+	/** Looks up the poll cache for a poll and finishes the poll immediately if the cache contains a result.
+	 *	@Return Whether the cache contained a result. If false, the poll should be performed using collision queries.
+	 */
+	bool PerformCachedPoll(const FVector& Location);
+
+	/** Stores the results of the traced poll that has just completed in the poll cache. */
+	void StoreTracedPollInCache();
+
+	/** Returns the poll cache key of a location for the current wind direction. */
+	FExteriorWindPollCacheKey GetPollCacheKey(const FVector& Location, const int32 DirectionIndex) const;
+
+	/** Performs all traces of a poll on the game thread and finishes the poll immediately. */
+	void PerformSynchronousPoll(const FVector& Location);
+
+	/** Submits all traces of a poll to the async trace interface. The poll is finished once all traces have returned. */
+	void SubmitAsynchronousPoll(const FVector& Location);
+
+	/** Starts a time sliced sweep at a location. */
+	void StartTimeSlicedPoll(const FVector& Location);
+
+	/** Performs the next traces of the time sliced sweep within the per-frame trace budget. The poll is finished once the sweep is complete. */
+	void ContinueTimeSlicedPoll();
+
+	/** Called by the async trace interface when a trace of an async poll has completed. */
+	void HandleAsyncTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	/** Processes the results of the current poll and sends the mapped features to the audio component. */
+	void FinishPoll();
+
+	/** Computes the aggregate features of a set of poll results. */
+	static FExteriorWindFeatures ComputeWindFeatures(TArrayView<const float> TerrainLengths, TArrayView<const float> OcclusionLengths, const float TraceLength);
+
+	/** Builds the occlusion trace table for all quantized wind directions. */
+	void PopulateOcclusionTraceTable();
+
+	/** Returns the start and end vectors of an occlusion trace for the current wind direction. */
+	FORCEINLINE const FVector& GetOcclusionTraceStart(const int32 Index) const {return OcclusionTraceStartTable[WindDirectionIndex * OcclusionTraceCount + Index]; }
+	FORCEINLINE const FVector& GetOcclusionTraceEnd(const int32 Index) const {return OcclusionTraceEndTable[WindDirectionIndex * OcclusionTraceCount + Index]; }
+
+	/** Performs a single trace on the game thread and returns its length. */
+	float DoSingleTrace(const FVector& TraceStart, const FVector& TraceEnd) const;
+
+	/** Returns the length of a trace, which is the distance to the first blocking hit or the full trace length if nothing was hit. */
+	static float GetTraceLength(const FVector& TraceStart, const FVector& TraceEnd, const FHitResult* HitResult);
+
+public:
 	/** Populates the terrain trace vector array. */
 	static void PopulateTerrainTraceVectors(TArray<FVector>& Array, const FRotator& Rotation, const float Radius, const float NumPoints);
 
@@ -99,4 +356,8 @@ public:
 	/** Returns the audio component that is used for playing wind audio. */
 	UFUNCTION(BlueprintGetter, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Audio Component"))
 	FORCEINLINE UAudioComponent* GetAudioComponent() const {return AudioComponent; }
+
+	/** Returns the aggregate features of the last completed poll. */
+	UFUNCTION(BlueprintGetter, Category = "ExteriorWindAudioComponent", Meta = (DisplayName = "Wind Features"))
+	FORCEINLINE FExteriorWindFeatures GetWindFeatures() const {return WindFeatures; }
 };
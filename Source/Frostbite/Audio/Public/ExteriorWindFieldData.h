@@ -0,0 +1,94 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ExteriorWindFieldData.generated.h"
+
+/** Data asset that stores a baked wind exposure and occlusion field.
+ *	The field contains the quantized results of the exterior wind trace patterns sampled on a regular 3D grid,
+ *	for a set of quantized wind directions. It is generated by an ExteriorWindFieldVolume and sampled
+ *	by the ExteriorWindAudioComponent instead of performing live collision queries.
+ *	@Brief Baked wind exposure and occlusion field.
+ */
+UCLASS(BlueprintType, ClassGroup = (Audio))
+class UExteriorWindFieldData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The world space location of the first sample point of the grid. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Origin"))
+	FVector Origin {FVector::ZeroVector};
+
+	/** The number of sample points along each axis of the grid. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Resolution"))
+	FIntVector Resolution {FIntVector::ZeroValue};
+
+	/** The distance between two neighbouring sample points. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Cell Size"))
+	float CellSize {250.0f};
+
+	/** The number of quantized wind directions the occlusion pattern was sampled for. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Direction Count"))
+	int32 DirectionCount {0};
+
+	/** The trace length that was used when baking. Quantized samples are expressed as a fraction of this length. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Trace Length"))
+	float TraceLength {3000.0f};
+
+	/** The number of terrain and occlusion traces stored per sample point. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Terrain Trace Count"))
+	int32 TerrainTraceCount {0};
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindField", Meta = (DisplayName = "Occlusion Trace Count"))
+	int32 OcclusionTraceCount {0};
+
+	/** Quantized terrain trace lengths, stored as [Point][Trace]. */
+	UPROPERTY()
+	TArray<uint8> TerrainSamples;
+
+	/** Quantized occlusion trace lengths, stored as [Point][Direction][Trace]. */
+	UPROPERTY()
+	TArray<uint8> OcclusionSamples;
+
+public:
+	/** Returns whether the field contains valid data. */
+	bool IsValidField() const;
+
+	/** Returns whether a world space location lies within the baked bounds of the field. */
+	bool IsInsideBounds(const FVector& Location) const;
+
+	/** Samples the terrain trace lengths at a location using trilinear interpolation.
+	 *	@Location The world space location to sample.
+	 *	@OutLengths Array that receives the interpolated trace lengths. Must hold at least TerrainTraceCount elements.
+	 *	@Return Whether the location could be sampled.
+	 */
+	bool SampleTerrain(const FVector& Location, TArrayView<float> OutLengths) const;
+
+	/** Samples the occlusion trace lengths at a location for a quantized wind direction using trilinear interpolation.
+	 *	@Location The world space location to sample.
+	 *	@DirectionIndex The quantized wind direction to sample.
+	 *	@OutLengths Array that receives the interpolated trace lengths. Must hold at least OcclusionTraceCount elements.
+	 *	@Return Whether the location could be sampled.
+	 */
+	bool SampleOcclusion(const FVector& Location, const int32 DirectionIndex, TArrayView<float> OutLengths) const;
+
+	/** Returns the quantized direction index for a wind direction. Only the yaw of the rotation is taken into account. */
+	static int32 GetDirectionIndex(const FRotator& Rotation, const int32 NumDirections);
+
+	/** Returns the wind direction that belongs to a quantized direction index. */
+	static FRotator GetDirectionRotation(const int32 DirectionIndex, const int32 NumDirections);
+
+	/** Quantizes a trace length to a single byte. */
+	static uint8 QuantizeTraceLength(const float Length, const float MaxLength);
+
+private:
+	/** Samples a channel set of the field. */
+	bool SampleChannels(const TArray<uint8>& Samples, const int32 Stride, const int32 Offset, const FVector& Location, TArrayView<float> OutLengths, const int32 NumChannels) const;
+
+	/** Returns the linear index of a grid point. */
+	FORCEINLINE int32 GetPointIndex(const int32 X, const int32 Y, const int32 Z) const {return (Z * Resolution.Y + Y) * Resolution.X + X; }
+};
@@ -0,0 +1,54 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ExteriorWindFieldVolume.generated.h"
+
+class UBoxComponent;
+class UExteriorWindFieldData;
+
+/** Actor that defines the bounds of a baked exterior wind field.
+ *	The bake samples the same terrain and occlusion trace patterns as the ExteriorWindAudioComponent
+ *	on a regular grid inside the volume, and stores the quantized results in a wind field data asset.
+ *	@Brief Editor volume for baking exterior wind fields.
+ */
+UCLASS(NotBlueprintable, Placeable, ClassGroup = (Audio), HideCategories = (Rendering, Input, Collision, HLOD, Replication))
+class AExteriorWindFieldVolume : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	/** The box that defines the bounds of the wind field. */
+	UPROPERTY(VisibleAnywhere, Category = "ExteriorWindFieldVolume", Meta = (DisplayName = "Bounds"))
+	UBoxComponent* Bounds;
+
+	/** The data asset to bake the wind field into. */
+	UPROPERTY(EditInstanceOnly, Category = "ExteriorWindFieldVolume", Meta = (DisplayName = "Wind Field"))
+	UExteriorWindFieldData* WindField;
+
+	/** The distance between two neighbouring sample points. */
+	UPROPERTY(EditInstanceOnly, Category = "ExteriorWindFieldVolume", Meta = (DisplayName = "Cell Size", ClampMin = "50", UIMin = "50"))
+	float CellSize {250.0f};
+
+	/** The number of quantized wind directions to sample the occlusion pattern for. */
+	UPROPERTY(EditInstanceOnly, Category = "ExteriorWindFieldVolume", Meta = (DisplayName = "Direction Count", ClampMin = "1", ClampMax = "64", UIMin = "1", UIMax = "64"))
+	int32 DirectionCount {16};
+
+	/** The trace length to bake with. This should match the collision trace length of the wind audio component. */
+	UPROPERTY(EditInstanceOnly, Category = "ExteriorWindFieldVolume", Meta = (DisplayName = "Trace Length"))
+	float TraceLength {3000.0f};
+
+public:
+	/** Sets default values for this actor's properties. */
+	AExteriorWindFieldVolume();
+
+#if WITH_EDITOR
+	/** Samples the wind trace patterns inside the volume and stores the results in the wind field data asset. */
+	UFUNCTION(CallInEditor, Category = "ExteriorWindFieldVolume", Meta = (DisplayName = "Bake Wind Field"))
+	void BakeWindField();
+#endif
+};
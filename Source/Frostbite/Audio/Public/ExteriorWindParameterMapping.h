@@ -0,0 +1,103 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ExteriorWindParameterMapping.generated.h"
+
+class UAudioComponent;
+
+/** Enum for defining the aggregate features that are derived from an exterior wind poll. */
+UENUM(BlueprintType)
+enum class EExteriorWindFeature : uint8
+{
+	Openness			UMETA(DisplayName = "Openness", ToolTip = "The mean terrain trace length as a fraction of the trace length. 0 is fully enclosed, 1 is fully open."),
+	OpennessVariance	UMETA(DisplayName = "Openness Variance", ToolTip = "The variance of the normalized terrain trace lengths."),
+	Occlusion			UMETA(DisplayName = "Occlusion", ToolTip = "How much the wind is blocked upwind. 0 is unoccluded, 1 is fully occluded."),
+	OcclusionVariance	UMETA(DisplayName = "Occlusion Variance", ToolTip = "The variance of the normalized occlusion trace lengths."),
+	OcclusionPan		UMETA(DisplayName = "Occlusion Pan", ToolTip = "The balance between the left and right occlusion traces. -1 is occluded on the left, 1 is occluded on the right."),
+};
+
+/** Struct containing the aggregate features of an exterior wind poll. */
+USTRUCT(BlueprintType)
+struct FExteriorWindFeatures
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "ExteriorWindFeatures", Meta = (DisplayName = "Openness"))
+	float Openness {0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "ExteriorWindFeatures", Meta = (DisplayName = "Openness Variance"))
+	float OpennessVariance {0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "ExteriorWindFeatures", Meta = (DisplayName = "Occlusion"))
+	float Occlusion {0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "ExteriorWindFeatures", Meta = (DisplayName = "Occlusion Variance"))
+	float OcclusionVariance {0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "ExteriorWindFeatures", Meta = (DisplayName = "Occlusion Pan"))
+	float OcclusionPan {0.0f};
+
+	/** Constructor with default values. */
+	FExteriorWindFeatures()
+	{
+	}
+
+	/** Returns the value of a single feature. */
+	float GetFeature(const EExteriorWindFeature Feature) const;
+};
+
+/** Struct that binds a wind feature to a MetaSound input parameter. */
+USTRUCT(BlueprintType)
+struct FExteriorWindParameterBinding
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The feature to drive the parameter with. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindParameterBinding", Meta = (DisplayName = "Feature"))
+	EExteriorWindFeature Feature {EExteriorWindFeature::Openness};
+
+	/** The name of the float input of the MetaSound. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindParameterBinding", Meta = (DisplayName = "Parameter Name"))
+	FName ParameterName;
+
+	/** The range of the feature that is mapped onto the output range. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindParameterBinding", Meta = (DisplayName = "Input Range"))
+	FVector2D InputRange {FVector2D(0.0, 1.0)};
+
+	/** The range of the value that is sent to the MetaSound. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindParameterBinding", Meta = (DisplayName = "Output Range"))
+	FVector2D OutputRange {FVector2D(0.0, 1.0)};
+
+	/** Constructor with default values. */
+	FExteriorWindParameterBinding()
+	{
+	}
+};
+
+/** Data asset that maps exterior wind features onto MetaSound input parameters.
+ *	This allows the wind audio component to drive its MetaSound natively after every poll, without Blueprint logic.
+ *	@Brief Mapping of exterior wind features to MetaSound parameters.
+ */
+UCLASS(BlueprintType, ClassGroup = (Audio))
+class UExteriorWindParameterMapping : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The parameter bindings. */
+	UPROPERTY(EditAnywhere, Category = "ExteriorWindParameterMapping", Meta = (DisplayName = "Bindings", TitleProperty = "ParameterName"))
+	TArray<FExteriorWindParameterBinding> Bindings;
+
+	/** Constructor with default values. */
+	UExteriorWindParameterMapping()
+	{
+	}
+
+	/** Sends the mapped features to the MetaSound that is playing on an audio component. */
+	void ApplyToAudioComponent(UAudioComponent* AudioComponent, const FExteriorWindFeatures& Features) const;
+};
@@ -0,0 +1,97 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Key of a cached wind poll, consisting of a quantized location cell and a quantized wind direction. */
+struct FExteriorWindPollCacheKey
+{
+	FIntVector Cell {FIntVector::ZeroValue};
+	int32 DirectionIndex {0};
+
+	FExteriorWindPollCacheKey()
+	{
+	}
+
+	FExteriorWindPollCacheKey(const FIntVector& InCell, const int32 InDirectionIndex)
+		: Cell(InCell), DirectionIndex(InDirectionIndex)
+	{
+	}
+
+	FORCEINLINE bool operator==(const FExteriorWindPollCacheKey& Other) const {return Cell == Other.Cell && DirectionIndex == Other.DirectionIndex; }
+	FORCEINLINE friend uint32 GetTypeHash(const FExteriorWindPollCacheKey& Key) {return HashCombine(GetTypeHash(Key.Cell), GetTypeHash(Key.DirectionIndex)); }
+};
+
+/** Least recently used cache for the results of exterior wind polls.
+ *	All storage is allocated up front when the cache is initialized, so lookups and insertions never allocate.
+ *	When the cache is full, the least recently used entry is replaced.
+ *	@Brief LRU cache for exterior wind poll results.
+ */
+class FExteriorWindPollCache
+{
+public:
+	/** Allocates the storage for the cache and removes all entries.
+	 *	@MaxEntries The maximum number of entries the cache can hold.
+	 *	@Stride The number of floats stored per entry.
+	 */
+	void Initialize(const int32 MaxEntries, const int32 Stride);
+
+	/** Removes all entries from the cache, but keeps its storage. */
+	void Empty();
+
+	/** Looks up an entry and marks it as most recently used.
+	 *	@OutResults Array that receives the cached results. Must hold at least Stride elements.
+	 *	@Return Whether the entry was found.
+	 */
+	bool Find(const FExteriorWindPollCacheKey& Key, TArrayView<float> OutResults);
+
+	/** Adds or replaces an entry and marks it as most recently used. */
+	void Add(const FExteriorWindPollCacheKey& Key, TArrayView<const float> Results);
+
+	/** Returns the number of bytes a cache entry with a given stride occupies. */
+	static SIZE_T GetBytesPerEntry(const int32 Stride);
+
+	/** Returns the number of bytes allocated by the cache. */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Returns the fraction of lookups that resulted in a hit. */
+	float GetHitRate() const;
+
+	FORCEINLINE int32 Num() const {return SlotMap.Num(); }
+	FORCEINLINE int32 GetMaxEntries() const {return SlotKeys.Num(); }
+	FORCEINLINE uint64 GetHitCount() const {return HitCount; }
+	FORCEINLINE uint64 GetMissCount() const {return MissCount; }
+
+private:
+	/** Unlinks a slot from the recency list. */
+	void Unlink(const int32 Slot);
+
+	/** Links a slot at the front of the recency list. */
+	void LinkAsMostRecent(const int32 Slot);
+
+	/** Maps a key to the slot that stores its results. */
+	TMap<FExteriorWindPollCacheKey, int32> SlotMap;
+
+	/** The key, results and recency links of every slot. */
+	TArray<FExteriorWindPollCacheKey> SlotKeys;
+	TArray<float> SlotResults;
+	TArray<int32> PreviousSlots;
+	TArray<int32> NextSlots;
+
+	/** The most and least recently used slots. */
+	int32 MostRecentSlot {INDEX_NONE};
+	int32 LeastRecentSlot {INDEX_NONE};
+
+	/** The number of slots that are in use. */
+	int32 NumUsedSlots {0};
+
+	/** The number of floats stored per entry. */
+	int32 EntryStride {0};
+
+	/** Lookup statistics. */
+	uint64 HitCount {0};
+	uint64 MissCount {0};
+};
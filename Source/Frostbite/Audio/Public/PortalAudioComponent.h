@@ -0,0 +1,78 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/AudioComponent.h"
+#include "PortalAudioComponent.generated.h"
+
+struct FPortalAudioPropagation;
+
+/** Audio component whose sound propagates through the portals between rooms.
+ *	When the listener is in another room, the sound is moved to the portal through which it enters the room of the listener,
+ *	and attenuated and low-passed by the number of portals and the length of the path it travels.
+ *	@Brief Audio component that propagates through room portals.
+ */
+UCLASS(Blueprintable, BlueprintType, ClassGroup = (Audio), Meta = (BlueprintSpawnableComponent))
+class UPortalAudioComponent : public UAudioComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** When enabled, the sound propagates through portals when the listener is in another room. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Enable Portal Propagation"))
+	bool IsPortalPropagationEnabled {true};
+
+	/** The volume multiplier applied for every portal the sound passes through. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Portal Volume Scale", ClampMin = "0", ClampMax = "1", UIMin = "0", UIMax = "1"))
+	float PortalVolumeScale {0.6f};
+
+	/** The low-pass frequency multiplier applied for every portal the sound passes through. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Portal Low-Pass Scale", ClampMin = "0", ClampMax = "1", UIMin = "0", UIMax = "1"))
+	float PortalLowPassScale {0.5f};
+
+	/** The path length over which the low-pass frequency is halved, in addition to the portal low-pass scale. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Path Length Low-Pass Distance", ClampMin = "1", UIMin = "1", Units = "cm"))
+	float PathLengthLowPassDistance {4000.0f};
+
+	/** The low-pass frequency of a sound that does not pass through any portal. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Max Low-Pass Frequency", ClampMin = "20", ClampMax = "20000", UIMin = "20", UIMax = "20000", Units = "Hz"))
+	float MaxLowPassFrequency {20000.0f};
+
+	/** The lowest low-pass frequency a propagated sound can have. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Min Low-Pass Frequency", ClampMin = "20", ClampMax = "20000", UIMin = "20", UIMax = "20000", Units = "Hz"))
+	float MinLowPassFrequency {400.0f};
+
+	/** The maximum number of portals the sound can pass through. The sound is silenced when the listener is further away. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "PortalAudioComponent", Meta = (DisplayName = "Max Portal Count", ClampMin = "1", UIMin = "1"))
+	int32 MaxPortalCount {4};
+
+private:
+	/** The location of the source relative to the attach parent. The component itself is moved to the apparent location of the sound. */
+	FVector SourceRelativeLocation {FVector::ZeroVector};
+
+	/** The volume multiplier of the component before any propagation was applied. */
+	float BaseVolumeMultiplier {1.0f};
+
+	/** Whether the component is currently propagating through portals. */
+	bool IsPropagating {false};
+
+public:
+	UPortalAudioComponent();
+
+	/** Returns the world space location of the source of the sound. */
+	UFUNCTION(BlueprintPure, Category = "PortalAudioComponent", Meta = (DisplayName = "Get Source Location"))
+	FVector GetSourceLocation() const;
+
+	/** Applies the propagation of the sound to the listener. Called by the portal audio subsystem every frame. */
+	void ApplyPropagation(const FPortalAudioPropagation& Propagation);
+
+	/** Moves the sound back to its source and removes any attenuation and filtering. */
+	void ApplyDirect();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
@@ -0,0 +1,115 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PortalAudioSubsystem.generated.h"
+
+class ARoomVolume;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+class UPortalAudioComponent;
+
+/** Struct containing the cached shortest path from a source room to a listener room. */
+struct FPortalAudioPath
+{
+	/** The number of portals on the path, or INDEX_NONE if the listener room cannot be reached. */
+	int32 PortalCount {INDEX_NONE};
+
+	/** The length of the path from the first to the last portal. */
+	float PortalPathLength {0.0f};
+
+	/** The portal through which the sound leaves the source room. */
+	FVector SourcePortal {FVector::ZeroVector};
+
+	/** The portal through which the sound enters the listener room. */
+	FVector ListenerPortal {FVector::ZeroVector};
+};
+
+/** Struct containing how a sound reaches the listener. */
+struct FPortalAudioPropagation
+{
+	/** The number of portals the sound passes through, or INDEX_NONE if the sound cannot reach the listener. */
+	int32 PortalCount {0};
+
+	/** The total distance the sound travels from the source to the listener. */
+	float PathLength {0.0f};
+
+	/** The location the sound appears to come from. Lies in the direction of the portal closest to the listener, at the path length from the listener. */
+	FVector ApparentLocation {FVector::ZeroVector};
+};
+
+/** Struct containing a registered portal audio component. */
+struct FPortalAudioSource
+{
+	TWeakObjectPtr<UPortalAudioComponent> Component;
+	int32 RoomId {INDEX_NONE};
+};
+
+/** World Subsystem that propagates sound through the portals between rooms.
+ *	Rooms that are connected in the room graph are treated as being connected by a portal. Sound from a source in another room than the listener
+ *	travels along the shortest path through these portals, and is attenuated and low-passed by the path length and the number of portals.
+ *	Paths are cached per pair of source and listener room, and only computed when the listener enters a room for the first time,
+ *	so that occluding a source costs a table lookup per frame instead of a set of raycasts.
+ *	@Brief World Subsystem that propagates sound between rooms.
+ */
+UCLASS(ClassGroup = ("Audio"))
+class UPortalAudioSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The cached paths, indexed by listener room and then by source room. Rows are computed the first time the listener enters a room. */
+	TArray<TArray<FPortalAudioPath>> PathCache;
+
+	/** The room the listener is in. */
+	int32 ListenerRoomId {INDEX_NONE};
+
+	/** The registered portal audio components. */
+	TArray<FPortalAudioSource> Sources;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Registers a portal audio component, so that its propagation is updated every frame. */
+	void RegisterComponent(UPortalAudioComponent* Component);
+
+	/** Unregisters a portal audio component. */
+	void UnregisterComponent(UPortalAudioComponent* Component);
+
+	/** Returns how a sound from a source location reaches a listener location.
+	 *	@SourceLocation The world space location of the source.
+	 *	@SourceRoomId The room of the source.
+	 *	@ListenerLocation The world space location of the listener.
+	 *	@Return Whether the sound has to travel through portals. If not, the sound reaches the listener directly.
+	 */
+	bool GetPropagation(const FVector& SourceLocation, const int32 SourceRoomId, const FVector& ListenerLocation, FPortalAudioPropagation& OutPropagation);
+
+	/** Returns the room the listener is in, or INDEX_NONE. */
+	FORCEINLINE int32 GetListenerRoomId() const {return ListenerRoomId; }
+
+private:
+	/** Clears the path cache and looks up the rooms of the listener and the sources again. Called whenever the membership index has been rebuilt for a new room graph. */
+	void ResetPathCache();
+
+	/** Returns the cached paths from every room to a listener room, computing them if necessary. */
+	const TArray<FPortalAudioPath>& GetPathsToListenerRoom(const int32 RoomId);
+
+	/** Called when a tracked actor changes room. */
+	UFUNCTION()
+	void HandleRoomMembershipChanged(AActor* Actor, ARoomVolume* PreviousRoom, ARoomVolume* NewRoom);
+};
@@ -14,5 +14,13 @@ DEFINE_LOG_CATEGORY(LogInteractableActor)
 
 DEFINE_LOG_CATEGORY(LogNightstalker)
 DEFINE_LOG_CATEGORY(LogNightstalkerController)
+DEFINE_LOG_CATEGORY(LogNightstalkerPathfinding)
+DEFINE_LOG_CATEGORY(LogAmbushPoints)
 
 DEFINE_LOG_CATEGORY(LogRoomVolume)
+DEFINE_LOG_CATEGORY(LogRoomGraph)
+DEFINE_LOG_CATEGORY(LogLightInfluence)
+DEFINE_LOG_CATEGORY(LogRoomStreaming)
+DEFINE_LOG_CATEGORY(LogRoomVisibility)
+
+DEFINE_LOG_CATEGORY(LogExteriorWindAudio)
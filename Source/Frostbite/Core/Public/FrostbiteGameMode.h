@@ -9,6 +9,11 @@
 #include "FrostbiteGameMode.generated.h"
 
 class APlayerCharacter;
+class URoomRelevanceSettings;
+class URoomStreamingSettings;
+class UStimulusHeatMapSettings;
+class ULineOfSightSettings;
+class UVirtualNightstalkerSettings;
 
 /**
  * 
@@ -22,10 +27,45 @@ private:
 	UPROPERTY()
 	bool IsPlayerActive {false};
 
+	/** The settings that define how actors in distant rooms are throttled. */
+	UPROPERTY(EditDefaultsOnly, Category = "RoomSystem", Meta = (DisplayName = "Room Relevance Settings"))
+	TSoftObjectPtr<URoomRelevanceSettings> RoomRelevanceSettings;
+
+	/** The settings that define how the streaming levels of rooms are loaded. */
+	UPROPERTY(EditDefaultsOnly, Category = "RoomSystem", Meta = (DisplayName = "Room Streaming Settings"))
+	TSoftObjectPtr<URoomStreamingSettings> RoomStreamingSettings;
+
+	/** The settings that define how player stimuli are recorded for the Nightstalker. */
+	UPROPERTY(EditDefaultsOnly, Category = "Nightstalker", Meta = (DisplayName = "Stimulus Heat Map Settings"))
+	TSoftObjectPtr<UStimulusHeatMapSettings> StimulusHeatMapSettings;
+
+	/** The settings that define how line of sight between the Nightstalker and the player is tested. */
+	UPROPERTY(EditDefaultsOnly, Category = "Nightstalker", Meta = (DisplayName = "Line Of Sight Settings"))
+	TSoftObjectPtr<ULineOfSightSettings> LineOfSightSettings;
+
+	/** The settings that define when and how distant Nightstalkers are simulated without their pawn. */
+	UPROPERTY(EditDefaultsOnly, Category = "Nightstalker", Meta = (DisplayName = "Virtual Nightstalker Settings"))
+	TSoftObjectPtr<UVirtualNightstalkerSettings> VirtualNightstalkerSettings;
+
 public:
 	/** Notifies the gamemode that a player character is fully initialized and is ready for use. */
 	void NotifyPlayerCharacterBeginPlay(APlayerCharacter* Character);
 
+	/** Returns the room relevance settings. */
+	FORCEINLINE const TSoftObjectPtr<URoomRelevanceSettings>& GetRoomRelevanceSettings() const {return RoomRelevanceSettings; }
+
+	/** Returns the room streaming settings. */
+	FORCEINLINE const TSoftObjectPtr<URoomStreamingSettings>& GetRoomStreamingSettings() const {return RoomStreamingSettings; }
+
+	/** Returns the stimulus heat map settings. */
+	FORCEINLINE const TSoftObjectPtr<UStimulusHeatMapSettings>& GetStimulusHeatMapSettings() const {return StimulusHeatMapSettings; }
+
+	/** Returns the line of sight settings. */
+	FORCEINLINE const TSoftObjectPtr<ULineOfSightSettings>& GetLineOfSightSettings() const {return LineOfSightSettings; }
+
+	/** Returns the virtual Nightstalker settings. */
+	FORCEINLINE const TSoftObjectPtr<UVirtualNightstalkerSettings>& GetVirtualNightstalkerSettings() const {return VirtualNightstalkerSettings; }
+
 protected:
 	/** Called when the player character is ready for use in the world. */
 	UFUNCTION(BlueprintNativeEvent, Category = Default, Meta = (DisplayName = "On Player Spawn"))
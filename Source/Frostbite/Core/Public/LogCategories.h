@@ -16,5 +16,13 @@ DECLARE_LOG_CATEGORY_EXTERN(LogInteractableActor, Log, All)
 
 DECLARE_LOG_CATEGORY_EXTERN(LogNightstalker, Log, All)
 DECLARE_LOG_CATEGORY_EXTERN(LogNightstalkerController, Log, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogNightstalkerPathfinding, Log, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogAmbushPoints, Log, All)
 
 DECLARE_LOG_CATEGORY_EXTERN(LogRoomVolume, Log, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogRoomGraph, Log, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogLightInfluence, Log, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogRoomStreaming, Log, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogRoomVisibility, Log, All)
+
+DECLARE_LOG_CATEGORY_EXTERN(LogExteriorWindAudio, Log, All)
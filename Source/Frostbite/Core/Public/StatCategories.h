@@ -0,0 +1,13 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("Frostbite Exterior Wind Audio"), STATGROUP_ExteriorWindAudio, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("Frostbite Room System"), STATGROUP_RoomSystem, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("Frostbite Portal Audio"), STATGROUP_PortalAudio, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("Frostbite Nightstalker"), STATGROUP_Nightstalker, STATCAT_Advanced);
@@ -0,0 +1,236 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "AmbushPointBaker.h"
+#include "AmbushPointData.h"
+#include "AmbushPointSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomVolume.h"
+#include "LogCategories.h"
+
+#include "Components/BoxComponent.h"
+#include "Components/LocalLightComponent.h"
+#include "Components/SpotLightComponent.h"
+#include "EngineUtils.h"
+#include "NavigationSystem.h"
+#include "Misc/ScopedSlowTask.h"
+
+/** Sets default values for this actor's properties. */
+AAmbushPointBaker::AAmbushPointBaker()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+void AAmbushPointBaker::BeginPlay()
+{
+	Super::BeginPlay();
+	if(UAmbushPointSubsystem* Subsystem {GetWorld()->GetSubsystem<UAmbushPointSubsystem>()})
+	{
+		Subsystem->RegisterData(AmbushPoints);
+	}
+}
+
+void AAmbushPointBaker::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UAmbushPointSubsystem* Subsystem {GetWorld()->GetSubsystem<UAmbushPointSubsystem>()})
+	{
+		Subsystem->UnregisterData(AmbushPoints);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+#if WITH_EDITOR
+void AAmbushPointBaker::BakeAmbushPoints()
+{
+	UWorld* World {GetWorld()};
+	if(!World || !AmbushPoints)
+	{
+		UE_LOG(LogAmbushPoints, Warning, TEXT("Could not bake ambush points for %s: no world or no ambush point asset assigned."), *GetName());
+		return;
+	}
+
+	TArray<ARoomVolume*> Rooms;
+	TArray<const UBoxComponent*> RoomBoxes;
+	for (TActorIterator<ARoomVolume> It {World}; It; ++It)
+	{
+		if(const UBoxComponent* Box {Cast<UBoxComponent>(It->GetCollisionComponent())})
+		{
+			Rooms.Add(*It);
+			RoomBoxes.Add(Box);
+		}
+	}
+
+	/** Only lights that cannot move are baked, as the influence of movable lights such as the flashlight changes at runtime. */
+	TArray<const ULocalLightComponent*> Lights;
+	for (TActorIterator<AActor> It {World}; It; ++It)
+	{
+		TInlineComponentArray<ULocalLightComponent*> Components {*It};
+		for (const ULocalLightComponent* Light : Components)
+		{
+			if(Light->Mobility != EComponentMobility::Movable && Light->IsVisible())
+			{
+				Lights.Add(Light);
+			}
+		}
+	}
+
+	/** Only static geometry provides cover and blocks light, as movable geometry such as doors can open at runtime. */
+	FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
+	Params.bTraceComplex = false;
+	Params.AddIgnoredActors(TArray<AActor*>(Rooms));
+	const FCollisionObjectQueryParams ObjectParams {ECC_WorldStatic};
+	const UNavigationSystemV1* NavigationSystem {FNavigationSystem::GetCurrent<UNavigationSystemV1>(World)};
+
+	/** Returns how strongly a location is lit by the baked lights, between 0 and 1. */
+	const auto GetIllumination {[World, &Lights, &Params, &ObjectParams](const FVector& Location)
+	{
+		float Illumination {0.0f};
+		for (const ULocalLightComponent* Light : Lights)
+		{
+			const FVector LightLocation {Light->GetComponentLocation()};
+			const float Distance {static_cast<float>(FVector::Dist(LightLocation, Location))};
+			if(Distance >= Light->AttenuationRadius) {continue; }
+
+			if(const USpotLightComponent* SpotLight {Cast<USpotLightComponent>(Light)})
+			{
+				const FVector Direction {(Location - LightLocation).GetSafeNormal()};
+				if((Direction | Light->GetDirection()) < FMath::Cos(FMath::DegreesToRadians(SpotLight->OuterConeAngle))) {continue; }
+			}
+			if(World->LineTraceTestByObjectType(LightLocation, Location, ObjectParams, Params)) {continue; }
+
+			Illumination = FMath::Max(Illumination, 1.0f - Distance / Light->AttenuationRadius);
+		}
+		return Illumination;
+	}};
+
+	AmbushPoints->Modify();
+	AmbushPoints->Rooms.Reset(Rooms.Num());
+	AmbushPoints->RoomOffsets.Reset(Rooms.Num() + 1);
+	AmbushPoints->LocationX.Reset();
+	AmbushPoints->LocationY.Reset();
+	AmbushPoints->LocationZ.Reset();
+	AmbushPoints->Cover.Reset();
+	AmbushPoints->Darkness.Reset();
+	AmbushPoints->PortalDistance.Reset();
+	AmbushPoints->RoomOffsets.Add(0);
+
+	FScopedSlowTask SlowTask {static_cast<float>(Rooms.Num()), FText::FromString(TEXT("Baking ambush points..."))};
+	SlowTask.MakeDialog(true);
+
+	/** Struct containing a scored floor sample of a room. */
+	struct FAmbushPointSample
+	{
+		FVector Location;
+		float Cover;
+		float Darkness;
+		float PortalDistance;
+		float Score;
+	};
+
+	TArray<FAmbushPointSample> Samples;
+	TArray<FVector> Portals;
+	for (int32 RoomIndex {0}; RoomIndex < Rooms.Num(); RoomIndex++)
+	{
+		if(SlowTask.ShouldCancel())
+		{
+			UE_LOG(LogAmbushPoints, Warning, TEXT("Ambush point bake for %s was cancelled, the asset is incomplete."), *GetName());
+			return;
+		}
+		SlowTask.EnterProgressFrame(1.0f);
+
+		const ARoomVolume* Room {Rooms[RoomIndex]};
+		AmbushPoints->Rooms.Add(Rooms[RoomIndex]);
+
+		/** The entrances of the room are the portals to its connected rooms, as computed by the room graph. */
+		Portals.Reset();
+		for (const TSoftObjectPtr<ARoomVolume>& ConnectedRoom : Room->ConnectedRooms)
+		{
+			if(const ARoomVolume* Other {ConnectedRoom.Get()})
+			{
+				Portals.AddUnique(URoomGraphSubsystem::ComputePortalLocation(Room, Other));
+			}
+		}
+		for (const FRoomPathData& Path : Room->PathData)
+		{
+			if(const ARoomVolume* Other {Path.Room.Get()})
+			{
+				Portals.AddUnique(URoomGraphSubsystem::ComputePortalLocation(Room, Other));
+			}
+		}
+
+		/** The floor is sampled on a grid in the space of the room, from the top of the room down. */
+		Samples.Reset();
+		const UBoxComponent* Box {RoomBoxes[RoomIndex]};
+		const FTransform& RoomTransform {Box->GetComponentTransform()};
+		const FVector Extent {Box->GetUnscaledBoxExtent()};
+		const FVector Scale {RoomTransform.GetScale3D().GetAbs()};
+		const FVector2D Spacing {SampleSpacing / FMath::Max(Scale.X, UE_KINDA_SMALL_NUMBER), SampleSpacing / FMath::Max(Scale.Y, UE_KINDA_SMALL_NUMBER)};
+		for (double X {-Extent.X + Spacing.X * 0.5}; X < Extent.X; X += Spacing.X)
+		{
+			for (double Y {-Extent.Y + Spacing.Y * 0.5}; Y < Extent.Y; Y += Spacing.Y)
+			{
+				FHitResult Hit;
+				const FVector Top {RoomTransform.TransformPosition(FVector(X, Y, Extent.Z))};
+				const FVector Bottom {RoomTransform.TransformPosition(FVector(X, Y, -Extent.Z))};
+				if(!World->LineTraceSingleByObjectType(Hit, Top, Bottom, ObjectParams, Params)) {continue; }
+
+				/** Samples that are off the navmesh cannot be reached by the Nightstalker. */
+				FVector Location {Hit.ImpactPoint};
+				if(NavigationSystem)
+				{
+					FNavLocation NavLocation;
+					if(!NavigationSystem->ProjectPointToNavigation(Location, NavLocation, FVector(SampleSpacing * 0.5, SampleSpacing * 0.5, 100.0))) {continue; }
+					Location = NavLocation.Location;
+				}
+
+				FAmbushPointSample& Sample {Samples.AddDefaulted_GetRef()};
+				Sample.Location = Location;
+
+				const FVector CoverLocation {Location + FVector(0.0, 0.0, CoverHeight)};
+				int32 CoveredPortals {0};
+				Sample.PortalDistance = Portals.Num() > 0 ? TNumericLimits<float>::Max() : 0.0f;
+				for (const FVector& Portal : Portals)
+				{
+					CoveredPortals += World->LineTraceTestByObjectType(Portal, CoverLocation, ObjectParams, Params) ? 1 : 0;
+					Sample.PortalDistance = FMath::Min(Sample.PortalDistance, static_cast<float>(FVector::Dist(Portal, Location)));
+				}
+				Sample.Cover = Portals.Num() > 0 ? static_cast<float>(CoveredPortals) / Portals.Num() : 1.0f;
+				Sample.Darkness = 1.0f - GetIllumination(CoverLocation);
+
+				/** The bake score only decides which samples are kept. The runtime score also takes the location of the player into account. */
+				Sample.Score = Sample.Cover + Sample.Darkness;
+			}
+		}
+
+		/** The best samples are kept, spread out over the room so that the Nightstalker has a choice of positions. */
+		Samples.Sort([](const FAmbushPointSample& A, const FAmbushPointSample& B) {return A.Score > B.Score; });
+		const int32 FirstPoint {AmbushPoints->LocationX.Num()};
+		const double MinPointSpacingSquared {FMath::Square(MinPointSpacing)};
+		for (const FAmbushPointSample& Sample : Samples)
+		{
+			if(AmbushPoints->LocationX.Num() - FirstPoint >= MaxPointsPerRoom) {break; }
+
+			bool IsTooClose {false};
+			for (int32 Point {FirstPoint}; Point < AmbushPoints->LocationX.Num() && !IsTooClose; Point++)
+			{
+				const FVector PointLocation {AmbushPoints->LocationX[Point], AmbushPoints->LocationY[Point], AmbushPoints->LocationZ[Point]};
+				IsTooClose = FVector::DistSquared(PointLocation, Sample.Location) < MinPointSpacingSquared;
+			}
+			if(IsTooClose) {continue; }
+
+			AmbushPoints->LocationX.Add(Sample.Location.X);
+			AmbushPoints->LocationY.Add(Sample.Location.Y);
+			AmbushPoints->LocationZ.Add(Sample.Location.Z);
+			AmbushPoints->Cover.Add(Sample.Cover);
+			AmbushPoints->Darkness.Add(Sample.Darkness);
+			AmbushPoints->PortalDistance.Add(Sample.PortalDistance);
+		}
+		AmbushPoints->RoomOffsets.Add(AmbushPoints->LocationX.Num());
+	}
+
+	AmbushPoints->MarkPackageDirty();
+	UE_LOG(LogAmbushPoints, Log, TEXT("Baked ambush points for %s: %d points in %d rooms."), *GetName(), AmbushPoints->GetPointCount(), Rooms.Num());
+}
+#endif
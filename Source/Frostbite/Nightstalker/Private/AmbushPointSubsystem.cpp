@@ -0,0 +1,130 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "AmbushPointSubsystem.h"
+#include "AmbushPointData.h"
+#include "NightstalkerBehaviorEngine.h"
+#include "RoomGraphSubsystem.h"
+#include "LightInfluenceSubsystem.h"
+#include "LogCategories.h"
+
+#include "Algo/Count.h"
+
+bool UAmbushPointSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAmbushPointSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	LightInfluence = Collection.InitializeDependency<ULightInfluenceSubsystem>();
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.AddUObject(this, &UAmbushPointSubsystem::BuildRoomIndices);
+	}
+}
+
+void UAmbushPointSubsystem::Deinitialize()
+{
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.RemoveAll(this);
+	}
+	DataIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+void UAmbushPointSubsystem::RegisterData(UAmbushPointData* InData)
+{
+	if(!InData || InData == Data) {return; }
+	if(!InData->IsValidData())
+	{
+		UE_LOG(LogAmbushPoints, Warning, TEXT("Ambush point data %s is empty or corrupt and was not registered. Bake it again from its ambush point baker."), *InData->GetName());
+		return;
+	}
+	if(Data)
+	{
+		UE_LOG(LogAmbushPoints, Warning, TEXT("Ambush point data %s replaces %s. Only one ambush point baker should be placed per world."), *InData->GetName(), *Data->GetName());
+	}
+	Data = InData;
+	BuildRoomIndices();
+}
+
+void UAmbushPointSubsystem::UnregisterData(UAmbushPointData* InData)
+{
+	if(!InData || InData != Data) {return; }
+	Data = nullptr;
+	BuildRoomIndices();
+}
+
+int32 UAmbushPointSubsystem::GatherPoints(const int32 RoomId, const int32 MaxPoints, FNightstalkerAmbushPoints& OutPoints) const
+{
+	if(!Data || !DataIndices.IsValidIndex(RoomId) || DataIndices[RoomId] == INDEX_NONE) {return 0; }
+
+	const int32 DataIndex {DataIndices[RoomId]};
+	const int32 First {Data->RoomOffsets[DataIndex]};
+	const int32 Count {FMath::Min(Data->RoomOffsets[DataIndex + 1] - First, MaxPoints - OutPoints.Num())};
+	if(Count <= 0) {return 0; }
+
+	/** The attributes are copied as contiguous ranges, so the points stay laid out for scoring four at a time. */
+	OutPoints.LocationX.Append(Data->LocationX.GetData() + First, Count);
+	OutPoints.LocationY.Append(Data->LocationY.GetData() + First, Count);
+	OutPoints.LocationZ.Append(Data->LocationZ.GetData() + First, Count);
+	OutPoints.Cover.Append(Data->Cover.GetData() + First, Count);
+	OutPoints.PortalDistance.Append(Data->PortalDistance.GetData() + First, Count);
+
+	/** The darkness was baked with every light on, so it only holds while an enabled light still reaches the point. */
+	if(LightInfluence && LightInfluence->HasData())
+	{
+		OutPoints.Darkness.Reserve(OutPoints.Darkness.Num() + Count);
+		for (int32 PointIndex {First}; PointIndex < First + Count; PointIndex++)
+		{
+			const FVector Location {Data->LocationX[PointIndex], Data->LocationY[PointIndex], Data->LocationZ[PointIndex]};
+			OutPoints.Darkness.Add(LightInfluence->IsLocationLit(Location) ? Data->Darkness[PointIndex] : 1.0f);
+		}
+	}
+	else
+	{
+		OutPoints.Darkness.Append(Data->Darkness.GetData() + First, Count);
+	}
+
+	OutPoints.RoomIds.Reserve(OutPoints.RoomIds.Num() + Count);
+	for (int32 i {0}; i < Count; i++)
+	{
+		OutPoints.RoomIds.Add(RoomId);
+	}
+	return Count;
+}
+
+int32 UAmbushPointSubsystem::GetRoomPointCount(const int32 RoomId) const
+{
+	if(!Data || !DataIndices.IsValidIndex(RoomId) || DataIndices[RoomId] == INDEX_NONE) {return 0; }
+	return Data->RoomOffsets[DataIndices[RoomId] + 1] - Data->RoomOffsets[DataIndices[RoomId]];
+}
+
+void UAmbushPointSubsystem::BuildRoomIndices()
+{
+	DataIndices.Reset();
+	if(!Data || !RoomGraph || RoomGraph->GetRoomCount() == 0) {return; }
+
+	DataIndices.Init(INDEX_NONE, RoomGraph->GetRoomCount());
+	for (int32 DataIndex {0}; DataIndex < Data->Rooms.Num(); DataIndex++)
+	{
+		const int32 RoomId {RoomGraph->GetRoomId(Data->Rooms[DataIndex].Get())};
+		if(DataIndices.IsValidIndex(RoomId))
+		{
+			DataIndices[RoomId] = DataIndex;
+		}
+	}
+
+	const int32 UnbakedRooms {static_cast<int32>(Algo::Count(DataIndices, INDEX_NONE))};
+	if(UnbakedRooms > 0)
+	{
+		UE_LOG(LogAmbushPoints, Log, TEXT("%d rooms are missing from ambush point data %s. The Nightstalker ambushes from their portals instead."), UnbakedRooms, *Data->GetName());
+	}
+}
@@ -0,0 +1,226 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "LineOfSightSubsystem.h"
+#include "FrostbiteGameMode.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVisibilitySubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "StatCategories.h"
+
+DECLARE_CYCLE_STAT(TEXT("Line Of Sight Tick"), STAT_LineOfSightTick, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Line Of Sight Pairs"), STAT_LineOfSightPairs, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Line Of Sight Traces"), STAT_LineOfSightTraces, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Line Of Sight Early Rejects"), STAT_LineOfSightEarlyRejects, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Line Of Sight Deferred Refreshes"), STAT_LineOfSightDeferredRefreshes, STATGROUP_Nightstalker);
+
+bool ULineOfSightSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void ULineOfSightSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	RoomVisibility = Collection.InitializeDependency<URoomVisibilitySubsystem>();
+}
+
+TStatId ULineOfSightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULineOfSightSubsystem, STATGROUP_Nightstalker);
+}
+
+void ULineOfSightSubsystem::LoadSettings()
+{
+	if(Settings) {return; }
+
+	const UWorld* World {GetWorld()};
+	if(const AFrostbiteGameMode* GameMode {World ? Cast<AFrostbiteGameMode>(World->GetAuthGameMode()) : nullptr})
+	{
+		if(!GameMode->GetLineOfSightSettings().IsNull())
+		{
+			Settings = GameMode->GetLineOfSightSettings().LoadSynchronous();
+		}
+	}
+	if(!Settings)
+	{
+		Settings = NewObject<ULineOfSightSettings>(this);
+	}
+}
+
+bool ULineOfSightSubsystem::GetLineOfSight(const AActor* Observer, const AActor* Target, const float ViewConeHalfAngle, FLineOfSightResult& OutResult)
+{
+	if(!Observer || !Target) {return false; }
+	LoadSettings();
+
+	const double Now {GetWorld()->GetTimeSeconds()};
+	FLineOfSightEntry& Entry {Entries.FindOrAdd(TPair<TWeakObjectPtr<const AActor>, TWeakObjectPtr<const AActor>>(Observer, Target))};
+	Entry.Observer = Observer;
+	Entry.Target = Target;
+	Entry.ViewConeHalfAngle = ViewConeHalfAngle;
+	Entry.RequestTime = Now;
+
+	/** A refresh that is already in flight will deliver a newer result soon, so it is not requested twice. */
+	const bool IsStale {Entry.ResultTime < 0.0 || Now - Entry.ResultTime > Settings->MaxStaleness};
+	if(IsStale && Entry.PendingTraces.Num() == 0)
+	{
+		Entry.IsRefreshRequested = true;
+	}
+
+	if(Entry.ResultTime < 0.0) {return false; }
+	OutResult = Entry.Result;
+	OutResult.Age = Now - Entry.ResultTime;
+	return true;
+}
+
+void ULineOfSightSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LineOfSightTick);
+	SET_DWORD_STAT(STAT_LineOfSightPairs, Entries.Num());
+	if(!Settings || Entries.Num() == 0) {return; }
+
+	UWorld* World {GetWorld()};
+	const double Now {World->GetTimeSeconds()};
+	int32 TraceCount {0};
+	int32 EarlyRejects {0};
+	int32 DeferredRefreshes {0};
+	for (auto It {Entries.CreateIterator()}; It; ++It)
+	{
+		FLineOfSightEntry& Entry {It.Value()};
+		if(!Entry.Observer.IsValid() || !Entry.Target.IsValid() || Now - Entry.RequestTime > Settings->ExpiryTime)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		/** Traces that were started in the previous frame have completed by now. */
+		if(Entry.PendingTraces.Num() > 0)
+		{
+			CollectTraces(Entry, Now);
+			continue;
+		}
+		if(!Entry.IsRefreshRequested) {continue; }
+
+		if(TraceCount >= Settings->MaxTracesPerFrame)
+		{
+			++DeferredRefreshes;
+			continue;
+		}
+		Entry.IsRefreshRequested = false;
+
+		const AActor* Observer {Entry.Observer.Get()};
+		const AActor* Target {Entry.Target.Get()};
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		Observer->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+		if(CanRejectEarly(Entry, EyeLocation, EyeRotation))
+		{
+			SetResult(Entry, false, 0.0f, Now);
+			++EarlyRejects;
+			continue;
+		}
+
+		TArray<FVector, TInlineAllocator<8>> Points;
+		GatherTargetPoints(Target, Points);
+
+		FCollisionQueryParams Params {SCENE_QUERY_STAT(LineOfSight), false, Observer};
+		Params.AddIgnoredActor(Target);
+		for (const FVector& Point : Points)
+		{
+			Entry.PendingTraces.Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single, EyeLocation, Point, Settings->TraceChannel, Params));
+		}
+		Entry.TraceTime = Now;
+		TraceCount += Points.Num();
+	}
+
+	SET_DWORD_STAT(STAT_LineOfSightTraces, TraceCount);
+	SET_DWORD_STAT(STAT_LineOfSightEarlyRejects, EarlyRejects);
+	SET_DWORD_STAT(STAT_LineOfSightDeferredRefreshes, DeferredRefreshes);
+}
+
+void ULineOfSightSubsystem::CollectTraces(FLineOfSightEntry& Entry, const double Now)
+{
+	const UWorld* World {GetWorld()};
+	int32 VisibleCount {0};
+	for (const FTraceHandle& Handle : Entry.PendingTraces)
+	{
+		/** The async trace buffer only holds the results of the previous frame. If they are gone, the refresh is started again. */
+		FTraceDatum TraceDatum;
+		if(!World->QueryTraceData(Handle, TraceDatum))
+		{
+			if(!World->IsTraceHandleValid(Handle, false))
+			{
+				Entry.PendingTraces.Reset();
+				Entry.IsRefreshRequested = true;
+			}
+			return;
+		}
+		if(!FHitResult::GetFirstBlockingHit(TraceDatum.OutHits))
+		{
+			++VisibleCount;
+		}
+	}
+
+	const int32 PointCount {Entry.PendingTraces.Num()};
+	Entry.PendingTraces.Reset();
+	SetResult(Entry, VisibleCount > 0, static_cast<float>(VisibleCount) / PointCount, Entry.TraceTime);
+}
+
+bool ULineOfSightSubsystem::CanRejectEarly(const FLineOfSightEntry& Entry, const FVector& EyeLocation, const FRotator& EyeRotation) const
+{
+	const AActor* Observer {Entry.Observer.Get()};
+	const AActor* Target {Entry.Target.Get()};
+	const FVector ToTarget {Target->GetActorLocation() - EyeLocation};
+	if(ToTarget.SizeSquared() > FMath::Square(Settings->MaxSightDistance)) {return true; }
+
+	if(Entry.ViewConeHalfAngle < 180.0f && (ToTarget.GetSafeNormal() | EyeRotation.Vector()) < FMath::Cos(FMath::DegreesToRadians(Entry.ViewConeHalfAngle)))
+	{
+		return true;
+	}
+
+	if(!RoomMembership || !RoomGraph) {return false; }
+	const int32 ObserverRoomId {RoomMembership->IsActorTracked(Observer) ? RoomMembership->GetActorRoomId(Observer) : RoomMembership->FindRoomId(EyeLocation)};
+	const int32 TargetRoomId {RoomMembership->IsActorTracked(Target) ? RoomMembership->GetActorRoomId(Target) : RoomMembership->FindRoomId(Target->GetActorLocation())};
+	if(ObserverRoomId == INDEX_NONE || TargetRoomId == INDEX_NONE || ObserverRoomId == TargetRoomId) {return false; }
+
+	/** The baked room visibility is exact. Without it, rooms are only considered visible within a number of connections. */
+	if(RoomVisibility && RoomVisibility->HasVisibilityData())
+	{
+		return !RoomVisibility->CanRoomSeeRoom(ObserverRoomId, TargetRoomId);
+	}
+	const int32 RoomDistance {RoomGraph->GetHopDistance(ObserverRoomId, TargetRoomId)};
+	return RoomDistance == INDEX_NONE || RoomDistance > Settings->MaxRoomDistance;
+}
+
+void ULineOfSightSubsystem::GatherTargetPoints(const AActor* Target, TArray<FVector, TInlineAllocator<8>>& OutPoints) const
+{
+	if(const USkeletalMeshComponent* Mesh {Target->FindComponentByClass<USkeletalMeshComponent>()})
+	{
+		for (const FName& Bone : Settings->TargetBones)
+		{
+			if(Mesh->DoesSocketExist(Bone))
+			{
+				OutPoints.Add(Mesh->GetSocketLocation(Bone));
+			}
+		}
+	}
+	if(OutPoints.Num() > 0) {return; }
+
+	FVector EyeLocation;
+	FRotator EyeRotation;
+	Target->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+	OutPoints.Add(Target->GetActorLocation());
+	OutPoints.Add(EyeLocation);
+}
+
+void ULineOfSightSubsystem::SetResult(FLineOfSightEntry& Entry, const bool IsVisible, const float VisibleFraction, const double Time)
+{
+	Entry.Result.IsVisible = IsVisible;
+	Entry.Result.VisibleFraction = VisibleFraction;
+	Entry.ResultTime = Time;
+}
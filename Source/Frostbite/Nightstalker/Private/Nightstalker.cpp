@@ -3,6 +3,13 @@
 // This source code is part of the project Frostbite
 
 #include "Nightstalker.h"
+#include "NightstalkerScriptRunner.h"
+#include "NightstalkerController.h"
+#include "VirtualNightstalkerSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomRelevanceSubsystem.h"
+
+#include "Components/AudioComponent.h"
 
 // Sets default values
 ANightstalker::ANightstalker()
@@ -10,13 +17,137 @@ ANightstalker::ANightstalker()
  	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	/** Construct Script Runner. */
+	ScriptRunner = CreateDefaultSubobject<UNightstalkerScriptRunner>(TEXT("Script Runner"));
+	ScriptRunner->bEditableWhenInherited = false;
 }
 
 // Called when the game starts or when spawned
 void ANightstalker::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	/** Room membership is tracked by the room membership subsystem, so the root component does not need to generate overlap events for room volumes. */
+	if(const UWorld* World {GetWorld()})
+	{
+		if(URoomMembershipSubsystem* RoomMembershipSubsystem {World->GetSubsystem<URoomMembershipSubsystem>()})
+		{
+			RoomMembershipSubsystem->RegisterActor(this, true);
+		}
+
+		/** The nightstalker and its controller are throttled when they are far away from the player. */
+		if(URoomRelevanceSubsystem* RoomRelevanceSubsystem {World->GetSubsystem<URoomRelevanceSubsystem>()})
+		{
+			RoomRelevanceSubsystem->RegisterActor(this);
+		}
+
+		/** When the nightstalker is even further away, it is simulated without its pawn. */
+		if(UVirtualNightstalkerSubsystem* VirtualNightstalkerSubsystem {World->GetSubsystem<UVirtualNightstalkerSubsystem>()})
+		{
+			VirtualNightstalkerSubsystem->RegisterNightstalker(this);
+		}
+	}
+}
+
+void ANightstalker::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(const UWorld* World {GetWorld()})
+	{
+		if(URoomMembershipSubsystem* RoomMembershipSubsystem {World->GetSubsystem<URoomMembershipSubsystem>()})
+		{
+			RoomMembershipSubsystem->UnregisterActor(this);
+		}
+		if(URoomRelevanceSubsystem* RoomRelevanceSubsystem {World->GetSubsystem<URoomRelevanceSubsystem>()})
+		{
+			RoomRelevanceSubsystem->UnregisterActor(this);
+		}
+		if(UVirtualNightstalkerSubsystem* VirtualNightstalkerSubsystem {World->GetSubsystem<UVirtualNightstalkerSubsystem>()})
+		{
+			VirtualNightstalkerSubsystem->UnregisterNightstalker(this);
+		}
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void ANightstalker::SetVirtualized(const bool Value)
+{
+	if(IsVirtualized == Value) {return; }
+	IsVirtualized = Value;
+
+	const UWorld* World {GetWorld()};
+	URoomMembershipSubsystem* RoomMembershipSubsystem {World->GetSubsystem<URoomMembershipSubsystem>()};
+	URoomRelevanceSubsystem* RoomRelevanceSubsystem {World->GetSubsystem<URoomRelevanceSubsystem>()};
+	ANightstalkerController* NightstalkerController {Cast<ANightstalkerController>(GetController())};
+	if(!IsVirtualized)
+	{
+		SetActorHiddenInGame(false);
+		SetActorEnableCollision(true);
+		SetActorTickEnabled(WasTickEnabledBeforeVirtualization);
+		for (const TWeakObjectPtr<UActorComponent>& Component : VirtualizedTickComponents)
+		{
+			if(Component.IsValid())
+			{
+				Component->SetComponentTickEnabled(true);
+			}
+		}
+		for (const TWeakObjectPtr<UAudioComponent>& AudioComponent : VirtualizedAudioComponents)
+		{
+			if(AudioComponent.IsValid())
+			{
+				AudioComponent->SetPaused(false);
+			}
+		}
+		VirtualizedTickComponents.Reset();
+		VirtualizedAudioComponents.Reset();
+		if(NightstalkerController)
+		{
+			NightstalkerController->SetVirtualized(false);
+		}
+
+		/** The room subsystems take over again from the location the nightstalker was rehydrated at. */
+		if(RoomMembershipSubsystem)
+		{
+			RoomMembershipSubsystem->RegisterActor(this, true);
+		}
+		if(RoomRelevanceSubsystem)
+		{
+			RoomRelevanceSubsystem->RegisterActor(this);
+		}
+		return;
+	}
+
+	/** The relevance subsystem restores the ticks it throttled first, so that the state captured here is the original state. */
+	if(RoomRelevanceSubsystem)
+	{
+		RoomRelevanceSubsystem->UnregisterActor(this);
+	}
+	if(RoomMembershipSubsystem)
+	{
+		RoomMembershipSubsystem->UnregisterActor(this);
+	}
+	if(NightstalkerController)
+	{
+		NightstalkerController->SetVirtualized(true);
+	}
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	WasTickEnabledBeforeVirtualization = IsActorTickEnabled();
+	SetActorTickEnabled(false);
+	for (UActorComponent* Component : GetComponents())
+	{
+		if(Component && Component->IsComponentTickEnabled())
+		{
+			Component->SetComponentTickEnabled(false);
+			VirtualizedTickComponents.Add(Component);
+		}
+		UAudioComponent* AudioComponent {Cast<UAudioComponent>(Component)};
+		if(AudioComponent && AudioComponent->IsPlaying())
+		{
+			AudioComponent->SetPaused(true);
+			VirtualizedAudioComponents.Add(AudioComponent);
+		}
+	}
 }
 
 // Called every frame
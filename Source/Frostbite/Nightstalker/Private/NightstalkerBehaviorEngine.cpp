@@ -0,0 +1,250 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "NightstalkerBehaviorEngine.h"
+#include "StatCategories.h"
+
+DECLARE_CYCLE_STAT(TEXT("Nightstalker Behavior Decide"), STAT_NightstalkerBehaviorDecide, STATGROUP_Nightstalker);
+
+FNightstalkerBehaviorDecision FNightstalkerBehaviorEngine::Decide(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NightstalkerBehaviorDecide);
+
+	FNightstalkerBehaviorDecision Decision;
+	Decision.Mode = DecideMode(Snapshot, Settings);
+
+	FRandomStream Random {Snapshot.RandomSeed};
+	switch(Decision.Mode)
+	{
+	case EBehaviorMode::RoamMode: DecideRoam(Snapshot, Settings, Random, Decision);
+		break;
+	case EBehaviorMode::StalkMode: DecideStalk(Snapshot, Settings, Decision);
+		break;
+	case EBehaviorMode::AmbushMode: DecideAmbush(Snapshot, Settings, Decision);
+		break;
+	}
+	return Decision;
+}
+
+EBehaviorMode FNightstalkerBehaviorEngine::DecideMode(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings)
+{
+	/** Without a known room distance to the player, the Nightstalker cannot stalk or ambush. */
+	const int32 Distance {Snapshot.DistanceToPlayer};
+	if(!Snapshot.HasPlayer || Distance == INDEX_NONE)
+	{
+		return Snapshot.Mode == EBehaviorMode::AmbushMode ? EBehaviorMode::StalkMode : Snapshot.Mode;
+	}
+
+	switch(Snapshot.Mode)
+	{
+	case EBehaviorMode::RoamMode:
+		return Distance <= Settings.StalkEnterDistance || Snapshot.CanSeePlayer ? EBehaviorMode::StalkMode : EBehaviorMode::RoamMode;
+	case EBehaviorMode::StalkMode:
+		if(Distance > Settings.RoamEnterDistance) {return EBehaviorMode::RoamMode; }
+		return Distance <= Settings.AmbushEnterDistance ? EBehaviorMode::AmbushMode : EBehaviorMode::StalkMode;
+	case EBehaviorMode::AmbushMode:
+		return Distance > Settings.AmbushEnterDistance + 1 ? EBehaviorMode::StalkMode : EBehaviorMode::AmbushMode;
+	}
+	return Snapshot.Mode;
+}
+
+void FNightstalkerBehaviorEngine::DecideRoam(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings, FRandomStream& Random, FNightstalkerBehaviorDecision& OutDecision)
+{
+	if(Snapshot.HasStimulus && Snapshot.StimulusHeat >= Settings.StimulusInvestigateHeat)
+	{
+		OutDecision.HasTarget = true;
+		OutDecision.TargetLocation = Snapshot.StimulusLocation;
+		OutDecision.TargetRoomId = Snapshot.StimulusRoomId;
+		return;
+	}
+
+	/** The Nightstalker keeps walking to the room it picked until it arrives there, or until it gives up.
+	 *	A target that was picked in another mode, or before roam mode was entered, is not a roam target, so a new one is picked. */
+	const bool IsRoamTarget {Snapshot.Mode == EBehaviorMode::RoamMode && Snapshot.TimeOnPreviousTarget <= Snapshot.TimeInMode};
+	if(Snapshot.HasPreviousTarget && IsRoamTarget && Snapshot.TimeOnPreviousTarget < Settings.RoamTargetTimeout)
+	{
+		const bool HasArrived {Snapshot.SelfRoomId == Snapshot.PreviousTargetRoomId
+			|| FVector::DistSquared(Snapshot.SelfLocation, Snapshot.PreviousTargetLocation) <= FMath::Square(Settings.AcceptanceRadius)};
+		if(!HasArrived)
+		{
+			OutDecision.HasTarget = true;
+			OutDecision.TargetLocation = Snapshot.PreviousTargetLocation;
+			OutDecision.TargetRoomId = Snapshot.PreviousTargetRoomId;
+			return;
+		}
+	}
+
+	/** Rooms further away are more likely to be picked, so that the Nightstalker covers the bunker instead of pacing between two rooms. */
+	int32 TotalWeight {0};
+	for (const FNightstalkerRoomCandidate& Candidate : Snapshot.Candidates)
+	{
+		if(Candidate.RoomId == Snapshot.SelfRoomId || Candidate.RoomId == Snapshot.PreviousTargetRoomId || Candidate.DistanceFromSelf == INDEX_NONE) {continue; }
+		TotalWeight += Candidate.DistanceFromSelf;
+	}
+	if(TotalWeight == 0) {return; }
+
+	int32 Pick {Random.RandRange(0, TotalWeight - 1)};
+	for (const FNightstalkerRoomCandidate& Candidate : Snapshot.Candidates)
+	{
+		if(Candidate.RoomId == Snapshot.SelfRoomId || Candidate.RoomId == Snapshot.PreviousTargetRoomId || Candidate.DistanceFromSelf == INDEX_NONE) {continue; }
+
+		Pick -= Candidate.DistanceFromSelf;
+		if(Pick < 0)
+		{
+			OutDecision.HasTarget = true;
+			OutDecision.TargetLocation = Candidate.Center;
+			OutDecision.TargetRoomId = Candidate.RoomId;
+			return;
+		}
+	}
+}
+
+void FNightstalkerBehaviorEngine::DecideStalk(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings, FNightstalkerBehaviorDecision& OutDecision)
+{
+	if(Snapshot.DistanceToPlayer == INDEX_NONE) {return; }
+
+	/** Too far away, so the Nightstalker closes in through the first portal towards the player. */
+	if(Snapshot.DistanceToPlayer > Settings.StalkHoldDistance)
+	{
+		if(!Snapshot.HasPortalTowardsPlayer) {return; }
+		OutDecision.HasTarget = true;
+		OutDecision.TargetLocation = Snapshot.PortalTowardsPlayer;
+		OutDecision.TargetRoomId = Snapshot.RoomTowardsPlayer;
+		return;
+	}
+
+	/** Too close or seen by the player, so the Nightstalker backs off to the nearest other room at the hold distance. */
+	if(Snapshot.DistanceToPlayer < Settings.StalkHoldDistance || Snapshot.IsSeenByPlayer)
+	{
+		const FNightstalkerRoomCandidate* Best {nullptr};
+		for (const FNightstalkerRoomCandidate& Candidate : Snapshot.Candidates)
+		{
+			if(Candidate.DistanceToPlayer != Settings.StalkHoldDistance || Candidate.DistanceFromSelf == INDEX_NONE || Candidate.RoomId == Snapshot.SelfRoomId) {continue; }
+			if(!Best || Candidate.DistanceFromSelf < Best->DistanceFromSelf)
+			{
+				Best = &Candidate;
+			}
+		}
+		if(!Best) {return; }
+		OutDecision.HasTarget = true;
+		OutDecision.TargetLocation = Best->Center;
+		OutDecision.TargetRoomId = Best->RoomId;
+	}
+}
+
+void FNightstalkerBehaviorEngine::DecideAmbush(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings, FNightstalkerBehaviorDecision& OutDecision)
+{
+	if(!Snapshot.HasPlayer) {return; }
+
+	const FVector PredictedLocation {Snapshot.PlayerLocation + Snapshot.PlayerVelocity * Settings.AmbushLookAheadTime};
+	const int32 BestPoint {FindBestAmbushPoint(Snapshot.AmbushPoints, Snapshot.PlayerLocation, PredictedLocation, Settings)};
+	if(BestPoint != INDEX_NONE)
+	{
+		OutDecision.HasTarget = true;
+		OutDecision.TargetLocation = Snapshot.AmbushPoints.GetLocation(BestPoint);
+		OutDecision.TargetRoomId = Snapshot.AmbushPoints.RoomIds[BestPoint];
+		return;
+	}
+
+	/** Without ambush points, the Nightstalker waits just behind the portal that the player is expected to pass through next. */
+	const FNightstalkerRoomCandidate* Best {nullptr};
+	double BestDistanceSquared {TNumericLimits<double>::Max()};
+	for (const FNightstalkerRoomCandidate& Candidate : Snapshot.Candidates)
+	{
+		if(Candidate.DistanceToPlayer != 1 || Candidate.DistanceFromSelf == INDEX_NONE) {continue; }
+
+		const double DistanceSquared {FVector::DistSquared(Candidate.PlayerRoomPortal, PredictedLocation)};
+		if(DistanceSquared < BestDistanceSquared)
+		{
+			BestDistanceSquared = DistanceSquared;
+			Best = &Candidate;
+		}
+	}
+	if(!Best) {return; }
+
+	OutDecision.HasTarget = true;
+	OutDecision.TargetLocation = Best->PlayerRoomPortal + (Best->Center - Best->PlayerRoomPortal).GetSafeNormal2D() * Settings.AmbushStandOff;
+	OutDecision.TargetRoomId = Best->RoomId;
+}
+
+int32 FNightstalkerBehaviorEngine::FindBestAmbushPoint(const FNightstalkerAmbushPoints& Points, const FVector& PlayerLocation, const FVector& PredictedLocation, const FNightstalkerBehaviorSettings& Settings)
+{
+	/** Score = Cover * CoverWeight + Darkness * DarknessWeight - min(PredictedDistance / Radius, 1) * PredictionWeight - min(PortalDistance / Radius, 1) * PortalWeight.
+	 *	Points within the minimum distance of the player score lowest and are rejected. */
+	const float InverseRadius {1.0f / FMath::Max(Settings.AmbushSearchRadius, 1.0f)};
+	const float MinPlayerDistanceSquared {FMath::Square(Settings.AmbushMinPlayerDistance)};
+	const float Rejected {-TNumericLimits<float>::Max()};
+
+	const VectorRegister4Float PredictedX {VectorSetFloat1(static_cast<float>(PredictedLocation.X))};
+	const VectorRegister4Float PredictedY {VectorSetFloat1(static_cast<float>(PredictedLocation.Y))};
+	const VectorRegister4Float PredictedZ {VectorSetFloat1(static_cast<float>(PredictedLocation.Z))};
+	const VectorRegister4Float PlayerX {VectorSetFloat1(static_cast<float>(PlayerLocation.X))};
+	const VectorRegister4Float PlayerY {VectorSetFloat1(static_cast<float>(PlayerLocation.Y))};
+	const VectorRegister4Float PlayerZ {VectorSetFloat1(static_cast<float>(PlayerLocation.Z))};
+	const VectorRegister4Float CoverWeight {VectorSetFloat1(Settings.AmbushCoverWeight)};
+	const VectorRegister4Float DarknessWeight {VectorSetFloat1(Settings.AmbushDarknessWeight)};
+	const VectorRegister4Float PredictionWeight {VectorSetFloat1(Settings.AmbushPredictionWeight)};
+	const VectorRegister4Float PortalWeight {VectorSetFloat1(Settings.AmbushPortalWeight)};
+	const VectorRegister4Float InverseRadiusVector {VectorSetFloat1(InverseRadius)};
+	const VectorRegister4Float MinPlayerDistanceVector {VectorSetFloat1(MinPlayerDistanceSquared)};
+	const VectorRegister4Float RejectedVector {VectorSetFloat1(Rejected)};
+
+	const int32 PointCount {Points.Num()};
+	int32 BestIndex {INDEX_NONE};
+	float BestScore {Rejected};
+	int32 Index {0};
+	for (; Index + 4 <= PointCount; Index += 4)
+	{
+		const VectorRegister4Float X {VectorLoad(Points.LocationX.GetData() + Index)};
+		const VectorRegister4Float Y {VectorLoad(Points.LocationY.GetData() + Index)};
+		const VectorRegister4Float Z {VectorLoad(Points.LocationZ.GetData() + Index)};
+
+		const VectorRegister4Float PredictedDeltaX {VectorSubtract(X, PredictedX)};
+		const VectorRegister4Float PredictedDeltaY {VectorSubtract(Y, PredictedY)};
+		const VectorRegister4Float PredictedDeltaZ {VectorSubtract(Z, PredictedZ)};
+		const VectorRegister4Float PredictedDistanceSquared {VectorMultiplyAdd(PredictedDeltaX, PredictedDeltaX, VectorMultiplyAdd(PredictedDeltaY, PredictedDeltaY, VectorMultiply(PredictedDeltaZ, PredictedDeltaZ)))};
+		const VectorRegister4Float PredictedDistance {VectorMin(VectorMultiply(VectorSqrt(PredictedDistanceSquared), InverseRadiusVector), GlobalVectorConstants::FloatOne)};
+		const VectorRegister4Float PortalDistance {VectorMin(VectorMultiply(VectorLoad(Points.PortalDistance.GetData() + Index), InverseRadiusVector), GlobalVectorConstants::FloatOne)};
+
+		VectorRegister4Float Score {VectorMultiply(VectorLoad(Points.Cover.GetData() + Index), CoverWeight)};
+		Score = VectorMultiplyAdd(VectorLoad(Points.Darkness.GetData() + Index), DarknessWeight, Score);
+		Score = VectorSubtract(Score, VectorMultiply(PredictedDistance, PredictionWeight));
+		Score = VectorSubtract(Score, VectorMultiply(PortalDistance, PortalWeight));
+
+		const VectorRegister4Float PlayerDeltaX {VectorSubtract(X, PlayerX)};
+		const VectorRegister4Float PlayerDeltaY {VectorSubtract(Y, PlayerY)};
+		const VectorRegister4Float PlayerDeltaZ {VectorSubtract(Z, PlayerZ)};
+		const VectorRegister4Float PlayerDistanceSquared {VectorMultiplyAdd(PlayerDeltaX, PlayerDeltaX, VectorMultiplyAdd(PlayerDeltaY, PlayerDeltaY, VectorMultiply(PlayerDeltaZ, PlayerDeltaZ)))};
+		Score = VectorSelect(VectorCompareLT(PlayerDistanceSquared, MinPlayerDistanceVector), RejectedVector, Score);
+
+		float Scores[4];
+		VectorStore(Score, Scores);
+		for (int32 Lane {0}; Lane < 4; Lane++)
+		{
+			if(Scores[Lane] > BestScore)
+			{
+				BestScore = Scores[Lane];
+				BestIndex = Index + Lane;
+			}
+		}
+	}
+
+	/** The remaining points are scored one at a time. */
+	for (; Index < PointCount; Index++)
+	{
+		const FVector Location {Points.GetLocation(Index)};
+		if(FVector::DistSquared(Location, PlayerLocation) < MinPlayerDistanceSquared) {continue; }
+
+		const float PredictedDistance {FMath::Min(static_cast<float>(FVector::Dist(Location, PredictedLocation)) * InverseRadius, 1.0f)};
+		const float PortalDistance {FMath::Min(Points.PortalDistance[Index] * InverseRadius, 1.0f)};
+		const float Score {Points.Cover[Index] * Settings.AmbushCoverWeight + Points.Darkness[Index] * Settings.AmbushDarknessWeight
+			- PredictedDistance * Settings.AmbushPredictionWeight - PortalDistance * Settings.AmbushPortalWeight};
+		if(Score > BestScore)
+		{
+			BestScore = Score;
+			BestIndex = Index;
+		}
+	}
+	return BestIndex;
+}
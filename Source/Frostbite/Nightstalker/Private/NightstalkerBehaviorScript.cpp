@@ -3,10 +3,13 @@
 // This source code is part of the project Frostbite
 
 #include "NightstalkerBehaviorScript.h"
+#include "Nightstalker.h"
+#include "NightstalkerScriptRunner.h"
 
 UNightstalkerBehaviorScript::UNightstalkerBehaviorScript()
 {
-	PrimaryComponentTick.bCanEverTick = true;
+	/** Scripts are updated by the script runner of the Nightstalker, so they never tick themselves. */
+	PrimaryComponentTick.bCanEverTick = false;
 	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
@@ -14,7 +17,11 @@ void UNightstalkerBehaviorScript::ActivateScript()
 {
 	if(IsScriptActive) {return; }
 
-	SetComponentTickEnabled(true);
+	UNightstalkerScriptRunner* ScriptRunner {GetScriptRunner()};
+	if(!ScriptRunner) {return; }
+
+	Nightstalker = Cast<ANightstalker>(GetOwner());
+	ScriptRunner->RegisterScript(this);
 	
 	IsScriptActive = true;
 	OnActivation.Broadcast();
@@ -24,14 +31,46 @@ void UNightstalkerBehaviorScript::DeactivateScript()
 {
 	if(!IsScriptActive) {return; }
 
-	SetComponentTickEnabled(false);
+	if(UNightstalkerScriptRunner* ScriptRunner {GetScriptRunner()})
+	{
+		ScriptRunner->UnregisterScript(this);
+	}
 	
 	IsScriptActive = false;
 	OnDeactivation.Broadcast();
 }
 
-void UNightstalkerBehaviorScript::TickComponent(float DeltaTime, ELevelTick TickType,
-	FActorComponentTickFunction* ThisTickFunction)
+void UNightstalkerBehaviorScript::UpdateScript(const float DeltaTime)
+{
+	/** Blueprint scripts implement their behavior in the tick event. */
+	if(GetClass()->HasAnyClassFlags(CLASS_CompiledFromBlueprint))
+	{
+		ReceiveTick(DeltaTime);
+	}
+}
+
+void UNightstalkerBehaviorScript::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(IsScriptActive)
+	{
+		if(UNightstalkerScriptRunner* ScriptRunner {GetScriptRunner()})
+		{
+			ScriptRunner->UnregisterScript(this);
+		}
+		IsScriptActive = false;
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+UNightstalkerScriptRunner* UNightstalkerBehaviorScript::GetScriptRunner() const
+{
+	const AActor* Owner {GetOwner()};
+	return Owner ? Owner->FindComponentByClass<UNightstalkerScriptRunner>() : nullptr;
+}
+
+void UNightstalkerBehaviorScript::RecordUpdateCost(const float Milliseconds)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	/** The average follows the cost over roughly the last 16 updates. */
+	LastUpdateCost = Milliseconds;
+	AverageUpdateCost = AverageUpdateCost > 0.0f ? FMath::Lerp(AverageUpdateCost, Milliseconds, 1.0f / 16.0f) : Milliseconds;
 }
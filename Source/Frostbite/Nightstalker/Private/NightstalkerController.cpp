@@ -3,21 +3,77 @@
 // This source code is part of the project Frostbite
 
 #include "NightstalkerController.h"
+#include "NightstalkerSubsystem.h"
+#include "StimulusHeatMapSubsystem.h"
+#include "LineOfSightSubsystem.h"
+#include "AmbushPointSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "NavigationData.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
 #include "LogCategories.h"
+#include "StatCategories.h"
+
+DECLARE_CYCLE_STAT(TEXT("Nightstalker Behavior Snapshot"), STAT_NightstalkerBehaviorSnapshot, STATGROUP_Nightstalker);
+DECLARE_CYCLE_STAT(TEXT("Nightstalker Behavior Apply"), STAT_NightstalkerBehaviorApply, STATGROUP_Nightstalker);
+
+void ANightstalkerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	BehaviorRandom.Initialize(BehaviorSeed != 0 ? BehaviorSeed : FMath::Rand());
+	BehaviorModeStartTime = GetWorld()->GetTimeSeconds();
+
+	/** Only the Blueprint hooks that are implemented by a Blueprint subclass are called. */
+	const UClass* Class {GetClass()};
+	const TPair<FName, ENightstalkerBehaviorHook> Hooks[] {
+		{GET_FUNCTION_NAME_CHECKED(ANightstalkerController, TickRoamMode), ENightstalkerBehaviorHook::TickRoam},
+		{GET_FUNCTION_NAME_CHECKED(ANightstalkerController, TickStalkMode), ENightstalkerBehaviorHook::TickStalk},
+		{GET_FUNCTION_NAME_CHECKED(ANightstalkerController, TickAmbushMode), ENightstalkerBehaviorHook::TickAmbush},
+		{GET_FUNCTION_NAME_CHECKED(ANightstalkerController, UpdateRoamMode), ENightstalkerBehaviorHook::UpdateRoam},
+		{GET_FUNCTION_NAME_CHECKED(ANightstalkerController, UpdateStalkMode), ENightstalkerBehaviorHook::UpdateStalk},
+		{GET_FUNCTION_NAME_CHECKED(ANightstalkerController, UpdateAmbushMode), ENightstalkerBehaviorHook::UpdateAmbush}};
+	for (const TPair<FName, ENightstalkerBehaviorHook>& Hook : Hooks)
+	{
+		if(Class->IsFunctionImplementedInScript(Hook.Key))
+		{
+			ImplementedBlueprintHooks |= 1 << static_cast<uint8>(Hook.Value);
+		}
+	}
+
+	/** The native behavior engine runs from the start, without waiting for a Blueprint to switch the behavior mode. */
+	if(IsNativeBehaviorEnabled)
+	{
+		StartBehaviorModeUpdates();
+	}
+}
 
 void ANightstalkerController::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
+
+	/** Decisions are made on a worker thread and applied on the game thread once they are complete. */
+	if(PendingDecision.IsValid() && PendingDecision.IsCompleted())
+	{
+		const FNightstalkerBehaviorDecision Decision {PendingDecision.GetResult()};
+		PendingDecision = {};
+		ApplyBehaviorDecision(Decision);
+	}
+
 	switch(BehaviorMode)
 	{
-	case EBehaviorMode::RoamMode: TickRoamMode();
+	case EBehaviorMode::RoamMode:
+		if(IsBlueprintHookImplemented(ENightstalkerBehaviorHook::TickRoam)) {TickRoamMode(); }
 		break;
-	case EBehaviorMode::StalkMode: TickStalkMode();
+	case EBehaviorMode::StalkMode:
+		if(IsBlueprintHookImplemented(ENightstalkerBehaviorHook::TickStalk)) {TickStalkMode(); }
 		break;
-	case EBehaviorMode::AmbushMode: TickAmbushMode();
+	case EBehaviorMode::AmbushMode:
+		if(IsBlueprintHookImplemented(ENightstalkerBehaviorHook::TickAmbush)) {TickAmbushMode(); }
 		break;
 	}
-	
 }
 
 void ANightstalkerController::SwitchBehaviorMode(const EBehaviorMode Mode)
@@ -27,34 +83,41 @@ void ANightstalkerController::SwitchBehaviorMode(const EBehaviorMode Mode)
 		return;
 	}
 	BehaviorMode = Mode;
+	BehaviorModeStartTime = GetWorld()->GetTimeSeconds();
 	
-	FTimerManager& TimerManager {GetWorldTimerManager()};
-	/** Clear the update timer. */
-	if(BehaviorUpdateTimerHandle.IsValid())
-	{
-		TimerManager.ClearTimer(BehaviorUpdateTimerHandle);
-	}
-	
-	/** Set the update interval by the behavior mode type. */
-	float Interval {1.0f};
 	switch(BehaviorMode)
 	{
 	case EBehaviorMode::RoamMode:
 		StartRoamMode();
-		Interval = RoamModeUpdateInterval;
 		break;
 	case EBehaviorMode::StalkMode:
 		StartStalkMode();
-		Interval = StalkModeUpdateInterval;
 		break;
 	case EBehaviorMode::AmbushMode:
 		StartAmbushMode();
-		Interval = AmbushModeUpdateInterval;
 		break;
 	}
-	
-	/** Initialize the update timer. */
-	TimerManager.SetTimer(BehaviorUpdateTimerHandle, this, &ANightstalkerController::OnBehaviorModeUpdate, Interval, true);
+	StartBehaviorModeUpdates();
+}
+
+float ANightstalkerController::GetBehaviorModeUpdateInterval(const EBehaviorMode Mode) const
+{
+	switch(Mode)
+	{
+	case EBehaviorMode::RoamMode: return RoamModeUpdateInterval;
+	case EBehaviorMode::StalkMode: return StalkModeUpdateInterval;
+	case EBehaviorMode::AmbushMode: return AmbushModeUpdateInterval;
+	}
+	return 1.0f;
+}
+
+void ANightstalkerController::StartBehaviorModeUpdates()
+{
+	/** The subsystem keeps the phase of the controller when the interval changes, so switching modes does not reset the update. */
+	if(UNightstalkerSubsystem* NightstalkerSubsystem {GetWorld()->GetSubsystem<UNightstalkerSubsystem>()})
+	{
+		NightstalkerSubsystem->ScheduleController(this, GetBehaviorModeUpdateInterval(BehaviorMode));
+	}
 }
 
 void ANightstalkerController::OnBehaviorModeUpdate()
@@ -62,15 +125,262 @@ void ANightstalkerController::OnBehaviorModeUpdate()
 	switch(BehaviorMode)
 	{
 	case EBehaviorMode::RoamMode:
-		UpdateRoamMode();
+		if(IsBlueprintHookImplemented(ENightstalkerBehaviorHook::UpdateRoam)) {UpdateRoamMode(); }
 		break;
 	case EBehaviorMode::StalkMode:
-		UpdateStalkMode();
+		if(IsBlueprintHookImplemented(ENightstalkerBehaviorHook::UpdateStalk)) {UpdateStalkMode(); }
 		break;
 	case EBehaviorMode::AmbushMode:
-		UpdateAmbushMode();
+		if(IsBlueprintHookImplemented(ENightstalkerBehaviorHook::UpdateAmbush)) {UpdateAmbushMode(); }
 		break;
 	}
+
+	if(IsNativeBehaviorEnabled)
+	{
+		RequestBehaviorDecision();
+	}
+}
+
+void ANightstalkerController::GatherBehaviorSnapshot(FNightstalkerBehaviorSnapshot& OutSnapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NightstalkerBehaviorSnapshot);
+
+	const UWorld* World {GetWorld()};
+	OutSnapshot.Mode = BehaviorMode;
+	OutSnapshot.TimeInMode = World->GetTimeSeconds() - BehaviorModeStartTime;
+	OutSnapshot.HasPreviousTarget = LastDecision.HasTarget;
+	OutSnapshot.PreviousTargetLocation = LastDecision.TargetLocation;
+	OutSnapshot.PreviousTargetRoomId = LastDecision.TargetRoomId;
+	OutSnapshot.TimeOnPreviousTarget = World->GetTimeSeconds() - TargetStartTime;
+	OutSnapshot.RandomSeed = BehaviorRandom.RandRange(0, MAX_int32 - 1);
+
+	const APawn* ControlledPawn {GetPawn()};
+	if(!ControlledPawn) {return; }
+	OutSnapshot.SelfLocation = ControlledPawn->GetActorLocation();
+
+	const URoomGraphSubsystem* RoomGraph {World->GetSubsystem<URoomGraphSubsystem>()};
+	const URoomMembershipSubsystem* RoomMembership {World->GetSubsystem<URoomMembershipSubsystem>()};
+	if(!RoomGraph || !RoomMembership) {return; }
+	OutSnapshot.SelfRoomId = RoomMembership->GetActorRoomId(ControlledPawn);
+
+	const UPlayerSubsystem* PlayerSubsystem {World->GetSubsystem<UPlayerSubsystem>()};
+	if(const APlayerCharacter* PlayerCharacter {PlayerSubsystem ? PlayerSubsystem->GetPlayerCharacter() : nullptr})
+	{
+		OutSnapshot.HasPlayer = true;
+		OutSnapshot.PlayerLocation = PlayerCharacter->GetActorLocation();
+		OutSnapshot.PlayerVelocity = PlayerCharacter->GetVelocity();
+		OutSnapshot.PlayerRoomId = RoomMembership->GetActorRoomId(PlayerCharacter);
+	}
+
+	/** The Nightstalker can only take the connections of the nightstalker layer, while the player can take every connection. */
+	OutSnapshot.DistanceToPlayer = RoomGraph->GetHopDistance(OutSnapshot.SelfRoomId, OutSnapshot.PlayerRoomId, ERoomGraphLayer::Nightstalker);
+	if(OutSnapshot.DistanceToPlayer > 0)
+	{
+		OutSnapshot.RoomTowardsPlayer = RoomGraph->GetNextHop(OutSnapshot.SelfRoomId, OutSnapshot.PlayerRoomId, ERoomGraphLayer::Nightstalker);
+		OutSnapshot.HasPortalTowardsPlayer = RoomGraph->GetPortalLocation(OutSnapshot.SelfRoomId, OutSnapshot.RoomTowardsPlayer, OutSnapshot.PortalTowardsPlayer);
+	}
+
+	/** Line of sight is tested asynchronously, so the snapshot holds the last known result. */
+	ULineOfSightSubsystem* LineOfSight {World->GetSubsystem<ULineOfSightSubsystem>()};
+	const APlayerCharacter* PlayerCharacter {PlayerSubsystem ? PlayerSubsystem->GetPlayerCharacter() : nullptr};
+	if(LineOfSight && PlayerCharacter)
+	{
+		FLineOfSightResult Result;
+		OutSnapshot.CanSeePlayer = LineOfSight->GetLineOfSight(ControlledPawn, PlayerCharacter, BehaviorSettings.SightConeHalfAngle, Result) && Result.IsVisible;
+		OutSnapshot.IsSeenByPlayer = LineOfSight->GetLineOfSight(PlayerCharacter, ControlledPawn, BehaviorSettings.PlayerViewConeHalfAngle, Result) && Result.IsVisible;
+	}
+
+	if(const UStimulusHeatMapSubsystem* StimulusHeatMap {World->GetSubsystem<UStimulusHeatMapSubsystem>()})
+	{
+		OutSnapshot.HasStimulus = StimulusHeatMap->FindHottestLocation(OutSnapshot.SelfLocation, BehaviorSettings.StimulusSearchRadius, OutSnapshot.StimulusLocation, OutSnapshot.StimulusHeat);
+		OutSnapshot.StimulusRoomId = OutSnapshot.HasStimulus ? RoomMembership->FindRoomId(OutSnapshot.StimulusLocation) : INDEX_NONE;
+	}
+
+	for (int32 RoomId {0}; RoomId < RoomGraph->GetRoomCount(); RoomId++)
+	{
+		const int32 DistanceFromSelf {RoomGraph->GetHopDistance(OutSnapshot.SelfRoomId, RoomId, ERoomGraphLayer::Nightstalker)};
+		if(DistanceFromSelf == INDEX_NONE || DistanceFromSelf > BehaviorSettings.RoamRadius) {continue; }
+
+		FNightstalkerRoomCandidate& Candidate {OutSnapshot.Candidates.AddDefaulted_GetRef()};
+		Candidate.RoomId = RoomId;
+		Candidate.Center = RoomGraph->GetRoom(RoomId)->GetActorLocation();
+		Candidate.DistanceFromSelf = DistanceFromSelf;
+		Candidate.DistanceToPlayer = RoomGraph->GetHopDistance(RoomId, OutSnapshot.PlayerRoomId);
+		if(Candidate.DistanceToPlayer == 1)
+		{
+			RoomGraph->GetPortalLocation(RoomId, OutSnapshot.PlayerRoomId, Candidate.PlayerRoomPortal);
+		}
+	}
+
+	/** Ambush points are only gathered when the decision can be an ambush, and only in the rooms the Nightstalker ambushes from. */
+	const UAmbushPointSubsystem* AmbushPoints {World->GetSubsystem<UAmbushPointSubsystem>()};
+	const bool CanAmbush {OutSnapshot.DistanceToPlayer != INDEX_NONE && OutSnapshot.DistanceToPlayer <= BehaviorSettings.AmbushEnterDistance + 1};
+	if(AmbushPoints && CanAmbush)
+	{
+		for (const FNightstalkerRoomCandidate& Candidate : OutSnapshot.Candidates)
+		{
+			if(Candidate.DistanceToPlayer != 1) {continue; }
+			AmbushPoints->GatherPoints(Candidate.RoomId, MaxAmbushPoints, OutSnapshot.AmbushPoints);
+		}
+	}
+}
+
+void ANightstalkerController::RequestBehaviorDecision()
+{
+	/** Only one decision is in flight at a time. A slow decision delays the next one instead of piling up. */
+	if(PendingDecision.IsValid() && !PendingDecision.IsCompleted()) {return; }
+
+	FNightstalkerBehaviorSnapshot Snapshot;
+	GatherBehaviorSnapshot(Snapshot);
+	if(IsDecisionSynchronous)
+	{
+		ApplyBehaviorDecision(FNightstalkerBehaviorEngine::Decide(Snapshot, BehaviorSettings));
+		return;
+	}
+	PendingDecision = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Snapshot = MoveTemp(Snapshot), Settings = BehaviorSettings]()
+	{
+		return FNightstalkerBehaviorEngine::Decide(Snapshot, Settings);
+	});
+}
+
+void ANightstalkerController::SetBehaviorSeed(const int32 Seed)
+{
+	BehaviorSeed = Seed;
+	BehaviorRandom.Initialize(Seed);
+}
+
+void ANightstalkerController::SetDecisionSynchronous(const bool Value)
+{
+	IsDecisionSynchronous = Value;
+}
+
+void ANightstalkerController::SetVirtualized(const bool Value)
+{
+	if(IsVirtualized == Value) {return; }
+	IsVirtualized = Value;
+
+	UNightstalkerSubsystem* NightstalkerSubsystem {GetWorld()->GetSubsystem<UNightstalkerSubsystem>()};
+	if(!IsVirtualized)
+	{
+		SetActorTickEnabled(true);
+		if(WasScheduledBeforeVirtualization)
+		{
+			StartBehaviorModeUpdates();
+		}
+		return;
+	}
+
+	/** Everything in flight is dropped, as the pawn will be somewhere else when it is rehydrated. */
+	WasScheduledBeforeVirtualization = NightstalkerSubsystem && NightstalkerSubsystem->IsControllerScheduled(this);
+	if(NightstalkerSubsystem)
+	{
+		NightstalkerSubsystem->UnscheduleController(this);
+	}
+	PendingDecision = {};
+	if(UNightstalkerPathfindingSubsystem* Pathfinding {GetWorld()->GetSubsystem<UNightstalkerPathfindingSubsystem>()})
+	{
+		Pathfinding->CancelRequest(PathRequestId);
+	}
+	PathRequestId = 0;
+	HasPathGoal = false;
+	IsPathRefinedToGoal = false;
+	StopMovement();
+	SetActorTickEnabled(false);
+}
+
+void ANightstalkerController::ApplyBehaviorDecision(const FNightstalkerBehaviorDecision& Decision)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NightstalkerBehaviorApply);
+
+	if(Decision.HasTarget && (!LastDecision.HasTarget || Decision.TargetRoomId != LastDecision.TargetRoomId || !Decision.TargetLocation.Equals(LastDecision.TargetLocation)))
+	{
+		TargetStartTime = GetWorld()->GetTimeSeconds();
+	}
+	LastDecision = Decision;
+	if(Decision.Mode != BehaviorMode)
+	{
+		UE_LOG(LogNightstalkerController, Verbose, TEXT("%s switches to behavior mode %s."), *GetName(), *UEnum::GetValueAsString(Decision.Mode));
+		SwitchBehaviorMode(Decision.Mode);
+	}
+	if(Decision.HasTarget)
+	{
+		MoveAlongPathTo(Decision.TargetLocation);
+	}
+	EventOnBehaviorDecision(Decision);
+}
+
+void ANightstalkerController::MoveAlongPathTo(const FVector& Goal)
+{
+	/** Decisions are made every update, and often pick the same target again. A path that already leads there is kept. */
+	if(HasPathGoal && FVector::DistSquared(Goal, PathGoal) <= FMath::Square(BehaviorSettings.AcceptanceRadius)) {return; }
+
+	PathGoal = Goal;
+	HasPathGoal = true;
+	RequestPathToGoal();
+}
+
+void ANightstalkerController::RequestPathToGoal()
+{
+	UNightstalkerPathfindingSubsystem* Pathfinding {GetWorld()->GetSubsystem<UNightstalkerPathfindingSubsystem>()};
+	const APawn* ControlledPawn {GetPawn()};
+	if(!ControlledPawn) {return; }
+	if(Pathfinding)
+	{
+		Pathfinding->CancelRequest(PathRequestId);
+		PathRequestId = Pathfinding->RequestPath(this, ControlledPawn->GetActorLocation(), PathGoal, FNightstalkerPathDelegate::CreateUObject(this, &ANightstalkerController::HandlePathFound));
+	}
+	if(!Pathfinding || PathRequestId == 0)
+	{
+		HasPathGoal = false;
+		MoveToLocation(PathGoal, BehaviorSettings.AcceptanceRadius);
+	}
+}
+
+void ANightstalkerController::HandlePathFound(const uint32 RequestId, const FNightstalkerPath& Path)
+{
+	if(RequestId != PathRequestId) {return; }
+	PathRequestId = 0;
+
+	/** Without a refined path, the full path to the goal is left to the navigation system. */
+	if(!Path.IsValid || Path.Points.Num() < 2)
+	{
+		HasPathGoal = false;
+		MoveToLocation(PathGoal, BehaviorSettings.AcceptanceRadius);
+		return;
+	}
+
+	IsPathRefinedToGoal = Path.IsComplete();
+	const FNavPathSharedPtr NavPath {MakeShared<FNavigationPath, ESPMode::ThreadSafe>(Path.Points, nullptr)};
+	FAIMoveRequest MoveRequest {Path.Points.Last()};
+	MoveRequest.SetAcceptanceRadius(BehaviorSettings.AcceptanceRadius);
+	MoveRequest.SetUsePathfinding(true);
+	RequestMove(MoveRequest, NavPath);
+}
+
+void ANightstalkerController::OnMoveCompleted(FAIRequestID RequestID, const FPathFollowingResult& Result)
+{
+	Super::OnMoveCompleted(RequestID, Result);
+
+	if(!HasPathGoal) {return; }
+	if(!Result.IsSuccess())
+	{
+		/** A move that failed or was blocked gives up its goal, so that the next decision requests a new path, even to the same target.
+		 *	A move that was only replaced by a new move keeps the goal. */
+		if(!Result.IsInterrupted())
+		{
+			HasPathGoal = false;
+			IsPathRefinedToGoal = false;
+		}
+		return;
+	}
+	if(IsPathRefinedToGoal)
+	{
+		HasPathGoal = false;
+		return;
+	}
+
+	/** The refined segments have been followed. The next segments are refined from here, most of them from the cache. */
+	RequestPathToGoal();
 }
 
 void ANightstalkerController::TickAmbushMode_Implementation()
@@ -111,6 +421,16 @@ void ANightstalkerController::StartRoamMode_Implementation()
 
 void ANightstalkerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	/** A decision that is still in flight only holds a copy of the snapshot, so its result can be discarded. */
+	PendingDecision = {};
+	if(UNightstalkerPathfindingSubsystem* Pathfinding {GetWorld()->GetSubsystem<UNightstalkerPathfindingSubsystem>()})
+	{
+		Pathfinding->CancelRequest(PathRequestId);
+	}
+	if(UNightstalkerSubsystem* NightstalkerSubsystem {GetWorld()->GetSubsystem<UNightstalkerSubsystem>()})
+	{
+		NightstalkerSubsystem->UnscheduleController(this);
+	}
 	Super::EndPlay(EndPlayReason);
 	GetWorld()->GetTimerManager().ClearAllTimersForObject(this);
 }
\ No newline at end of file
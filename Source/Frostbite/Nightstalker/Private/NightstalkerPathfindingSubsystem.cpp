@@ -0,0 +1,269 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "NightstalkerPathfindingSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "AIController.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "TimerManager.h"
+#include "LogCategories.h"
+#include "StatCategories.h"
+
+DECLARE_CYCLE_STAT(TEXT("Nightstalker Path Planning"), STAT_NightstalkerPathPlanning, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Path Segment Cache Hits"), STAT_NightstalkerPathCacheHits, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Path Segment Cache Misses"), STAT_NightstalkerPathCacheMisses, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Path Queries In Flight"), STAT_NightstalkerPathQueries, STATGROUP_Nightstalker);
+
+bool UNightstalkerPathfindingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UNightstalkerPathfindingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.AddUObject(this, &UNightstalkerPathfindingSubsystem::ClearCache);
+	}
+	SegmentCache.Empty(MaxCachedSegments);
+}
+
+void UNightstalkerPathfindingSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	/** Cached segments are only valid for the navmesh they were refined on. */
+	if(UNavigationSystemV1* NavigationSystem {FNavigationSystem::GetCurrent<UNavigationSystemV1>(&InWorld)})
+	{
+		NavigationSystem->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UNightstalkerPathfindingSubsystem::HandleNavigationGenerationFinished);
+	}
+}
+
+void UNightstalkerPathfindingSubsystem::Deinitialize()
+{
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.RemoveAll(this);
+	}
+	if(UNavigationSystemV1* NavigationSystem {FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld())})
+	{
+		NavigationSystem->OnNavigationGenerationFinishedDelegate.RemoveAll(this);
+		for (const TPair<uint32, FNightstalkerSegmentQuery>& Query : PendingQueries)
+		{
+			NavigationSystem->AbortAsyncFindPathRequest(Query.Key);
+		}
+	}
+	PendingQueries.Empty();
+	Requests.Empty();
+	SegmentCache.Empty();
+
+	Super::Deinitialize();
+}
+
+uint32 UNightstalkerPathfindingSubsystem::RequestPath(const AAIController* Querier, const FVector& Start, const FVector& Goal, const FNightstalkerPathDelegate& OnComplete)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NightstalkerPathPlanning);
+
+	UNavigationSystemV1* NavigationSystem {FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld())};
+	if(!Querier || !NavigationSystem) {return 0; }
+
+	const FNavAgentProperties& AgentProperties {Querier->GetNavAgentPropertiesRef()};
+	const ANavigationData* NavData {NavigationSystem->GetNavDataForProps(AgentProperties, Start)};
+	if(!NavData) {return 0; }
+	const FSharedConstNavQueryFilter QueryFilter {UNavigationQueryFilter::GetQueryFilter(*NavData, Querier, Querier->GetDefaultNavigationFilterClass())};
+
+	/** Zero is reserved for failed requests. */
+	LastRequestId = LastRequestId == MAX_uint32 ? 1 : LastRequestId + 1;
+	const uint32 RequestId {LastRequestId};
+	FNightstalkerPathRequest& Request {Requests.Add(RequestId)};
+	Request.OnComplete = OnComplete;
+	PlanPath(Start, Goal, Request.Path);
+
+	const int32 SegmentCount {FMath::Min(RefinedSegmentCount, Request.Path.Waypoints.Num())};
+	Request.Path.RefinedWaypointCount = SegmentCount;
+	Request.SegmentPoints.SetNum(SegmentCount);
+	for (int32 SegmentIndex {0}; SegmentIndex < SegmentCount; SegmentIndex++)
+	{
+		const FVector SegmentStart {SegmentIndex == 0 ? Start : Request.Path.Waypoints[SegmentIndex - 1]};
+		const FVector SegmentEnd {Request.Path.Waypoints[SegmentIndex]};
+
+		/** A segment between two portals only depends on the rooms around it. The first segment starts at the Nightstalker and the last one ends at the goal, so neither is cached. */
+		const bool IsPortalSegment {SegmentIndex > 0 && SegmentIndex < Request.Path.Rooms.Num() - 1};
+		FIntVector Key {INDEX_NONE};
+		if(IsPortalSegment)
+		{
+			Key = FIntVector(Request.Path.Rooms[SegmentIndex - 1], Request.Path.Rooms[SegmentIndex], Request.Path.Rooms[SegmentIndex + 1]);
+			if(const TArray<FVector>* CachedPoints {SegmentCache.FindAndTouch(Key)})
+			{
+				Request.SegmentPoints[SegmentIndex] = *CachedPoints;
+				INC_DWORD_STAT(STAT_NightstalkerPathCacheHits);
+				continue;
+			}
+			INC_DWORD_STAT(STAT_NightstalkerPathCacheMisses);
+		}
+
+		const FPathFindingQuery Query {Querier, *NavData, SegmentStart, SegmentEnd, QueryFilter};
+		if(IsSynchronous)
+		{
+			const FPathFindingResult PathResult {NavigationSystem->FindPathSync(AgentProperties, Query)};
+			TArray<FVector> Points;
+			if(!GetSegmentPoints(PathResult.Result, PathResult.Path, Points))
+			{
+				Request.HasFailed = true;
+				continue;
+			}
+			if(IsPortalSegment)
+			{
+				SegmentCache.Add(Key, Points);
+			}
+			Request.SegmentPoints[SegmentIndex] = MoveTemp(Points);
+			continue;
+		}
+
+		const uint32 QueryId {NavigationSystem->FindPathAsync(AgentProperties, Query, FNavPathQueryDelegate::CreateUObject(this, &UNightstalkerPathfindingSubsystem::HandleSegmentFound))};
+		FNightstalkerSegmentQuery& SegmentQuery {PendingQueries.Add(QueryId)};
+		SegmentQuery.RequestId = RequestId;
+		SegmentQuery.SegmentIndex = SegmentIndex;
+		SegmentQuery.SegmentKey = Key;
+		++Request.PendingSegmentCount;
+	}
+	SET_DWORD_STAT(STAT_NightstalkerPathQueries, PendingQueries.Num());
+
+	/** A request whose segments are all cached is completed in the next frame, so that the caller always knows the request ID before the delegate is called. */
+	if(Request.PendingSegmentCount == 0)
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &UNightstalkerPathfindingSubsystem::CompleteRequest, RequestId));
+	}
+	return RequestId;
+}
+
+void UNightstalkerPathfindingSubsystem::CancelRequest(const uint32 RequestId)
+{
+	if(Requests.Remove(RequestId) == 0) {return; }
+
+	/** Queries of the request are left to finish, so that their segments can still be cached. */
+	UE_LOG(LogNightstalkerPathfinding, VeryVerbose, TEXT("Path request %u was cancelled."), RequestId);
+}
+
+void UNightstalkerPathfindingSubsystem::SetSynchronous(const bool Value)
+{
+	IsSynchronous = Value;
+}
+
+void UNightstalkerPathfindingSubsystem::ClearCache()
+{
+	SegmentCache.Empty(MaxCachedSegments);
+}
+
+void UNightstalkerPathfindingSubsystem::PlanPath(const FVector& Start, const FVector& Goal, FNightstalkerPath& OutPath) const
+{
+	OutPath.Rooms.Reset();
+	OutPath.Waypoints.Reset();
+	if(RoomGraph && RoomMembership)
+	{
+		const int32 StartRoomId {RoomMembership->FindRoomId(Start)};
+		const int32 GoalRoomId {RoomMembership->FindRoomId(Goal)};
+		if(StartRoomId != INDEX_NONE && GoalRoomId != INDEX_NONE && RoomGraph->GetPath(StartRoomId, GoalRoomId, OutPath.Rooms, ERoomGraphLayer::Nightstalker))
+		{
+			for (int32 i {0}; i < OutPath.Rooms.Num() - 1; i++)
+			{
+				FVector Portal;
+				if(!RoomGraph->GetPortalLocation(OutPath.Rooms[i], OutPath.Rooms[i + 1], Portal))
+				{
+					UE_LOG(LogNightstalkerPathfinding, Warning, TEXT("Rooms %d and %d are connected but have no portal."), OutPath.Rooms[i], OutPath.Rooms[i + 1]);
+					OutPath.Rooms.Reset();
+					OutPath.Waypoints.Reset();
+					break;
+				}
+				OutPath.Waypoints.Add(Portal);
+			}
+		}
+		else
+		{
+			OutPath.Rooms.Reset();
+		}
+	}
+	OutPath.Waypoints.Add(Goal);
+}
+
+void UNightstalkerPathfindingSubsystem::HandleSegmentFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath)
+{
+	FNightstalkerSegmentQuery Query;
+	if(!PendingQueries.RemoveAndCopyValue(QueryId, Query)) {return; }
+	SET_DWORD_STAT(STAT_NightstalkerPathQueries, PendingQueries.Num());
+
+	TArray<FVector> Points;
+	const bool IsSuccess {GetSegmentPoints(Result, NavPath, Points)};
+
+	/** The segment is cached even if its request has been cancelled in the meantime. */
+	if(IsSuccess && Query.SegmentKey.X != INDEX_NONE)
+	{
+		SegmentCache.Add(Query.SegmentKey, Points);
+	}
+	FNightstalkerPathRequest* Request {Requests.Find(Query.RequestId)};
+	if(!Request) {return; }
+
+	if(IsSuccess)
+	{
+		Request->SegmentPoints[Query.SegmentIndex] = MoveTemp(Points);
+	}
+	else
+	{
+		Request->HasFailed = true;
+	}
+	if(--Request->PendingSegmentCount == 0)
+	{
+		CompleteRequest(Query.RequestId);
+	}
+}
+
+bool UNightstalkerPathfindingSubsystem::GetSegmentPoints(const ENavigationQueryResult::Type Result, const FNavPathSharedPtr& NavPath, TArray<FVector>& OutPoints)
+{
+	if(Result != ENavigationQueryResult::Success || !NavPath.IsValid() || NavPath->IsPartial()) {return false; }
+
+	OutPoints.Reserve(NavPath->GetPathPoints().Num());
+	for (const FNavPathPoint& PathPoint : NavPath->GetPathPoints())
+	{
+		OutPoints.Add(PathPoint.Location);
+	}
+	return true;
+}
+
+void UNightstalkerPathfindingSubsystem::CompleteRequest(const uint32 RequestId)
+{
+	FNightstalkerPathRequest Request;
+	if(!Requests.RemoveAndCopyValue(RequestId, Request)) {return; }
+
+	FNightstalkerPath& Path {Request.Path};
+	Path.IsValid = !Request.HasFailed;
+	if(Path.IsValid)
+	{
+		for (const TArray<FVector>& SegmentPoints : Request.SegmentPoints)
+		{
+			/** Consecutive segments share the portal they meet at. */
+			const int32 FirstPoint {Path.Points.Num() > 0 && SegmentPoints.Num() > 0 ? 1 : 0};
+			for (int32 i {FirstPoint}; i < SegmentPoints.Num(); i++)
+			{
+				Path.Points.Add(SegmentPoints[i]);
+			}
+		}
+	}
+	else
+	{
+		UE_LOG(LogNightstalkerPathfinding, Verbose, TEXT("Path request %u failed to refine a segment on the navmesh."), RequestId);
+	}
+	Request.OnComplete.ExecuteIfBound(RequestId, Path);
+}
+
+void UNightstalkerPathfindingSubsystem::HandleNavigationGenerationFinished(ANavigationData* NavData)
+{
+	ClearCache();
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "NightstalkerScriptRunner.h"
+#include "NightstalkerBehaviorScript.h"
+#include "StatCategories.h"
+
+DECLARE_CYCLE_STAT(TEXT("Nightstalker Script Runner Tick"), STAT_NightstalkerScriptRunnerTick, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Active Scripts"), STAT_NightstalkerActiveScripts, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Script Updates"), STAT_NightstalkerScriptUpdates, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Deferred Script Updates"), STAT_NightstalkerDeferredScriptUpdates, STATGROUP_Nightstalker);
+
+UNightstalkerScriptRunner::UNightstalkerScriptRunner()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UNightstalkerScriptRunner::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	SCOPE_CYCLE_COUNTER(STAT_NightstalkerScriptRunnerTick);
+	INC_DWORD_STAT_BY(STAT_NightstalkerActiveScripts, ActiveScripts.Num());
+
+	const double StartTime {FPlatformTime::Seconds()};
+	const double Budget {UpdateBudget / 1000.0};
+	int32 Updates {0};
+	int32 DeferredUpdates {0};
+
+	IsUpdating = true;
+	for (int32 i {0}; i < ActiveScripts.Num(); i++)
+	{
+		UNightstalkerBehaviorScript* Script {ActiveScripts[i]};
+		if(!IsValid(Script)) {continue; }
+
+		Script->TimeSinceUpdate += DeltaTime;
+		if(Script->TimeSinceUpdate < Script->GetUpdateInterval()) {continue; }
+
+		/** Once the budget is spent, lower priority scripts stay due until the next frame, unless they have been deferred for too long. */
+		if(Updates > 0 && Script->DeferredFrames < MaxDeferredFrames && FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			++Script->DeferredFrames;
+			++DeferredUpdates;
+			continue;
+		}
+
+		/** Scripts receive the time since their last update, so that throttled and deferred scripts remain frame rate independent. */
+		const float ScriptDeltaTime {Script->TimeSinceUpdate};
+		Script->TimeSinceUpdate = 0.0f;
+		Script->DeferredFrames = 0;
+
+		const double ScriptStartTime {FPlatformTime::Seconds()};
+		{
+			FScopeCycleCounterUObject ScriptScope {Script};
+			Script->UpdateScript(ScriptDeltaTime);
+		}
+		Script->RecordUpdateCost(static_cast<float>((FPlatformTime::Seconds() - ScriptStartTime) * 1000.0));
+		++Updates;
+	}
+	IsUpdating = false;
+
+	/** Apply the changes that scripts made to the active scripts during the update. */
+	ActiveScripts.RemoveAll([](const UNightstalkerBehaviorScript* Script) {return !IsValid(Script); });
+	for (UNightstalkerBehaviorScript* Script : PendingScripts)
+	{
+		InsertScript(Script);
+	}
+	PendingScripts.Reset();
+	if(ActiveScripts.Num() == 0)
+	{
+		SetComponentTickEnabled(false);
+	}
+
+	INC_DWORD_STAT_BY(STAT_NightstalkerScriptUpdates, Updates);
+	INC_DWORD_STAT_BY(STAT_NightstalkerDeferredScriptUpdates, DeferredUpdates);
+}
+
+void UNightstalkerScriptRunner::RegisterScript(UNightstalkerBehaviorScript* Script)
+{
+	if(!Script || ActiveScripts.Contains(Script) || PendingScripts.Contains(Script)) {return; }
+
+	Script->TimeSinceUpdate = Script->GetUpdateInterval();
+	Script->DeferredFrames = 0;
+	if(IsUpdating)
+	{
+		PendingScripts.Add(Script);
+		return;
+	}
+	InsertScript(Script);
+	SetComponentTickEnabled(true);
+}
+
+void UNightstalkerScriptRunner::UnregisterScript(UNightstalkerBehaviorScript* Script)
+{
+	if(PendingScripts.Remove(Script) > 0) {return; }
+
+	const int32 Index {ActiveScripts.Find(Script)};
+	if(Index == INDEX_NONE) {return; }
+
+	/** The array cannot shrink while it is being iterated, so the script is cleared and removed after the update. */
+	if(IsUpdating)
+	{
+		ActiveScripts[Index] = nullptr;
+		return;
+	}
+	ActiveScripts.RemoveAt(Index);
+	if(ActiveScripts.Num() == 0)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UNightstalkerScriptRunner::SetUpdateBudget(const float Milliseconds)
+{
+	UpdateBudget = FMath::Max(Milliseconds, 0.0f);
+}
+
+void UNightstalkerScriptRunner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ActiveScripts.Empty();
+	PendingScripts.Empty();
+	Super::EndPlay(EndPlayReason);
+}
+
+void UNightstalkerScriptRunner::InsertScript(UNightstalkerBehaviorScript* Script)
+{
+	int32 Index {0};
+	while(Index < ActiveScripts.Num() && ActiveScripts[Index]->GetPriority() >= Script->GetPriority())
+	{
+		++Index;
+	}
+	ActiveScripts.Insert(Script, Index);
+}
@@ -0,0 +1,365 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "NightstalkerSimulationCommandlet.h"
+#include "Nightstalker.h"
+#include "NightstalkerController.h"
+#include "NightstalkerStart.h"
+#include "NightstalkerSubsystem.h"
+#include "NightstalkerPathfindingSubsystem.h"
+#include "NightstalkerScriptRunner.h"
+#include "PlayerCharacter.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "LogCategories.h"
+
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerStart.h"
+#include "Components/CapsuleComponent.h"
+#include "NavigationSystem.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+
+UNightstalkerSimulationCommandlet::UNightstalkerSimulationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UNightstalkerSimulationCommandlet::Main(const FString& Params)
+{
+	FString MapName;
+	float Duration {300.0f};
+	float FrameRate {30.0f};
+	int32 Seed {1337};
+	float Speed {300.0f};
+	FString PlayerClassPath;
+	FString NightstalkerClassPath;
+	int32 NightstalkerCount {1};
+	FString CsvPath;
+	FParse::Value(*Params, TEXT("Map="), MapName);
+	FParse::Value(*Params, TEXT("Seconds="), Duration);
+	FParse::Value(*Params, TEXT("Fps="), FrameRate);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Speed="), Speed);
+	FParse::Value(*Params, TEXT("Player="), PlayerClassPath);
+	FParse::Value(*Params, TEXT("Nightstalker="), NightstalkerClassPath);
+	FParse::Value(*Params, TEXT("Count="), NightstalkerCount);
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+	if(MapName.IsEmpty())
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("No map was given. Use -Map=/Game/Path/Map."));
+		return 1;
+	}
+
+	UWorld* World {LoadWorld(MapName)};
+	if(!World) {return 1; }
+
+	APlayerCharacter* PlayerCharacter {SpawnPlayer(World, PlayerClassPath)};
+	if(!PlayerCharacter)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+		return 1;
+	}
+	SpawnNightstalkers(World, NightstalkerClassPath, NightstalkerCount);
+
+	/** Every source of frame timing dependent behavior is removed: the update budgets, worker thread decisions and asynchronous path queries. */
+	UNightstalkerSubsystem* NightstalkerSubsystem {World->GetSubsystem<UNightstalkerSubsystem>()};
+	NightstalkerSubsystem->SetUpdateBudget(TNumericLimits<float>::Max());
+	if(UNightstalkerPathfindingSubsystem* Pathfinding {World->GetSubsystem<UNightstalkerPathfindingSubsystem>()})
+	{
+		Pathfinding->SetSynchronous(true);
+	}
+
+	/** Controllers are seeded in the order of their names, so that the seed of every controller is the same in every run. */
+	TArray<ANightstalkerController*> Controllers;
+	for (TActorIterator<ANightstalkerController> It {World}; It; ++It)
+	{
+		Controllers.Add(*It);
+	}
+	Controllers.Sort([](const ANightstalkerController& A, const ANightstalkerController& B) {return A.GetName() < B.GetName(); });
+	TMap<const ANightstalkerController*, int32> ControllerIndices;
+	for (int32 i {0}; i < Controllers.Num(); i++)
+	{
+		Controllers[i]->SetBehaviorSeed(Seed + i + 1);
+		Controllers[i]->SetDecisionSynchronous(true);
+		ControllerIndices.Add(Controllers[i], i);
+
+		/** The script runner defers scripts once its own budget is spent, which depends on the wall clock as much as the update budget. */
+		if(const ANightstalker* Nightstalker {Cast<ANightstalker>(Controllers[i]->GetPawn())})
+		{
+			Nightstalker->GetScriptRunner()->SetUpdateBudget(TNumericLimits<float>::Max());
+		}
+	}
+	UE_LOG(LogNightstalker, Display, TEXT("Simulating %d Nightstalkers on %s for %.0f seconds at %.0f fps."), Controllers.Num(), *MapName, Duration, FrameRate);
+
+	FRandomStream Random {Seed};
+	TArray<FVector> Waypoints;
+	BuildPlayerTour(World, PlayerCharacter->GetActorLocation(), Duration * Speed, PlayerCharacter->GetCapsuleComponent()->GetScaledCapsuleHalfHeight(), Random, Waypoints);
+
+	const float DeltaTime {1.0f / FMath::Max(FrameRate, 1.0f)};
+	const int32 NumFrames {FMath::CeilToInt32(Duration / DeltaTime)};
+	TArray<FNightstalkerSimulationRecord> Records;
+	int32 Frame {0};
+	const FDelegateHandle UpdateHandle {NightstalkerSubsystem->OnControllerUpdated.AddLambda([&Records, &Frame, &ControllerIndices, World](ANightstalkerController* Controller, const double Seconds)
+	{
+		if(!Controller) {return; }
+		FNightstalkerSimulationRecord& Record {Records.AddDefaulted_GetRef()};
+		Record.Frame = Frame;
+		Record.Time = World->GetTimeSeconds();
+		Record.ControllerIndex = ControllerIndices.FindRef(Controller, INDEX_NONE);
+		Record.Microseconds = Seconds * 1000000.0;
+		Record.Decision = Controller->GetLastBehaviorDecision();
+	})};
+
+	UCharacterMovementComponent* Movement {PlayerCharacter->GetCharacterMovement()};
+	int32 Segment {0};
+	float SegmentStart {0.0f};
+	for (Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const FVector Location {GetTourLocation(Waypoints, Frame * DeltaTime * Speed, Segment, SegmentStart)};
+		Movement->Velocity = (Location - PlayerCharacter->GetActorLocation()) / DeltaTime;
+		PlayerCharacter->SetActorLocation(Location);
+
+		World->Tick(LEVELTICK_All, DeltaTime);
+
+		/** Streaming levels finish loading within the frame, so that loading times cannot change the simulation. */
+		World->FlushLevelStreaming(EFlushLevelStreamingType::Full);
+	}
+	NightstalkerSubsystem->OnControllerUpdated.Remove(UpdateHandle);
+
+	ReportResults(Records, CsvPath);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+
+	/** A run without updates has an empty trace, whose hash would match every other broken run. */
+	if(Records.Num() == 0)
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("No Nightstalker updates were recorded. Make sure the map contains Nightstalkers or pass -Nightstalker=."));
+		return 1;
+	}
+	return 0;
+}
+
+UWorld* UNightstalkerSimulationCommandlet::LoadWorld(const FString& MapName)
+{
+	UPackage* Package {LoadPackage(nullptr, *MapName, LOAD_None)};
+	UWorld* World {Package ? UWorld::FindWorldInPackage(Package) : nullptr};
+	if(!World)
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("Failed to load map %s."), *MapName);
+		return nullptr;
+	}
+
+	/** The world type has to be set before the world is initialized, as the world subsystems only support game worlds. */
+	World->AddToRoot();
+	World->WorldType = EWorldType::Game;
+	FWorldContext& WorldContext {GEngine->CreateNewWorldContext(EWorldType::Game)};
+	WorldContext.SetCurrentWorld(World);
+	if(!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).CreatePhysicsScene(true).CreateNavigation(true).CreateAISystem(true).EnableTraceCollision(true));
+	}
+	FNavigationSystem::AddNavigationSystemToWorld(*World, FNavigationSystemRunMode::GameMode);
+
+	/** Actors only begin play through the game mode, which is created from the world settings of the map as in a regular game startup. */
+	const FURL URL;
+	if(!World->SetGameMode(URL))
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("Failed to create the game mode of map %s."), *MapName);
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+		return nullptr;
+	}
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+	return World;
+}
+
+APlayerCharacter* UNightstalkerSimulationCommandlet::SpawnPlayer(UWorld* World, const FString& PlayerClassPath)
+{
+	UClass* PlayerClass {PlayerClassPath.IsEmpty() ? APlayerCharacter::StaticClass() : LoadClass<APlayerCharacter>(nullptr, *PlayerClassPath)};
+	if(!PlayerClass)
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("Failed to load player class %s."), *PlayerClassPath);
+		return nullptr;
+	}
+
+	FTransform SpawnTransform {FTransform::Identity};
+	for (TActorIterator<APlayerStart> It {World}; It; ++It)
+	{
+		SpawnTransform = It->GetActorTransform();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	APlayerCharacter* PlayerCharacter {World->SpawnActor<APlayerCharacter>(PlayerClass, SpawnTransform, SpawnParameters)};
+	if(!PlayerCharacter)
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("Failed to spawn the player."));
+		return nullptr;
+	}
+	PlayerCharacter->GetCharacterMovement()->SetComponentTickEnabled(false);
+	return PlayerCharacter;
+}
+
+void UNightstalkerSimulationCommandlet::SpawnNightstalkers(UWorld* World, const FString& NightstalkerClassPath, const int32 Count)
+{
+	if(NightstalkerClassPath.IsEmpty() || Count <= 0) {return; }
+
+	UClass* NightstalkerClass {LoadClass<ANightstalker>(nullptr, *NightstalkerClassPath)};
+	if(!NightstalkerClass)
+	{
+		UE_LOG(LogNightstalker, Error, TEXT("Failed to load Nightstalker class %s."), *NightstalkerClassPath);
+		return;
+	}
+
+	TArray<FTransform> SpawnTransforms;
+	for (TActorIterator<ANightstalkerStart> It {World}; It; ++It)
+	{
+		SpawnTransforms.Add(It->GetActorTransform());
+	}
+	if(SpawnTransforms.Num() == 0)
+	{
+		UE_LOG(LogNightstalker, Warning, TEXT("The map contains no Nightstalker starts. Nightstalkers are spawned at the origin."));
+		SpawnTransforms.Add(FTransform::Identity);
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	for (int32 i {0}; i < Count; i++)
+	{
+		ANightstalker* Nightstalker {World->SpawnActor<ANightstalker>(NightstalkerClass, SpawnTransforms[i % SpawnTransforms.Num()], SpawnParameters)};
+		if(Nightstalker && !Nightstalker->GetController())
+		{
+			Nightstalker->SpawnDefaultController();
+		}
+	}
+}
+
+void UNightstalkerSimulationCommandlet::BuildPlayerTour(const UWorld* World, const FVector& Start, const float Length, const float HalfHeight, FRandomStream& Random, TArray<FVector>& OutWaypoints)
+{
+	OutWaypoints.Add(Start);
+
+	const URoomGraphSubsystem* RoomGraph {World->GetSubsystem<URoomGraphSubsystem>()};
+	const URoomMembershipSubsystem* RoomMembership {World->GetSubsystem<URoomMembershipSubsystem>()};
+	int32 RoomId {RoomGraph && RoomMembership ? RoomMembership->FindRoomId(Start) : INDEX_NONE};
+	if(RoomId == INDEX_NONE)
+	{
+		UE_LOG(LogNightstalker, Warning, TEXT("The player does not start in a room. The player will stand still."));
+		return;
+	}
+
+	const auto ProjectToFloor {[World, HalfHeight](const FVector& Location)
+	{
+		FHitResult HitResult;
+		if(World->LineTraceSingleByChannel(HitResult, Location + FVector(0.0, 0.0, 100.0), Location - FVector(0.0, 0.0, 10000.0), ECC_Visibility))
+		{
+			return HitResult.ImpactPoint + FVector(0.0, 0.0, HalfHeight);
+		}
+		return Location;
+	}};
+
+	int32 PreviousRoomId {INDEX_NONE};
+	float TourLength {0.0f};
+	TArray<int32, TInlineAllocator<8>> Candidates;
+	while(TourLength < Length && OutWaypoints.Num() < MaxWaypoints)
+	{
+		Candidates.Reset();
+		for (const int32 NeighborId : RoomGraph->GetNeighbors(RoomId))
+		{
+			if(NeighborId != PreviousRoomId)
+			{
+				Candidates.Add(NeighborId);
+			}
+		}
+		if(Candidates.Num() == 0 && PreviousRoomId != INDEX_NONE)
+		{
+			Candidates.Add(PreviousRoomId);
+		}
+		if(Candidates.Num() == 0) {break; }
+
+		const int32 NextRoomId {Candidates[Random.RandRange(0, Candidates.Num() - 1)]};
+		FVector Portal;
+		if(RoomGraph->GetPortalLocation(RoomId, NextRoomId, Portal))
+		{
+			const FVector Waypoint {ProjectToFloor(Portal)};
+			TourLength += FVector::Dist(OutWaypoints.Last(), Waypoint);
+			OutWaypoints.Add(Waypoint);
+		}
+		if(const ARoomVolume* NextRoom {RoomGraph->GetRoom(NextRoomId)})
+		{
+			const FVector Waypoint {ProjectToFloor(NextRoom->GetActorLocation())};
+			TourLength += FVector::Dist(OutWaypoints.Last(), Waypoint);
+			OutWaypoints.Add(Waypoint);
+		}
+
+		PreviousRoomId = RoomId;
+		RoomId = NextRoomId;
+	}
+}
+
+FVector UNightstalkerSimulationCommandlet::GetTourLocation(const TArray<FVector>& Waypoints, const float Distance, int32& InOutSegment, float& InOutSegmentStart)
+{
+	while(InOutSegment < Waypoints.Num() - 1)
+	{
+		const float SegmentLength {static_cast<float>(FVector::Dist(Waypoints[InOutSegment], Waypoints[InOutSegment + 1]))};
+		if(Distance <= InOutSegmentStart + SegmentLength)
+		{
+			const float Alpha {SegmentLength > 0.0f ? (Distance - InOutSegmentStart) / SegmentLength : 1.0f};
+			return FMath::Lerp(Waypoints[InOutSegment], Waypoints[InOutSegment + 1], Alpha);
+		}
+		InOutSegmentStart += SegmentLength;
+		++InOutSegment;
+	}
+	return Waypoints.Last();
+}
+
+void UNightstalkerSimulationCommandlet::ReportResults(const TArray<FNightstalkerSimulationRecord>& Records, const FString& CsvPath)
+{
+	FString CsvRows {TEXT("Frame,Time,Controller,Microseconds,Mode,HasTarget,TargetRoomId,TargetX,TargetY,TargetZ\n")};
+	TArray<double> Microseconds;
+	Microseconds.Reserve(Records.Num());
+	uint32 DecisionHash {0};
+	for (const FNightstalkerSimulationRecord& Record : Records)
+	{
+		/** The cost differs between runs, so it is left out of the decision trace. */
+		const FNightstalkerBehaviorDecision& Decision {Record.Decision};
+		const FString DecisionRow {FString::Printf(TEXT("%d,%.4f,%d,%s,%d,%d,%.2f,%.2f,%.2f"), Record.Frame, Record.Time, Record.ControllerIndex,
+			*UEnum::GetValueAsString(Decision.Mode), Decision.HasTarget, Decision.TargetRoomId, Decision.TargetLocation.X, Decision.TargetLocation.Y, Decision.TargetLocation.Z)};
+		DecisionHash = FCrc::StrCrc32(*DecisionRow, DecisionHash);
+		Microseconds.Add(Record.Microseconds);
+
+		CsvRows += FString::Printf(TEXT("%d,%.4f,%d,%.3f,%s,%d,%d,%.2f,%.2f,%.2f\n"), Record.Frame, Record.Time, Record.ControllerIndex, Record.Microseconds,
+			*UEnum::GetValueAsString(Decision.Mode), Decision.HasTarget, Decision.TargetRoomId, Decision.TargetLocation.X, Decision.TargetLocation.Y, Decision.TargetLocation.Z);
+	}
+
+	double MedianMicroseconds {0.0};
+	double P99Microseconds {0.0};
+	double MaxMicroseconds {0.0};
+	if(Microseconds.Num() > 0)
+	{
+		Microseconds.Sort();
+		MedianMicroseconds = Microseconds[(Microseconds.Num() - 1) / 2];
+		P99Microseconds = Microseconds[FMath::FloorToInt32((Microseconds.Num() - 1) * 0.99)];
+		MaxMicroseconds = Microseconds.Last();
+	}
+	UE_LOG(LogNightstalker, Display, TEXT("Updates: %d, us/update p50: %.2f p99: %.2f max: %.2f, decision trace hash: %08X"),
+		Records.Num(), MedianMicroseconds, P99Microseconds, MaxMicroseconds, DecisionHash);
+
+	/** Every run writes its own trace, so that the traces of two runs can be compared line by line. */
+	if(CsvPath.IsEmpty()) {return; }
+	FFileHelper::SaveStringToFile(CsvRows, *CsvPath);
+}
@@ -3,4 +3,183 @@
 // This source code is part of the project Frostbite
 
 #include "NightstalkerSubsystem.h"
+#include "NightstalkerController.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
+#include "StatCategories.h"
 
+DECLARE_CYCLE_STAT(TEXT("Nightstalker Scheduler Tick"), STAT_NightstalkerSchedulerTick, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Scheduled Controllers"), STAT_NightstalkerScheduledControllers, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Updates Per Frame"), STAT_NightstalkerUpdatesPerFrame, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Nightstalker Deferred Updates"), STAT_NightstalkerDeferredUpdates, STATGROUP_Nightstalker);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Nightstalker Frame Latency (ms)"), STAT_NightstalkerFrameLatency, STATGROUP_Nightstalker);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Nightstalker Worst Latency (ms)"), STAT_NightstalkerWorstLatency, STATGROUP_Nightstalker);
+
+namespace
+{
+	/** Orders the update queue by due time. */
+	struct FDueTimePredicate
+	{
+		FORCEINLINE bool operator()(const FNightstalkerUpdateEntry& A, const FNightstalkerUpdateEntry& B) const {return A.DueTime < B.DueTime; }
+	};
+}
+
+bool UNightstalkerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UNightstalkerSubsystem::Deinitialize()
+{
+	UpdateQueue.Empty();
+	DueUpdates.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UNightstalkerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNightstalkerSubsystem, STATGROUP_Nightstalker);
+}
+
+void UNightstalkerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NightstalkerSchedulerTick);
+	SET_DWORD_STAT(STAT_NightstalkerScheduledControllers, UpdateQueue.Num());
+	if(UpdateQueue.Num() == 0) {return; }
+
+	/** Take all due updates from the queue. */
+	const double Now {GetWorld()->GetTimeSeconds()};
+	DueUpdates.Reset();
+	while(UpdateQueue.Num() > 0 && UpdateQueue.HeapTop().DueTime <= Now)
+	{
+		FNightstalkerUpdateEntry Entry;
+		UpdateQueue.HeapPop(Entry, FDueTimePredicate(), false);
+		if(!Entry.Controller.IsValid()) {continue; }
+
+		Entry.Priority = GetUpdatePriority(Entry.Controller.Get());
+		DueUpdates.Add(Entry);
+	}
+
+	/** Nightstalkers closer to the player are updated first, as their behavior is the most noticeable. */
+	DueUpdates.Sort([](const FNightstalkerUpdateEntry& A, const FNightstalkerUpdateEntry& B) {return A.Priority < B.Priority; });
+
+	const double StartTime {FPlatformTime::Seconds()};
+	const double Budget {UpdateBudget / 1000.0};
+	int32 Updates {0};
+	int32 DeferredUpdates {0};
+	float FrameLatency {0.0f};
+	for (DueIndex = 0; DueIndex < DueUpdates.Num(); ++DueIndex)
+	{
+		/** Due updates are never added while the loop runs, so the reference stays valid during the update. */
+		FNightstalkerUpdateEntry& Entry {DueUpdates[DueIndex]};
+		if(Entry.IsUnscheduled || !Entry.Controller.IsValid()) {continue; }
+
+		/** Once the budget is spent, the remaining updates stay due and are reconsidered in the next frame. */
+		if(Updates > 0 && FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			++DeferredUpdates;
+			UpdateQueue.HeapPush(Entry, FDueTimePredicate());
+			continue;
+		}
+
+		FrameLatency = FMath::Max(FrameLatency, static_cast<float>((Now - Entry.DueTime) * 1000.0));
+		const double UpdateStartTime {FPlatformTime::Seconds()};
+		Entry.Controller->OnBehaviorModeUpdate();
+		++Updates;
+		OnControllerUpdated.Broadcast(Entry.Controller.Get(), FPlatformTime::Seconds() - UpdateStartTime);
+		if(Entry.IsUnscheduled || !Entry.Controller.IsValid()) {continue; }
+
+		/** The next update keeps the phase of the controller, unless the update is so late that it would be due again immediately. */
+		Entry.LastUpdateTime = Now;
+		Entry.DueTime = FMath::Max(Entry.DueTime + Entry.Interval, Now + Entry.Interval * 0.5);
+		UpdateQueue.HeapPush(Entry, FDueTimePredicate());
+	}
+	DueUpdates.Reset();
+	DueIndex = 0;
+
+	WorstLatency = FMath::Max(WorstLatency, FrameLatency);
+	SET_DWORD_STAT(STAT_NightstalkerUpdatesPerFrame, Updates);
+	SET_DWORD_STAT(STAT_NightstalkerDeferredUpdates, DeferredUpdates);
+	SET_FLOAT_STAT(STAT_NightstalkerFrameLatency, FrameLatency);
+	SET_FLOAT_STAT(STAT_NightstalkerWorstLatency, WorstLatency);
+}
+
+void UNightstalkerSubsystem::ScheduleController(ANightstalkerController* Controller, const float Interval)
+{
+	if(!Controller) {return; }
+
+	const double Now {GetWorld()->GetTimeSeconds()};
+	const float ClampedInterval {FMath::Max(Interval, 0.01f)};
+	const int32 DueUpdateIndex {FindDueUpdate(Controller)};
+	if(DueUpdateIndex != INDEX_NONE)
+	{
+		/** A due update keeps its due time, and the next due time is derived from the new interval once it has run. */
+		DueUpdates[DueUpdateIndex].Interval = ClampedInterval;
+		DueUpdates[DueUpdateIndex].IsUnscheduled = false;
+		return;
+	}
+	if(FNightstalkerUpdateEntry* Entry {UpdateQueue.FindByPredicate([Controller](const FNightstalkerUpdateEntry& Candidate) {return Candidate.Controller.Get() == Controller; })})
+	{
+		Entry->Interval = ClampedInterval;
+		Entry->DueTime = FMath::Max(Entry->LastUpdateTime + ClampedInterval, Now);
+		UpdateQueue.Heapify(FDueTimePredicate());
+		return;
+	}
+
+	/** The first update is offset by a fraction of the interval from the golden ratio sequence, which spreads any number of controllers evenly. */
+	const float Phase {FMath::Frac(RegistrationCount++ * 0.618034f)};
+	FNightstalkerUpdateEntry Entry;
+	Entry.Controller = Controller;
+	Entry.Interval = ClampedInterval;
+	Entry.LastUpdateTime = Now;
+	Entry.DueTime = Now + ClampedInterval * Phase;
+	UpdateQueue.HeapPush(Entry, FDueTimePredicate());
+}
+
+void UNightstalkerSubsystem::UnscheduleController(ANightstalkerController* Controller)
+{
+	if(!Controller) {return; }
+
+	const int32 DueUpdateIndex {FindDueUpdate(Controller)};
+	if(DueUpdateIndex != INDEX_NONE)
+	{
+		DueUpdates[DueUpdateIndex].IsUnscheduled = true;
+		return;
+	}
+
+	const int32 Index {UpdateQueue.IndexOfByPredicate([Controller](const FNightstalkerUpdateEntry& Entry) {return Entry.Controller.Get() == Controller; })};
+	if(Index == INDEX_NONE) {return; }
+	UpdateQueue.HeapRemoveAt(Index, FDueTimePredicate(), false);
+}
+
+bool UNightstalkerSubsystem::IsControllerScheduled(const ANightstalkerController* Controller) const
+{
+	if(!Controller) {return false; }
+
+	const int32 DueUpdateIndex {FindDueUpdate(Controller)};
+	if(DueUpdateIndex != INDEX_NONE) {return !DueUpdates[DueUpdateIndex].IsUnscheduled; }
+	return UpdateQueue.ContainsByPredicate([Controller](const FNightstalkerUpdateEntry& Entry) {return Entry.Controller.Get() == Controller; });
+}
+
+void UNightstalkerSubsystem::SetUpdateBudget(const float Milliseconds)
+{
+	UpdateBudget = FMath::Max(Milliseconds, 0.0f);
+}
+
+float UNightstalkerSubsystem::GetUpdatePriority(const ANightstalkerController* Controller) const
+{
+	const APawn* Pawn {Controller->GetPawn()};
+	const UPlayerSubsystem* PlayerSubsystem {GetWorld()->GetSubsystem<UPlayerSubsystem>()};
+	const APlayerCharacter* PlayerCharacter {PlayerSubsystem ? PlayerSubsystem->GetPlayerCharacter() : nullptr};
+	if(!Pawn || !PlayerCharacter) {return TNumericLimits<float>::Max(); }
+	return FVector::Dist(Pawn->GetActorLocation(), PlayerCharacter->GetActorLocation());
+}
+
+int32 UNightstalkerSubsystem::FindDueUpdate(const ANightstalkerController* Controller) const
+{
+	for (int32 Index {DueIndex}; Index < DueUpdates.Num(); ++Index)
+	{
+		if(DueUpdates[Index].Controller.Get() == Controller) {return Index; }
+	}
+	return INDEX_NONE;
+}
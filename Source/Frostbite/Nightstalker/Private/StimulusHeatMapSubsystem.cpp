@@ -0,0 +1,357 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "StimulusHeatMapSubsystem.h"
+#include "FrostbiteGameMode.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomVolume.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
+#include "PlayerCharacterAnimInstance.h"
+#include "PlayerCharacterMovementComponent.h"
+#include "PlayerFlashlightComponent.h"
+#include "Components/SpotLightComponent.h"
+#include "LogCategories.h"
+#include "StatCategories.h"
+
+DECLARE_CYCLE_STAT(TEXT("Stimulus Heat Map Decay"), STAT_StimulusHeatMapDecay, STATGROUP_Nightstalker);
+DECLARE_CYCLE_STAT(TEXT("Stimulus Heat Map Splat"), STAT_StimulusHeatMapSplat, STATGROUP_Nightstalker);
+DECLARE_CYCLE_STAT(TEXT("Stimulus Heat Map Query"), STAT_StimulusHeatMapQuery, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Stimulus Heat Map Active Tiles"), STAT_StimulusHeatMapActiveTiles, STATGROUP_Nightstalker);
+
+bool UStimulusHeatMapSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStimulusHeatMapSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.AddUObject(this, &UStimulusHeatMapSubsystem::BuildGridAroundRooms);
+	}
+}
+
+void UStimulusHeatMapSubsystem::Deinitialize()
+{
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.RemoveAll(this);
+	}
+	if(APlayerCharacter* PlayerCharacter {BoundPlayer.Get()})
+	{
+		if(UPlayerCharacterMovementComponent* Movement {PlayerCharacter->GetPlayerCharacterMovement()})
+		{
+			Movement->OnLanding.RemoveAll(this);
+		}
+		if(UPlayerCharacterAnimInstance* AnimInstance {Cast<UPlayerCharacterAnimInstance>(PlayerCharacter->GetMesh()->GetAnimInstance())})
+		{
+			AnimInstance->OnFootstep.RemoveAll(this);
+		}
+	}
+	Heat.Empty();
+	CellHeight.Empty();
+	TileMaxHeat.Empty();
+	ActiveTiles.Empty();
+	IsTileActive.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UStimulusHeatMapSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStimulusHeatMapSubsystem, STATGROUP_Nightstalker);
+}
+
+void UStimulusHeatMapSubsystem::Tick(float DeltaTime)
+{
+	BindPlayer();
+	if(!Settings || Heat.Num() == 0) {return; }
+
+	DecayActiveTiles(DeltaTime);
+
+	TimeSinceFlashlightTrace += DeltaTime;
+	if(TimeSinceFlashlightTrace >= Settings->FlashlightInterval)
+	{
+		TimeSinceFlashlightTrace = 0.0f;
+		TraceFlashlight();
+	}
+	SET_DWORD_STAT(STAT_StimulusHeatMapActiveTiles, ActiveTiles.Num());
+}
+
+void UStimulusHeatMapSubsystem::LoadSettings()
+{
+	if(Settings) {return; }
+
+	const UWorld* World {GetWorld()};
+	if(const AFrostbiteGameMode* GameMode {World ? Cast<AFrostbiteGameMode>(World->GetAuthGameMode()) : nullptr})
+	{
+		if(!GameMode->GetStimulusHeatMapSettings().IsNull())
+		{
+			Settings = GameMode->GetStimulusHeatMapSettings().LoadSynchronous();
+		}
+	}
+	if(!Settings)
+	{
+		Settings = NewObject<UStimulusHeatMapSettings>(this);
+	}
+}
+
+void UStimulusHeatMapSubsystem::BuildGridAroundRooms()
+{
+	FBox Bounds {ForceInit};
+	for (int32 RoomId {0}; RoomId < RoomGraph->GetRoomCount(); RoomId++)
+	{
+		if(const ARoomVolume* Room {RoomGraph->GetRoom(RoomId)})
+		{
+			Bounds += Room->GetComponentsBoundingBox();
+		}
+	}
+	if(Bounds.IsValid)
+	{
+		LoadSettings();
+		BuildGrid(Bounds.ExpandBy(Settings->Margin));
+	}
+}
+
+void UStimulusHeatMapSubsystem::BuildGrid(const FBox& Bounds)
+{
+	LoadSettings();
+
+	/** The cell size is increased until the tiles fit within the limit. */
+	CellSize = Settings->CellSize;
+	const FVector2D Size {Bounds.GetSize()};
+	const float TileExtent {CellSize * TileSize};
+	TileResolution = FIntPoint(FMath::CeilToInt(Size.X / TileExtent), FMath::CeilToInt(Size.Y / TileExtent));
+	while(TileResolution.X * TileResolution.Y > MaxTiles)
+	{
+		CellSize *= 2.0f;
+		TileResolution = FIntPoint(FMath::CeilToInt(Size.X / (CellSize * TileSize)), FMath::CeilToInt(Size.Y / (CellSize * TileSize)));
+	}
+	TileResolution = FIntPoint(FMath::Max(TileResolution.X, 1), FMath::Max(TileResolution.Y, 1));
+	GridOrigin = FVector2D(Bounds.Min);
+
+	const int32 TileCount {TileResolution.X * TileResolution.Y};
+	Heat.Init(0.0f, TileCount * TileCellCount);
+	CellHeight.Init(0.0f, TileCount * TileCellCount);
+	TileMaxHeat.Init(0.0f, TileCount);
+	IsTileActive.Init(false, TileCount);
+	ActiveTiles.Reset();
+
+	UE_LOG(LogNightstalker, Log, TEXT("Built a stimulus heat map of %d by %d tiles with a cell size of %.0f."), TileResolution.X, TileResolution.Y, CellSize);
+}
+
+void UStimulusHeatMapSubsystem::BindPlayer()
+{
+	const UPlayerSubsystem* PlayerSubsystem {GetWorld()->GetSubsystem<UPlayerSubsystem>()};
+	APlayerCharacter* PlayerCharacter {PlayerSubsystem ? PlayerSubsystem->GetPlayerCharacter() : nullptr};
+	if(!PlayerCharacter || BoundPlayer.Get() == PlayerCharacter) {return; }
+
+	/** The footstep delegate is on the anim instance, which may not exist yet in the first frames of the player. */
+	UPlayerCharacterAnimInstance* AnimInstance {Cast<UPlayerCharacterAnimInstance>(PlayerCharacter->GetMesh()->GetAnimInstance())};
+	UPlayerCharacterMovementComponent* Movement {PlayerCharacter->GetPlayerCharacterMovement()};
+	if(!AnimInstance || !Movement) {return; }
+
+	AnimInstance->OnFootstep.AddDynamic(this, &UStimulusHeatMapSubsystem::HandleFootstep);
+	Movement->OnLanding.AddDynamic(this, &UStimulusHeatMapSubsystem::HandleLanding);
+	BoundPlayer = PlayerCharacter;
+
+	/** Without rooms, the heat map is centered on the player. */
+	if(Heat.Num() == 0)
+	{
+		LoadSettings();
+		BuildGrid(FBox::BuildAABB(PlayerCharacter->GetActorLocation(), FVector(Settings->FallbackExtent)));
+	}
+}
+
+void UStimulusHeatMapSubsystem::DecayActiveTiles(const float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StimulusHeatMapDecay);
+	if(ActiveTiles.Num() == 0) {return; }
+
+	const float DecayFactor {FMath::Exp2(-DeltaTime / Settings->HalfLife)};
+	const VectorRegister4Float Factor {VectorSetFloat1(DecayFactor)};
+	const VectorRegister4Float Threshold {VectorSetFloat1(Settings->MinHeat)};
+	const VectorRegister4Float Zero {VectorZeroFloat()};
+
+	for (int32 i {ActiveTiles.Num() - 1}; i >= 0; i--)
+	{
+		const int32 TileIndex {ActiveTiles[i]};
+		float* Cells {&Heat[GetTileCellOffset(TileIndex)]};
+
+		/** Every cell is multiplied by the decay factor and cleared once it drops below the minimum heat, four cells at a time. */
+		VectorRegister4Float MaxHeat {Zero};
+		for (int32 CellIndex {0}; CellIndex < TileCellCount; CellIndex += 4)
+		{
+			VectorRegister4Float Values {VectorMultiply(VectorLoad(Cells + CellIndex), Factor)};
+			Values = VectorSelect(VectorCompareGT(Values, Threshold), Values, Zero);
+			VectorStore(Values, Cells + CellIndex);
+			MaxHeat = VectorMax(MaxHeat, Values);
+		}
+
+		alignas(16) float MaxHeatComponents[4];
+		VectorStoreAligned(MaxHeat, MaxHeatComponents);
+		TileMaxHeat[TileIndex] = FMath::Max(FMath::Max(MaxHeatComponents[0], MaxHeatComponents[1]), FMath::Max(MaxHeatComponents[2], MaxHeatComponents[3]));
+		if(TileMaxHeat[TileIndex] <= 0.0f)
+		{
+			IsTileActive[TileIndex] = false;
+			ActiveTiles.RemoveAtSwap(i, 1, false);
+		}
+	}
+}
+
+void UStimulusHeatMapSubsystem::AddStimulus(const FVector& Location, const float StimulusHeat, const float Radius)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StimulusHeatMapSplat);
+	if(Heat.Num() == 0 || StimulusHeat <= 0.0f) {return; }
+
+	const FVector2D Center {Location};
+	const float ClampedRadius {FMath::Max(Radius, CellSize * 0.5f)};
+	const int32 MinX {FMath::Max(FMath::FloorToInt((Center.X - ClampedRadius - GridOrigin.X) / CellSize), 0)};
+	const int32 MinY {FMath::Max(FMath::FloorToInt((Center.Y - ClampedRadius - GridOrigin.Y) / CellSize), 0)};
+	const int32 MaxX {FMath::Min(FMath::FloorToInt((Center.X + ClampedRadius - GridOrigin.X) / CellSize), TileResolution.X * TileSize - 1)};
+	const int32 MaxY {FMath::Min(FMath::FloorToInt((Center.Y + ClampedRadius - GridOrigin.Y) / CellSize), TileResolution.Y * TileSize - 1)};
+
+	for (int32 Y {MinY}; Y <= MaxY; Y++)
+	{
+		for (int32 X {MinX}; X <= MaxX; X++)
+		{
+			const FVector2D CellCenter {GetCellCenter(X / TileSize, Y / TileSize, X % TileSize, Y % TileSize)};
+			const float Distance {static_cast<float>(FVector2D::Distance(CellCenter, Center))};
+			if(Distance > ClampedRadius) {continue; }
+
+			/** Cells keep the strongest stimulus instead of accumulating, so that repeated footsteps do not saturate the map. */
+			const float CellHeat {StimulusHeat * (1.0f - Distance / ClampedRadius)};
+			if(CellHeat < Settings->MinHeat) {continue; }
+
+			const int32 TileIndex {(Y / TileSize) * TileResolution.X + X / TileSize};
+			const int32 CellIndex {GetTileCellOffset(TileIndex) + (Y % TileSize) * TileSize + X % TileSize};
+			if(CellHeat > Heat[CellIndex])
+			{
+				/** The cell takes the height of the stimulus that heats it the most, so that stimuli on other floors are found at their own floor. */
+				Heat[CellIndex] = CellHeat;
+				CellHeight[CellIndex] = Location.Z;
+			}
+			TileMaxHeat[TileIndex] = FMath::Max(TileMaxHeat[TileIndex], CellHeat);
+			if(!IsTileActive[TileIndex])
+			{
+				IsTileActive[TileIndex] = true;
+				ActiveTiles.Add(TileIndex);
+			}
+		}
+	}
+}
+
+float UStimulusHeatMapSubsystem::GetHeatAtLocation(const FVector& Location) const
+{
+	if(Heat.Num() == 0) {return 0.0f; }
+
+	const int32 X {FMath::FloorToInt((Location.X - GridOrigin.X) / CellSize)};
+	const int32 Y {FMath::FloorToInt((Location.Y - GridOrigin.Y) / CellSize)};
+	if(X < 0 || Y < 0 || X >= TileResolution.X * TileSize || Y >= TileResolution.Y * TileSize) {return 0.0f; }
+
+	const int32 TileIndex {(Y / TileSize) * TileResolution.X + X / TileSize};
+	return Heat[GetTileCellOffset(TileIndex) + (Y % TileSize) * TileSize + X % TileSize];
+}
+
+bool UStimulusHeatMapSubsystem::FindHottestLocation(const FVector& Location, const float Radius, FVector& OutLocation, float& OutHeat) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_StimulusHeatMapQuery);
+	OutHeat = 0.0f;
+	if(Heat.Num() == 0) {return false; }
+
+	const FVector2D Center {Location};
+	const float TileExtent {CellSize * TileSize};
+	const int32 MinTileX {FMath::Max(FMath::FloorToInt((Center.X - Radius - GridOrigin.X) / TileExtent), 0)};
+	const int32 MinTileY {FMath::Max(FMath::FloorToInt((Center.Y - Radius - GridOrigin.Y) / TileExtent), 0)};
+	const int32 MaxTileX {FMath::Min(FMath::FloorToInt((Center.X + Radius - GridOrigin.X) / TileExtent), TileResolution.X - 1)};
+	const int32 MaxTileY {FMath::Min(FMath::FloorToInt((Center.Y + Radius - GridOrigin.Y) / TileExtent), TileResolution.Y - 1)};
+	const float RadiusSquared {FMath::Square(Radius)};
+
+	FVector HottestCell {FVector::ZeroVector};
+	for (int32 TileY {MinTileY}; TileY <= MaxTileY; TileY++)
+	{
+		for (int32 TileX {MinTileX}; TileX <= MaxTileX; TileX++)
+		{
+			/** Tiles that cannot contain a hotter cell than the best one so far are skipped without looking at their cells. */
+			const int32 TileIndex {TileY * TileResolution.X + TileX};
+			if(TileMaxHeat[TileIndex] <= OutHeat) {continue; }
+
+			const FVector2D TileMin {GridOrigin + FVector2D(TileX, TileY) * TileExtent};
+			const FBox2D TileBounds {TileMin, TileMin + FVector2D(TileExtent)};
+			if(TileBounds.ComputeSquaredDistanceToPoint(Center) > RadiusSquared) {continue; }
+
+			const float* Cells {&Heat[GetTileCellOffset(TileIndex)]};
+			const float* Heights {&CellHeight[GetTileCellOffset(TileIndex)]};
+			for (int32 CellIndex {0}; CellIndex < TileCellCount; CellIndex++)
+			{
+				if(Cells[CellIndex] <= OutHeat) {continue; }
+
+				const FVector2D CellCenter {GetCellCenter(TileX, TileY, CellIndex % TileSize, CellIndex / TileSize)};
+				if(FVector2D::DistSquared(CellCenter, Center) > RadiusSquared) {continue; }
+
+				OutHeat = Cells[CellIndex];
+				HottestCell = FVector(CellCenter, Heights[CellIndex]);
+			}
+		}
+	}
+
+	if(OutHeat <= 0.0f) {return false; }
+	OutLocation = HottestCell;
+	return true;
+}
+
+void UStimulusHeatMapSubsystem::TraceFlashlight()
+{
+	const APlayerCharacter* PlayerCharacter {BoundPlayer.Get()};
+	const UPlayerFlashlightComponent* FlashlightComponent {PlayerCharacter ? PlayerCharacter->FindComponentByClass<UPlayerFlashlightComponent>() : nullptr};
+	if(!FlashlightComponent || !FlashlightComponent->IsFlashlightEnabled()) {return; }
+
+	const USpotLightComponent* Flashlight {FlashlightComponent->GetFlashlight()};
+	const FVector Start {Flashlight->GetComponentLocation()};
+	const FVector End {Start + Flashlight->GetForwardVector() * Flashlight->AttenuationRadius};
+
+	FCollisionQueryParams Params {SCENE_QUERY_STAT(StimulusHeatMapFlashlight), false, PlayerCharacter};
+	FHitResult HitResult;
+	if(GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, ECC_Visibility, Params))
+	{
+		AddSplat(HitResult.ImpactPoint, Settings->Flashlight);
+	}
+}
+
+void UStimulusHeatMapSubsystem::HandleFootstep(FFootstepData FootstepData)
+{
+	const APlayerCharacter* PlayerCharacter {BoundPlayer.Get()};
+	const UPlayerCharacterMovementComponent* Movement {PlayerCharacter ? PlayerCharacter->GetPlayerCharacterMovement() : nullptr};
+	if(!Settings || !Movement) {return; }
+
+	AddSplat(FootstepData.Location, Movement->GetIsSprinting() ? Settings->SprintFootstep : Settings->Footstep);
+}
+
+void UStimulusHeatMapSubsystem::HandleLanding(EPlayerLandingType Value)
+{
+	const APlayerCharacter* PlayerCharacter {BoundPlayer.Get()};
+	if(!Settings || !PlayerCharacter) {return; }
+
+	switch(Value)
+	{
+	case EPlayerLandingType::Soft:
+		AddSplat(PlayerCharacter->GetActorLocation(), Settings->SoftLanding);
+		break;
+	case EPlayerLandingType::Hard:
+		AddSplat(PlayerCharacter->GetActorLocation(), Settings->HardLanding);
+		break;
+	case EPlayerLandingType::Heavy:
+		AddSplat(PlayerCharacter->GetActorLocation(), Settings->HeavyLanding);
+		break;
+	}
+}
+
+FVector2D UStimulusHeatMapSubsystem::GetCellCenter(const int32 TileX, const int32 TileY, const int32 CellX, const int32 CellY) const
+{
+	return GridOrigin + FVector2D(TileX * TileSize + CellX + 0.5f, TileY * TileSize + CellY + 0.5f) * CellSize;
+}
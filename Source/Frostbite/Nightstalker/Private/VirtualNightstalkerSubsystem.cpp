@@ -0,0 +1,293 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "VirtualNightstalkerSubsystem.h"
+#include "Nightstalker.h"
+#include "FrostbiteGameMode.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
+#include "NavigationSystem.h"
+#include "StatCategories.h"
+
+#include "Algo/Count.h"
+
+DECLARE_CYCLE_STAT(TEXT("Virtual Nightstalker Tick"), STAT_VirtualNightstalkerTick, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Virtual Nightstalkers"), STAT_VirtualNightstalkers, STATGROUP_Nightstalker);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Full Nightstalkers"), STAT_FullNightstalkers, STATGROUP_Nightstalker);
+
+bool UVirtualNightstalkerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UVirtualNightstalkerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+}
+
+void UVirtualNightstalkerSubsystem::Deinitialize()
+{
+	Entries.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UVirtualNightstalkerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVirtualNightstalkerSubsystem, STATGROUP_Nightstalker);
+}
+
+void UVirtualNightstalkerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_VirtualNightstalkerTick);
+	if(Entries.Num() == 0 || !RoomGraph || !RoomMembership) {return; }
+
+	LoadSettings();
+	TimeSinceUpdate += DeltaTime;
+	if(TimeSinceUpdate < Settings->UpdateInterval) {return; }
+	TimeSinceUpdate = 0.0f;
+
+	/** Nightstalkers are only classified while the room of the player is known, so that they are not virtualized during loading or transitions. */
+	const int32 PlayerRoomId {GetPlayerRoomId()};
+	if(PlayerRoomId == INDEX_NONE) {return; }
+
+	const double Now {GetWorld()->GetTimeSeconds()};
+	int32 VirtualCount {0};
+	for (FVirtualNightstalkerEntry& Entry : Entries)
+	{
+		if(!Entry.Nightstalker.IsValid()) {continue; }
+
+		if(!Entry.IsVirtual)
+		{
+			const int32 RoomId {RoomMembership->GetActorRoomId(Entry.Nightstalker.Get())};
+			if(RoomId == INDEX_NONE) {continue; }
+
+			/** A Nightstalker that cannot reach the player at all is as far away as it can be. */
+			const int32 Distance {GetDistanceToPlayer(RoomId, PlayerRoomId)};
+			if(Distance == INDEX_NONE || Distance > Settings->VirtualizeDistance)
+			{
+				Virtualize(Entry, RoomId, PlayerRoomId, Now);
+				++VirtualCount;
+			}
+			continue;
+		}
+
+		Advance(Entry, PlayerRoomId, Now);
+
+		/** The Nightstalker is rehydrated as soon as the room it is in, or the room it is moving into, is close enough to the player. */
+		const bool IsTravelling {Now >= Entry.DepartureTime && Entry.NextRoomId != INDEX_NONE};
+		const int32 FrontRoomId {IsTravelling ? Entry.NextRoomId : Entry.RoomId};
+		const int32 Distance {GetDistanceToPlayer(FrontRoomId, PlayerRoomId)};
+		if(Distance != INDEX_NONE && Distance <= FMath::Min(Settings->RehydrateDistance, Settings->VirtualizeDistance - 1))
+		{
+			Rehydrate(Entry, Now);
+			continue;
+		}
+		++VirtualCount;
+	}
+
+	SET_DWORD_STAT(STAT_VirtualNightstalkers, VirtualCount);
+	SET_DWORD_STAT(STAT_FullNightstalkers, Entries.Num() - VirtualCount);
+}
+
+void UVirtualNightstalkerSubsystem::RegisterNightstalker(ANightstalker* Nightstalker)
+{
+	if(!Nightstalker || Entries.ContainsByPredicate([Nightstalker](const FVirtualNightstalkerEntry& Entry) {return Entry.Nightstalker.Get() == Nightstalker; })) {return; }
+
+	FVirtualNightstalkerEntry& Entry {Entries.AddDefaulted_GetRef()};
+	Entry.Nightstalker = Nightstalker;
+
+	/** The seed is hashed from the name string, as the hash of an FName depends on the order in which names were created in the process. */
+	Entry.Random.Initialize(static_cast<int32>(FCrc::StrCrc32(*Nightstalker->GetName())));
+}
+
+void UVirtualNightstalkerSubsystem::UnregisterNightstalker(ANightstalker* Nightstalker)
+{
+	Entries.RemoveAllSwap([Nightstalker](const FVirtualNightstalkerEntry& Entry) {return !Entry.Nightstalker.IsValid() || Entry.Nightstalker.Get() == Nightstalker; });
+}
+
+bool UVirtualNightstalkerSubsystem::GetNightstalkerLocation(const ANightstalker* Nightstalker, FVector& OutLocation) const
+{
+	const FVirtualNightstalkerEntry* Entry {Entries.FindByPredicate([Nightstalker](const FVirtualNightstalkerEntry& Entry) {return Entry.Nightstalker.Get() == Nightstalker; })};
+	if(!Entry || !Nightstalker) {return false; }
+	if(!Entry->IsVirtual)
+	{
+		OutLocation = Nightstalker->GetActorLocation();
+		return true;
+	}
+
+	const ARoomVolume* Room {RoomGraph ? RoomGraph->GetRoom(Entry->RoomId) : nullptr};
+	if(!Room) {return false; }
+
+	/** While travelling, the Nightstalker moves from the center of its room to the portal, and from the portal to the center of the next room. */
+	const double Now {GetWorld()->GetTimeSeconds()};
+	const ARoomVolume* NextRoom {RoomGraph->GetRoom(Entry->NextRoomId)};
+	FVector Portal;
+	if(Now < Entry->DepartureTime || !NextRoom || !RoomGraph->GetPortalLocation(Entry->RoomId, Entry->NextRoomId, Portal))
+	{
+		OutLocation = Room->GetActorLocation();
+		return true;
+	}
+
+	const FVector From {Room->GetActorLocation()};
+	const FVector To {NextRoom->GetActorLocation()};
+	const double FirstLength {FVector::Dist(From, Portal)};
+	const double TotalLength {FirstLength + FVector::Dist(Portal, To)};
+	const double Alpha {FMath::Clamp((Now - Entry->DepartureTime) / FMath::Max(Entry->ArrivalTime - Entry->DepartureTime, UE_KINDA_SMALL_NUMBER), 0.0, 1.0)};
+	const double Travelled {Alpha * TotalLength};
+	OutLocation = Travelled <= FirstLength
+		? FMath::Lerp(From, Portal, FirstLength > 0.0 ? Travelled / FirstLength : 1.0)
+		: FMath::Lerp(Portal, To, (Travelled - FirstLength) / FMath::Max(TotalLength - FirstLength, UE_KINDA_SMALL_NUMBER));
+	return true;
+}
+
+int32 UVirtualNightstalkerSubsystem::GetVirtualNightstalkerCount() const
+{
+	return static_cast<int32>(Algo::CountIf(Entries, [](const FVirtualNightstalkerEntry& Entry) {return Entry.IsVirtual; }));
+}
+
+void UVirtualNightstalkerSubsystem::LoadSettings()
+{
+	if(Settings) {return; }
+
+	const UWorld* World {GetWorld()};
+	if(const AFrostbiteGameMode* GameMode {World ? Cast<AFrostbiteGameMode>(World->GetAuthGameMode()) : nullptr})
+	{
+		if(!GameMode->GetVirtualNightstalkerSettings().IsNull())
+		{
+			Settings = GameMode->GetVirtualNightstalkerSettings().LoadSynchronous();
+		}
+	}
+	if(!Settings)
+	{
+		Settings = NewObject<UVirtualNightstalkerSettings>(this);
+	}
+}
+
+int32 UVirtualNightstalkerSubsystem::GetPlayerRoomId() const
+{
+	const UPlayerSubsystem* PlayerSubsystem {GetWorld()->GetSubsystem<UPlayerSubsystem>()};
+	const APlayerCharacter* PlayerCharacter {PlayerSubsystem ? PlayerSubsystem->GetPlayerCharacter() : nullptr};
+	return PlayerCharacter ? RoomMembership->GetActorRoomId(PlayerCharacter) : INDEX_NONE;
+}
+
+int32 UVirtualNightstalkerSubsystem::GetDistanceToPlayer(const int32 RoomId, const int32 PlayerRoomId) const
+{
+	return RoomGraph->GetHopDistance(RoomId, PlayerRoomId, ERoomGraphLayer::Nightstalker);
+}
+
+void UVirtualNightstalkerSubsystem::Virtualize(FVirtualNightstalkerEntry& Entry, const int32 RoomId, const int32 PlayerRoomId, const double Now)
+{
+	Entry.IsVirtual = true;
+	Entry.RoomId = RoomId;
+	Entry.PreviousRoomId = INDEX_NONE;
+	Entry.NextRoomId = INDEX_NONE;
+	Entry.Nightstalker->SetVirtualized(true);
+
+	/** The Nightstalker first finishes its stay in the room it was virtualized in. */
+	PlanNextMove(Entry, PlayerRoomId, Now);
+}
+
+void UVirtualNightstalkerSubsystem::Rehydrate(FVirtualNightstalkerEntry& Entry, const double Now)
+{
+	ANightstalker* Nightstalker {Entry.Nightstalker.Get()};
+	Entry.IsVirtual = false;
+
+	/** A travelling Nightstalker appears at the portal it is passing through. A Nightstalker that is staying in a room appears at the portal it entered through. */
+	const bool IsTravelling {Now >= Entry.DepartureTime && Entry.NextRoomId != INDEX_NONE};
+	const int32 FromId {IsTravelling ? Entry.RoomId : Entry.PreviousRoomId};
+	const int32 ToId {IsTravelling ? Entry.NextRoomId : Entry.RoomId};
+	FVector Location;
+	if(!RoomGraph->GetPortalLocation(FromId, ToId, Location))
+	{
+		const ARoomVolume* Room {RoomGraph->GetRoom(Entry.RoomId)};
+		Location = Room ? Room->GetActorLocation() : Nightstalker->GetActorLocation();
+	}
+
+	/** The portal lies halfway up the doorway, so it is projected onto the navmesh and the pawn is placed on top of it. */
+	if(const UNavigationSystemV1* NavigationSystem {FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld())})
+	{
+		FNavLocation NavLocation;
+		if(NavigationSystem->ProjectPointToNavigation(Location, NavLocation, FVector(100.0, 100.0, 300.0)))
+		{
+			Location = NavLocation.Location + FVector(0.0, 0.0, Nightstalker->GetSimpleCollisionHalfHeight());
+		}
+	}
+
+	const ARoomVolume* TargetRoom {RoomGraph->GetRoom(ToId)};
+	const FRotator Rotation {TargetRoom ? (TargetRoom->GetActorLocation() - Location).GetSafeNormal2D().Rotation() : Nightstalker->GetActorRotation()};
+	Nightstalker->TeleportTo(Location, Rotation, false, true);
+	Nightstalker->SetVirtualized(false);
+}
+
+void UVirtualNightstalkerSubsystem::Advance(FVirtualNightstalkerEntry& Entry, const int32 PlayerRoomId, const double Now)
+{
+	/** The number of moves per update is limited, so that a long hitch cannot stall the game thread. Any remaining moves happen in the next update. */
+	for (int32 Move {0}; Move < 8 && Entry.NextRoomId != INDEX_NONE && Now >= Entry.ArrivalTime; Move++)
+	{
+		Entry.PreviousRoomId = Entry.RoomId;
+		Entry.RoomId = Entry.NextRoomId;
+		Entry.NextRoomId = INDEX_NONE;
+		PlanNextMove(Entry, PlayerRoomId, Entry.ArrivalTime);
+	}
+
+	/** A Nightstalker in a dead end retries once its stay is over. */
+	if(Entry.NextRoomId == INDEX_NONE && Now >= Entry.DepartureTime)
+	{
+		PlanNextMove(Entry, PlayerRoomId, Now);
+	}
+}
+
+void UVirtualNightstalkerSubsystem::PlanNextMove(FVirtualNightstalkerEntry& Entry, const int32 PlayerRoomId, const double StartTime)
+{
+	Entry.DepartureTime = StartTime + Entry.Random.FRandRange(Settings->MinDwellTime, FMath::Max(Settings->MinDwellTime, Settings->MaxDwellTime));
+	Entry.NextRoomId = INDEX_NONE;
+
+	/** The Nightstalker is drawn towards the player, so that virtual Nightstalkers do not stay out of range forever. */
+	if(PlayerRoomId != INDEX_NONE && Entry.Random.FRand() < Settings->PlayerAttraction)
+	{
+		Entry.NextRoomId = RoomGraph->GetNextHop(Entry.RoomId, PlayerRoomId, ERoomGraphLayer::Nightstalker);
+	}
+
+	/** Otherwise it roams to a random adjacent room it can take, only turning back in a dead end. */
+	if(Entry.NextRoomId == INDEX_NONE)
+	{
+		TArray<int32, TInlineAllocator<8>> Candidates;
+		for (const int32 NeighborId : RoomGraph->GetNeighbors(Entry.RoomId))
+		{
+			if(NeighborId != Entry.PreviousRoomId && RoomGraph->GetHopDistance(Entry.RoomId, NeighborId, ERoomGraphLayer::Nightstalker) == 1)
+			{
+				Candidates.Add(NeighborId);
+			}
+		}
+		if(Candidates.Num() == 0 && Entry.PreviousRoomId != INDEX_NONE && RoomGraph->GetHopDistance(Entry.RoomId, Entry.PreviousRoomId, ERoomGraphLayer::Nightstalker) == 1)
+		{
+			Candidates.Add(Entry.PreviousRoomId);
+		}
+		if(Candidates.Num() > 0)
+		{
+			Entry.NextRoomId = Candidates[Entry.Random.RandRange(0, Candidates.Num() - 1)];
+		}
+	}
+
+	Entry.ArrivalTime = Entry.NextRoomId != INDEX_NONE ? Entry.DepartureTime + GetTravelTime(Entry.RoomId, Entry.NextRoomId) : Entry.DepartureTime;
+}
+
+float UVirtualNightstalkerSubsystem::GetTravelTime(const int32 FromId, const int32 ToId) const
+{
+	const ARoomVolume* From {RoomGraph->GetRoom(FromId)};
+	const ARoomVolume* To {RoomGraph->GetRoom(ToId)};
+	if(!From || !To) {return 0.0f; }
+
+	FVector Portal;
+	const double Distance {RoomGraph->GetPortalLocation(FromId, ToId, Portal)
+		? FVector::Dist(From->GetActorLocation(), Portal) + FVector::Dist(Portal, To->GetActorLocation())
+		: FVector::Dist(From->GetActorLocation(), To->GetActorLocation())};
+	return static_cast<float>(Distance) / Settings->TravelSpeed;
+}
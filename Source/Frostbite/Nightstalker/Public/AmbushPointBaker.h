@@ -0,0 +1,57 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "AmbushPointBaker.generated.h"
+
+class UAmbushPointData;
+
+/** Actor that bakes and registers the ambush points of a level.
+ *	The bake samples the floor of every room on a grid and scores every sample by its cover from the entrances of the room, its darkness and its distance to the portals of the room.
+ *	The best samples of every room are stored in an ambush point data asset. At runtime, the baker registers its data with the ambush point subsystem.
+ *	@Brief Actor for baking and registering ambush points.
+ */
+UCLASS(NotBlueprintable, Placeable, ClassGroup = (Nightstalker), HideCategories = (Rendering, Input, Collision, HLOD, Replication))
+class AAmbushPointBaker : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	/** The data asset to bake the ambush points into. */
+	UPROPERTY(EditInstanceOnly, Category = "AmbushPointBaker", Meta = (DisplayName = "Ambush Points"))
+	UAmbushPointData* AmbushPoints;
+
+	/** The distance between the floor samples of a room. */
+	UPROPERTY(EditInstanceOnly, Category = "AmbushPointBaker", Meta = (DisplayName = "Sample Spacing", ClampMin = "25", UIMin = "25", Units = "cm"))
+	float SampleSpacing {100.0f};
+
+	/** The maximum number of points that are stored per room. */
+	UPROPERTY(EditInstanceOnly, Category = "AmbushPointBaker", Meta = (DisplayName = "Max Points Per Room", ClampMin = "1", UIMin = "1", UIMax = "64"))
+	int32 MaxPointsPerRoom {12};
+
+	/** The minimum distance between two stored points of a room. */
+	UPROPERTY(EditInstanceOnly, Category = "AmbushPointBaker", Meta = (DisplayName = "Min Point Spacing", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float MinPointSpacing {250.0f};
+
+	/** The height above the floor that cover is tested at, roughly the center of the Nightstalker. */
+	UPROPERTY(EditInstanceOnly, Category = "AmbushPointBaker", Meta = (DisplayName = "Cover Height", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float CoverHeight {100.0f};
+
+public:
+	/** Sets default values for this actor's properties. */
+	AAmbushPointBaker();
+
+#if WITH_EDITOR
+	/** Generates and scores the ambush points of every room and stores the best points in the ambush point data asset. */
+	UFUNCTION(CallInEditor, Category = "AmbushPointBaker", Meta = (DisplayName = "Bake Ambush Points"))
+	void BakeAmbushPoints();
+#endif
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
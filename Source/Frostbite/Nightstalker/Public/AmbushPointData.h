@@ -0,0 +1,65 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "AmbushPointData.generated.h"
+
+class ARoomVolume;
+
+/** Data asset that stores baked ambush points per room.
+ *	The points of all rooms are stored in one array per attribute, and the points of a room are a contiguous range in every array.
+ *	It is generated by an AmbushPointBaker.
+ *	@Brief Baked ambush points per room.
+ */
+UCLASS(BlueprintType, ClassGroup = (Nightstalker))
+class UAmbushPointData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The rooms that were baked. */
+	UPROPERTY(VisibleAnywhere, Category = "AmbushPoints", Meta = (DisplayName = "Rooms"))
+	TArray<TSoftObjectPtr<ARoomVolume>> Rooms;
+
+	/** The index of the first point of every room. Contains one more entry than there are rooms. */
+	UPROPERTY()
+	TArray<int32> RoomOffsets;
+
+	/** The world space location of every point, on the floor. */
+	UPROPERTY()
+	TArray<float> LocationX;
+
+	UPROPERTY()
+	TArray<float> LocationY;
+
+	UPROPERTY()
+	TArray<float> LocationZ;
+
+	/** The fraction of the entrances of the room that cannot see the point, between 0 and 1. */
+	UPROPERTY()
+	TArray<float> Cover;
+
+	/** The darkness of the point when the room is lit, between 0 and 1. */
+	UPROPERTY()
+	TArray<float> Darkness;
+
+	/** The distance between the point and the nearest portal of the room. */
+	UPROPERTY()
+	TArray<float> PortalDistance;
+
+public:
+	/** Returns the number of points. */
+	FORCEINLINE int32 GetPointCount() const {return RoomOffsets.Num() > 0 ? RoomOffsets.Last() : 0; }
+
+	/** Returns whether the data is consistent. */
+	FORCEINLINE bool IsValidData() const
+	{
+		const int32 PointCount {GetPointCount()};
+		return Rooms.Num() > 0 && RoomOffsets.Num() == Rooms.Num() + 1 && LocationX.Num() == PointCount && LocationY.Num() == PointCount && LocationZ.Num() == PointCount
+			&& Cover.Num() == PointCount && Darkness.Num() == PointCount && PortalDistance.Num() == PointCount;
+	}
+};
@@ -0,0 +1,69 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AmbushPointSubsystem.generated.h"
+
+class UAmbushPointData;
+class URoomGraphSubsystem;
+class ULightInfluenceSubsystem;
+struct FNightstalkerAmbushPoints;
+
+/** World Subsystem that provides the baked ambush points of every room.
+ *	The baked rooms are remapped to room graph IDs, so that gathering the points of a room copies a contiguous range of every attribute array.
+ *	The baked darkness of a point only applies while an enabled light reaches it, according to the light influence grids. Points that no enabled
+ *	light reaches are fully dark. Without light influence data, the baked darkness is used as is.
+ *	@Brief World Subsystem for baked ambush points.
+ */
+UCLASS(ClassGroup = (Nightstalker))
+class UAmbushPointSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointer to the room graph subsystem, which provides the room IDs. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	/** Pointer to the light influence subsystem, which tells whether the lights that reach a point are enabled. */
+	UPROPERTY()
+	ULightInfluenceSubsystem* LightInfluence {nullptr};
+
+	/** The registered ambush point data. */
+	UPROPERTY()
+	UAmbushPointData* Data {nullptr};
+
+	/** The index of every room ID in the baked data, or INDEX_NONE if the room was not baked. */
+	TArray<int32> DataIndices;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Registers ambush point data. Only one data asset can be registered at a time. */
+	void RegisterData(UAmbushPointData* InData);
+
+	/** Unregisters ambush point data. */
+	void UnregisterData(UAmbushPointData* InData);
+
+	/** Appends the ambush points of a room.
+	 *	@Param RoomId The room to gather the points of.
+	 *	@Param MaxPoints The maximum total number of points. Points beyond it are not appended.
+	 *	@Param OutPoints The points to append to.
+	 *	@Return The number of points that were appended.
+	 */
+	int32 GatherPoints(const int32 RoomId, const int32 MaxPoints, FNightstalkerAmbushPoints& OutPoints) const;
+
+	/** Returns the number of ambush points in a room. */
+	UFUNCTION(BlueprintPure, Category = "AmbushPoints", Meta = (DisplayName = "Get Room Ambush Point Count"))
+	int32 GetRoomPointCount(const int32 RoomId) const;
+
+private:
+	/** Remaps the baked rooms to room IDs. Called when the room graph is built or data is registered. */
+	void BuildRoomIndices();
+};
@@ -0,0 +1,47 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "LineOfSightSettings.generated.h"
+
+/** Data asset that defines how line of sight between actors is tested.
+ *	@Brief Settings for the line of sight subsystem.
+ */
+UCLASS(BlueprintType, ClassGroup = (Nightstalker))
+class ULineOfSightSettings : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The age after which a result is refreshed when it is requested again. Older results are still returned until the refresh completes. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Max Staleness", ClampMin = "0", UIMin = "0", Units = "s"))
+	float MaxStaleness {0.2f};
+
+	/** Results that have not been requested for this long are discarded. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Expiry Time", ClampMin = "0", UIMin = "0", Units = "s"))
+	float ExpiryTime {2.0f};
+
+	/** The maximum distance at which an actor can be seen. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Max Sight Distance", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float MaxSightDistance {5000.0f};
+
+	/** The maximum room distance at which an actor can be seen, if no room visibility data is baked. Rooms further apart are rejected without tracing. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Max Room Distance", ClampMin = "0", UIMin = "0"))
+	int32 MaxRoomDistance {1};
+
+	/** The bones or sockets of the skeletal mesh of a target that are traced to. Targets without a skeletal mesh are traced to their location and eyes. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Target Bones"))
+	TArray<FName> TargetBones {TEXT("head"), TEXT("spine_03"), TEXT("pelvis"), TEXT("foot_l"), TEXT("foot_r")};
+
+	/** The collision channel that blocks sight. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Trace Channel"))
+	TEnumAsByte<ECollisionChannel> TraceChannel {ECC_Visibility};
+
+	/** The maximum number of traces started per frame. Requests beyond this are started in the next frame. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "LineOfSight", Meta = (DisplayName = "Max Traces Per Frame", ClampMin = "1", UIMin = "1"))
+	int32 MaxTracesPerFrame {32};
+};
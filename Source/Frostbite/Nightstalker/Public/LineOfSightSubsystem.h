@@ -0,0 +1,121 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "LineOfSightSettings.h"
+#include "LineOfSightSubsystem.generated.h"
+
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+class URoomVisibilitySubsystem;
+
+/** Struct containing the result of a line of sight test. */
+USTRUCT(BlueprintType)
+struct FLineOfSightResult
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Whether any point of the target can be seen by the observer. */
+	UPROPERTY(BlueprintReadOnly, Category = "LineOfSightResult", Meta = (DisplayName = "Is Visible"))
+	bool IsVisible {false};
+
+	/** The fraction of the points of the target that can be seen by the observer. */
+	UPROPERTY(BlueprintReadOnly, Category = "LineOfSightResult", Meta = (DisplayName = "Visible Fraction"))
+	float VisibleFraction {0.0f};
+
+	/** The time since the result was determined. */
+	UPROPERTY(BlueprintReadOnly, Category = "LineOfSightResult", Meta = (DisplayName = "Age", Units = "s"))
+	float Age {0.0f};
+};
+
+/** Struct containing a pair of actors whose line of sight is tested. */
+struct FLineOfSightEntry
+{
+	TWeakObjectPtr<const AActor> Observer;
+	TWeakObjectPtr<const AActor> Target;
+
+	/** The half angle of the view cone of the observer, in degrees. */
+	float ViewConeHalfAngle {180.0f};
+
+	/** The last result, and the world time at which it was determined. */
+	FLineOfSightResult Result;
+	double ResultTime {-1.0};
+
+	/** The world time at which the result was last requested. */
+	double RequestTime {0.0};
+
+	/** Whether the result has been requested to be refreshed. Multiple requests for the same pair in one frame result in a single refresh. */
+	bool IsRefreshRequested {false};
+
+	/** The traces that are in flight, and the world time at which they were started. */
+	TArray<FTraceHandle, TInlineAllocator<8>> PendingTraces;
+	double TraceTime {0.0};
+};
+
+/** World Subsystem that tests line of sight between actors without blocking on physics.
+ *	Agents request the line of sight between an observer and a target and immediately get the last known result. Results older than the
+ *	maximum staleness are refreshed, and requests for the same pair are merged. A refresh is rejected without tracing if the rooms of the
+ *	actors cannot see each other, or the target is outside the view cone or sight distance of the observer. The remaining refreshes trace
+ *	asynchronously from the eyes of the observer to several points on the skeleton of the target, and their results are collected in the next frame.
+ *	@Brief World Subsystem that tests line of sight asynchronously.
+ */
+UCLASS(ClassGroup = (Nightstalker))
+class ULineOfSightSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	UPROPERTY()
+	URoomVisibilitySubsystem* RoomVisibility {nullptr};
+
+	/** The line of sight settings in use. */
+	UPROPERTY()
+	ULineOfSightSettings* Settings {nullptr};
+
+	/** The tested pairs, keyed by observer and target. */
+	TMap<TPair<TWeakObjectPtr<const AActor>, TWeakObjectPtr<const AActor>>, FLineOfSightEntry> Entries;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Returns the last known line of sight between an observer and a target, and requests a refresh if it is stale. Never blocks.
+	 *	@Param Observer The actor that looks. Its eyes view point is the origin of the test.
+	 *	@Param Target The actor that is looked at.
+	 *	@Param ViewConeHalfAngle The half angle of the view cone of the observer. 180 degrees disables the view cone.
+	 *	@Param OutResult The last known result.
+	 *	@Return Whether a result is known. The first request for a pair returns false until its first refresh completes.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LineOfSight", Meta = (DisplayName = "Get Line Of Sight"))
+	bool GetLineOfSight(const AActor* Observer, const AActor* Target, const float ViewConeHalfAngle, FLineOfSightResult& OutResult);
+
+private:
+	/** Loads the line of sight settings of the game mode, or the default settings if the game mode does not define any. */
+	void LoadSettings();
+
+	/** Collects the results of the traces of an entry if they have all completed. */
+	void CollectTraces(FLineOfSightEntry& Entry, const double Now);
+
+	/** Returns whether the target of an entry can be rejected without tracing. */
+	bool CanRejectEarly(const FLineOfSightEntry& Entry, const FVector& EyeLocation, const FRotator& EyeRotation) const;
+
+	/** Gathers the points of a target that are traced to. */
+	void GatherTargetPoints(const AActor* Target, TArray<FVector, TInlineAllocator<8>>& OutPoints) const;
+
+	/** Stores the result of a refresh. */
+	static void SetResult(FLineOfSightEntry& Entry, const bool IsVisible, const float VisibleFraction, const double Time);
+};
@@ -8,11 +8,27 @@
 #include "GameFramework/Pawn.h"
 #include "Nightstalker.generated.h"
 
+class UNightstalkerScriptRunner;
+class UAudioComponent;
+
 UCLASS(Abstract, Blueprintable, BlueprintType, NotPlaceable, ClassGroup = (Nightstalker))
 class ANightstalker : public APawn
 {
 	GENERATED_BODY()
 
+private:
+	/** The script runner that updates the active behavior scripts of the Nightstalker. */
+	UPROPERTY(BlueprintGetter = GetScriptRunner, VisibleAnywhere, Category = "Nightstalker|Components", Meta = (DisplayName = "Script Runner"))
+	UNightstalkerScriptRunner* ScriptRunner;
+
+	/** Whether the Nightstalker is simulated by the virtual Nightstalker subsystem instead of by its pawn, and whether the actor ticked before. */
+	bool IsVirtualized {false};
+	bool WasTickEnabledBeforeVirtualization {false};
+
+	/** The components whose tick was enabled, and the audio components that were playing, when the Nightstalker was virtualized. */
+	TArray<TWeakObjectPtr<UActorComponent>> VirtualizedTickComponents;
+	TArray<TWeakObjectPtr<UAudioComponent>> VirtualizedAudioComponents;
+
 public:
 	// Sets default values for this pawn's properties
 	ANightstalker();
@@ -21,6 +37,9 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	/** Called when the actor is removed from the world. */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -28,4 +47,16 @@ public:
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	/** Hides the Nightstalker and disables its ticks, collision, audio and controller, or restores them.
+	 *	Called by the virtual Nightstalker subsystem when the Nightstalker is far enough from the player to be simulated without its pawn.
+	 */
+	void SetVirtualized(const bool Value);
+
+	/** Returns whether the Nightstalker is simulated without its pawn. */
+	FORCEINLINE bool GetIsVirtualized() const {return IsVirtualized; }
+
+	/** Returns the script runner of the Nightstalker. */
+	UFUNCTION(BlueprintGetter, Category = "Nightstalker|Components", Meta = (DisplayName = "Script Runner"))
+	FORCEINLINE UNightstalkerScriptRunner* GetScriptRunner() const {return ScriptRunner; }
+
 };
@@ -0,0 +1,251 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NightstalkerBehaviorEngine.generated.h"
+
+UENUM(BlueprintType)
+enum class EBehaviorMode : uint8
+{
+	RoamMode    UMETA(DisplayName = "Roam Mode", ToolTip = "In roam mode, we assume that the Nightstalker is not implicitly aware about the whereabouts of the player." ),
+	StalkMode    UMETA(DisplayName = "stalk Mode", ToolTip = "In stalk mode, we assume that the Nightstalker is implicitly aware about the whereabouts of the player."),
+	AmbushMode  UMETA(DisplayName = "Ambush Mode", ToolTip = "In ambush mode, The Nightstalker is near the player and ready to strike.")
+};
+
+/** Struct defining the thresholds and distances the native behavior engine decides with. */
+USTRUCT(BlueprintType)
+struct FNightstalkerBehaviorSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The room distance to the player at which the Nightstalker switches from roam mode to stalk mode. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Stalk Enter Distance", ClampMin = "1", UIMin = "1"))
+	int32 StalkEnterDistance {3};
+
+	/** The room distance to the player beyond which the Nightstalker switches from stalk mode back to roam mode. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Roam Enter Distance", ClampMin = "1", UIMin = "1"))
+	int32 RoamEnterDistance {5};
+
+	/** The room distance to the player at which the Nightstalker switches from stalk mode to ambush mode. It switches back one room further away. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Enter Distance", ClampMin = "0", UIMin = "0"))
+	int32 AmbushEnterDistance {1};
+
+	/** The maximum room distance of the rooms the Nightstalker picks from while roaming. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Roam Radius", ClampMin = "1", UIMin = "1"))
+	int32 RoamRadius {4};
+
+	/** The time after which the Nightstalker gives up on a roam target it has not reached, and picks a new one. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Roam Target Timeout", ClampMin = "0", UIMin = "0", Units = "s"))
+	float RoamTargetTimeout {30.0f};
+
+	/** The distance around the Nightstalker within which it notices stimuli of the player while roaming. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Stimulus Search Radius", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float StimulusSearchRadius {3000.0f};
+
+	/** The half angle of the view cone of the Nightstalker. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Sight Cone Half Angle", ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180", Units = "deg"))
+	float SightConeHalfAngle {70.0f};
+
+	/** The half angle of the view cone of the player, used to test whether the player can see the Nightstalker. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Player View Cone Half Angle", ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180", Units = "deg"))
+	float PlayerViewConeHalfAngle {60.0f};
+
+	/** The minimum heat of a stimulus for the Nightstalker to investigate it instead of roaming to a random room. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Stimulus Investigate Heat", ClampMin = "0", UIMin = "0"))
+	float StimulusInvestigateHeat {0.25f};
+
+	/** The room distance to the player the Nightstalker tries to keep while stalking. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Stalk Hold Distance", ClampMin = "1", UIMin = "1"))
+	int32 StalkHoldDistance {2};
+
+	/** The time ahead the location of the player is predicted for choosing an ambush position. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Look Ahead Time", ClampMin = "0", UIMin = "0", Units = "s"))
+	float AmbushLookAheadTime {1.5f};
+
+	/** The distance from a portal the Nightstalker waits at while ambushing. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Stand Off", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float AmbushStandOff {150.0f};
+
+	/** The weight of the cover of an ambush point from the entrances of its room. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Cover Weight", ClampMin = "0", UIMin = "0"))
+	float AmbushCoverWeight {1.0f};
+
+	/** The weight of the darkness of an ambush point. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Darkness Weight", ClampMin = "0", UIMin = "0"))
+	float AmbushDarknessWeight {1.0f};
+
+	/** The weight of the distance between an ambush point and the predicted location of the player, relative to the ambush search radius. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Prediction Weight", ClampMin = "0", UIMin = "0"))
+	float AmbushPredictionWeight {2.0f};
+
+	/** The weight of the distance between an ambush point and the nearest portal of its room, relative to the ambush search radius. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Portal Weight", ClampMin = "0", UIMin = "0"))
+	float AmbushPortalWeight {0.5f};
+
+	/** The distance at which the distance penalties of an ambush point are at their maximum. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Search Radius", ClampMin = "1", UIMin = "1", Units = "cm"))
+	float AmbushSearchRadius {1500.0f};
+
+	/** Ambush points closer to the player than this distance are never picked. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Ambush Min Player Distance", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float AmbushMinPlayerDistance {300.0f};
+
+	/** The distance from a target at which the Nightstalker considers it reached. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "NightstalkerBehaviorSettings", Meta = (DisplayName = "Acceptance Radius", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float AcceptanceRadius {50.0f};
+
+	/** Constructor with default values. */
+	FNightstalkerBehaviorSettings()
+	{
+	}
+};
+
+/** Struct containing the result of a behavior decision. */
+USTRUCT(BlueprintType)
+struct FNightstalkerBehaviorDecision
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The behavior mode the Nightstalker should be in. */
+	UPROPERTY(BlueprintReadOnly, Category = "NightstalkerBehaviorDecision", Meta = (DisplayName = "Mode"))
+	EBehaviorMode Mode {EBehaviorMode::RoamMode};
+
+	/** Whether the Nightstalker should move to the target location. */
+	UPROPERTY(BlueprintReadOnly, Category = "NightstalkerBehaviorDecision", Meta = (DisplayName = "Has Target"))
+	bool HasTarget {false};
+
+	/** The location the Nightstalker should move to. */
+	UPROPERTY(BlueprintReadOnly, Category = "NightstalkerBehaviorDecision", Meta = (DisplayName = "Target Location"))
+	FVector TargetLocation {FVector::ZeroVector};
+
+	/** The room that contains the target location, or -1. */
+	UPROPERTY(BlueprintReadOnly, Category = "NightstalkerBehaviorDecision", Meta = (DisplayName = "Target Room ID"))
+	int32 TargetRoomId {INDEX_NONE};
+
+	/** Constructor with default values. */
+	FNightstalkerBehaviorDecision()
+	{
+	}
+};
+
+/** Struct containing a room the Nightstalker could move to. */
+struct FNightstalkerRoomCandidate
+{
+	int32 RoomId {INDEX_NONE};
+	FVector Center {FVector::ZeroVector};
+
+	/** The room distance from the Nightstalker and from the player, or INDEX_NONE if unreachable. */
+	int32 DistanceFromSelf {INDEX_NONE};
+	int32 DistanceToPlayer {INDEX_NONE};
+
+	/** The portal between this room and the room of the player. Only valid if the room is adjacent to the room of the player. */
+	FVector PlayerRoomPortal {FVector::ZeroVector};
+};
+
+/** Struct containing baked ambush points, stored as separate arrays per attribute so that they can be scored four at a time. */
+struct FNightstalkerAmbushPoints
+{
+	TArray<float> LocationX;
+	TArray<float> LocationY;
+	TArray<float> LocationZ;
+
+	/** The fraction of the entrances of the room the point is hidden from, between 0 and 1. */
+	TArray<float> Cover;
+
+	/** The darkness of the point, between 0 and 1. */
+	TArray<float> Darkness;
+
+	/** The distance to the nearest portal of the room of the point. */
+	TArray<float> PortalDistance;
+
+	/** The room of every point. */
+	TArray<int32> RoomIds;
+
+	/** Returns the number of points. */
+	FORCEINLINE int32 Num() const {return RoomIds.Num(); }
+
+	/** Returns the location of a point. */
+	FORCEINLINE FVector GetLocation(const int32 Index) const {return FVector(LocationX[Index], LocationY[Index], LocationZ[Index]); }
+};
+
+/** Struct containing a copy of all world state a behavior decision depends on. Gathered on the game thread, so that the decision can be made on any thread. */
+struct FNightstalkerBehaviorSnapshot
+{
+	EBehaviorMode Mode {EBehaviorMode::RoamMode};
+	float TimeInMode {0.0f};
+
+	FVector SelfLocation {FVector::ZeroVector};
+	int32 SelfRoomId {INDEX_NONE};
+
+	bool HasPlayer {false};
+	FVector PlayerLocation {FVector::ZeroVector};
+	FVector PlayerVelocity {FVector::ZeroVector};
+	int32 PlayerRoomId {INDEX_NONE};
+
+	/** The room distance between the Nightstalker and the player over the connections the Nightstalker can take, or INDEX_NONE if unknown. */
+	int32 DistanceToPlayer {INDEX_NONE};
+
+	/** The last known line of sight between the Nightstalker and the player, in both directions. */
+	bool CanSeePlayer {false};
+	bool IsSeenByPlayer {false};
+
+	/** The first portal on the path of the Nightstalker to the room of the player. */
+	bool HasPortalTowardsPlayer {false};
+	FVector PortalTowardsPlayer {FVector::ZeroVector};
+	int32 RoomTowardsPlayer {INDEX_NONE};
+
+	/** The rooms within the roam radius of the Nightstalker. */
+	TArray<FNightstalkerRoomCandidate> Candidates;
+
+	/** The hottest player stimulus within the stimulus search radius of the Nightstalker. */
+	bool HasStimulus {false};
+	FVector StimulusLocation {FVector::ZeroVector};
+	float StimulusHeat {0.0f};
+	int32 StimulusRoomId {INDEX_NONE};
+
+	/** The baked ambush points in the rooms next to the room of the player. Only gathered when the Nightstalker is close enough to ambush. */
+	FNightstalkerAmbushPoints AmbushPoints;
+
+	/** The target of the previous decision, and the time since the Nightstalker started moving towards it. */
+	bool HasPreviousTarget {false};
+	FVector PreviousTargetLocation {FVector::ZeroVector};
+	int32 PreviousTargetRoomId {INDEX_NONE};
+	float TimeOnPreviousTarget {0.0f};
+
+	/** The seed of the random stream the decision uses. */
+	int32 RandomSeed {0};
+};
+
+/** The native behavior engine of the Nightstalker.
+ *	A decision is a pure function of a snapshot and the settings. It does not access any UObject, so it can run on a worker thread.
+ *	@Brief Native behavior decisions for the Nightstalker.
+ */
+class FNightstalkerBehaviorEngine
+{
+public:
+	/** Decides the behavior mode and target of the Nightstalker. Thread safe. */
+	static FNightstalkerBehaviorDecision Decide(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings);
+
+	/** Returns the behavior mode the Nightstalker should be in, applying hysteresis between the modes. */
+	static EBehaviorMode DecideMode(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings);
+
+private:
+	/** Investigates a strong enough player stimulus, or picks a random room within the roam radius, preferring rooms further away. */
+	static void DecideRoam(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings, FRandomStream& Random, FNightstalkerBehaviorDecision& OutDecision);
+
+	/** Moves towards or away from the player to keep the stalk hold distance, and out of the sight of the player. */
+	static void DecideStalk(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings, FNightstalkerBehaviorDecision& OutDecision);
+
+	/** Waits at the best ambush point near the predicted location of the player.
+	 *	Without baked ambush points, waits next to the portal of the room of the player that is closest to the predicted location of the player.
+	 */
+	static void DecideAmbush(const FNightstalkerBehaviorSnapshot& Snapshot, const FNightstalkerBehaviorSettings& Settings, FNightstalkerBehaviorDecision& OutDecision);
+
+	/** Scores all ambush points four at a time and returns the index of the best point, or INDEX_NONE if every point is too close to the player.
+	 *	@Param PredictedLocation The location the player is expected to be at.
+	 */
+	static int32 FindBestAmbushPoint(const FNightstalkerAmbushPoints& Points, const FVector& PlayerLocation, const FVector& PredictedLocation, const FNightstalkerBehaviorSettings& Settings);
+};
@@ -10,15 +10,23 @@
 
 class ANightstalker;
 class ANightstalkerController;
+class UNightstalkerScriptRunner;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnActivationDelegate);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnDeactivationDelegate);
 
+/** Actor Component that implements a behavior of the Nightstalker.
+ *	Active scripts do not tick themselves. They are updated by the script runner of the Nightstalker, in order of priority and at their own update rate.
+ *	Blueprint scripts implement their behavior in the tick event, which is called by the script runner.
+ *	@Brief Actor Component that implements a behavior of the Nightstalker.
+ */
 UCLASS(Abstract, Blueprintable, BlueprintType, ClassGroup = (Nightstalker))
 class UNightstalkerBehaviorScript : public UActorComponent
 {
 	GENERATED_BODY()
 
+	friend class UNightstalkerScriptRunner;
+
 public:
 	/** The delegate that is called when the script is activated. */
 	UPROPERTY(BlueprintAssignable, Category = "BehaviorScrip|Delegates", Meta = (DisplayName = "On Script Activation"))
@@ -36,7 +44,23 @@ private:
 	/** If true, the behavior script is currently active. */
 	UPROPERTY()
 	bool IsScriptActive {false};
-	
+
+	/** Scripts with a higher priority are updated first, and are the last to be deferred when the update budget of the script runner is spent. */
+	UPROPERTY(EditDefaultsOnly, Category = "BehaviorScript|Scheduling", Meta = (DisplayName = "Priority"))
+	int32 Priority {0};
+
+	/** The number of updates per second. A value of zero updates the script every frame. */
+	UPROPERTY(EditDefaultsOnly, Category = "BehaviorScript|Scheduling", Meta = (DisplayName = "Update Rate", Units = "Hertz", ClampMin = "0.0"))
+	float UpdateRate {0.0f};
+
+	/** The time since the last update, and the number of consecutive frames the script has been deferred. Managed by the script runner. */
+	float TimeSinceUpdate {0.0f};
+	int32 DeferredFrames {0};
+
+	/** The time the last update took, and the moving average of the time an update takes, in milliseconds. */
+	float LastUpdateCost {0.0f};
+	float AverageUpdateCost {0.0f};
+
 public:
 	UNightstalkerBehaviorScript();
 	
@@ -52,10 +76,36 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "BehaviorScript", Meta = (DisplayName = "Deactivate Script"))
 	void DeactivateScript();
 
+	/** Returns the priority of the script. */
+	FORCEINLINE int32 GetPriority() const {return Priority; }
+
+	/** Returns the time between updates of the script. */
+	FORCEINLINE float GetUpdateInterval() const {return UpdateRate > 0.0f ? 1.0f / UpdateRate : 0.0f; }
+
+	/** Returns the time the last update of the script took, in milliseconds. */
+	UFUNCTION(BlueprintPure, Category = "BehaviorScript|Stats", Meta = (DisplayName = "Get Last Update Cost"))
+	FORCEINLINE float GetLastUpdateCost() const {return LastUpdateCost; }
+
+	/** Returns the moving average of the time an update of the script takes, in milliseconds. */
+	UFUNCTION(BlueprintPure, Category = "BehaviorScript|Stats", Meta = (DisplayName = "Get Average Update Cost"))
+	FORCEINLINE float GetAverageUpdateCost() const {return AverageUpdateCost; }
+
 protected:
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	/** Updates the behavior of the script. Called by the script runner.
+	 *	@Param DeltaTime The time since the last update of the script.
+	 */
+	virtual void UpdateScript(const float DeltaTime);
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	/** Returns a pointer to the nightstalker instance that this behavior script is controlling. */
 	UFUNCTION(BlueprintGetter, Category = "BehaviorScript", Meta = (DisplayName = "Nightstalker", BlueprintProtected))
 	FORCEINLINE ANightstalker* GetNightstalker() const {return Nightstalker; }
+
+private:
+	/** Returns the script runner of the actor that owns this script. */
+	UNightstalkerScriptRunner* GetScriptRunner() const;
+
+	/** Records the time an update took. */
+	void RecordUpdateCost(const float Milliseconds);
 };
@@ -6,22 +6,31 @@
 
 #include "CoreMinimal.h"
 #include "AIController.h"
+#include "Tasks/Task.h"
+#include "NightstalkerBehaviorEngine.h"
+#include "NightstalkerPathfindingSubsystem.h"
 #include "NightstalkerController.generated.h"
 
-struct FTimerHandle;
 
-UENUM(BlueprintType)
-enum class EBehaviorMode : uint8
+/** Enum for indexing the Blueprint mode hooks of the Nightstalker controller. */
+enum class ENightstalkerBehaviorHook : uint8
 {
-	RoamMode    UMETA(DisplayName = "Roam Mode", ToolTip = "In roam mode, we assume that the Nightstalker is not implicitly aware about the whereabouts of the player." ),
-	StalkMode    UMETA(DisplayName = "stalk Mode", ToolTip = "In stalk mode, we assume that the Nightstalker is implicitly aware about the whereabouts of the player."),
-	AmbushMode  UMETA(DisplayName = "Ambush Mode", ToolTip = "In ambush mode, The Nightstalker is near the player and ready to strike.")
+	TickRoam,
+	TickStalk,
+	TickAmbush,
+	UpdateRoam,
+	UpdateStalk,
+	UpdateAmbush,
 };
 
 UCLASS(Abstract, Blueprintable, BlueprintType, ClassGroup = (Nightstalker))
 class ANightstalkerController : public AAIController
 {
 	GENERATED_BODY()
+
+public:
+	/** The maximum number of ambush points a decision scores. */
+	static constexpr int32 MaxAmbushPoints {64};
 	
 private:
 	/** The current behavior mode of the Nightstalker.*/
@@ -40,16 +49,67 @@ private:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Ambush Mode Update Interval", AllowPrivateAccess = "true"))
 	float AmbushModeUpdateInterval {1.1f};
 	
-	/** The timer handle for the behavior mode update. */
-	UPROPERTY(BlueprintReadOnly, Category = "NightstalkerController|Timers", Meta = (DisplayName = "Behavior Update Timer Handle", AllowPrivateAccess = "true"))
-	FTimerHandle BehaviorUpdateTimerHandle;
-	
+	/** When enabled, the native behavior engine decides the behavior mode and movement target on every update.
+	 *	The Blueprint mode events remain available as optional hooks, and are only called if they are implemented. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Enable Native Behavior", AllowPrivateAccess = "true"))
+	bool IsNativeBehaviorEnabled {true};
+
+	/** The settings the native behavior engine decides with. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Behavior Settings", EditCondition = "IsNativeBehaviorEnabled", AllowPrivateAccess = "true"))
+	FNightstalkerBehaviorSettings BehaviorSettings;
+
+	/** The seed of the random stream of the native behavior engine. Zero picks a random seed. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Behavior Seed", EditCondition = "IsNativeBehaviorEnabled", AllowPrivateAccess = "true"))
+	int32 BehaviorSeed {0};
+
+	/** When enabled, decisions are made and applied on the game thread during the update that requests them. */
+	bool IsDecisionSynchronous {false};
+
+	/** Whether the Nightstalker is simulated by the virtual Nightstalker subsystem, and whether its updates were scheduled before. */
+	bool IsVirtualized {false};
+	bool WasScheduledBeforeVirtualization {false};
+
+	/** The random stream that provides the seed of every decision. */
+	FRandomStream BehaviorRandom;
+
+	/** The decision that is being made on a worker thread, if any. */
+	UE::Tasks::TTask<FNightstalkerBehaviorDecision> PendingDecision;
+
+	/** The last decision that was applied. */
+	UPROPERTY(BlueprintReadOnly, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Last Behavior Decision", AllowPrivateAccess = "true"))
+	FNightstalkerBehaviorDecision LastDecision;
+
+	/** The world time at which the current behavior mode was entered. */
+	double BehaviorModeStartTime {0.0};
+
+	/** The world time at which the Nightstalker started moving towards the target of the last decision. */
+	double TargetStartTime {0.0};
+
+	/** The ID of the path request that is in flight, or zero. */
+	uint32 PathRequestId {0};
+
+	/** The goal of the path that is being followed. */
+	FVector PathGoal {FVector::ZeroVector};
+
+	/** Whether a path is being followed that has not been refined up to its goal yet. */
+	bool HasPathGoal {false};
+	bool IsPathRefinedToGoal {false};
+
+	/** Bitmask of the Blueprint mode hooks that are implemented. Hooks that are not implemented are never called, to avoid the cost of the Blueprint VM. */
+	uint8 ImplementedBlueprintHooks {0};
+
 protected:
+	/** Called when the game starts for the controller. */
+	virtual void BeginPlay() override;
+
 	/** Called every frame. */
 	virtual void Tick(float DeltaSeconds) override;
 
 	/** Called when the game ends for the controller. */
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Called when a move request finishes. Continues along a path that has only been refined in part. */
+	virtual void OnMoveCompleted(FAIRequestID RequestID, const FPathFollowingResult& Result) override;
 	
 	/** Set the controller to a specific behavior mode.
 	 *	@Mode The mode to switch to.
@@ -96,12 +156,54 @@ protected:
 	UFUNCTION(BlueprintNativeEvent, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Ambush Mode Tick"))
 	void TickAmbushMode();
 
+	/** Called after the native behavior engine has made a decision and the decision has been applied. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "On Behavior Decision"))
+	void EventOnBehaviorDecision(const FNightstalkerBehaviorDecision& Decision);
+
 private:
-	/** Called every update interval. */
-	UFUNCTION()
-	void OnBehaviorModeUpdate();
+	/** Returns the update interval of a behavior mode. */
+	float GetBehaviorModeUpdateInterval(const EBehaviorMode Mode) const;
+
+	/** Schedules the behavior updates for the current behavior mode with the Nightstalker subsystem. */
+	void StartBehaviorModeUpdates();
+
+	/** Copies the world state the native behavior engine depends on. */
+	void GatherBehaviorSnapshot(FNightstalkerBehaviorSnapshot& OutSnapshot);
+
+	/** Starts a native behavior decision on a worker thread, unless one is already in flight. */
+	void RequestBehaviorDecision();
+
+	/** Applies a native behavior decision on the game thread. */
+	void ApplyBehaviorDecision(const FNightstalkerBehaviorDecision& Decision);
+
+	/** Moves to a location over a hierarchical path. Keeps following the current path if it already leads to the location. */
+	void MoveAlongPathTo(const FVector& Goal);
+
+	/** Requests a path from the Nightstalker to the path goal. */
+	void RequestPathToGoal();
+
+	/** Called when a requested path has been refined. */
+	void HandlePathFound(const uint32 RequestId, const FNightstalkerPath& Path);
+
+	/** Returns whether a Blueprint mode hook is implemented. */
+	FORCEINLINE bool IsBlueprintHookImplemented(const ENightstalkerBehaviorHook Hook) const {return ImplementedBlueprintHooks & (1 << static_cast<uint8>(Hook)); }
 
 public:
+	/** Called by the Nightstalker subsystem every update interval. */
+	void OnBehaviorModeUpdate();
+
+	/** Restarts the random stream of the native behavior engine with a seed. */
+	void SetBehaviorSeed(const int32 Seed);
+
+	/** Sets whether decisions are made on the game thread. Used by deterministic simulations, where the frame in which a worker thread completes would change the outcome. */
+	void SetDecisionSynchronous(const bool Value);
+
+	/** Stops or resumes the behavior of the controller. While virtualized, the controller does not update, decide, path or move. */
+	void SetVirtualized(const bool Value);
+
+	/** Returns the last decision that was applied. */
+	FORCEINLINE const FNightstalkerBehaviorDecision& GetLastBehaviorDecision() const {return LastDecision; }
+
 	UFUNCTION(BlueprintGetter, Category = "NightstalkerController|Behavior", Meta = (DisplayName = "Current Behavior Mode"))
 	FORCEINLINE EBehaviorMode GetBehaviorMode() const {return BehaviorMode; }
 };
@@ -0,0 +1,151 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Containers/LruCache.h"
+#include "NavigationSystemTypes.h"
+#include "NightstalkerPathfindingSubsystem.generated.h"
+
+class AAIController;
+class ANavigationData;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+
+/** Struct containing a hierarchical path. */
+struct FNightstalkerPath
+{
+	/** The rooms the path passes through, from the start room to the goal room. Empty if the path does not use the room graph. */
+	TArray<int32> Rooms;
+
+	/** The coarse waypoints of the path: the portals between consecutive rooms, followed by the goal. */
+	TArray<FVector> Waypoints;
+
+	/** The navmesh points of the refined segments, starting at the start location. */
+	TArray<FVector> Points;
+
+	/** The number of waypoints that are covered by the refined points. */
+	int32 RefinedWaypointCount {0};
+
+	/** Whether a path was found. */
+	bool IsValid {false};
+
+	/** Returns whether the refined points reach the goal. */
+	FORCEINLINE bool IsComplete() const {return IsValid && RefinedWaypointCount == Waypoints.Num(); }
+};
+
+DECLARE_DELEGATE_TwoParams(FNightstalkerPathDelegate, const uint32 /** RequestId */, const FNightstalkerPath& /** Path */);
+
+/** Struct containing a path request that is waiting for its segments to be refined. */
+struct FNightstalkerPathRequest
+{
+	FNightstalkerPath Path;
+
+	/** The refined points of every segment. */
+	TArray<TArray<FVector>, TInlineAllocator<2>> SegmentPoints;
+
+	/** The number of segments that are still being refined on the navmesh. */
+	int32 PendingSegmentCount {0};
+
+	bool HasFailed {false};
+
+	FNightstalkerPathDelegate OnComplete;
+};
+
+/** Struct containing a navmesh query for a segment that is in flight. */
+struct FNightstalkerSegmentQuery
+{
+	uint32 RequestId {0};
+	int32 SegmentIndex {INDEX_NONE};
+
+	/** The cache key of the segment, kept with the query so that the segment is cached even if its request has been cancelled. Invalid if the segment cannot be cached. */
+	FIntVector SegmentKey {INDEX_NONE};
+};
+
+/** World Subsystem that finds paths for the Nightstalker in two levels.
+ *	A path is first planned over the Nightstalker layer of the room graph, which yields the rooms and portals between the start and the goal.
+ *	Only the segments through the current and the next room are then refined on the navmesh, asynchronously. The rest of the path is refined
+ *	when the Nightstalker has followed the refined segments and requests the path again. Refined segments from one portal to the next are
+ *	independent of the start and the goal, and are kept in a least recently used cache. The cache assumes all Nightstalkers share one navigation agent.
+ *	@Brief World Subsystem that finds hierarchical paths for the Nightstalker.
+ */
+UCLASS(ClassGroup = (Nightstalker))
+class UNightstalkerPathfindingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** The number of segments that are refined on the navmesh per request. */
+	static constexpr int32 RefinedSegmentCount {2};
+
+	/** The maximum number of portal to portal segments in the cache. */
+	static constexpr int32 MaxCachedSegments {256};
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The refined portal to portal segments, keyed by the room before, through and after the segment. */
+	TLruCache<FIntVector, TArray<FVector>> SegmentCache;
+
+	/** The requests that are waiting for their segments. */
+	TMap<uint32, FNightstalkerPathRequest> Requests;
+
+	/** The navmesh queries that are in flight, mapped to their request and segment. */
+	TMap<uint32, FNightstalkerSegmentQuery> PendingQueries;
+
+	/** The ID of the last request. */
+	uint32 LastRequestId {0};
+
+	/** When enabled, segments are refined on the game thread when they are requested. */
+	bool IsSynchronous {false};
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Requests a path. The result is always delivered asynchronously, also when every segment is cached.
+	 *	@Param Querier The controller the path is for, which provides the navigation agent and query filter.
+	 *	@Param Start The start location of the path.
+	 *	@Param Goal The goal location of the path.
+	 *	@Param OnComplete Called with the path when it has been refined.
+	 *	@Return The ID of the request, or zero if the request could not be made.
+	 */
+	uint32 RequestPath(const AAIController* Querier, const FVector& Start, const FVector& Goal, const FNightstalkerPathDelegate& OnComplete);
+
+	/** Cancels a request. Its delegate will not be called. */
+	void CancelRequest(const uint32 RequestId);
+
+	/** Sets whether segments are refined synchronously. The result is still delivered in the next frame.
+	 *	Used by deterministic simulations, where the frame in which an asynchronous query completes would change the outcome. */
+	void SetSynchronous(const bool Value);
+
+	/** Empties the segment cache. Called when the navmesh or the room graph changes. */
+	void ClearCache();
+
+private:
+	/** Plans the rooms and waypoints of a path over the room graph. Falls back to a single segment to the goal if either location is outside the room graph. */
+	void PlanPath(const FVector& Start, const FVector& Goal, FNightstalkerPath& OutPath) const;
+
+	/** Called when a navmesh query for a segment finishes. */
+	void HandleSegmentFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath);
+
+	/** Copies the points of a refined segment. Returns false if the segment could not be refined up to its end. */
+	static bool GetSegmentPoints(const ENavigationQueryResult::Type Result, const FNavPathSharedPtr& NavPath, TArray<FVector>& OutPoints);
+
+	/** Stitches the segments of a request together and calls its delegate. */
+	void CompleteRequest(const uint32 RequestId);
+
+	/** Called when the navmesh has been rebuilt. */
+	UFUNCTION()
+	void HandleNavigationGenerationFinished(ANavigationData* NavData);
+};
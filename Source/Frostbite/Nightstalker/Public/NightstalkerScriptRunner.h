@@ -0,0 +1,69 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "NightstalkerScriptRunner.generated.h"
+
+class UNightstalkerBehaviorScript;
+
+/** Actor Component that updates the active behavior scripts of a Nightstalker from a single tick function.
+ *	The active scripts are kept in a flat array, sorted from the highest to the lowest priority. Scripts are only updated at their own update rate,
+ *	and once the update budget of a frame is spent, the remaining scripts are deferred to the next frame. The script with the highest priority that is due always runs.
+ *	The component only ticks while at least one script is active.
+ *	@Brief Actor Component that runs the behavior scripts of a Nightstalker within a budget.
+ */
+UCLASS(NotBlueprintable, BlueprintType, ClassGroup = (Nightstalker))
+class UNightstalkerScriptRunner : public UActorComponent
+{
+	GENERATED_BODY()
+
+private:
+	/** The active scripts, sorted by priority. Scripts that are deactivated during an update are cleared and removed after the update. */
+	UPROPERTY()
+	TArray<UNightstalkerBehaviorScript*> ActiveScripts;
+
+	/** The scripts that were activated during an update. They are added to the active scripts after the update. */
+	UPROPERTY()
+	TArray<UNightstalkerBehaviorScript*> PendingScripts;
+
+	/** The time the script updates of a frame may take together, in milliseconds. */
+	UPROPERTY(EditAnywhere, Category = "ScriptRunner", Meta = (DisplayName = "Update Budget", Units = "Milliseconds", ClampMin = "0.0"))
+	float UpdateBudget {0.5f};
+
+	/** The number of consecutive frames a script can be deferred before it runs regardless of the budget. */
+	UPROPERTY(EditAnywhere, Category = "ScriptRunner", Meta = (DisplayName = "Max Deferred Frames", ClampMin = "0"))
+	int32 MaxDeferredFrames {4};
+
+	/** If true, the active scripts are currently being updated. */
+	bool IsUpdating {false};
+
+public:
+	UNightstalkerScriptRunner();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Adds a script to the active scripts. Called when a script is activated. */
+	void RegisterScript(UNightstalkerBehaviorScript* Script);
+
+	/** Removes a script from the active scripts. Called when a script is deactivated. */
+	void UnregisterScript(UNightstalkerBehaviorScript* Script);
+
+	/** Sets the time the script updates of a frame may take together. */
+	UFUNCTION(BlueprintCallable, Category = "ScriptRunner", Meta = (DisplayName = "Set Update Budget"))
+	void SetUpdateBudget(const float Milliseconds);
+
+	/** Returns the number of active scripts. */
+	UFUNCTION(BlueprintPure, Category = "ScriptRunner", Meta = (DisplayName = "Get Active Script Count"))
+	FORCEINLINE int32 GetActiveScriptCount() const {return ActiveScripts.Num() + PendingScripts.Num(); }
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Inserts a script after all active scripts with the same or a higher priority. */
+	void InsertScript(UNightstalkerBehaviorScript* Script);
+};
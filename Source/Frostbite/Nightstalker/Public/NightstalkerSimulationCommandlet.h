@@ -0,0 +1,70 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NightstalkerBehaviorEngine.h"
+#include "NightstalkerSimulationCommandlet.generated.h"
+
+class APlayerCharacter;
+
+/** Struct containing a single recorded Nightstalker update. */
+struct FNightstalkerSimulationRecord
+{
+	int32 Frame {0};
+	double Time {0.0};
+	int32 ControllerIndex {INDEX_NONE};
+	double Microseconds {0.0};
+	FNightstalkerBehaviorDecision Decision;
+};
+
+/** Commandlet that runs the Nightstalker AI on a map at a fixed timestep, as fast as possible.
+ *	The player is moved along a seeded random tour through the rooms of the map, and every Nightstalker update is recorded with its cost and decision.
+ *	Decisions are made synchronously, paths are refined synchronously and the update budgets of the scheduler and the script runners are lifted,
+ *	so that two runs with the same seed make the same decisions. The hash of the decision trace is logged, so that runs can be compared without comparing the CSV files.
+ *	Run with: UnrealEditor-Cmd Frostbite -run=NightstalkerSimulation -nullrhi -nosound -Map=/Game/Maps/Map [-Seconds=300] [-Fps=30] [-Seed=1337]
+ *	[-Speed=300] [-Player=/Game/Path/BP_Player.BP_Player_C] [-Nightstalker=/Game/Path/BP_Nightstalker.BP_Nightstalker_C] [-Count=1] [-Csv=Path]
+ *	@Brief Deterministic headless simulation of the Nightstalker AI.
+ */
+UCLASS()
+class UNightstalkerSimulationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	/** The maximum number of waypoints of the tour of the player. */
+	static constexpr int32 MaxWaypoints {4096};
+
+	/** Constructor with default values. */
+	UNightstalkerSimulationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** Loads a map into a game world that is ticked manually. */
+	static UWorld* LoadWorld(const FString& MapName);
+
+	/** Spawns the player at the first player start. The player is moved by the simulation, so its movement component does not tick. */
+	static APlayerCharacter* SpawnPlayer(UWorld* World, const FString& PlayerClassPath);
+
+	/** Spawns Nightstalkers at the Nightstalker starts of the map, in addition to the Nightstalkers that are placed in the map. */
+	static void SpawnNightstalkers(UWorld* World, const FString& NightstalkerClassPath, const int32 Count);
+
+	/** Builds a tour of the player through random adjacent rooms, through the portals between them. Turning back is only allowed in dead ends.
+	 *	@Param Start The location of the player.
+	 *	@Param Length The minimum length of the tour.
+	 *	@Param HalfHeight The distance between the floor and the location of the player.
+	 *	@Param Random The random stream that picks the rooms.
+	 *	@Param OutWaypoints The waypoints of the tour, projected onto the floor.
+	 */
+	static void BuildPlayerTour(const UWorld* World, const FVector& Start, const float Length, const float HalfHeight, FRandomStream& Random, TArray<FVector>& OutWaypoints);
+
+	/** Returns the location on the tour at a distance from its start. The segment cursor only moves forward, as the distance only increases. */
+	static FVector GetTourLocation(const TArray<FVector>& Waypoints, const float Distance, int32& InOutSegment, float& InOutSegmentStart);
+
+	/** Writes the records to the log and optionally to a CSV file. */
+	static void ReportResults(const TArray<FNightstalkerSimulationRecord>& Records, const FString& CsvPath);
+};
@@ -8,12 +8,96 @@
 #include "Subsystems/WorldSubsystem.h"
 #include "NightstalkerSubsystem.generated.h"
 
-/**
- * 
+class ANightstalkerController;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FNightstalkerUpdatedDelegate, ANightstalkerController* /** Controller */, const double /** Seconds */);
+
+/** Struct containing a scheduled Nightstalker update. */
+struct FNightstalkerUpdateEntry
+{
+	TWeakObjectPtr<ANightstalkerController> Controller;
+
+	/** The world time at which the next update is due. */
+	double DueTime {0.0};
+
+	/** The world time of the last update. */
+	double LastUpdateTime {0.0};
+
+	/** The interval between updates. */
+	float Interval {1.0f};
+
+	/** Sort key for the due updates of a frame. Lower values are updated first. */
+	float Priority {0.0f};
+
+	/** Whether the controller was unscheduled while its update was due. */
+	bool IsUnscheduled {false};
+};
+
+/** World Subsystem that schedules the behavior updates of all Nightstalkers.
+ *	Updates are kept in a priority queue ordered by their due time. The first update of every controller is staggered over its interval,
+ *	so that controllers that register in the same frame do not update in the same frame. Every frame, the due updates are run in order of the
+ *	distance of their Nightstalker to the player until the update budget is spent. Remaining updates are deferred to the next frame.
+ *	@Brief World Subsystem that schedules Nightstalker updates.
  */
 UCLASS(ClassGroup = (Nightstalker))
-class UNightstalkerSubsystem : public UWorldSubsystem
+class UNightstalkerSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
-	
+
+public:
+	/** Delegate that is called after every update, with the time the update took. */
+	FNightstalkerUpdatedDelegate OnControllerUpdated;
+
+private:
+	/** The scheduled updates, stored as a binary heap ordered by due time. */
+	TArray<FNightstalkerUpdateEntry> UpdateQueue;
+
+	/** The updates that are due in the current frame. These are out of the queue until they have run or are deferred,
+	 *	so that a controller that is rescheduled or unscheduled in the meantime changes its due entry instead of the queue. */
+	TArray<FNightstalkerUpdateEntry> DueUpdates;
+
+	/** The index of the due update that is currently running. Due updates before this index have already been handled. */
+	int32 DueIndex {0};
+
+	/** The time all updates of a frame may take together. At least one update runs every frame. */
+	float UpdateBudget {1.0f};
+
+	/** The number of controllers that have registered. Used to stagger the phase of their updates. */
+	int32 RegistrationCount {0};
+
+	/** The longest time an update has been deferred past its due time. */
+	float WorstLatency {0.0f};
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Schedules the updates of a controller. If the controller is already scheduled, its interval is changed while keeping its phase.
+	 *	@Param Controller The controller to update.
+	 *	@Param Interval The time between two updates.
+	 */
+	void ScheduleController(ANightstalkerController* Controller, const float Interval);
+
+	/** Stops scheduling the updates of a controller. */
+	void UnscheduleController(ANightstalkerController* Controller);
+
+	/** Returns whether the updates of a controller are scheduled. */
+	bool IsControllerScheduled(const ANightstalkerController* Controller) const;
+
+	/** Sets the time all Nightstalker updates of a frame may take together. */
+	UFUNCTION(BlueprintCallable, Category = "Nightstalker", Meta = (DisplayName = "Set Update Budget"))
+	void SetUpdateBudget(const float Milliseconds);
+
+	/** Returns the longest time an update has been deferred past its due time. */
+	UFUNCTION(BlueprintPure, Category = "Nightstalker", Meta = (DisplayName = "Get Worst Update Latency"))
+	FORCEINLINE float GetWorstLatency() const {return WorstLatency; }
+
+private:
+	/** Returns the priority of an update, which is the distance of the Nightstalker to the player. */
+	float GetUpdatePriority(const ANightstalkerController* Controller) const;
+
+	/** Returns the index of the due update of a controller that has not been handled yet, or INDEX_NONE. */
+	int32 FindDueUpdate(const ANightstalkerController* Controller) const;
 };
@@ -0,0 +1,92 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "StimulusHeatMapSettings.generated.h"
+
+/** Struct defining the heat a player stimulus adds to the heat map. */
+USTRUCT(BlueprintType)
+struct FStimulusSplat
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The heat at the location of the stimulus. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusSplat", Meta = (DisplayName = "Heat", ClampMin = "0", UIMin = "0"))
+	float Heat {1.0f};
+
+	/** The distance at which the heat of the stimulus has fallen off to zero. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusSplat", Meta = (DisplayName = "Radius", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float Radius {300.0f};
+
+	/** Constructor with default values. */
+	FStimulusSplat()
+	{
+	}
+
+	FStimulusSplat(const float InHeat, const float InRadius)
+		: Heat(InHeat), Radius(InRadius)
+	{
+	}
+};
+
+/** Data asset that defines how player stimuli are recorded in the stimulus heat map.
+ *	@Brief Settings for the stimulus heat map subsystem.
+ */
+UCLASS(BlueprintType, ClassGroup = (Nightstalker))
+class UStimulusHeatMapSettings : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The size of a cell of the heat map. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap", Meta = (DisplayName = "Cell Size", ClampMin = "10", UIMin = "10", Units = "cm"))
+	float CellSize {100.0f};
+
+	/** The margin around the rooms that is covered by the heat map. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap", Meta = (DisplayName = "Margin", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float Margin {1000.0f};
+
+	/** The half extent of the heat map around the player if the level contains no rooms. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap", Meta = (DisplayName = "Fallback Extent", ClampMin = "0", UIMin = "0", Units = "cm"))
+	float FallbackExtent {10000.0f};
+
+	/** The time in which the heat of a stimulus halves. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap", Meta = (DisplayName = "Half Life", ClampMin = "0.01", UIMin = "0.01", Units = "s"))
+	float HalfLife {4.0f};
+
+	/** Heat below this value is cleared, so that tiles without stimuli stop decaying. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap", Meta = (DisplayName = "Min Heat", ClampMin = "0", UIMin = "0"))
+	float MinHeat {0.02f};
+
+	/** The stimulus of a footstep while walking. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Footstep"))
+	FStimulusSplat Footstep {FStimulusSplat(0.3f, 400.0f)};
+
+	/** The stimulus of a footstep while sprinting. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Sprint Footstep"))
+	FStimulusSplat SprintFootstep {FStimulusSplat(0.6f, 900.0f)};
+
+	/** The stimulus of a soft landing. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Soft Landing"))
+	FStimulusSplat SoftLanding {FStimulusSplat(0.4f, 500.0f)};
+
+	/** The stimulus of a hard landing. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Hard Landing"))
+	FStimulusSplat HardLanding {FStimulusSplat(0.8f, 1000.0f)};
+
+	/** The stimulus of a heavy landing. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Heavy Landing"))
+	FStimulusSplat HeavyLanding {FStimulusSplat(1.0f, 1500.0f)};
+
+	/** The stimulus at the location the flashlight of the player is pointed at. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Flashlight"))
+	FStimulusSplat Flashlight {FStimulusSplat(0.5f, 300.0f)};
+
+	/** The interval at which the flashlight is traced while it is enabled. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "StimulusHeatMap|Stimuli", Meta = (DisplayName = "Flashlight Interval", ClampMin = "0", UIMin = "0", Units = "s"))
+	float FlashlightInterval {0.25f};
+};
@@ -0,0 +1,134 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StimulusHeatMapSettings.h"
+#include "FootstepData.h"
+#include "StimulusHeatMapSubsystem.generated.h"
+
+class APlayerCharacter;
+class URoomGraphSubsystem;
+enum class EPlayerLandingType : uint8;
+
+/** World Subsystem that records the noise and light the player makes in a world space heat map.
+ *	The heat map is a 2D grid of cells around the rooms, stored in square tiles of cells. Stimuli of the player, such as footsteps, landings
+ *	and the flashlight, add heat around their location. Heat decays every frame, but only in tiles that are active, and tiles whose heat has
+ *	decayed completely are deactivated again. Every tile keeps the maximum heat of its cells, so that queries can skip tiles that cannot
+ *	contain a hotter cell. The Nightstalker reads this single structure instead of listening to the player directly.
+ *	@Brief World Subsystem that records player stimuli in a heat map.
+ */
+UCLASS(ClassGroup = (Nightstalker))
+class UStimulusHeatMapSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** The number of cells along each edge of a tile. */
+	static constexpr int32 TileSize {8};
+	static constexpr int32 TileCellCount {TileSize * TileSize};
+
+	/** The maximum number of tiles. The cell size is increased if the play area would require more tiles. */
+	static constexpr int32 MaxTiles {16384};
+
+private:
+	/** Pointer to the room graph subsystem, which provides the bounds of the play area. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	/** The heat map settings in use. */
+	UPROPERTY()
+	UStimulusHeatMapSettings* Settings {nullptr};
+
+	/** The world space location of the corner of the grid, the size of a cell and the number of tiles along each axis. */
+	FVector2D GridOrigin {FVector2D::ZeroVector};
+	float CellSize {100.0f};
+	FIntPoint TileResolution {FIntPoint::ZeroValue};
+
+	/** The heat of every cell, stored per tile. The cells of a tile are contiguous. */
+	TArray<float> Heat;
+
+	/** The world space height of the stimulus that set the heat of every cell, stored in the same layout as the heat. */
+	TArray<float> CellHeight;
+
+	/** The maximum heat of every tile. */
+	TArray<float> TileMaxHeat;
+
+	/** The tiles that contain heat, and whether every tile is in that list. */
+	TArray<int32> ActiveTiles;
+	TBitArray<> IsTileActive;
+
+	/** The player whose stimuli are recorded. */
+	TWeakObjectPtr<APlayerCharacter> BoundPlayer;
+
+	/** The time since the flashlight was last traced. */
+	float TimeSinceFlashlightTrace {0.0f};
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Adds a stimulus to the heat map. The heat falls off linearly with the distance to the location. Cells keep the highest heat of all stimuli.
+	 *	@Param Location The world space location of the stimulus.
+	 *	@Param StimulusHeat The heat at the location of the stimulus.
+	 *	@Param Radius The distance at which the heat has fallen off to zero.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "StimulusHeatMap", Meta = (DisplayName = "Add Stimulus"))
+	void AddStimulus(const FVector& Location, const float StimulusHeat, const float Radius);
+
+	/** Returns the heat at a location. */
+	UFUNCTION(BlueprintPure, Category = "StimulusHeatMap", Meta = (DisplayName = "Get Heat At Location"))
+	float GetHeatAtLocation(const FVector& Location) const;
+
+	/** Finds the hottest cell within a radius of a location.
+	 *	@Param Location The world space location to search around.
+	 *	@Param Radius The search radius.
+	 *	@Param OutLocation The center of the hottest cell, at the height of the stimulus that heated the cell.
+	 *	@Param OutHeat The heat of the hottest cell.
+	 *	@Return Whether a cell with any heat was found.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "StimulusHeatMap", Meta = (DisplayName = "Find Hottest Location"))
+	bool FindHottestLocation(const FVector& Location, const float Radius, FVector& OutLocation, float& OutHeat) const;
+
+private:
+	/** Loads the heat map settings of the game mode, or the default settings if the game mode does not define any. */
+	void LoadSettings();
+
+	/** Builds an empty grid that covers a box. */
+	void BuildGrid(const FBox& Bounds);
+
+	/** Builds the grid around the rooms. Called whenever the room graph is built. */
+	void BuildGridAroundRooms();
+
+	/** Subscribes to the stimuli of the player, if the player has changed. */
+	void BindPlayer();
+
+	/** Decays the heat of all active tiles and deactivates tiles that have cooled down. */
+	void DecayActiveTiles(const float DeltaTime);
+
+	/** Adds the stimulus of the flashlight of the player at the location it is pointed at. */
+	void TraceFlashlight();
+
+	/** Adds a stimulus from the settings. */
+	FORCEINLINE void AddSplat(const FVector& Location, const FStimulusSplat& Splat) {AddStimulus(Location, Splat.Heat, Splat.Radius); }
+
+	/** Called when the player makes a footstep. */
+	UFUNCTION()
+	void HandleFootstep(FFootstepData FootstepData);
+
+	/** Called when the player lands. */
+	UFUNCTION()
+	void HandleLanding(EPlayerLandingType Value);
+
+	/** Returns the index of the first cell of a tile. */
+	FORCEINLINE int32 GetTileCellOffset(const int32 TileIndex) const {return TileIndex * TileCellCount; }
+
+	/** Returns the world space location of the center of a cell. */
+	FVector2D GetCellCenter(const int32 TileX, const int32 TileY, const int32 CellX, const int32 CellY) const;
+};
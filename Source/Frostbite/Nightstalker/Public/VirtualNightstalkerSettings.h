@@ -0,0 +1,46 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "VirtualNightstalkerSettings.generated.h"
+
+/** Data asset that defines when distant Nightstalkers are virtualized, and how they move through the room graph while they are virtual.
+ *	@Brief Settings for the virtual Nightstalker subsystem.
+ */
+UCLASS(BlueprintType, ClassGroup = (Nightstalker))
+class UVirtualNightstalkerSettings : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The room distance to the player beyond which a Nightstalker is virtualized. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Virtualize Distance", ClampMin = "1", UIMin = "1"))
+	int32 VirtualizeDistance {4};
+
+	/** The room distance to the player at which a virtual Nightstalker is rehydrated. Kept below the virtualize distance, so that a Nightstalker does not flip between both states on a room boundary. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Rehydrate Distance", ClampMin = "0", UIMin = "0"))
+	int32 RehydrateDistance {3};
+
+	/** The speed at which a virtual Nightstalker travels from the center of a room through a portal to the center of the next room. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Travel Speed", ClampMin = "1", UIMin = "1", Units = "cm/s"))
+	float TravelSpeed {300.0f};
+
+	/** The range of time a virtual Nightstalker stays in a room before it moves on. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Min Dwell Time", ClampMin = "0", UIMin = "0", Units = "s"))
+	float MinDwellTime {2.0f};
+
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Max Dwell Time", ClampMin = "0", UIMin = "0", Units = "s"))
+	float MaxDwellTime {8.0f};
+
+	/** The chance that a virtual Nightstalker moves towards the room of the player instead of to a random adjacent room. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Player Attraction", ClampMin = "0", ClampMax = "1", UIMin = "0", UIMax = "1"))
+	float PlayerAttraction {0.35f};
+
+	/** The interval at which Nightstalkers are reclassified and virtual Nightstalkers are advanced. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "VirtualNightstalker", Meta = (DisplayName = "Update Interval", ClampMin = "0", UIMin = "0", Units = "s"))
+	float UpdateInterval {0.25f};
+};
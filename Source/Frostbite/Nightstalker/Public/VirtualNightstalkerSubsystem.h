@@ -0,0 +1,112 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VirtualNightstalkerSettings.h"
+#include "VirtualNightstalkerSubsystem.generated.h"
+
+class ANightstalker;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+
+/** Struct containing a registered Nightstalker and its state in the room graph while it is virtual. */
+struct FVirtualNightstalkerEntry
+{
+	TWeakObjectPtr<ANightstalker> Nightstalker;
+
+	/** Whether the Nightstalker is currently simulated as a point in the room graph. */
+	bool IsVirtual {false};
+
+	/** The room the Nightstalker is in or leaving, the room it entered it from and the room it is moving to. */
+	int32 RoomId {INDEX_NONE};
+	int32 PreviousRoomId {INDEX_NONE};
+	int32 NextRoomId {INDEX_NONE};
+
+	/** The world time at which the Nightstalker leaves its room, and the world time at which it arrives in the next room. */
+	double DepartureTime {0.0};
+	double ArrivalTime {0.0};
+
+	/** The random stream that picks the rooms and dwell times. Seeded by the name of the Nightstalker, so that runs are reproducible. */
+	FRandomStream Random;
+};
+
+/** World Subsystem that simulates distant Nightstalkers without their pawn.
+ *	A Nightstalker whose room distance to the player exceeds the virtualize distance is hidden, its ticks are disabled and its controller stops updating.
+ *	While virtual, it moves along the connections of the room graph that it can take, staying in a room for a while and then travelling to an adjacent room
+ *	at the travel speed. Once it comes within the rehydrate distance, the pawn is placed at the portal it is passing through and resumes its full behavior.
+ *	@Brief World Subsystem for the simulation level of detail of the Nightstalker.
+ */
+UCLASS(ClassGroup = (Nightstalker))
+class UVirtualNightstalkerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The virtual Nightstalker settings in use. */
+	UPROPERTY()
+	UVirtualNightstalkerSettings* Settings {nullptr};
+
+	/** The registered Nightstalkers. */
+	TArray<FVirtualNightstalkerEntry> Entries;
+
+	/** The time since the last update. */
+	float TimeSinceUpdate {0.0f};
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Starts managing the simulation level of detail of a Nightstalker. Called when the Nightstalker begins play. */
+	void RegisterNightstalker(ANightstalker* Nightstalker);
+
+	/** Stops managing the simulation level of detail of a Nightstalker. Called when the Nightstalker ends play. */
+	void UnregisterNightstalker(ANightstalker* Nightstalker);
+
+	/** Returns the location of a Nightstalker, interpolated along the room graph while it is virtual.
+	 *	@Return Whether the Nightstalker is registered and its location is known.
+	 */
+	bool GetNightstalkerLocation(const ANightstalker* Nightstalker, FVector& OutLocation) const;
+
+	/** Returns the number of Nightstalkers that are currently virtual. */
+	UFUNCTION(BlueprintPure, Category = "VirtualNightstalker", Meta = (DisplayName = "Get Virtual Nightstalker Count"))
+	int32 GetVirtualNightstalkerCount() const;
+
+private:
+	/** Loads the virtual Nightstalker settings of the game mode, or the default settings if the game mode does not define any. */
+	void LoadSettings();
+
+	/** Returns the room the player is in, or INDEX_NONE. */
+	int32 GetPlayerRoomId() const;
+
+	/** Returns the room distance between a room and the room of the player over the connections the Nightstalker can take, or INDEX_NONE if unknown. */
+	int32 GetDistanceToPlayer(const int32 RoomId, const int32 PlayerRoomId) const;
+
+	/** Hides a Nightstalker and starts simulating it in its current room. */
+	void Virtualize(FVirtualNightstalkerEntry& Entry, const int32 RoomId, const int32 PlayerRoomId, const double Now);
+
+	/** Places a virtual Nightstalker at the portal it is passing through and restores its full behavior. */
+	void Rehydrate(FVirtualNightstalkerEntry& Entry, const double Now);
+
+	/** Moves a virtual Nightstalker through the room graph up to the current time. */
+	void Advance(FVirtualNightstalkerEntry& Entry, const int32 PlayerRoomId, const double Now);
+
+	/** Picks the next room of a virtual Nightstalker and the times at which it leaves its room and arrives in the next room. */
+	void PlanNextMove(FVirtualNightstalkerEntry& Entry, const int32 PlayerRoomId, const double StartTime);
+
+	/** Returns the time it takes to travel from the center of one room through their portal to the center of another room. */
+	float GetTravelTime(const int32 FromId, const int32 ToId) const;
+};
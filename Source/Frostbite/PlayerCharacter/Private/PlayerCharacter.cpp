@@ -7,6 +7,7 @@
 #include "PlayerCharacterController.h"
 #include "PlayerCharacterMovementComponent.h"
 #include "PlayerSubsystem.h"
+#include "RoomMembershipSubsystem.h"
 #include "FrostbiteGameMode.h"
 #include "LogCategories.h"
 
@@ -104,6 +105,15 @@ void APlayerCharacter::BeginPlay()
 		}
 	}
 
+	/** Room membership is tracked by the room membership subsystem, so the capsule does not need to generate overlap events for room volumes. */
+	if(const UWorld* World {GetWorld()})
+	{
+		if(URoomMembershipSubsystem* RoomMembershipSubsystem {World->GetSubsystem<URoomMembershipSubsystem>()})
+		{
+			RoomMembershipSubsystem->RegisterActor(this, true);
+		}
+	}
+
 #if WITH_EDITOR
 		/** Check if all components have been succesfully initialized. */
 		ValidateObject(CameraController, "CameraController");
@@ -309,6 +319,10 @@ void APlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 		{
 			Subsystem->UnregisterPlayerCharacter(this);
 		}
+		if(URoomMembershipSubsystem* RoomMembershipSubsystem {World->GetSubsystem<URoomMembershipSubsystem>()})
+		{
+			RoomMembershipSubsystem->UnregisterActor(this);
+		}
 	}
 	Super::EndPlay(EndPlayReason);
 }
@@ -0,0 +1,11 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "LightInfluenceData.h"
+
+bool ULightInfluenceData::IsValidData() const
+{
+	return CellSize > 0.0f && Sources.Num() > 0 && MaskWordCount == GetMaskWordCount(Sources.Num())
+		&& CellMasks.Num() == CellKeys.Num() * MaskWordCount;
+}
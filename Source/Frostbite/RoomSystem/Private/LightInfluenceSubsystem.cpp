@@ -0,0 +1,162 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "LightInfluenceSubsystem.h"
+#include "LightInfluenceData.h"
+#include "RoomVolume.h"
+#include "StatCategories.h"
+#include "LogCategories.h"
+
+#include "Components/LightComponent.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Light Influence Lit Cells"), STAT_LightInfluenceLitCells, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Light Influence Lights"), STAT_LightInfluenceLights, STATGROUP_RoomSystem);
+DECLARE_MEMORY_STAT(TEXT("Light Influence Memory"), STAT_LightInfluenceMemory, STATGROUP_RoomSystem);
+
+bool ULightInfluenceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void ULightInfluenceSubsystem::Deinitialize()
+{
+	Data.Empty();
+	Grids.Empty();
+	LightHandles.Empty();
+	RoomLightHandles.Empty();
+	UpdateStats();
+
+	Super::Deinitialize();
+}
+
+void ULightInfluenceSubsystem::RegisterData(ULightInfluenceData* InData)
+{
+	if(!InData || Data.Contains(InData)) {return; }
+	if(!InData->IsValidData())
+	{
+		UE_LOG(LogLightInfluence, Warning, TEXT("Light influence data %s is empty or corrupt and was not registered. Bake it again from its light influence volume."), *InData->GetName());
+		return;
+	}
+
+	FLightInfluenceGrid& Grid {Grids.AddDefaulted_GetRef()};
+	Data.Add(InData);
+
+	Grid.CellIndices.Reserve(InData->CellKeys.Num());
+	for (int32 i {0}; i < InData->CellKeys.Num(); i++)
+	{
+		Grid.CellIndices.Add(InData->CellKeys[i], i);
+	}
+
+	/** Lights start enabled if they are visible and their room is lit, so that the mask matches the light status of the rooms.
+	 *	Lights in unloaded levels stay disabled. */
+	Grid.EnabledMask.SetNumZeroed(InData->MaskWordCount);
+	for (int32 LightId {0}; LightId < InData->Sources.Num(); LightId++)
+	{
+		const ULightComponent* Light {InData->Sources[LightId].Light.Get()};
+		const ARoomVolume* Room {InData->Sources[LightId].Room.Get()};
+		if(Light && Light->IsVisible() && Light->Intensity > 0.0f && (!Room || Room->GetIsLit()))
+		{
+			Grid.EnabledMask[LightId / 64] |= uint64(1) << (LightId % 64);
+		}
+	}
+
+	RebuildHandles();
+	UpdateStats();
+}
+
+void ULightInfluenceSubsystem::UnregisterData(ULightInfluenceData* InData)
+{
+	const int32 Index {Data.Find(InData)};
+	if(Index == INDEX_NONE) {return; }
+
+	Data.RemoveAt(Index);
+	Grids.RemoveAt(Index);
+	RebuildHandles();
+	UpdateStats();
+}
+
+bool ULightInfluenceSubsystem::IsLocationLit(const FVector& Location) const
+{
+	for (int32 GridIndex {0}; GridIndex < Grids.Num(); GridIndex++)
+	{
+		const ULightInfluenceData* GridData {Data[GridIndex]};
+		const int32* CellIndex {Grids[GridIndex].CellIndices.Find(GridData->GetCellKey(Location))};
+		if(!CellIndex) {continue; }
+
+		const uint64* CellMask {GridData->CellMasks.GetData() + *CellIndex * GridData->MaskWordCount};
+		const uint64* EnabledMask {Grids[GridIndex].EnabledMask.GetData()};
+		for (int32 Word {0}; Word < GridData->MaskWordCount; Word++)
+		{
+			if(CellMask[Word] & EnabledMask[Word])
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ULightInfluenceSubsystem::SetLightEnabled(const ULightComponent* Light, const bool Value)
+{
+	if(const FLightInfluenceHandle* Handle {LightHandles.Find(Light)})
+	{
+		SetLightBit(*Handle, Value);
+	}
+}
+
+void ULightInfluenceSubsystem::SetRoomLightsEnabled(const ARoomVolume* Room, const bool Value)
+{
+	for (TMultiMap<TWeakObjectPtr<const ARoomVolume>, FLightInfluenceHandle>::TConstKeyIterator It {RoomLightHandles.CreateConstKeyIterator(Room)}; It; ++It)
+	{
+		SetLightBit(It.Value(), Value);
+	}
+}
+
+void ULightInfluenceSubsystem::SetLightBit(const FLightInfluenceHandle& Handle, const bool Value)
+{
+	if(!Grids.IsValidIndex(Handle.GridIndex)) {return; }
+
+	uint64& Word {Grids[Handle.GridIndex].EnabledMask[Handle.LightId / 64]};
+	const uint64 Bit {uint64(1) << (Handle.LightId % 64)};
+	Word = Value ? Word | Bit : Word & ~Bit;
+}
+
+void ULightInfluenceSubsystem::RebuildHandles()
+{
+	LightHandles.Reset();
+	RoomLightHandles.Reset();
+	for (int32 GridIndex {0}; GridIndex < Data.Num(); GridIndex++)
+	{
+		const TArray<FLightInfluenceSource>& Sources {Data[GridIndex]->Sources};
+		for (int32 LightId {0}; LightId < Sources.Num(); LightId++)
+		{
+			const FLightInfluenceHandle Handle {GridIndex, LightId};
+			if(const ULightComponent* Light {Sources[LightId].Light.Get()})
+			{
+				LightHandles.Add(Light, Handle);
+			}
+			if(const ARoomVolume* Room {Sources[LightId].Room.Get()})
+			{
+				RoomLightHandles.Add(Room, Handle);
+			}
+		}
+	}
+}
+
+void ULightInfluenceSubsystem::UpdateStats() const
+{
+	int32 LitCells {0};
+	int32 Lights {0};
+	SIZE_T Memory {0};
+	for (int32 GridIndex {0}; GridIndex < Grids.Num(); GridIndex++)
+	{
+		LitCells += Data[GridIndex]->CellKeys.Num();
+		Lights += Data[GridIndex]->Sources.Num();
+		Memory += Data[GridIndex]->CellKeys.GetAllocatedSize() + Data[GridIndex]->CellMasks.GetAllocatedSize()
+			+ Grids[GridIndex].CellIndices.GetAllocatedSize() + Grids[GridIndex].EnabledMask.GetAllocatedSize();
+	}
+	SET_DWORD_STAT(STAT_LightInfluenceLitCells, LitCells);
+	SET_DWORD_STAT(STAT_LightInfluenceLights, Lights);
+	SET_MEMORY_STAT(STAT_LightInfluenceMemory, Memory);
+}
@@ -0,0 +1,171 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "LightInfluenceVolume.h"
+#include "LightInfluenceData.h"
+#include "LightInfluenceSubsystem.h"
+#include "RoomVolume.h"
+#include "LogCategories.h"
+
+#include "Components/BoxComponent.h"
+#include "Components/LocalLightComponent.h"
+#include "Components/SpotLightComponent.h"
+#include "EngineUtils.h"
+#include "Misc/ScopedSlowTask.h"
+
+/** Sets default values for this actor's properties. */
+ALightInfluenceVolume::ALightInfluenceVolume()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Bounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bounds"));
+	Bounds->SetBoxExtent(FVector(2500.0, 2500.0, 500.0));
+	Bounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Bounds->SetGenerateOverlapEvents(false);
+	RootComponent = Bounds;
+}
+
+void ALightInfluenceVolume::BeginPlay()
+{
+	Super::BeginPlay();
+	if(ULightInfluenceSubsystem* Subsystem {GetWorld()->GetSubsystem<ULightInfluenceSubsystem>()})
+	{
+		Subsystem->RegisterData(LightInfluence);
+	}
+}
+
+void ALightInfluenceVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(ULightInfluenceSubsystem* Subsystem {GetWorld()->GetSubsystem<ULightInfluenceSubsystem>()})
+	{
+		Subsystem->UnregisterData(LightInfluence);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+#if WITH_EDITOR
+void ALightInfluenceVolume::BakeLightInfluence()
+{
+	UWorld* World {GetWorld()};
+	if(!World || !LightInfluence)
+	{
+		UE_LOG(LogLightInfluence, Warning, TEXT("Could not bake light influence for %s: no world or no light influence asset assigned."), *GetName());
+		return;
+	}
+
+	/** Gather all local lights inside the volume that cannot move. Movable lights are not baked, as their influence changes at runtime. */
+	const FBox Box {Bounds->Bounds.GetBox()};
+	TArray<ULocalLightComponent*> Lights;
+	for (TActorIterator<AActor> It {World}; It; ++It)
+	{
+		TInlineComponentArray<ULocalLightComponent*> Components {*It};
+		for (ULocalLightComponent* Light : Components)
+		{
+			if(Light->Mobility != EComponentMobility::Movable && Box.IsInside(Light->GetComponentLocation()))
+			{
+				Lights.Add(Light);
+			}
+		}
+	}
+
+	TArray<ARoomVolume*> Rooms;
+	for (TActorIterator<ARoomVolume> It {World}; It; ++It)
+	{
+		Rooms.Add(*It);
+	}
+
+	const int32 MaskWordCount {ULightInfluenceData::GetMaskWordCount(Lights.Num())};
+	LightInfluence->Modify();
+	LightInfluence->Origin = Box.Min;
+	LightInfluence->CellSize = CellSize;
+	LightInfluence->MaskWordCount = MaskWordCount;
+	LightInfluence->Sources.Reset(Lights.Num());
+	LightInfluence->CellKeys.Reset();
+	LightInfluence->CellMasks.Reset();
+
+	const FIntVector MaxCell {LightInfluence->GetCellKey(Box.Max)};
+	TMap<FIntVector, TArray<uint64>> CellMasks;
+
+	FScopedSlowTask SlowTask {static_cast<float>(Lights.Num()), FText::FromString(TEXT("Baking light influence..."))};
+	SlowTask.MakeDialog(true);
+
+	for (int32 LightId {0}; LightId < Lights.Num(); LightId++)
+	{
+		if(SlowTask.ShouldCancel())
+		{
+			UE_LOG(LogLightInfluence, Warning, TEXT("Light influence bake for %s was cancelled, the asset is incomplete."), *GetName());
+			return;
+		}
+		SlowTask.EnterProgressFrame(1.0f);
+
+		const ULocalLightComponent* Light {Lights[LightId]};
+		const FVector LightLocation {Light->GetComponentLocation()};
+
+		/** The light belongs to the smallest room that contains it. */
+		FLightInfluenceSource& Source {LightInfluence->Sources.AddDefaulted_GetRef()};
+		Source.Light = const_cast<ULocalLightComponent*>(Light);
+		double SmallestRoomVolume {TNumericLimits<double>::Max()};
+		for (ARoomVolume* Room : Rooms)
+		{
+			const FBox RoomBox {Room->GetComponentsBoundingBox()};
+			if(RoomBox.IsInside(LightLocation) && RoomBox.GetVolume() < SmallestRoomVolume)
+			{
+				SmallestRoomVolume = RoomBox.GetVolume();
+				Source.Room = Room;
+			}
+		}
+
+		/** Spot lights only influence cells inside their outer cone. */
+		const USpotLightComponent* SpotLight {Cast<USpotLightComponent>(Light)};
+		const float CosOuterCone {SpotLight ? FMath::Cos(FMath::DegreesToRadians(SpotLight->OuterConeAngle)) : -1.0f};
+		const FVector LightDirection {Light->GetDirection()};
+
+		const float Radius {Light->AttenuationRadius * InfluenceRadiusScale};
+		const FIntVector MinLightCell {LightInfluence->GetCellKey(LightLocation - FVector(Radius))};
+		const FIntVector MaxLightCell {LightInfluence->GetCellKey(LightLocation + FVector(Radius))};
+
+		FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
+		Params.bTraceComplex = false;
+		Params.AddIgnoredActor(Light->GetOwner());
+
+		for (int32 Z {FMath::Max(MinLightCell.Z, 0)}; Z <= FMath::Min(MaxLightCell.Z, MaxCell.Z); Z++)
+		{
+			for (int32 Y {FMath::Max(MinLightCell.Y, 0)}; Y <= FMath::Min(MaxLightCell.Y, MaxCell.Y); Y++)
+			{
+				for (int32 X {FMath::Max(MinLightCell.X, 0)}; X <= FMath::Min(MaxLightCell.X, MaxCell.X); X++)
+				{
+					const FVector CellCenter {Box.Min + (FVector(X, Y, Z) + 0.5) * CellSize};
+					const FVector ToCell {CellCenter - LightLocation};
+					const double Distance {ToCell.Size()};
+					if(Distance > Radius) {continue; }
+					if(SpotLight && Distance > KINDA_SMALL_NUMBER && (ToCell / Distance | LightDirection) < CosOuterCone) {continue; }
+
+					/** A cell is only lit if the light can reach its center. */
+					FHitResult HitResult;
+					if(World->LineTraceSingleByChannel(HitResult, LightLocation, CellCenter, ECC_Visibility, Params)) {continue; }
+
+					TArray<uint64>& Mask {CellMasks.FindOrAdd(FIntVector(X, Y, Z))};
+					if(Mask.Num() == 0)
+					{
+						Mask.SetNumZeroed(MaskWordCount);
+					}
+					Mask[LightId / 64] |= uint64(1) << (LightId % 64);
+				}
+			}
+		}
+	}
+
+	LightInfluence->CellKeys.Reserve(CellMasks.Num());
+	LightInfluence->CellMasks.Reserve(CellMasks.Num() * MaskWordCount);
+	for (const TPair<FIntVector, TArray<uint64>>& Cell : CellMasks)
+	{
+		LightInfluence->CellKeys.Add(Cell.Key);
+		LightInfluence->CellMasks.Append(Cell.Value);
+	}
+
+	LightInfluence->MarkPackageDirty();
+	UE_LOG(LogLightInfluence, Log, TEXT("Baked light influence for %s: %d lights, %d lit cells, %d bytes."), *GetName(), Lights.Num(), LightInfluence->CellKeys.Num(),
+		LightInfluence->CellKeys.Num() * static_cast<int32>(sizeof(FIntVector)) + LightInfluence->CellMasks.Num() * static_cast<int32>(sizeof(uint64)));
+}
+#endif
@@ -0,0 +1,278 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomGraphSubsystem.h"
+#include "RoomVolume.h"
+#include "LogCategories.h"
+#include "StatCategories.h"
+
+#include "EngineUtils.h"
+
+DECLARE_CYCLE_STAT(TEXT("Room Graph Build"), STAT_RoomGraphBuild, STATGROUP_RoomSystem);
+DECLARE_MEMORY_STAT(TEXT("Room Graph Memory"), STAT_RoomGraphMemory, STATGROUP_RoomSystem);
+
+bool URoomGraphSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoomGraphSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	BuildGraph();
+}
+
+void URoomGraphSubsystem::Deinitialize()
+{
+	Rooms.Empty();
+	RoomIds.Empty();
+	EdgeOffsets.Empty();
+	EdgeTargets.Empty();
+	EdgeNightstalkerFlags.Empty();
+	EdgePortalLocations.Empty();
+	HopDistances.Empty();
+	NextHops.Empty();
+	SET_MEMORY_STAT(STAT_RoomGraphMemory, 0);
+
+	Super::Deinitialize();
+}
+
+void URoomGraphSubsystem::BuildGraph()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomGraphBuild);
+
+	Rooms.Reset();
+	RoomIds.Reset();
+	UWorld* World {GetWorld()};
+	if(!World) {return; }
+
+	for (TActorIterator<ARoomVolume> It {World}; It; ++It)
+	{
+		RoomIds.Add(*It, Rooms.Add(*It));
+	}
+	if(Rooms.Num() >= InvalidRoomId)
+	{
+		UE_LOG(LogRoomGraph, Error, TEXT("The world contains %d rooms, which exceeds the maximum of %d rooms."), Rooms.Num(), InvalidRoomId - 1);
+		Rooms.Reset();
+		RoomIds.Reset();
+	}
+	const int32 NumRooms {Rooms.Num()};
+
+	/** Gather the undirected connections between rooms. A connection can be defined by either room, and the nightstalker can only take it if neither room disallows it. */
+	TMap<TPair<int32, int32>, bool> Connections;
+	const auto AddConnection {[this, &Connections](const int32 FromId, const TSoftObjectPtr<ARoomVolume>& Target, const bool CanNightstalkerTakePath)
+	{
+		const int32 ToId {GetRoomId(Target.Get())};
+		if(ToId == INDEX_NONE)
+		{
+			UE_LOG(LogRoomGraph, Warning, TEXT("Room %s has a connection to room %s, which is not loaded."), *Rooms[FromId]->GetName(), *Target.ToString());
+			return;
+		}
+		if(ToId == FromId) {return; }
+
+		bool& IsNightstalkerPath {Connections.FindOrAdd(TPair<int32, int32>(FMath::Min(FromId, ToId), FMath::Max(FromId, ToId)), true)};
+		IsNightstalkerPath &= CanNightstalkerTakePath;
+	}};
+
+	for (int32 RoomId {0}; RoomId < NumRooms; RoomId++)
+	{
+		for (const TSoftObjectPtr<ARoomVolume>& ConnectedRoom : Rooms[RoomId]->ConnectedRooms)
+		{
+			if(!ConnectedRoom.IsNull())
+			{
+				AddConnection(RoomId, ConnectedRoom, true);
+			}
+		}
+		for (const FRoomPathData& Path : Rooms[RoomId]->PathData)
+		{
+			if(!Path.Room.IsNull())
+			{
+				AddConnection(RoomId, Path.Room, Path.CanNightstalkerTakePath);
+			}
+		}
+	}
+
+	/** Store every connection as two directed edges, sorted by source and target room so that the layout does not depend on the order of the connections. */
+	struct FDirectedEdge
+	{
+		int32 From;
+		int32 To;
+		bool IsNightstalkerPath;
+	};
+	TArray<FDirectedEdge> DirectedEdges;
+	DirectedEdges.Reserve(Connections.Num() * 2);
+	for (const TPair<TPair<int32, int32>, bool>& Connection : Connections)
+	{
+		DirectedEdges.Add({Connection.Key.Key, Connection.Key.Value, Connection.Value});
+		DirectedEdges.Add({Connection.Key.Value, Connection.Key.Key, Connection.Value});
+	}
+	DirectedEdges.Sort([](const FDirectedEdge& A, const FDirectedEdge& B)
+	{
+		return A.From != B.From ? A.From < B.From : A.To < B.To;
+	});
+
+	EdgeOffsets.Init(0, NumRooms + 1);
+	EdgeTargets.Reset(DirectedEdges.Num());
+	EdgeNightstalkerFlags.Reset(DirectedEdges.Num());
+	EdgePortalLocations.Reset(DirectedEdges.Num());
+	for (const FDirectedEdge& Edge : DirectedEdges)
+	{
+		++EdgeOffsets[Edge.From + 1];
+		EdgeTargets.Add(Edge.To);
+		EdgeNightstalkerFlags.Add(Edge.IsNightstalkerPath);
+		EdgePortalLocations.Add(ComputePortalLocation(Rooms[Edge.From], Rooms[Edge.To]));
+	}
+	for (int32 RoomId {0}; RoomId < NumRooms; RoomId++)
+	{
+		EdgeOffsets[RoomId + 1] += EdgeOffsets[RoomId];
+	}
+
+	HopDistances.Init(UnreachableDistance, LayerCount * NumRooms * NumRooms);
+	NextHops.Init(InvalidRoomId, LayerCount * NumRooms * NumRooms);
+	ComputeAllPairsPaths(ERoomGraphLayer::Unrestricted);
+	ComputeAllPairsPaths(ERoomGraphLayer::Nightstalker);
+
+	SET_MEMORY_STAT(STAT_RoomGraphMemory, EdgeOffsets.GetAllocatedSize() + EdgeTargets.GetAllocatedSize() + EdgeNightstalkerFlags.GetAllocatedSize()
+		+ EdgePortalLocations.GetAllocatedSize() + HopDistances.GetAllocatedSize() + NextHops.GetAllocatedSize());
+	UE_LOG(LogRoomGraph, Log, TEXT("Built room graph with %d rooms and %d connections."), NumRooms, Connections.Num());
+
+	OnGraphBuilt.Broadcast();
+}
+
+FVector URoomGraphSubsystem::ComputePortalLocation(const ARoomVolume* From, const ARoomVolume* To)
+{
+	const FBox FromBounds {From->GetComponentsBoundingBox()};
+	const FBox ToBounds {To->GetComponentsBoundingBox()};
+	if(FromBounds.Intersect(ToBounds))
+	{
+		return FromBounds.Overlap(ToBounds).GetCenter();
+	}
+	const FVector ClosestOnFrom {FromBounds.GetClosestPointTo(ToBounds.GetCenter())};
+	const FVector ClosestOnTo {ToBounds.GetClosestPointTo(ClosestOnFrom)};
+	return (ClosestOnFrom + ClosestOnTo) * 0.5;
+}
+
+void URoomGraphSubsystem::ComputeAllPairsPaths(const ERoomGraphLayer Layer)
+{
+	const int32 NumRooms {Rooms.Num()};
+	if(NumRooms == 0) {return; }
+
+	TArray<int32> Queue;
+	Queue.SetNumUninitialized(NumRooms);
+	for (int32 SourceId {0}; SourceId < NumRooms; SourceId++)
+	{
+		uint16* Distances {HopDistances.GetData() + GetTableIndex(Layer, SourceId, 0)};
+		uint16* Hops {NextHops.GetData() + GetTableIndex(Layer, SourceId, 0)};
+		Distances[SourceId] = 0;
+
+		int32 Head {0};
+		int32 Tail {0};
+		Queue[Tail++] = SourceId;
+		while(Head < Tail)
+		{
+			const int32 RoomId {Queue[Head++]};
+			for (int32 Edge {EdgeOffsets[RoomId]}; Edge < EdgeOffsets[RoomId + 1]; Edge++)
+			{
+				if(Layer == ERoomGraphLayer::Nightstalker && !EdgeNightstalkerFlags[Edge]) {continue; }
+
+				const int32 NeighborId {EdgeTargets[Edge]};
+				if(Distances[NeighborId] != UnreachableDistance) {continue; }
+
+				/** The first hop of a room is inherited from the room it was discovered from. */
+				Distances[NeighborId] = Distances[RoomId] + 1;
+				Hops[NeighborId] = RoomId == SourceId ? NeighborId : Hops[RoomId];
+				Queue[Tail++] = NeighborId;
+			}
+		}
+	}
+}
+
+int32 URoomGraphSubsystem::GetRoomId(const ARoomVolume* Room) const
+{
+	const int32* RoomId {RoomIds.Find(Room)};
+	return RoomId ? *RoomId : INDEX_NONE;
+}
+
+ARoomVolume* URoomGraphSubsystem::GetRoom(const int32 RoomId) const
+{
+	return IsValidRoomId(RoomId) ? Rooms[RoomId] : nullptr;
+}
+
+TArrayView<const int32> URoomGraphSubsystem::GetNeighbors(const int32 RoomId) const
+{
+	if(!IsValidRoomId(RoomId)) {return TArrayView<const int32>(); }
+	return TArrayView<const int32>(EdgeTargets.GetData() + EdgeOffsets[RoomId], EdgeOffsets[RoomId + 1] - EdgeOffsets[RoomId]);
+}
+
+bool URoomGraphSubsystem::CanNightstalkerTakeEdge(const int32 RoomId, const int32 NeighborIndex) const
+{
+	if(!IsValidRoomId(RoomId)) {return false; }
+	const int32 Edge {EdgeOffsets[RoomId] + NeighborIndex};
+	return Edge < EdgeOffsets[RoomId + 1] && EdgeNightstalkerFlags[Edge];
+}
+
+bool URoomGraphSubsystem::GetPortalLocation(const int32 FromId, const int32 ToId, FVector& OutLocation) const
+{
+	if(!IsValidRoomId(FromId)) {return false; }
+	for (int32 Edge {EdgeOffsets[FromId]}; Edge < EdgeOffsets[FromId + 1]; Edge++)
+	{
+		if(EdgeTargets[Edge] == ToId)
+		{
+			OutLocation = EdgePortalLocations[Edge];
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 URoomGraphSubsystem::GetHopDistance(const int32 FromId, const int32 ToId, const ERoomGraphLayer Layer) const
+{
+	if(!IsValidRoomId(FromId) || !IsValidRoomId(ToId)) {return INDEX_NONE; }
+	const uint16 Distance {HopDistances[GetTableIndex(Layer, FromId, ToId)]};
+	return Distance == UnreachableDistance ? INDEX_NONE : Distance;
+}
+
+int32 URoomGraphSubsystem::GetNextHop(const int32 FromId, const int32 ToId, const ERoomGraphLayer Layer) const
+{
+	if(!IsValidRoomId(FromId) || !IsValidRoomId(ToId)) {return INDEX_NONE; }
+	const uint16 NextHop {NextHops[GetTableIndex(Layer, FromId, ToId)]};
+	return NextHop == InvalidRoomId ? INDEX_NONE : NextHop;
+}
+
+bool URoomGraphSubsystem::GetPath(const int32 FromId, const int32 ToId, TArray<int32>& OutPath, const ERoomGraphLayer Layer) const
+{
+	OutPath.Reset();
+	const int32 Distance {GetHopDistance(FromId, ToId, Layer)};
+	if(Distance == INDEX_NONE) {return false; }
+
+	OutPath.Reserve(Distance + 1);
+	OutPath.Add(FromId);
+	int32 RoomId {FromId};
+	while(RoomId != ToId)
+	{
+		RoomId = GetNextHop(RoomId, ToId, Layer);
+		OutPath.Add(RoomId);
+	}
+	return true;
+}
+
+int32 URoomGraphSubsystem::GetRoomDistance(const ARoomVolume* From, const ARoomVolume* To, const ERoomGraphLayer Layer) const
+{
+	return GetHopDistance(GetRoomId(From), GetRoomId(To), Layer);
+}
+
+TArray<ARoomVolume*> URoomGraphSubsystem::GetRoomPath(const ARoomVolume* From, const ARoomVolume* To, const ERoomGraphLayer Layer) const
+{
+	TArray<ARoomVolume*> Path;
+	TArray<int32> PathIds;
+	if(GetPath(GetRoomId(From), GetRoomId(To), PathIds, Layer))
+	{
+		Path.Reserve(PathIds.Num());
+		for (const int32 RoomId : PathIds)
+		{
+			Path.Add(Rooms[RoomId]);
+		}
+	}
+	return Path;
+}
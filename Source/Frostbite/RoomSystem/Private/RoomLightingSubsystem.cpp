@@ -0,0 +1,237 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomLightingSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "StatCategories.h"
+#include "LogCategories.h"
+
+#include "Components/LocalLightComponent.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+
+DECLARE_CYCLE_STAT(TEXT("Room Lighting Tick"), STAT_RoomLightingTick, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Lighting Active Rooms"), STAT_RoomLightingActiveRooms, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Lighting Updated Lights"), STAT_RoomLightingUpdatedLights, STATGROUP_RoomSystem);
+
+bool URoomLightingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoomLightingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** The batches are built once the membership index has been rebuilt for the new graph, as the lights are assigned to rooms using it. */
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.AddUObject(this, &URoomLightingSubsystem::BuildBatches);
+	}
+}
+
+void URoomLightingSubsystem::Deinitialize()
+{
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.RemoveAll(this);
+	}
+	Batches.Empty();
+	ActiveRoomIds.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId URoomLightingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URoomLightingSubsystem, STATGROUP_RoomSystem);
+}
+
+void URoomLightingSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomLightingTick);
+
+	int32 UpdatedLights {0};
+	for (int32 i {ActiveRoomIds.Num() - 1}; i >= 0; i--)
+	{
+		if(!UpdateBatch(ActiveRoomIds[i], DeltaTime, UpdatedLights))
+		{
+			ActiveRoomIds.RemoveAtSwap(i);
+		}
+	}
+	SET_DWORD_STAT(STAT_RoomLightingActiveRooms, ActiveRoomIds.Num());
+	SET_DWORD_STAT(STAT_RoomLightingUpdatedLights, UpdatedLights);
+}
+
+void URoomLightingSubsystem::BuildBatches()
+{
+	Batches.Reset();
+	ActiveRoomIds.Reset();
+
+	UWorld* World {GetWorld()};
+	if(!World || !RoomGraph || !RoomMembership) {return; }
+	Batches.SetNum(RoomGraph->GetRoomCount());
+
+	/** Lights carried by pawns, such as the flashlight of the player, do not belong to a room. */
+	for (TActorIterator<AActor> It {World}; It; ++It)
+	{
+		if(It->IsA<APawn>()) {continue; }
+
+		TInlineComponentArray<ULocalLightComponent*> Lights {*It};
+		for (ULocalLightComponent* Light : Lights)
+		{
+			const int32 RoomId {RoomMembership->FindRoomId(Light->GetComponentLocation())};
+			if(!Batches.IsValidIndex(RoomId)) {continue; }
+
+			/** Static lights are baked and ignore intensity and visibility changes at runtime. */
+			if(Light->Mobility == EComponentMobility::Static)
+			{
+				UE_LOG(LogRoomVolume, Warning, TEXT("Light %s in %s is static and cannot be switched by the room lighting subsystem. Make it stationary or movable."),
+					*Light->GetName(), *It->GetName());
+				continue;
+			}
+
+			FRoomLightBatch& Batch {Batches[RoomId]};
+			Batch.Lights.Add(Light);
+			Batch.BaseIntensities.Add(Light->Intensity);
+		}
+	}
+
+	/** A room is considered switched on if its first light is visible. */
+	for (FRoomLightBatch& Batch : Batches)
+	{
+		const ULocalLightComponent* FirstLight {Batch.Lights.Num() > 0 ? Batch.Lights[0].Get() : nullptr};
+		Batch.IsVisible = FirstLight ? FirstLight->IsVisible() : true;
+		Batch.IsTargetOn = Batch.IsVisible;
+		Batch.AppliedBrightness = Batch.IsVisible ? 1.0f : 0.0f;
+	}
+}
+
+void URoomLightingSubsystem::SetRoomLightsOn(ARoomVolume* Room, const bool Value)
+{
+	int32 RoomId {INDEX_NONE};
+	FRoomLightBatch* Batch {FindBatch(Room, RoomId)};
+	if(!Batch)
+	{
+		/** Rooms without lights still keep track of their light status. */
+		if(Room)
+		{
+			Room->SetLightStatus(Value);
+		}
+		return;
+	}
+	Batch->IsTargetOn = Value;
+	ActivateBatch(RoomId);
+}
+
+void URoomLightingSubsystem::PlayRoomLightFlicker(ARoomVolume* Room, const FRoomLightFlickerPattern& Pattern, const bool EndOn)
+{
+	int32 RoomId {INDEX_NONE};
+	FRoomLightBatch* Batch {FindBatch(Room, RoomId)};
+	if(!Batch || Pattern.Pattern.IsEmpty()) {return; }
+
+	Batch->Flicker = Pattern;
+	Batch->IsFlickering = true;
+	Batch->FlickerTime = 0.0f;
+	Batch->IsTargetOn = EndOn;
+	ActivateBatch(RoomId);
+}
+
+void URoomLightingSubsystem::StopRoomLightFlicker(ARoomVolume* Room)
+{
+	int32 RoomId {INDEX_NONE};
+	FRoomLightBatch* Batch {FindBatch(Room, RoomId)};
+	if(!Batch || !Batch->IsFlickering) {return; }
+
+	Batch->IsFlickering = false;
+	ActivateBatch(RoomId);
+}
+
+int32 URoomLightingSubsystem::GetRoomLightCount(const ARoomVolume* Room) const
+{
+	const int32 RoomId {RoomGraph ? RoomGraph->GetRoomId(Room) : INDEX_NONE};
+	return Batches.IsValidIndex(RoomId) ? Batches[RoomId].Lights.Num() : 0;
+}
+
+float URoomLightingSubsystem::EvaluateFlickerPattern(const FRoomLightFlickerPattern& Pattern, const float Time)
+{
+	const int32 Length {Pattern.Pattern.Len()};
+	if(Length == 0) {return 1.0f; }
+
+	const int32 Step {FMath::FloorToInt32(Time * Pattern.StepsPerSecond)};
+	const int32 Index {Pattern.Loop ? Step % Length : FMath::Clamp(Step, 0, Length - 1)};
+	const TCHAR Character {FChar::ToLower(Pattern.Pattern[Index])};
+	return FMath::Clamp(Character - TEXT('a'), 0, 25) / static_cast<float>(TEXT('m') - TEXT('a'));
+}
+
+FRoomLightBatch* URoomLightingSubsystem::FindBatch(const ARoomVolume* Room, int32& OutRoomId)
+{
+	OutRoomId = RoomGraph ? RoomGraph->GetRoomId(Room) : INDEX_NONE;
+	return Batches.IsValidIndex(OutRoomId) && Batches[OutRoomId].Lights.Num() > 0 ? &Batches[OutRoomId] : nullptr;
+}
+
+void URoomLightingSubsystem::ActivateBatch(const int32 RoomId)
+{
+	ActiveRoomIds.AddUnique(RoomId);
+}
+
+bool URoomLightingSubsystem::UpdateBatch(const int32 RoomId, const float DeltaTime, int32& OutUpdatedLights)
+{
+	FRoomLightBatch& Batch {Batches[RoomId]};
+	if(Batch.IsFlickering)
+	{
+		Batch.FlickerTime += DeltaTime;
+		const float Duration {Batch.Flicker.Pattern.Len() / FMath::Max(Batch.Flicker.StepsPerSecond, 0.1f)};
+		if(Batch.Flicker.Loop || Batch.FlickerTime < Duration)
+		{
+			OutUpdatedLights += ApplyBrightness(Batch, EvaluateFlickerPattern(Batch.Flicker, Batch.FlickerTime), false);
+			return true;
+		}
+		Batch.IsFlickering = false;
+	}
+
+	/** The batch has settled, so the lights are hidden if they are off and the room is notified of its new light status. */
+	OutUpdatedLights += ApplyBrightness(Batch, Batch.IsTargetOn ? 1.0f : 0.0f, true);
+	if(ARoomVolume* Room {RoomGraph->GetRoom(RoomId)})
+	{
+		Room->SetLightStatus(Batch.IsTargetOn);
+	}
+	return false;
+}
+
+int32 URoomLightingSubsystem::ApplyBrightness(FRoomLightBatch& Batch, const float Brightness, const bool Settled)
+{
+	const bool ShouldBeVisible {Brightness > 0.0f || !Settled};
+	if(Brightness == Batch.AppliedBrightness && ShouldBeVisible == Batch.IsVisible) {return 0; }
+
+	/** Intensity changes only update the light parameters on the render thread, while visibility changes recreate the render state.
+	 *	Visibility is therefore only changed when the lights are switched on, or when they settle in the off state. */
+	const bool ShouldUpdateIntensity {Brightness != Batch.AppliedBrightness && ShouldBeVisible};
+	int32 UpdatedLights {0};
+	for (int32 i {0}; i < Batch.Lights.Num(); i++)
+	{
+		ULocalLightComponent* Light {Batch.Lights[i].Get()};
+		if(!Light) {continue; }
+
+		if(ShouldUpdateIntensity)
+		{
+			Light->SetIntensity(Batch.BaseIntensities[i] * Brightness);
+		}
+		if(ShouldBeVisible != Batch.IsVisible)
+		{
+			Light->SetVisibility(ShouldBeVisible);
+		}
+		++UpdatedLights;
+	}
+	if(ShouldUpdateIntensity)
+	{
+		Batch.AppliedBrightness = Brightness;
+	}
+	Batch.IsVisible = ShouldBeVisible;
+	return UpdatedLights;
+}
@@ -0,0 +1,339 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomMembershipSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomVolume.h"
+#include "LogCategories.h"
+#include "StatCategories.h"
+
+#include "Components/BoxComponent.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Room Membership Index Build"), STAT_RoomMembershipBuild, STATGROUP_RoomSystem);
+DECLARE_CYCLE_STAT(TEXT("Room Membership Update"), STAT_RoomMembershipUpdate, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tracked Actors"), STAT_RoomMembershipTrackedActors, STATGROUP_RoomSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Room Transitions"), STAT_RoomMembershipTransitions, STATGROUP_RoomSystem);
+
+bool URoomMembershipSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoomMembershipSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** The index is rebuilt whenever the room graph is rebuilt, so that the room IDs of both subsystems always match. */
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.AddUObject(this, &URoomMembershipSubsystem::HandleGraphBuilt);
+	}
+}
+
+void URoomMembershipSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	InWorld.GetTimerManager().SetTimer(TrackingTimerHandle, this, &URoomMembershipSubsystem::UpdateTrackedActors, TrackingInterval, true);
+}
+
+void URoomMembershipSubsystem::Deinitialize()
+{
+	if(RoomGraph)
+	{
+		RoomGraph->OnGraphBuilt.RemoveAll(this);
+	}
+	if(UWorld* World {GetWorld()})
+	{
+		World->GetTimerManager().ClearTimer(TrackingTimerHandle);
+	}
+	TrackedActors.Empty();
+	RoomBounds.Empty();
+	HasSmallerOverlappingRoom.Empty();
+	CellOffsets.Empty();
+	CellRooms.Empty();
+
+	Super::Deinitialize();
+}
+
+void URoomMembershipSubsystem::HandleGraphBuilt()
+{
+	BuildIndex();
+	OnIndexBuilt.Broadcast();
+}
+
+void URoomMembershipSubsystem::BuildIndex()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomMembershipBuild);
+
+	const int32 NumRooms {RoomGraph ? RoomGraph->GetRoomCount() : 0};
+	RoomBounds.SetNum(NumRooms);
+	HasSmallerOverlappingRoom.Init(false, NumRooms);
+	CellOffsets.Reset();
+	CellRooms.Reset();
+	GridResolution = FIntPoint::ZeroValue;
+
+	/** Gather the oriented bounds of every room and the axis aligned bounds of all rooms together. */
+	TArray<FBox> RoomBoxes;
+	RoomBoxes.SetNum(NumRooms);
+	FBox GridBounds {ForceInit};
+	for (int32 RoomId {0}; RoomId < NumRooms; RoomId++)
+	{
+		RoomBounds[RoomId] = FRoomMembershipBounds();
+		RoomBoxes[RoomId] = FBox(ForceInit);
+
+		const ARoomVolume* Room {RoomGraph->GetRoom(RoomId)};
+		const UBoxComponent* Box {Room ? Cast<UBoxComponent>(Room->GetCollisionComponent()) : nullptr};
+		if(!Box)
+		{
+			UE_LOG(LogRoomVolume, Warning, TEXT("Room %s does not have a box collision component and is ignored by the membership index."), Room ? *Room->GetName() : TEXT("None"));
+			continue;
+		}
+
+		const FTransform& Transform {Box->GetComponentTransform()};
+		FRoomMembershipBounds& Bounds {RoomBounds[RoomId]};
+		Bounds.Center = Transform.GetLocation();
+		Bounds.AxisX = Transform.GetUnitAxis(EAxis::X);
+		Bounds.AxisY = Transform.GetUnitAxis(EAxis::Y);
+		Bounds.AxisZ = Transform.GetUnitAxis(EAxis::Z);
+		Bounds.Extent = Box->GetScaledBoxExtent();
+
+		RoomBoxes[RoomId] = Box->Bounds.GetBox();
+		GridBounds += RoomBoxes[RoomId];
+	}
+	if(!GridBounds.IsValid) {return; }
+
+	/** Choose a cell size that keeps the grid within its cell budget. */
+	const FVector GridSize {GridBounds.GetSize()};
+	GridCellSize = 500.0f;
+	while(FMath::CeilToInt32(GridSize.X / GridCellSize) * FMath::CeilToInt32(GridSize.Y / GridCellSize) > MaxGridCells)
+	{
+		GridCellSize *= 2.0f;
+	}
+	GridOrigin = FVector2D(GridBounds.Min.X, GridBounds.Min.Y);
+	GridResolution = FIntPoint(FMath::Max(FMath::CeilToInt32(GridSize.X / GridCellSize), 1), FMath::Max(FMath::CeilToInt32(GridSize.Y / GridCellSize), 1));
+
+	/** Rooms are inserted from smallest to largest, so that the rooms of every cell are sorted by volume and the most specific room is found first. */
+	TArray<int32> SortedRoomIds;
+	SortedRoomIds.Reserve(NumRooms);
+	for (int32 RoomId {0}; RoomId < NumRooms; RoomId++)
+	{
+		if(RoomBoxes[RoomId].IsValid)
+		{
+			SortedRoomIds.Add(RoomId);
+		}
+	}
+	SortedRoomIds.Sort([this](const int32 A, const int32 B)
+	{
+		return RoomBounds[A].Extent.X * RoomBounds[A].Extent.Y * RoomBounds[A].Extent.Z < RoomBounds[B].Extent.X * RoomBounds[B].Extent.Y * RoomBounds[B].Extent.Z;
+	});
+
+	const auto GetCellRange {[this](const FBox& Box, FIntPoint& OutMin, FIntPoint& OutMax)
+	{
+		OutMin.X = FMath::Clamp(FMath::FloorToInt32((Box.Min.X - GridOrigin.X) / GridCellSize), 0, GridResolution.X - 1);
+		OutMin.Y = FMath::Clamp(FMath::FloorToInt32((Box.Min.Y - GridOrigin.Y) / GridCellSize), 0, GridResolution.Y - 1);
+		OutMax.X = FMath::Clamp(FMath::FloorToInt32((Box.Max.X - GridOrigin.X) / GridCellSize), 0, GridResolution.X - 1);
+		OutMax.Y = FMath::Clamp(FMath::FloorToInt32((Box.Max.Y - GridOrigin.Y) / GridCellSize), 0, GridResolution.Y - 1);
+	}};
+
+	/** Count the rooms per cell, convert the counts to offsets and then fill the cells. */
+	const int32 NumCells {GridResolution.X * GridResolution.Y};
+	CellOffsets.Init(0, NumCells + 1);
+	for (const int32 RoomId : SortedRoomIds)
+	{
+		FIntPoint Min, Max;
+		GetCellRange(RoomBoxes[RoomId], Min, Max);
+		for (int32 Y {Min.Y}; Y <= Max.Y; Y++)
+		{
+			for (int32 X {Min.X}; X <= Max.X; X++)
+			{
+				++CellOffsets[Y * GridResolution.X + X + 1];
+			}
+		}
+	}
+	for (int32 Cell {0}; Cell < NumCells; Cell++)
+	{
+		CellOffsets[Cell + 1] += CellOffsets[Cell];
+	}
+
+	CellRooms.SetNumUninitialized(CellOffsets[NumCells]);
+	TArray<int32> CellCursors {CellOffsets};
+	for (const int32 RoomId : SortedRoomIds)
+	{
+		FIntPoint Min, Max;
+		GetCellRange(RoomBoxes[RoomId], Min, Max);
+		for (int32 Y {Min.Y}; Y <= Max.Y; Y++)
+		{
+			for (int32 X {Min.X}; X <= Max.X; X++)
+			{
+				CellRooms[CellCursors[Y * GridResolution.X + X]++] = RoomId;
+			}
+		}
+	}
+
+	/** A room that overlaps a smaller room in any cell cannot be returned from the hint, as the smaller room takes precedence.
+	 *	Rooms that only touch, such as neighbors that share a wall, do not count. */
+	for (int32 Cell {0}; Cell < NumCells; Cell++)
+	{
+		for (int32 i {CellOffsets[Cell] + 1}; i < CellOffsets[Cell + 1]; i++)
+		{
+			const int32 RoomId {CellRooms[i]};
+			if(HasSmallerOverlappingRoom[RoomId]) {continue; }
+			for (int32 j {CellOffsets[Cell]}; j < i; j++)
+			{
+				if(RoomBoxes[CellRooms[j]].Overlap(RoomBoxes[RoomId]).GetVolume() > 0.0)
+				{
+					HasSmallerOverlappingRoom[RoomId] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	/** Room IDs change when the graph is rebuilt, so the rooms of tracked actors are resolved again. */
+	for (FRoomTrackedActor& TrackedActor : TrackedActors)
+	{
+		TrackedActor.RoomId = INDEX_NONE;
+	}
+	UpdateTrackedActors();
+}
+
+int32 URoomMembershipSubsystem::GetCellIndex(const FVector& Location) const
+{
+	const int32 X {FMath::FloorToInt32((Location.X - GridOrigin.X) / GridCellSize)};
+	const int32 Y {FMath::FloorToInt32((Location.Y - GridOrigin.Y) / GridCellSize)};
+	if(X < 0 || Y < 0 || X >= GridResolution.X || Y >= GridResolution.Y) {return INDEX_NONE; }
+	return Y * GridResolution.X + X;
+}
+
+int32 URoomMembershipSubsystem::FindRoomId(const FVector& Location, const int32 HintRoomId) const
+{
+	/** Actors usually stay in the same room, so the hint avoids the grid lookup entirely in most cases. */
+	if(RoomBounds.IsValidIndex(HintRoomId) && !HasSmallerOverlappingRoom[HintRoomId] && RoomBounds[HintRoomId].Contains(Location))
+	{
+		return HintRoomId;
+	}
+
+	const int32 Cell {GetCellIndex(Location)};
+	if(Cell == INDEX_NONE) {return INDEX_NONE; }
+
+	for (int32 i {CellOffsets[Cell]}; i < CellOffsets[Cell + 1]; i++)
+	{
+		if(RoomBounds[CellRooms[i]].Contains(Location))
+		{
+			return CellRooms[i];
+		}
+	}
+	return INDEX_NONE;
+}
+
+ARoomVolume* URoomMembershipSubsystem::GetRoomAtLocation(const FVector& Location) const
+{
+	return RoomGraph ? RoomGraph->GetRoom(FindRoomId(Location)) : nullptr;
+}
+
+void URoomMembershipSubsystem::RegisterActor(AActor* Actor, const bool DisableOverlapEvents)
+{
+	if(!Actor || IsActorTracked(Actor)) {return; }
+
+	FRoomTrackedActor& TrackedActor {TrackedActors.AddDefaulted_GetRef()};
+	TrackedActor.Actor = Actor;
+	SET_DWORD_STAT(STAT_RoomMembershipTrackedActors, TrackedActors.Num());
+
+	if(DisableOverlapEvents)
+	{
+		if(UPrimitiveComponent* Root {Cast<UPrimitiveComponent>(Actor->GetRootComponent())})
+		{
+			Root->SetGenerateOverlapEvents(false);
+		}
+	}
+
+	/** Resolve the initial room immediately, so that the actor does not have to wait for the next update. */
+	SetActorRoom(TrackedActor, FindRoomId(Actor->GetActorLocation()));
+}
+
+void URoomMembershipSubsystem::UnregisterActor(AActor* Actor)
+{
+	TrackedActors.RemoveAllSwap([Actor](const FRoomTrackedActor& TrackedActor)
+	{
+		return TrackedActor.Actor.Get() == Actor;
+	});
+	SET_DWORD_STAT(STAT_RoomMembershipTrackedActors, TrackedActors.Num());
+}
+
+bool URoomMembershipSubsystem::IsActorTracked(const AActor* Actor) const
+{
+	return Actor && TrackedActors.ContainsByPredicate([Actor](const FRoomTrackedActor& TrackedActor)
+	{
+		return TrackedActor.Actor.Get() == Actor;
+	});
+}
+
+int32 URoomMembershipSubsystem::GetActorRoomId(const AActor* Actor) const
+{
+	const FRoomTrackedActor* TrackedActor {TrackedActors.FindByPredicate([Actor](const FRoomTrackedActor& Entry)
+	{
+		return Entry.Actor.Get() == Actor;
+	})};
+	return TrackedActor ? TrackedActor->RoomId : INDEX_NONE;
+}
+
+ARoomVolume* URoomMembershipSubsystem::GetActorRoom(const AActor* Actor) const
+{
+	return RoomGraph ? RoomGraph->GetRoom(GetActorRoomId(Actor)) : nullptr;
+}
+
+void URoomMembershipSubsystem::SetTrackingInterval(const float Interval)
+{
+	TrackingInterval = FMath::Max(Interval, 0.0f);
+	UWorld* World {GetWorld()};
+	if(World && TrackingTimerHandle.IsValid())
+	{
+		World->GetTimerManager().SetTimer(TrackingTimerHandle, this, &URoomMembershipSubsystem::UpdateTrackedActors, TrackingInterval, true);
+	}
+}
+
+void URoomMembershipSubsystem::UpdateTrackedActors()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomMembershipUpdate);
+
+	for (int32 i {TrackedActors.Num() - 1}; i >= 0; i--)
+	{
+		const AActor* Actor {TrackedActors[i].Actor.Get()};
+		if(!Actor)
+		{
+			TrackedActors.RemoveAtSwap(i);
+			continue;
+		}
+
+		const int32 RoomId {FindRoomId(Actor->GetActorLocation(), TrackedActors[i].RoomId)};
+		if(RoomId != TrackedActors[i].RoomId)
+		{
+			SetActorRoom(TrackedActors[i], RoomId);
+		}
+	}
+	SET_DWORD_STAT(STAT_RoomMembershipTrackedActors, TrackedActors.Num());
+}
+
+void URoomMembershipSubsystem::SetActorRoom(FRoomTrackedActor& TrackedActor, const int32 NewRoomId)
+{
+	AActor* Actor {TrackedActor.Actor.Get()};
+	if(!Actor || !RoomGraph) {return; }
+
+	ARoomVolume* PreviousRoom {RoomGraph->GetRoom(TrackedActor.RoomId)};
+	ARoomVolume* NewRoom {RoomGraph->GetRoom(NewRoomId)};
+	TrackedActor.RoomId = NewRoomId;
+	INC_DWORD_STAT(STAT_RoomMembershipTransitions);
+
+	if(PreviousRoom)
+	{
+		PreviousRoom->NotifyActorLeaveRoom(Actor);
+	}
+	if(NewRoom)
+	{
+		NewRoom->NotifyActorEnterRoom(Actor);
+	}
+	OnRoomMembershipChanged.Broadcast(Actor, PreviousRoom, NewRoom);
+}
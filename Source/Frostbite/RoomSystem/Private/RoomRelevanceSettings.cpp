@@ -0,0 +1,34 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomRelevanceSettings.h"
+
+int32 URoomRelevanceSettings::GetTierIndex(const int32 RoomDistance) const
+{
+	if(Tiers.Num() == 0) {return INDEX_NONE; }
+	if(RoomDistance == INDEX_NONE) {return Tiers.Num() - 1; }
+
+	int32 TierIndex {INDEX_NONE};
+	for (int32 i {0}; i < Tiers.Num(); i++)
+	{
+		if(Tiers[i].MinRoomDistance <= RoomDistance)
+		{
+			TierIndex = i;
+		}
+	}
+	return TierIndex;
+}
+
+bool URoomRelevanceSettings::IsExcluded(const AActor* Actor) const
+{
+	if(!Actor) {return true; }
+	for (const TSubclassOf<AActor>& ExcludedClass : ExcludedClasses)
+	{
+		if(ExcludedClass && Actor->IsA(ExcludedClass))
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,411 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomRelevanceSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
+#include "FrostbiteGameMode.h"
+#include "PortalAudioComponent.h"
+#include "Nightstalker.h"
+#include "StatCategories.h"
+
+#include "Components/AudioComponent.h"
+#include "Components/LightComponent.h"
+#include "EngineUtils.h"
+#include "GameFramework/Info.h"
+
+DECLARE_CYCLE_STAT(TEXT("Room Relevance Update"), STAT_RoomRelevanceUpdate, STATGROUP_RoomSystem);
+DECLARE_CYCLE_STAT(TEXT("Room Relevance Tick"), STAT_RoomRelevanceTick, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Relevance Managed Actors"), STAT_RoomRelevanceManagedActors, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Relevance Throttled Tick Functions"), STAT_RoomRelevanceThrottledTickFunctions, STATGROUP_RoomSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Relevance Ticks Saved Per Frame"), STAT_RoomRelevanceTicksSaved, STATGROUP_RoomSystem);
+
+bool URoomRelevanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoomRelevanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** Actors are registered once the membership index has been rebuilt for the new graph, as their rooms are looked up in it. */
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.AddUObject(this, &URoomRelevanceSubsystem::RegisterActorsInRooms);
+		RoomMembership->OnRoomMembershipChanged.AddDynamic(this, &URoomRelevanceSubsystem::HandleRoomMembershipChanged);
+	}
+}
+
+void URoomRelevanceSubsystem::Deinitialize()
+{
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.RemoveAll(this);
+		RoomMembership->OnRoomMembershipChanged.RemoveDynamic(this, &URoomRelevanceSubsystem::HandleRoomMembershipChanged);
+	}
+	for (FRoomRelevanceEntry& Entry : Entries)
+	{
+		RestoreEntry(Entry);
+	}
+	Entries.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId URoomRelevanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URoomRelevanceSubsystem, STATGROUP_RoomSystem);
+}
+
+void URoomRelevanceSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomRelevanceTick);
+	if(!Settings) {return; }
+
+	/** Estimate the ticks saved this frame. A throttled tick function ticks once per interval instead of once per frame. */
+	float TicksSaved {0.0f};
+	int32 ThrottledTickFunctions {0};
+	for (int32 TierIndex {0}; TierIndex < TierTickFunctionCounts.Num(); TierIndex++)
+	{
+		const int32 Count {TierTickFunctionCounts[TierIndex]};
+		if(Count == 0 || !Settings->Tiers.IsValidIndex(TierIndex)) {continue; }
+
+		const FRoomRelevanceTier& Tier {Settings->Tiers[TierIndex]};
+		const float SavedFraction {Tier.DisableTick ? 1.0f : Tier.TickInterval > 0.0f ? FMath::Max(1.0f - DeltaTime / Tier.TickInterval, 0.0f) : 0.0f};
+		TicksSaved += Count * SavedFraction;
+		ThrottledTickFunctions += Count;
+	}
+	SET_FLOAT_STAT(STAT_RoomRelevanceTicksSaved, TicksSaved);
+	SET_DWORD_STAT(STAT_RoomRelevanceThrottledTickFunctions, ThrottledTickFunctions);
+}
+
+void URoomRelevanceSubsystem::LoadSettings()
+{
+	if(Settings) {return; }
+
+	const UWorld* World {GetWorld()};
+	if(const AFrostbiteGameMode* GameMode {World ? Cast<AFrostbiteGameMode>(World->GetAuthGameMode()) : nullptr})
+	{
+		if(!GameMode->GetRoomRelevanceSettings().IsNull())
+		{
+			Settings = GameMode->GetRoomRelevanceSettings().LoadSynchronous();
+		}
+	}
+	if(!Settings)
+	{
+		Settings = NewObject<URoomRelevanceSettings>(this);
+	}
+	TierTickFunctionCounts.Init(0, Settings->Tiers.Num());
+}
+
+void URoomRelevanceSubsystem::RegisterActorsInRooms()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomRelevanceUpdate);
+	LoadSettings();
+
+	/** Room IDs are only valid until the graph is rebuilt, so all actors are registered again. */
+	for (FRoomRelevanceEntry& Entry : Entries)
+	{
+		RestoreEntry(Entry);
+	}
+	Entries.Reset();
+
+	UWorld* World {GetWorld()};
+	if(!World || !RoomMembership) {return; }
+
+	for (TActorIterator<AActor> It {World}; It; ++It)
+	{
+		if(!CanManageActor(*It)) {continue; }
+
+		/** Static actors keep the room they were placed in. Actors outside of any room are always fully relevant. */
+		const int32 RoomId {RoomMembership->IsActorTracked(*It) ? RoomMembership->GetActorRoomId(*It) : RoomMembership->FindRoomId(It->GetActorLocation())};
+		if(RoomId == INDEX_NONE && !RoomMembership->IsActorTracked(*It)) {continue; }
+
+		FRoomRelevanceEntry& Entry {Entries.AddDefaulted_GetRef()};
+		Entry.Actor = *It;
+		Entry.RoomId = RoomId;
+		if(const APawn* Pawn {Cast<APawn>(*It)})
+		{
+			Entry.Controller = Pawn->GetController();
+		}
+	}
+
+	const UPlayerSubsystem* PlayerSubsystem {World->GetSubsystem<UPlayerSubsystem>()};
+	PlayerRoomId = PlayerSubsystem ? RoomMembership->GetActorRoomId(PlayerSubsystem->GetPlayerCharacter()) : INDEX_NONE;
+	UpdateAllEntries();
+}
+
+bool URoomRelevanceSubsystem::CanManageActor(const AActor* Actor) const
+{
+	if(!Actor || !Actor->GetRootComponent() || (Settings && Settings->IsExcluded(Actor))) {return false; }
+	if(Actor->IsA<AInfo>() || Actor->IsA<AController>() || Actor->IsA<ARoomVolume>() || Actor->IsA<APlayerCharacter>()) {return false; }
+
+	/** Only actors that have something to throttle are managed. */
+	if(Actor->PrimaryActorTick.bCanEverTick) {return true; }
+	for (const UActorComponent* Component : Actor->GetComponents())
+	{
+		if(Component && (Component->PrimaryComponentTick.bCanEverTick || Component->IsA<ULightComponent>() || Component->IsA<UAudioComponent>()))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void URoomRelevanceSubsystem::RegisterActor(AActor* Actor)
+{
+	LoadSettings();
+	if(!CanManageActor(Actor) || !RoomMembership) {return; }
+	if(Entries.ContainsByPredicate([Actor](const FRoomRelevanceEntry& Entry) {return Entry.Actor.Get() == Actor; })) {return; }
+
+	FRoomRelevanceEntry& Entry {Entries.AddDefaulted_GetRef()};
+	Entry.Actor = Actor;
+	Entry.RoomId = RoomMembership->FindRoomId(Actor->GetActorLocation());
+	if(const APawn* Pawn {Cast<APawn>(Actor)})
+	{
+		Entry.Controller = Pawn->GetController();
+	}
+	UpdateEntry(Entry);
+	SET_DWORD_STAT(STAT_RoomRelevanceManagedActors, Entries.Num());
+}
+
+void URoomRelevanceSubsystem::UnregisterActor(AActor* Actor)
+{
+	const int32 Index {Entries.IndexOfByPredicate([Actor](const FRoomRelevanceEntry& Entry) {return Entry.Actor.Get() == Actor; })};
+	if(Index == INDEX_NONE) {return; }
+
+	RestoreEntry(Entries[Index]);
+	Entries.RemoveAtSwap(Index);
+	SET_DWORD_STAT(STAT_RoomRelevanceManagedActors, Entries.Num());
+}
+
+int32 URoomRelevanceSubsystem::GetRoomDistanceToPlayer(const AActor* Actor) const
+{
+	if(!Actor || !RoomGraph || !RoomMembership) {return INDEX_NONE; }
+
+	const FRoomRelevanceEntry* Entry {Entries.FindByPredicate([Actor](const FRoomRelevanceEntry& Candidate) {return Candidate.Actor.Get() == Actor; })};
+	const int32 RoomId {Entry ? GetEntryRoomId(*Entry) : RoomMembership->FindRoomId(Actor->GetActorLocation())};
+	return RoomGraph->GetHopDistance(PlayerRoomId, RoomId);
+}
+
+int32 URoomRelevanceSubsystem::GetEntryRoomId(const FRoomRelevanceEntry& Entry) const
+{
+	const AActor* Actor {Entry.Actor.Get()};
+	return Actor && RoomMembership && RoomMembership->IsActorTracked(Actor) ? RoomMembership->GetActorRoomId(Actor) : Entry.RoomId;
+}
+
+void URoomRelevanceSubsystem::HandleRoomMembershipChanged(AActor* Actor, ARoomVolume* PreviousRoom, ARoomVolume* NewRoom)
+{
+	if(!RoomGraph || !Settings) {return; }
+
+	/** When the player changes room, every managed actor is reclassified. Otherwise, only the actor that moved is. */
+	if(Actor && Actor->IsA<APlayerCharacter>())
+	{
+		PlayerRoomId = RoomGraph->GetRoomId(NewRoom);
+		UpdateAllEntries();
+		return;
+	}
+	if(FRoomRelevanceEntry* Entry {Entries.FindByPredicate([Actor](const FRoomRelevanceEntry& Candidate) {return Candidate.Actor.Get() == Actor; })})
+	{
+		UpdateEntry(*Entry);
+	}
+}
+
+void URoomRelevanceSubsystem::UpdateAllEntries()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomRelevanceUpdate);
+
+	for (int32 i {Entries.Num() - 1}; i >= 0; i--)
+	{
+		if(!Entries[i].Actor.IsValid())
+		{
+			RestoreEntry(Entries[i]);
+			Entries.RemoveAtSwap(i);
+			continue;
+		}
+		UpdateEntry(Entries[i]);
+	}
+	SET_DWORD_STAT(STAT_RoomRelevanceManagedActors, Entries.Num());
+}
+
+void URoomRelevanceSubsystem::UpdateEntry(FRoomRelevanceEntry& Entry)
+{
+	if(!Settings || !RoomGraph) {return; }
+
+	/** Without a known player room, every actor is fully relevant. */
+	const int32 RoomId {GetEntryRoomId(Entry)};
+	int32 TierIndex {INDEX_NONE};
+	if(PlayerRoomId != INDEX_NONE && RoomId != INDEX_NONE)
+	{
+		TierIndex = Settings->GetTierIndex(RoomGraph->GetHopDistance(PlayerRoomId, RoomId));
+		if(TierIndex != INDEX_NONE && !Settings->Tiers[TierIndex].HasPolicy())
+		{
+			TierIndex = INDEX_NONE;
+		}
+	}
+	if(TierIndex == Entry.TierIndex) {return; }
+
+	RestoreEntry(Entry);
+	if(TierIndex != INDEX_NONE)
+	{
+		ApplyTier(Entry, TierIndex);
+	}
+}
+
+void URoomRelevanceSubsystem::RestoreEntry(FRoomRelevanceEntry& Entry)
+{
+	if(Entry.TierIndex == INDEX_NONE) {return; }
+
+	for (const FRoomRelevanceTickState& TickState : Entry.TickStates)
+	{
+		RestoreTickFunction(TickState);
+	}
+	for (const TPair<TWeakObjectPtr<ULightComponent>, bool>& LightState : Entry.LightShadowStates)
+	{
+		if(ULightComponent* Light {LightState.Key.Get()})
+		{
+			Light->SetCastShadows(LightState.Value);
+		}
+	}
+	for (const TPair<TWeakObjectPtr<UAudioComponent>, float>& AudioState : Entry.AudioVolumeStates)
+	{
+		if(UAudioComponent* Audio {AudioState.Key.Get()})
+		{
+			Audio->SetVolumeMultiplier(AudioState.Value);
+		}
+	}
+
+	if(TierTickFunctionCounts.IsValidIndex(Entry.TierIndex))
+	{
+		TierTickFunctionCounts[Entry.TierIndex] -= Entry.TickFunctionCount;
+	}
+	Entry.TickStates.Reset();
+	Entry.LightShadowStates.Reset();
+	Entry.AudioVolumeStates.Reset();
+	Entry.TickFunctionCount = 0;
+	Entry.TierIndex = INDEX_NONE;
+}
+
+void URoomRelevanceSubsystem::ApplyTier(FRoomRelevanceEntry& Entry, const int32 TierIndex)
+{
+	const FRoomRelevanceTier& Tier {Settings->Tiers[TierIndex]};
+	Entry.TierIndex = TierIndex;
+
+	/** The nightstalker is never frozen, as its controller has to keep applying decisions wherever it is. It is only throttled by the tick interval of the tier. */
+	const bool DisableTick {Tier.DisableTick && !Cast<ANightstalker>(Entry.Actor.Get())};
+
+	for (AActor* Actor : {Entry.Actor.Get(), Entry.Controller.Get()})
+	{
+		if(!Actor) {continue; }
+
+		if(DisableTick || Tier.TickInterval > 0.0f)
+		{
+			if(Actor->PrimaryActorTick.bCanEverTick)
+			{
+				ApplyTierToTickFunction(Entry, Actor, nullptr, Tier.TickInterval, DisableTick);
+			}
+			for (UActorComponent* Component : Actor->GetComponents())
+			{
+				if(Component && Component->PrimaryComponentTick.bCanEverTick)
+				{
+					ApplyTierToTickFunction(Entry, Actor, Component, Tier.TickInterval, DisableTick);
+				}
+			}
+		}
+
+		if(Tier.DisableLightShadows)
+		{
+			TInlineComponentArray<ULightComponent*> Lights {Actor};
+			for (ULightComponent* Light : Lights)
+			{
+				if(Light->CastShadows)
+				{
+					Entry.LightShadowStates.Emplace(Light, true);
+					Light->SetCastShadows(false);
+				}
+			}
+		}
+
+		if(Tier.VirtualizeAudio)
+		{
+			/** Silent sounds are virtualized by the audio engine, so they stop rendering but keep their playback position.
+			 *	Portal audio components manage their own volume based on their distance through the room graph. */
+			TInlineComponentArray<UAudioComponent*> AudioComponents {Actor};
+			for (UAudioComponent* Audio : AudioComponents)
+			{
+				if(Audio->IsA<UPortalAudioComponent>()) {continue; }
+				Entry.AudioVolumeStates.Emplace(Audio, Audio->VolumeMultiplier);
+				Audio->SetVolumeMultiplier(0.0f);
+			}
+		}
+	}
+
+	if(TierTickFunctionCounts.IsValidIndex(TierIndex))
+	{
+		TierTickFunctionCounts[TierIndex] += Entry.TickFunctionCount;
+	}
+}
+
+void URoomRelevanceSubsystem::ApplyTierToTickFunction(FRoomRelevanceEntry& Entry, AActor* Actor, UActorComponent* Component, const float TickInterval, const bool DisableTick)
+{
+	FRoomRelevanceTickState& TickState {Entry.TickStates.AddDefaulted_GetRef()};
+	TickState.Actor = Actor;
+	TickState.Component = Component;
+	TickState.TickInterval = Component ? Component->GetComponentTickInterval() : Actor->GetActorTickInterval();
+	TickState.IsTickEnabled = Component ? Component->IsComponentTickEnabled() : Actor->IsActorTickEnabled();
+
+	/** Only tick functions that are enabled count towards the saved ticks. */
+	if(TickState.IsTickEnabled)
+	{
+		++Entry.TickFunctionCount;
+	}
+
+	TickState.HasDisabledTick = DisableTick;
+	TickState.AppliedTickInterval = FMath::Max(TickState.TickInterval, TickInterval);
+	if(Component)
+	{
+		DisableTick ? Component->SetComponentTickEnabled(false) : Component->SetComponentTickInterval(TickState.AppliedTickInterval);
+	}
+	else
+	{
+		DisableTick ? Actor->SetActorTickEnabled(false) : Actor->SetActorTickInterval(TickState.AppliedTickInterval);
+	}
+}
+
+void URoomRelevanceSubsystem::RestoreTickFunction(const FRoomRelevanceTickState& TickState)
+{
+	/** Only the part of the state that was changed is restored. A tick that gameplay enabled again, or an interval it changed, is kept.
+	 *	The state of a component that has been destroyed since is skipped, as it does not belong to the tick of its actor. */
+	if(!TickState.Component.IsExplicitlyNull())
+	{
+		UActorComponent* Component {TickState.Component.Get()};
+		if(!Component) {return; }
+
+		if(TickState.HasDisabledTick && !Component->IsComponentTickEnabled())
+		{
+			Component->SetComponentTickEnabled(TickState.IsTickEnabled);
+		}
+		else if(!TickState.HasDisabledTick && FMath::IsNearlyEqual(Component->GetComponentTickInterval(), TickState.AppliedTickInterval))
+		{
+			Component->SetComponentTickInterval(TickState.TickInterval);
+		}
+	}
+	else if(AActor* Actor {TickState.Actor.Get()})
+	{
+		if(TickState.HasDisabledTick && !Actor->IsActorTickEnabled())
+		{
+			Actor->SetActorTickEnabled(TickState.IsTickEnabled);
+		}
+		else if(!TickState.HasDisabledTick && FMath::IsNearlyEqual(Actor->GetActorTickInterval(), TickState.AppliedTickInterval))
+		{
+			Actor->SetActorTickInterval(TickState.TickInterval);
+		}
+	}
+}
@@ -0,0 +1,355 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomStreamingSubsystem.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "PlayerSubsystem.h"
+#include "PlayerCharacter.h"
+#include "FrostbiteGameMode.h"
+#include "StatCategories.h"
+#include "LogCategories.h"
+
+#include "Engine/LevelStreaming.h"
+
+DECLARE_CYCLE_STAT(TEXT("Room Streaming Update"), STAT_RoomStreamingUpdate, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Streaming Resident Levels"), STAT_RoomStreamingResidentLevels, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Streaming Prefetched Levels"), STAT_RoomStreamingPrefetchedLevels, STATGROUP_RoomSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Room Streaming Estimated Memory (MB)"), STAT_RoomStreamingEstimatedMemory, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Streaming Hitches"), STAT_RoomStreamingHitches, STATGROUP_RoomSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Room Streaming Worst Hitch (ms)"), STAT_RoomStreamingWorstHitch, STATGROUP_RoomSystem);
+
+bool URoomStreamingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoomStreamingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** The levels are resolved once the membership index has been rebuilt for the new graph, as the first update looks up the room of the player in it. */
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.AddUObject(this, &URoomStreamingSubsystem::BuildRoomLevels);
+	}
+}
+
+void URoomStreamingSubsystem::Deinitialize()
+{
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.RemoveAll(this);
+	}
+	Levels.Empty();
+	RoomLevels.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId URoomStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URoomStreamingSubsystem, STATGROUP_RoomSystem);
+}
+
+void URoomStreamingSubsystem::Tick(float DeltaTime)
+{
+	if(!Settings || Levels.Num() == 0) {return; }
+
+	RecordHitch(DeltaTime);
+
+	TimeSinceUpdate += DeltaTime;
+	if(TimeSinceUpdate < Settings->UpdateInterval) {return; }
+	TimeSinceUpdate = 0.0f;
+	UpdateStreaming();
+}
+
+void URoomStreamingSubsystem::LoadSettings()
+{
+	if(Settings) {return; }
+
+	const UWorld* World {GetWorld()};
+	if(const AFrostbiteGameMode* GameMode {World ? Cast<AFrostbiteGameMode>(World->GetAuthGameMode()) : nullptr})
+	{
+		if(!GameMode->GetRoomStreamingSettings().IsNull())
+		{
+			Settings = GameMode->GetRoomStreamingSettings().LoadSynchronous();
+		}
+	}
+	if(!Settings)
+	{
+		Settings = NewObject<URoomStreamingSettings>(this);
+	}
+}
+
+void URoomStreamingSubsystem::BuildRoomLevels()
+{
+	LoadSettings();
+	Levels.Reset();
+	RoomLevels.Reset();
+	PlayerRoomId = INDEX_NONE;
+
+	UWorld* World {GetWorld()};
+	if(!World || !RoomGraph) {return; }
+	RoomLevels.SetNum(RoomGraph->GetRoomCount());
+
+	/** Streaming levels are matched by package name. In PIE, the package names of streaming levels are prefixed, so the prefix is removed first. */
+	TMap<FString, ULevelStreaming*> StreamingLevelsByPackage;
+	for (ULevelStreaming* StreamingLevel : World->GetStreamingLevels())
+	{
+		if(StreamingLevel)
+		{
+			StreamingLevelsByPackage.Add(UWorld::RemovePIEPrefix(StreamingLevel->GetWorldAssetPackageName()), StreamingLevel);
+		}
+	}
+
+	TMap<ULevelStreaming*, int32> LevelIndices;
+	for (int32 RoomId {0}; RoomId < RoomGraph->GetRoomCount(); RoomId++)
+	{
+		const ARoomVolume* Room {RoomGraph->GetRoom(RoomId)};
+		if(!Room) {continue; }
+
+		for (const FRoomStreamingLevelData& LevelData : Room->StreamingLevels)
+		{
+			if(LevelData.Level.IsNull()) {continue; }
+
+			ULevelStreaming* const* StreamingLevel {StreamingLevelsByPackage.Find(LevelData.Level.ToSoftObjectPath().GetLongPackageName())};
+			if(!StreamingLevel)
+			{
+				UE_LOG(LogRoomStreaming, Warning, TEXT("Room %s refers to level %s, which is not a streaming level of this world."), *Room->GetName(), *LevelData.Level.ToString());
+				continue;
+			}
+
+			/** Levels can be shared by multiple rooms. */
+			int32 LevelIndex {INDEX_NONE};
+			if(const int32* ExistingIndex {LevelIndices.Find(*StreamingLevel)})
+			{
+				LevelIndex = *ExistingIndex;
+				Levels[LevelIndex].EstimatedMemory = FMath::Max(Levels[LevelIndex].EstimatedMemory, LevelData.EstimatedMemory);
+			}
+			else
+			{
+				LevelIndex = Levels.Num();
+				LevelIndices.Add(*StreamingLevel, LevelIndex);
+
+				FRoomStreamingLevel& Level {Levels.AddDefaulted_GetRef()};
+				Level.Level = *StreamingLevel;
+				Level.EstimatedMemory = LevelData.EstimatedMemory;
+				Level.State = (*StreamingLevel)->ShouldBeVisible() ? ERoomStreamingState::Resident
+					: (*StreamingLevel)->ShouldBeLoaded() ? ERoomStreamingState::Prefetched : ERoomStreamingState::Unloaded;
+			}
+			RoomLevels[RoomId].AddUnique(LevelIndex);
+		}
+	}
+
+	UE_LOG(LogRoomStreaming, Log, TEXT("Bound %d streaming levels to %d rooms."), Levels.Num(), RoomLevels.Num());
+	UpdateStreaming();
+}
+
+void URoomStreamingSubsystem::UpdateStreaming()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomStreamingUpdate);
+
+	const UWorld* World {GetWorld()};
+	const UPlayerSubsystem* PlayerSubsystem {World ? World->GetSubsystem<UPlayerSubsystem>() : nullptr};
+	const APlayerCharacter* PlayerCharacter {PlayerSubsystem ? PlayerSubsystem->GetPlayerCharacter() : nullptr};
+	if(!PlayerCharacter || !RoomGraph || !RoomMembership) {return; }
+
+	/** Outside of any room, the levels stay as they are. */
+	const int32 RoomId {RoomMembership->GetActorRoomId(PlayerCharacter)};
+	if(!RoomGraph->IsValidRoomId(RoomId)) {return; }
+
+	if(RoomId != PlayerRoomId)
+	{
+		if(PlayerRoomId != INDEX_NONE && AreRoomLevelsResident(RoomId))
+		{
+			++Telemetry.RoomEntryHits;
+		}
+		else if(PlayerRoomId != INDEX_NONE)
+		{
+			++Telemetry.RoomEntryMisses;
+		}
+		PlayerRoomId = RoomId;
+	}
+
+	TArray<ERoomStreamingState> WantedStates;
+	WantedStates.Init(ERoomStreamingState::Unloaded, Levels.Num());
+	float Memory {0.0f};
+
+	/** Returns the memory that wanting the levels of a room in a state adds, and optionally marks them as wanted. */
+	auto WantRoom = [&](const int32 WantedRoomId, const ERoomStreamingState State, const bool Apply) -> float
+	{
+		float AddedMemory {0.0f};
+		for (const int32 LevelIndex : RoomLevels[WantedRoomId])
+		{
+			if(WantedStates[LevelIndex] != ERoomStreamingState::Unloaded)
+			{
+				if(Apply && State > WantedStates[LevelIndex])
+				{
+					WantedStates[LevelIndex] = State;
+				}
+				continue;
+			}
+			AddedMemory += Levels[LevelIndex].EstimatedMemory;
+			if(Apply)
+			{
+				WantedStates[LevelIndex] = State;
+			}
+		}
+		return AddedMemory;
+	};
+
+	/** The room of the player and its adjacent rooms are always resident. */
+	Memory += WantRoom(RoomId, ERoomStreamingState::Resident, true);
+	for (const int32 NeighborId : RoomGraph->GetNeighbors(RoomId))
+	{
+		Memory += WantRoom(NeighborId, ERoomStreamingState::Resident, true);
+	}
+	if(Memory > Settings->MemoryBudget)
+	{
+		UE_LOG(LogRoomStreaming, Verbose, TEXT("The resident levels around room %s exceed the memory budget: %.0f MB of %.0f MB."),
+			*RoomGraph->GetRoom(RoomId)->GetName(), Memory, Settings->MemoryBudget);
+	}
+
+	/** Rooms the player is heading towards are prefetched as long as they fit in the budget. */
+	TArray<int32> PrefetchRoomIds;
+	GetPrefetchRooms(PlayerCharacter->GetActorLocation(), PlayerCharacter->GetVelocity(), PrefetchRoomIds);
+	for (const int32 PrefetchRoomId : PrefetchRoomIds)
+	{
+		const float AddedMemory {WantRoom(PrefetchRoomId, ERoomStreamingState::Prefetched, false)};
+		if(Memory + AddedMemory > Settings->MemoryBudget) {continue; }
+		Memory += WantRoom(PrefetchRoomId, ERoomStreamingState::Prefetched, true);
+	}
+
+	const double Now {World->GetTimeSeconds()};
+	TArray<int32> UnwantedLoadedLevels;
+	for (int32 LevelIndex {0}; LevelIndex < Levels.Num(); LevelIndex++)
+	{
+		if(WantedStates[LevelIndex] != ERoomStreamingState::Unloaded)
+		{
+			Levels[LevelIndex].LastWantedTime = Now;
+		}
+		else if(Levels[LevelIndex].State != ERoomStreamingState::Unloaded)
+		{
+			UnwantedLoadedLevels.Add(LevelIndex);
+		}
+	}
+
+	/** Levels that are no longer wanted stay loaded but hidden while they fit in the budget, so that returning to a room does not stream it again. */
+	UnwantedLoadedLevels.Sort([this](const int32 A, const int32 B) {return Levels[A].LastWantedTime > Levels[B].LastWantedTime; });
+	for (const int32 LevelIndex : UnwantedLoadedLevels)
+	{
+		if(Memory + Levels[LevelIndex].EstimatedMemory > Settings->MemoryBudget) {continue; }
+		Memory += Levels[LevelIndex].EstimatedMemory;
+		WantedStates[LevelIndex] = ERoomStreamingState::Prefetched;
+	}
+
+	Telemetry.ResidentLevels = 0;
+	Telemetry.PrefetchedLevels = 0;
+	for (int32 LevelIndex {0}; LevelIndex < Levels.Num(); LevelIndex++)
+	{
+		RequestLevelState(Levels[LevelIndex], WantedStates[LevelIndex]);
+		Telemetry.ResidentLevels += WantedStates[LevelIndex] == ERoomStreamingState::Resident ? 1 : 0;
+		Telemetry.PrefetchedLevels += WantedStates[LevelIndex] == ERoomStreamingState::Prefetched ? 1 : 0;
+	}
+	Telemetry.EstimatedMemory = Memory;
+
+	SET_DWORD_STAT(STAT_RoomStreamingResidentLevels, Telemetry.ResidentLevels);
+	SET_DWORD_STAT(STAT_RoomStreamingPrefetchedLevels, Telemetry.PrefetchedLevels);
+	SET_FLOAT_STAT(STAT_RoomStreamingEstimatedMemory, Memory);
+}
+
+void URoomStreamingSubsystem::GetPrefetchRooms(const FVector& PlayerLocation, const FVector& PlayerVelocity, TArray<int32>& OutRoomIds) const
+{
+	OutRoomIds.Reset();
+	const float Speed {static_cast<float>(PlayerVelocity.Size())};
+	if(Speed < Settings->PrefetchMinSpeed) {return; }
+	const FVector Direction {PlayerVelocity / Speed};
+
+	/** The time until the player reaches the portal towards every adjacent room it is moving towards. */
+	TArray<TPair<float, int32>> ApproachedRooms;
+	for (const int32 NeighborId : RoomGraph->GetNeighbors(PlayerRoomId))
+	{
+		FVector Portal {FVector::ZeroVector};
+		if(!RoomGraph->GetPortalLocation(PlayerRoomId, NeighborId, Portal)) {continue; }
+
+		const FVector ToPortal {Portal - PlayerLocation};
+		const float Distance {static_cast<float>(ToPortal.Size())};
+		if(Distance > KINDA_SMALL_NUMBER && (ToPortal / Distance | Direction) < Settings->PrefetchDirectionThreshold) {continue; }
+
+		const float TimeToPortal {Distance / Speed};
+		if(TimeToPortal <= Settings->PrefetchTime)
+		{
+			ApproachedRooms.Emplace(TimeToPortal, NeighborId);
+		}
+	}
+	ApproachedRooms.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) {return A.Key < B.Key; });
+
+	/** The rooms behind the approached rooms are two connections away from the player. */
+	for (const TPair<float, int32>& ApproachedRoom : ApproachedRooms)
+	{
+		for (const int32 RoomId : RoomGraph->GetNeighbors(ApproachedRoom.Value))
+		{
+			if(RoomGraph->GetHopDistance(PlayerRoomId, RoomId) == 2)
+			{
+				OutRoomIds.AddUnique(RoomId);
+			}
+		}
+	}
+}
+
+void URoomStreamingSubsystem::RequestLevelState(FRoomStreamingLevel& Level, const ERoomStreamingState State)
+{
+	if(Level.State == State) {return; }
+
+	ULevelStreaming* StreamingLevel {Level.Level.Get()};
+	if(!StreamingLevel) {return; }
+
+	StreamingLevel->SetShouldBeLoaded(State != ERoomStreamingState::Unloaded);
+	StreamingLevel->SetShouldBeVisible(State == ERoomStreamingState::Resident);
+	Level.State = State;
+}
+
+bool URoomStreamingSubsystem::IsRoomResident(const ARoomVolume* Room) const
+{
+	return RoomGraph && AreRoomLevelsResident(RoomGraph->GetRoomId(Room));
+}
+
+bool URoomStreamingSubsystem::AreRoomLevelsResident(const int32 RoomId) const
+{
+	if(!RoomLevels.IsValidIndex(RoomId)) {return false; }
+	for (const int32 LevelIndex : RoomLevels[RoomId])
+	{
+		const ULevelStreaming* StreamingLevel {Levels[LevelIndex].Level.Get()};
+		if(!StreamingLevel || !StreamingLevel->IsLevelVisible())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void URoomStreamingSubsystem::RecordHitch(const float DeltaTime)
+{
+	const float FrameTime {DeltaTime * 1000.0f};
+	if(FrameTime < Settings->HitchThreshold) {return; }
+
+	/** Slow frames only count as streaming hitches if a level was loading or changing visibility. */
+	const bool IsStreaming {Levels.ContainsByPredicate([](const FRoomStreamingLevel& Level)
+	{
+		const ULevelStreaming* StreamingLevel {Level.Level.Get()};
+		return StreamingLevel && StreamingLevel->IsStreamingStatePending();
+	})};
+	if(!IsStreaming) {return; }
+
+	++Telemetry.HitchCount;
+	Telemetry.TotalHitchTime += FrameTime;
+	Telemetry.WorstHitchTime = FMath::Max(Telemetry.WorstHitchTime, FrameTime);
+	SET_DWORD_STAT(STAT_RoomStreamingHitches, Telemetry.HitchCount);
+	SET_FLOAT_STAT(STAT_RoomStreamingWorstHitch, Telemetry.WorstHitchTime);
+	UE_LOG(LogRoomStreaming, Verbose, TEXT("Streaming hitch of %.1f ms."), FrameTime);
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomVisibilityBaker.h"
+#include "RoomVisibilityData.h"
+#include "RoomVisibilitySubsystem.h"
+#include "RoomVolume.h"
+#include "LogCategories.h"
+
+#include "Components/BoxComponent.h"
+#include "EngineUtils.h"
+#include "Misc/ScopedSlowTask.h"
+
+/** Sets default values for this actor's properties. */
+ARoomVisibilityBaker::ARoomVisibilityBaker()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+void ARoomVisibilityBaker::BeginPlay()
+{
+	Super::BeginPlay();
+	if(URoomVisibilitySubsystem* Subsystem {GetWorld()->GetSubsystem<URoomVisibilitySubsystem>()})
+	{
+		Subsystem->RegisterData(RoomVisibility);
+	}
+}
+
+void ARoomVisibilityBaker::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(URoomVisibilitySubsystem* Subsystem {GetWorld()->GetSubsystem<URoomVisibilitySubsystem>()})
+	{
+		Subsystem->UnregisterData(RoomVisibility);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+#if WITH_EDITOR
+void ARoomVisibilityBaker::BakeRoomVisibility()
+{
+	UWorld* World {GetWorld()};
+	if(!World || !RoomVisibility)
+	{
+		UE_LOG(LogRoomVisibility, Warning, TEXT("Could not bake room visibility for %s: no world or no room visibility asset assigned."), *GetName());
+		return;
+	}
+
+	TArray<ARoomVolume*> Rooms;
+	TArray<const UBoxComponent*> RoomBoxes;
+	for (TActorIterator<ARoomVolume> It {World}; It; ++It)
+	{
+		if(const UBoxComponent* Box {Cast<UBoxComponent>(It->GetCollisionComponent())})
+		{
+			Rooms.Add(*It);
+			RoomBoxes.Add(Box);
+		}
+	}
+
+	const int32 WordCount {URoomVisibilityData::GetWordCount(Rooms.Num())};
+	RoomVisibility->Modify();
+	RoomVisibility->Rooms.Reset(Rooms.Num());
+	for (ARoomVolume* Room : Rooms)
+	{
+		RoomVisibility->Rooms.Add(Room);
+	}
+	RoomVisibility->WordCount = WordCount;
+	RoomVisibility->VisibilityBits.Init(0, Rooms.Num() * WordCount);
+
+	const auto SetVisible {[this, WordCount](const int32 A, const int32 B)
+	{
+		RoomVisibility->VisibilityBits[A * WordCount + B / 64] |= uint64(1) << (B % 64);
+		RoomVisibility->VisibilityBits[B * WordCount + A / 64] |= uint64(1) << (A % 64);
+	}};
+
+	/** Every room can see itself, and connected rooms can always see each other through their portal. */
+	for (int32 A {0}; A < Rooms.Num(); A++)
+	{
+		SetVisible(A, A);
+		for (const TSoftObjectPtr<ARoomVolume>& ConnectedRoom : Rooms[A]->ConnectedRooms)
+		{
+			const int32 B {Rooms.Find(ConnectedRoom.Get())};
+			if(B != INDEX_NONE)
+			{
+				SetVisible(A, B);
+			}
+		}
+		for (const FRoomPathData& Path : Rooms[A]->PathData)
+		{
+			const int32 B {Rooms.Find(Path.Room.Get())};
+			if(B != INDEX_NONE)
+			{
+				SetVisible(A, B);
+			}
+		}
+	}
+
+	/** Only static geometry blocks visibility, as movable geometry such as doors can open at runtime. */
+	FCollisionQueryParams Params {FCollisionQueryParams::DefaultQueryParam};
+	Params.bTraceComplex = false;
+	Params.AddIgnoredActors(TArray<AActor*>(Rooms));
+	const FCollisionObjectQueryParams ObjectParams {ECC_WorldStatic};
+
+	/** Returns a random point inside the oriented bounds of a room. */
+	FRandomStream Random {RandomSeed};
+	const auto RandomPointInRoom {[&Random](const UBoxComponent* Box)
+	{
+		const FVector Extent {Box->GetUnscaledBoxExtent()};
+		const FVector Local {Random.FRandRange(-Extent.X, Extent.X), Random.FRandRange(-Extent.Y, Extent.Y), Random.FRandRange(-Extent.Z, Extent.Z)};
+		return Box->GetComponentTransform().TransformPosition(Local);
+	}};
+
+	const int32 PairCount {Rooms.Num() * (Rooms.Num() - 1) / 2};
+	FScopedSlowTask SlowTask {static_cast<float>(PairCount), FText::FromString(TEXT("Baking room visibility..."))};
+	SlowTask.MakeDialog(true);
+
+	int32 VisiblePairs {0};
+	for (int32 A {0}; A < Rooms.Num(); A++)
+	{
+		for (int32 B {A + 1}; B < Rooms.Num(); B++)
+		{
+			if(SlowTask.ShouldCancel())
+			{
+				UE_LOG(LogRoomVisibility, Warning, TEXT("Room visibility bake for %s was cancelled, the asset is incomplete."), *GetName());
+				return;
+			}
+			SlowTask.EnterProgressFrame(1.0f);
+
+			if(RoomVisibility->CanRoomSeeRoom(A, B))
+			{
+				++VisiblePairs;
+				continue;
+			}
+			for (int32 Ray {0}; Ray < RaysPerRoomPair; Ray++)
+			{
+				if(!World->LineTraceTestByObjectType(RandomPointInRoom(RoomBoxes[A]), RandomPointInRoom(RoomBoxes[B]), ObjectParams, Params))
+				{
+					SetVisible(A, B);
+					++VisiblePairs;
+					break;
+				}
+			}
+		}
+	}
+
+	RoomVisibility->MarkPackageDirty();
+	UE_LOG(LogRoomVisibility, Log, TEXT("Baked room visibility for %s: %d rooms, %d of %d room pairs can see each other."), *GetName(), Rooms.Num(), VisiblePairs, PairCount);
+}
+#endif
@@ -0,0 +1,203 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#include "RoomVisibilitySubsystem.h"
+#include "RoomVisibilityData.h"
+#include "RoomGraphSubsystem.h"
+#include "RoomMembershipSubsystem.h"
+#include "RoomVolume.h"
+#include "StatCategories.h"
+#include "LogCategories.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Components/PrimitiveComponent.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Room Visibility Build"), STAT_RoomVisibilityBuild, STATGROUP_RoomSystem);
+DECLARE_CYCLE_STAT(TEXT("Room Visibility Update Hidden Primitives"), STAT_RoomVisibilityUpdateHiddenPrimitives, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Visibility Primitives Culled"), STAT_RoomVisibilityPrimitivesCulled, STATGROUP_RoomSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Room Visibility Visible Rooms"), STAT_RoomVisibilityVisibleRooms, STATGROUP_RoomSystem);
+
+bool URoomVisibilitySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void URoomVisibilitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/** The visibility is built once the membership index has been rebuilt for the new graph, as primitives are assigned to rooms using it. */
+	RoomMembership = Collection.InitializeDependency<URoomMembershipSubsystem>();
+	RoomGraph = Collection.InitializeDependency<URoomGraphSubsystem>();
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.AddUObject(this, &URoomVisibilitySubsystem::BuildVisibility);
+	}
+}
+
+void URoomVisibilitySubsystem::Deinitialize()
+{
+	if(RoomMembership)
+	{
+		RoomMembership->OnIndexBuilt.RemoveAll(this);
+	}
+	VisibilityBits.Empty();
+	RoomPrimitives.Empty();
+	HiddenPrimitives.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId URoomVisibilitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URoomVisibilitySubsystem, STATGROUP_RoomSystem);
+}
+
+void URoomVisibilitySubsystem::Tick(float DeltaTime)
+{
+	if(WordCount == 0 || !RoomMembership) {return; }
+
+	const APlayerController* PlayerController {GetWorld()->GetFirstPlayerController()};
+	if(!PlayerController || !PlayerController->PlayerCameraManager) {return; }
+
+	/** The previous room of the camera is tested first, so that the lookup is constant time while the camera stays in its room. */
+	const int32 RoomId {RoomMembership->FindRoomId(PlayerController->PlayerCameraManager->GetCameraLocation(), CameraRoomId)};
+	if(RoomId == CameraRoomId) {return; }
+
+	CameraRoomId = RoomId;
+	UpdateHiddenPrimitives();
+}
+
+void URoomVisibilitySubsystem::RegisterData(URoomVisibilityData* InData)
+{
+	if(!InData || InData == Data) {return; }
+	if(!InData->IsValidData())
+	{
+		UE_LOG(LogRoomVisibility, Warning, TEXT("Room visibility data %s is empty or corrupt and was not registered. Bake it again from its room visibility baker."), *InData->GetName());
+		return;
+	}
+	if(Data)
+	{
+		UE_LOG(LogRoomVisibility, Warning, TEXT("Room visibility data %s replaces %s. Only one room visibility baker should be placed per world."), *InData->GetName(), *Data->GetName());
+	}
+	Data = InData;
+	BuildVisibility();
+}
+
+void URoomVisibilitySubsystem::UnregisterData(URoomVisibilityData* InData)
+{
+	if(!InData || InData != Data) {return; }
+	Data = nullptr;
+	BuildVisibility();
+}
+
+bool URoomVisibilitySubsystem::CanRoomVolumeSeeRoomVolume(const ARoomVolume* From, const ARoomVolume* To) const
+{
+	return !RoomGraph || CanRoomSeeRoom(RoomGraph->GetRoomId(From), RoomGraph->GetRoomId(To));
+}
+
+void URoomVisibilitySubsystem::BuildVisibility()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomVisibilityBuild);
+
+	/** Previously hidden primitives are shown again, as room IDs are only valid until the graph is rebuilt. */
+	CameraRoomId = INDEX_NONE;
+	VisibilityBits.Reset();
+	RoomPrimitives.Reset();
+	WordCount = 0;
+	UpdateHiddenPrimitives();
+
+	UWorld* World {GetWorld()};
+	if(!Data || !World || !RoomGraph || !RoomMembership || RoomGraph->GetRoomCount() == 0) {return; }
+
+	/** Maps every room ID to its index in the baked data. Rooms that were not baked can see and be seen by every room. */
+	const int32 RoomCount {RoomGraph->GetRoomCount()};
+	TArray<int32> DataIndices;
+	DataIndices.Init(INDEX_NONE, RoomCount);
+	for (int32 DataIndex {0}; DataIndex < Data->Rooms.Num(); DataIndex++)
+	{
+		const int32 RoomId {RoomGraph->GetRoomId(Data->Rooms[DataIndex].Get())};
+		if(DataIndices.IsValidIndex(RoomId))
+		{
+			DataIndices[RoomId] = DataIndex;
+		}
+	}
+
+	WordCount = URoomVisibilityData::GetWordCount(RoomCount);
+	VisibilityBits.SetNumZeroed(RoomCount * WordCount);
+	int32 UnbakedRooms {0};
+	for (int32 From {0}; From < RoomCount; From++)
+	{
+		UnbakedRooms += DataIndices[From] == INDEX_NONE ? 1 : 0;
+		for (int32 To {0}; To < RoomCount; To++)
+		{
+			const bool IsVisible {DataIndices[From] == INDEX_NONE || DataIndices[To] == INDEX_NONE || Data->CanRoomSeeRoom(DataIndices[From], DataIndices[To])};
+			if(IsVisible)
+			{
+				VisibilityBits[From * WordCount + To / 64] |= uint64(1) << (To % 64);
+			}
+		}
+	}
+	if(UnbakedRooms > 0)
+	{
+		UE_LOG(LogRoomVisibility, Warning, TEXT("%d rooms are missing from room visibility data %s and are treated as always visible. Bake it again."), UnbakedRooms, *Data->GetName());
+	}
+
+	/** Only primitives that cannot move and lie entirely within a single room can be hidden by room. */
+	RoomPrimitives.SetNum(RoomCount);
+	for (TActorIterator<AActor> It {World}; It; ++It)
+	{
+		if(It->IsA<APawn>() || It->IsA<ARoomVolume>()) {continue; }
+
+		TInlineComponentArray<UPrimitiveComponent*> Primitives {*It};
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if(Primitive->Mobility == EComponentMobility::Movable || !Primitive->IsVisible() || Primitive->bHiddenInGame) {continue; }
+
+			const FBox Bounds {Primitive->Bounds.GetBox()};
+			const int32 RoomId {RoomMembership->FindRoomId(Bounds.GetCenter())};
+			const FRoomMembershipBounds* RoomBounds {RoomMembership->GetRoomBounds(RoomId)};
+			if(RoomBounds && RoomBounds->ContainsBox(Bounds))
+			{
+				RoomPrimitives[RoomId].Add(Primitive);
+			}
+		}
+	}
+}
+
+void URoomVisibilitySubsystem::UpdateHiddenPrimitives()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RoomVisibilityUpdateHiddenPrimitives);
+
+	APlayerController* PlayerController {GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr};
+	if(!PlayerController) {return; }
+
+	/** Only the primitives hidden by this subsystem are removed, so that primitives hidden by other systems stay hidden. */
+	if(HiddenPrimitives.Num() > 0)
+	{
+		const TSet<TWeakObjectPtr<UPrimitiveComponent>> PreviouslyHidden {HiddenPrimitives};
+		PlayerController->HiddenPrimitiveComponents.RemoveAll([&PreviouslyHidden](const TWeakObjectPtr<UPrimitiveComponent>& Primitive) {return PreviouslyHidden.Contains(Primitive); });
+		HiddenPrimitives.Reset();
+	}
+
+	int32 VisibleRooms {0};
+	if(RoomPrimitives.IsValidIndex(CameraRoomId))
+	{
+		for (int32 RoomId {0}; RoomId < RoomPrimitives.Num(); RoomId++)
+		{
+			if(CanRoomSeeRoom(CameraRoomId, RoomId))
+			{
+				++VisibleRooms;
+				continue;
+			}
+			HiddenPrimitives.Append(RoomPrimitives[RoomId]);
+		}
+		PlayerController->HiddenPrimitiveComponents.Append(HiddenPrimitives);
+	}
+	SET_DWORD_STAT(STAT_RoomVisibilityPrimitivesCulled, HiddenPrimitives.Num());
+	SET_DWORD_STAT(STAT_RoomVisibilityVisibleRooms, VisibleRooms);
+}
@@ -3,6 +3,8 @@
 // This source code is part of the project Frostbite
 
 #include "RoomVolume.h"
+#include "RoomMembershipSubsystem.h"
+#include "LightInfluenceSubsystem.h"
 #include "Nightstalker.h"
 #include "PlayerCharacter.h"
 #include "LogCategories.h"
@@ -10,7 +12,13 @@
 void ARoomVolume::NotifyActorBeginOverlap(AActor* OtherActor)
 {
 	Super::NotifyActorBeginOverlap(OtherActor);
-	if(APlayerCharacter* PlayerCharacter {Cast<APlayerCharacter>(OtherActor)})
+	if(IsTrackedByMembershipSubsystem(OtherActor)) {return; }
+	NotifyActorEnterRoom(OtherActor);
+}
+
+void ARoomVolume::NotifyActorEnterRoom(AActor* Actor)
+{
+	if(APlayerCharacter* PlayerCharacter {Cast<APlayerCharacter>(Actor)})
 	{
 		OnPlayerEnter.Broadcast(PlayerCharacter);
 		EventOnPlayerEnter(PlayerCharacter);
@@ -19,7 +27,7 @@ void ARoomVolume::NotifyActorBeginOverlap(AActor* OtherActor)
 		
 		return;
 	}
-	if(ANightstalker* Nightstalker {Cast<ANightstalker>(OtherActor)})
+	if(ANightstalker* Nightstalker {Cast<ANightstalker>(Actor)})
 	{
 		OnNightstalkerEnter.Broadcast(Nightstalker);
 		EventOnNightstalkerEnter(Nightstalker);
@@ -32,13 +40,25 @@ void ARoomVolume::SetLightStatus(const bool Value)
 {
 	if(IsLit == Value) {return; }
 	IsLit = Value;
+
+	/** The baked lights in the room are toggled before the delegate is broadcast, so that listeners see the new light influence. */
+	if(ULightInfluenceSubsystem* LightInfluenceSubsystem {GetWorld() ? GetWorld()->GetSubsystem<ULightInfluenceSubsystem>() : nullptr})
+	{
+		LightInfluenceSubsystem->SetRoomLightsEnabled(this, Value);
+	}
 	OnLuminosityChanged.Broadcast(Value);
 }
 
 void ARoomVolume::NotifyActorEndOverlap(AActor* OtherActor)
 {
 	Super::NotifyActorEndOverlap(OtherActor);
-	if(APlayerCharacter* PlayerCharacter {Cast<APlayerCharacter>(OtherActor)})
+	if(IsTrackedByMembershipSubsystem(OtherActor)) {return; }
+	NotifyActorLeaveRoom(OtherActor);
+}
+
+void ARoomVolume::NotifyActorLeaveRoom(AActor* Actor)
+{
+	if(APlayerCharacter* PlayerCharacter {Cast<APlayerCharacter>(Actor)})
 	{
 		OnPlayerLeave.Broadcast(PlayerCharacter);
 		EventOnPlayerLeave(PlayerCharacter);
@@ -47,7 +67,7 @@ void ARoomVolume::NotifyActorEndOverlap(AActor* OtherActor)
 		
 		return;
 	}
-	if(ANightstalker* Nightstalker {Cast<ANightstalker>(OtherActor)})
+	if(ANightstalker* Nightstalker {Cast<ANightstalker>(Actor)})
 	{
 		OnNightstalkerLeave.Broadcast(Nightstalker);
 		EventOnNightstalkerLeave(Nightstalker);
@@ -56,6 +76,14 @@ void ARoomVolume::NotifyActorEndOverlap(AActor* OtherActor)
 	}
 }
 
+bool ARoomVolume::IsTrackedByMembershipSubsystem(const AActor* Actor) const
+{
+	/** Room transitions of tracked actors are reported by the membership subsystem, so their overlap events are ignored to avoid duplicate notifications. */
+	const UWorld* World {GetWorld()};
+	const URoomMembershipSubsystem* MembershipSubsystem {World ? World->GetSubsystem<URoomMembershipSubsystem>() : nullptr};
+	return MembershipSubsystem && MembershipSubsystem->IsActorTracked(Actor);
+}
+
 // BLUEPRINT NATIVE EVENTS
 void ARoomVolume::EventOnPlayerEnter_Implementation(APlayerCharacter* PlayerCharacter)
 {
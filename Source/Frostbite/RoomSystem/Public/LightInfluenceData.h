@@ -0,0 +1,82 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "LightInfluenceData.generated.h"
+
+class ARoomVolume;
+class ULightComponent;
+
+/** Struct containing a light whose influence was baked. The index of the source in the data asset is its light ID. */
+USTRUCT()
+struct FLightInfluenceSource
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Soft object pointer to the light component. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluenceSource", Meta = (DisplayName = "Light"))
+	TSoftObjectPtr<ULightComponent> Light {nullptr};
+
+	/** Soft object pointer to the room that contains the light. Changing the light status of this room toggles the light. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluenceSource", Meta = (DisplayName = "Room"))
+	TSoftObjectPtr<ARoomVolume> Room {nullptr};
+
+	/** Constructor with default values. */
+	FLightInfluenceSource()
+	{
+	}
+};
+
+/** Data asset that stores the baked influence of static and stationary lights.
+ *	The influence is stored in a sparse voxel grid. Only cells that are lit by at least one light are stored,
+ *	together with a bitmask of the IDs of the lights that reach the cell. It is generated by a LightInfluenceVolume.
+ *	@Brief Baked light influence grid.
+ */
+UCLASS(BlueprintType, ClassGroup = ("RoomSystem"))
+class ULightInfluenceData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The world space location of the corner of the first cell of the grid. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluence", Meta = (DisplayName = "Origin"))
+	FVector Origin {FVector::ZeroVector};
+
+	/** The size of a cell. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluence", Meta = (DisplayName = "Cell Size"))
+	float CellSize {100.0f};
+
+	/** The lights whose influence was baked, indexed by light ID. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluence", Meta = (DisplayName = "Sources"))
+	TArray<FLightInfluenceSource> Sources;
+
+	/** The number of 64 bit words in the bitmask of every cell. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluence", Meta = (DisplayName = "Mask Word Count"))
+	int32 MaskWordCount {0};
+
+	/** The coordinates of every lit cell. */
+	UPROPERTY()
+	TArray<FIntVector> CellKeys;
+
+	/** The light ID bitmask of every lit cell, stored as [Cell][Word]. */
+	UPROPERTY()
+	TArray<uint64> CellMasks;
+
+public:
+	/** Returns whether the grid contains valid data. */
+	bool IsValidData() const;
+
+	/** Returns the coordinates of the cell that contains a world space location. */
+	FORCEINLINE FIntVector GetCellKey(const FVector& Location) const
+	{
+		const FVector Local {(Location - Origin) / CellSize};
+		return FIntVector(FMath::FloorToInt32(Local.X), FMath::FloorToInt32(Local.Y), FMath::FloorToInt32(Local.Z));
+	}
+
+	/** Returns the number of words required to store a bitmask for a number of lights. */
+	static FORCEINLINE int32 GetMaskWordCount(const int32 LightCount) {return (LightCount + 63) / 64; }
+};
@@ -0,0 +1,89 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LightInfluenceSubsystem.generated.h"
+
+class ARoomVolume;
+class ULightComponent;
+class ULightInfluenceData;
+
+/** Struct containing the runtime state of a registered light influence grid. */
+struct FLightInfluenceGrid
+{
+	/** The index of every lit cell in the cell masks of the data asset. */
+	TMap<FIntVector, int32> CellIndices;
+
+	/** The bitmask of the lights that are currently enabled. */
+	TArray<uint64> EnabledMask;
+};
+
+/** Struct referring to a single light in a registered grid. */
+struct FLightInfluenceHandle
+{
+	int32 GridIndex {INDEX_NONE};
+	int32 LightId {INDEX_NONE};
+};
+
+/** World Subsystem that answers whether a location is lit, using baked light influence grids.
+ *	Every lit cell of a grid stores a bitmask of the lights that reach it, and the subsystem keeps a bitmask of the lights that are currently enabled.
+ *	A query is a hashed cell lookup and a bitmask AND. Toggling a light, or changing the light status of the room that contains it, flips a single bit.
+ *	@Brief World Subsystem for point lit queries.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class ULightInfluenceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** The registered light influence data assets. */
+	UPROPERTY()
+	TArray<ULightInfluenceData*> Data;
+
+	/** The runtime state of every registered data asset. */
+	TArray<FLightInfluenceGrid> Grids;
+
+	/** The handle of every baked light component. */
+	TMap<TWeakObjectPtr<const ULightComponent>, FLightInfluenceHandle> LightHandles;
+
+	/** The handles of the lights in every room. */
+	TMultiMap<TWeakObjectPtr<const ARoomVolume>, FLightInfluenceHandle> RoomLightHandles;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+	/** Registers a light influence data asset. Lights are enabled if their component is visible and their room is lit at the time of registration. */
+	void RegisterData(ULightInfluenceData* InData);
+
+	/** Unregisters a light influence data asset. */
+	void UnregisterData(ULightInfluenceData* InData);
+
+	/** Returns whether a location is lit by any enabled baked light. */
+	UFUNCTION(BlueprintPure, Category = "LightInfluence", Meta = (DisplayName = "Is Location Lit"))
+	bool IsLocationLit(const FVector& Location) const;
+
+	/** Returns whether any light influence data is registered. Without data, no location is lit. */
+	FORCEINLINE bool HasData() const {return Data.Num() > 0; }
+
+	/** Enables or disables the influence of a baked light. */
+	UFUNCTION(BlueprintCallable, Category = "LightInfluence", Meta = (DisplayName = "Set Light Enabled"))
+	void SetLightEnabled(const ULightComponent* Light, const bool Value);
+
+	/** Enables or disables the influence of all baked lights in a room. Called when the light status of the room changes. */
+	void SetRoomLightsEnabled(const ARoomVolume* Room, const bool Value);
+
+private:
+	/** Sets the bit of a light in the enabled mask of its grid. */
+	void SetLightBit(const FLightInfluenceHandle& Handle, const bool Value);
+
+	/** Rebuilds the light and room lookup tables of all registered grids. */
+	void RebuildHandles();
+
+	/** Updates the memory stats of the registered grids. */
+	void UpdateStats() const;
+};
@@ -0,0 +1,54 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "LightInfluenceVolume.generated.h"
+
+class UBoxComponent;
+class ULightInfluenceData;
+
+/** Actor that defines the bounds of a baked light influence grid.
+ *	The bake rasterizes the influence of all static and stationary local lights inside the volume into a sparse voxel grid,
+ *	and stores it in a light influence data asset. At runtime, the volume registers its data with the light influence subsystem.
+ *	@Brief Volume for baking and registering light influence grids.
+ */
+UCLASS(NotBlueprintable, Placeable, ClassGroup = ("RoomSystem"), HideCategories = (Rendering, Input, Collision, HLOD, Replication))
+class ALightInfluenceVolume : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	/** The box that defines the bounds of the grid. */
+	UPROPERTY(VisibleAnywhere, Category = "LightInfluenceVolume", Meta = (DisplayName = "Bounds"))
+	UBoxComponent* Bounds;
+
+	/** The data asset to bake the light influence into. */
+	UPROPERTY(EditInstanceOnly, Category = "LightInfluenceVolume", Meta = (DisplayName = "Light Influence"))
+	ULightInfluenceData* LightInfluence;
+
+	/** The size of a cell. */
+	UPROPERTY(EditInstanceOnly, Category = "LightInfluenceVolume", Meta = (DisplayName = "Cell Size", ClampMin = "25", UIMin = "25", Units = "cm"))
+	float CellSize {100.0f};
+
+	/** The fraction of the attenuation radius of a light within which a location is considered lit. */
+	UPROPERTY(EditInstanceOnly, Category = "LightInfluenceVolume", Meta = (DisplayName = "Influence Radius Scale", ClampMin = "0", ClampMax = "1", UIMin = "0", UIMax = "1"))
+	float InfluenceRadiusScale {0.75f};
+
+public:
+	/** Sets default values for this actor's properties. */
+	ALightInfluenceVolume();
+
+#if WITH_EDITOR
+	/** Rasterizes the influence of the lights inside the volume and stores the results in the light influence data asset. */
+	UFUNCTION(CallInEditor, Category = "LightInfluenceVolume", Meta = (DisplayName = "Bake Light Influence"))
+	void BakeLightInfluence();
+#endif
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
@@ -0,0 +1,139 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomGraphSubsystem.generated.h"
+
+class ARoomVolume;
+
+/** Enum for selecting which connections of the room graph are taken into account. */
+UENUM(BlueprintType)
+enum class ERoomGraphLayer : uint8
+{
+	Unrestricted		UMETA(DisplayName = "Unrestricted", ToolTip = "All connections between rooms."),
+	Nightstalker		UMETA(DisplayName = "Nightstalker", ToolTip = "Only connections that can be taken by the nightstalker."),
+};
+
+DECLARE_MULTICAST_DELEGATE(FRoomGraphBuiltDelegate);
+
+/** World Subsystem that turns the connections between room volumes into a queryable graph.
+ *	All rooms in the world are resolved once when the world begins play and are assigned a compact integer ID.
+ *	The adjacency is stored as a compressed sparse row array, and the hop distances and next hops between every pair of rooms
+ *	are precomputed for both graph layers, so that path and distance queries are constant time table lookups.
+ *	@Brief World Subsystem that provides the room graph.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class URoomGraphSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** The number of graph layers. */
+	static constexpr int32 LayerCount {2};
+
+	/** The hop distance that is stored for rooms that cannot reach each other. */
+	static constexpr uint16 UnreachableDistance {MAX_uint16};
+
+	/** The room ID that is stored as next hop for rooms that cannot reach each other. */
+	static constexpr uint16 InvalidRoomId {MAX_uint16};
+
+	/** Delegate that is called after the graph has been built. Room IDs are only stable until the graph is rebuilt. */
+	FRoomGraphBuiltDelegate OnGraphBuilt;
+
+private:
+	/** All rooms in the world, indexed by room ID. */
+	UPROPERTY()
+	TArray<ARoomVolume*> Rooms;
+
+	/** Maps a room to its room ID. */
+	TMap<const ARoomVolume*, int32> RoomIds;
+
+	/** The offset of the first edge of every room in the edge arrays. Contains one more entry than there are rooms. */
+	TArray<int32> EdgeOffsets;
+
+	/** The target room of every edge, grouped per source room. */
+	TArray<int32> EdgeTargets;
+
+	/** Whether the nightstalker can take every edge. */
+	TArray<bool> EdgeNightstalkerFlags;
+
+	/** The world space location of the portal between the rooms of every edge. */
+	TArray<FVector> EdgePortalLocations;
+
+	/** The hop distance between every pair of rooms, stored as [Layer][From][To]. */
+	TArray<uint16> HopDistances;
+
+	/** The first room to move to on a shortest path between every pair of rooms, stored as [Layer][From][To]. */
+	TArray<uint16> NextHops;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Resolves all rooms in the world and rebuilds the graph. This is called automatically when the world begins play. */
+	UFUNCTION(BlueprintCallable, Category = "RoomGraph", Meta = (DisplayName = "Rebuild Room Graph"))
+	void BuildGraph();
+
+	/** Returns the ID of a room, or INDEX_NONE if the room is not part of the graph. */
+	int32 GetRoomId(const ARoomVolume* Room) const;
+
+	/** Returns the room with an ID, or nullptr if the ID is invalid. */
+	ARoomVolume* GetRoom(const int32 RoomId) const;
+
+	/** Returns the IDs of the rooms that are directly connected to a room. */
+	TArrayView<const int32> GetNeighbors(const int32 RoomId) const;
+
+	/** Returns whether the nightstalker can take an edge, where the edge index is relative to the neighbors of the room. */
+	bool CanNightstalkerTakeEdge(const int32 RoomId, const int32 NeighborIndex) const;
+
+	/** Returns the location of the portal between two directly connected rooms.
+	 *	@Return Whether the rooms are directly connected.
+	 */
+	bool GetPortalLocation(const int32 FromId, const int32 ToId, FVector& OutLocation) const;
+
+	/** Returns the number of connections on a shortest path between two rooms, or INDEX_NONE if the rooms cannot reach each other. */
+	int32 GetHopDistance(const int32 FromId, const int32 ToId, const ERoomGraphLayer Layer = ERoomGraphLayer::Unrestricted) const;
+
+	/** Returns the ID of the first room to move to on a shortest path between two rooms, or INDEX_NONE if the rooms cannot reach each other or are the same room. */
+	int32 GetNextHop(const int32 FromId, const int32 ToId, const ERoomGraphLayer Layer = ERoomGraphLayer::Unrestricted) const;
+
+	/** Writes the IDs of the rooms on a shortest path between two rooms, including both rooms, to an array.
+	 *	@Return Whether a path exists.
+	 */
+	bool GetPath(const int32 FromId, const int32 ToId, TArray<int32>& OutPath, const ERoomGraphLayer Layer = ERoomGraphLayer::Unrestricted) const;
+
+	/** Returns the number of connections on a shortest path between two rooms, or -1 if the rooms cannot reach each other. */
+	UFUNCTION(BlueprintPure, Category = "RoomGraph", Meta = (DisplayName = "Get Room Distance"))
+	int32 GetRoomDistance(const ARoomVolume* From, const ARoomVolume* To, const ERoomGraphLayer Layer) const;
+
+	/** Returns the rooms on a shortest path between two rooms, including both rooms. The array is empty if the rooms cannot reach each other. */
+	UFUNCTION(BlueprintPure, Category = "RoomGraph", Meta = (DisplayName = "Get Room Path"))
+	TArray<ARoomVolume*> GetRoomPath(const ARoomVolume* From, const ARoomVolume* To, const ERoomGraphLayer Layer) const;
+
+	/** Returns the number of rooms in the graph. */
+	UFUNCTION(BlueprintPure, Category = "RoomGraph", Meta = (DisplayName = "Get Room Count"))
+	FORCEINLINE int32 GetRoomCount() const {return Rooms.Num(); }
+
+	/** Returns whether a room ID is valid. */
+	FORCEINLINE bool IsValidRoomId(const int32 RoomId) const {return Rooms.IsValidIndex(RoomId); }
+
+	/** Returns the location of the portal between two rooms. This is the center of the overlap of their bounds, or the point halfway between their bounds if they do not overlap.
+	 *	Also used by bakes, which run without a room graph.
+	 */
+	static FVector ComputePortalLocation(const ARoomVolume* From, const ARoomVolume* To);
+
+private:
+	/** Runs a breadth first search from every room and fills the distance and next hop tables of a layer. */
+	void ComputeAllPairsPaths(const ERoomGraphLayer Layer);
+
+	/** Returns the index of a pair of rooms in the distance and next hop tables. */
+	FORCEINLINE int32 GetTableIndex(const ERoomGraphLayer Layer, const int32 FromId, const int32 ToId) const
+	{
+		return (static_cast<int32>(Layer) * Rooms.Num() + FromId) * Rooms.Num() + ToId;
+	}
+};
@@ -0,0 +1,136 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomLightingSubsystem.generated.h"
+
+class ARoomVolume;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+class ULocalLightComponent;
+
+/** Struct defining a flicker pattern for the lights of a room.
+ *	Every character of the pattern is one step of brightness, where 'a' is off, 'm' is the normal brightness and 'z' is double the normal brightness.
+ */
+USTRUCT(BlueprintType)
+struct FRoomLightFlickerPattern
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The brightness steps of the pattern. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "RoomLightFlickerPattern", Meta = (DisplayName = "Pattern"))
+	FString Pattern {TEXT("mmamammmmammamamaaamammma")};
+
+	/** The number of steps per second. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "RoomLightFlickerPattern", Meta = (DisplayName = "Steps Per Second", ClampMin = "0.1", UIMin = "0.1"))
+	float StepsPerSecond {10.0f};
+
+	/** When enabled, the pattern repeats until it is stopped. Otherwise, the lights settle to their target state after the last step. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "RoomLightFlickerPattern", Meta = (DisplayName = "Loop"))
+	bool Loop {false};
+
+	/** Constructor with default values. */
+	FRoomLightFlickerPattern()
+	{
+	}
+};
+
+/** Struct containing all lights of a room, which are updated as one batch. */
+struct FRoomLightBatch
+{
+	/** The lights in the room and their intensity when the batch was built. */
+	TArray<TWeakObjectPtr<ULocalLightComponent>> Lights;
+	TArray<float> BaseIntensities;
+
+	/** Whether the lights should be on once any flicker pattern has finished. */
+	bool IsTargetOn {true};
+
+	/** The brightness that was last applied to the lights, relative to their base intensity. */
+	float AppliedBrightness {1.0f};
+
+	/** Whether the lights are currently visible. */
+	bool IsVisible {true};
+
+	/** The flicker pattern that is playing, and the time since it started. */
+	FRoomLightFlickerPattern Flicker;
+	bool IsFlickering {false};
+	float FlickerTime {0.0f};
+};
+
+/** World Subsystem that controls the lights of every room as one batch.
+ *	All stationary and movable local lights inside a room volume are grouped when the room graph is built. Switching the lights of a room, or playing a flicker pattern on them,
+ *	only marks the batch as active. Active batches are evaluated natively once per frame, and a light is only updated if its brightness actually changed.
+ *	Brightness changes are applied as intensity changes, so flickering does not recreate the render state of the lights. Lights are only hidden once they are switched off.
+ *	@Brief World Subsystem that controls room lighting.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class URoomLightingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The light batch of every room, indexed by room ID. */
+	TArray<FRoomLightBatch> Batches;
+
+	/** The IDs of the rooms whose batch has to be evaluated this frame. */
+	TArray<int32> ActiveRoomIds;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Switches the lights of a room on or off. The light status of the room is updated once the lights have been switched. */
+	UFUNCTION(BlueprintCallable, Category = "RoomLighting", Meta = (DisplayName = "Set Room Lights On"))
+	void SetRoomLightsOn(ARoomVolume* Room, const bool Value);
+
+	/** Plays a flicker pattern on the lights of a room.
+	 *	@Param Room The room to play the pattern in.
+	 *	@Param Pattern The flicker pattern to play.
+	 *	@Param EndOn Whether the lights should be on once the pattern has finished. Ignored for looping patterns until they are stopped.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "RoomLighting", Meta = (DisplayName = "Play Room Light Flicker"))
+	void PlayRoomLightFlicker(ARoomVolume* Room, const FRoomLightFlickerPattern& Pattern, const bool EndOn = true);
+
+	/** Stops the flicker pattern that is playing in a room. The lights settle to their target state. */
+	UFUNCTION(BlueprintCallable, Category = "RoomLighting", Meta = (DisplayName = "Stop Room Light Flicker"))
+	void StopRoomLightFlicker(ARoomVolume* Room);
+
+	/** Returns the number of lights in a room. */
+	UFUNCTION(BlueprintPure, Category = "RoomLighting", Meta = (DisplayName = "Get Room Light Count"))
+	int32 GetRoomLightCount(const ARoomVolume* Room) const;
+
+	/** Returns the brightness of a flicker pattern at a time, relative to the normal brightness. */
+	static float EvaluateFlickerPattern(const FRoomLightFlickerPattern& Pattern, const float Time);
+
+private:
+	/** Groups the stationary and movable lights of every room into batches. Called whenever the membership index has been rebuilt for a new room graph. */
+	void BuildBatches();
+
+	/** Returns the batch of a room, or nullptr if the room is unknown. */
+	FRoomLightBatch* FindBatch(const ARoomVolume* Room, int32& OutRoomId);
+
+	/** Marks a batch as active, so that it is evaluated in the next tick. */
+	void ActivateBatch(const int32 RoomId);
+
+	/** Evaluates and applies a batch.
+	 *	@Return Whether the batch has to remain active.
+	 */
+	bool UpdateBatch(const int32 RoomId, const float DeltaTime, int32& OutUpdatedLights);
+
+	/** Applies a brightness to all lights of a batch. */
+	static int32 ApplyBrightness(FRoomLightBatch& Batch, const float Brightness, const bool Settled);
+};
@@ -0,0 +1,171 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomMembershipSubsystem.generated.h"
+
+class ARoomVolume;
+class URoomGraphSubsystem;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FRoomMembershipChangedDelegate, AActor*, Actor, ARoomVolume*, PreviousRoom, ARoomVolume*, NewRoom);
+DECLARE_MULTICAST_DELEGATE(FRoomMembershipIndexBuiltDelegate);
+
+/** Struct containing the bounds of a room as an oriented box. */
+struct FRoomMembershipBounds
+{
+	FVector Center {FVector::ZeroVector};
+	FVector AxisX {FVector::ForwardVector};
+	FVector AxisY {FVector::RightVector};
+	FVector AxisZ {FVector::UpVector};
+	FVector Extent {FVector::ZeroVector};
+
+	/** Returns whether a location lies within the box. */
+	FORCEINLINE bool Contains(const FVector& Location) const
+	{
+		const FVector Offset {Location - Center};
+		return FMath::Abs(Offset | AxisX) <= Extent.X && FMath::Abs(Offset | AxisY) <= Extent.Y && FMath::Abs(Offset | AxisZ) <= Extent.Z;
+	}
+
+	/** Returns whether an axis aligned box lies entirely within the box. */
+	FORCEINLINE bool ContainsBox(const FBox& Box) const
+	{
+		for (int32 Corner {0}; Corner < 8; Corner++)
+		{
+			const FVector Location {Corner & 1 ? Box.Max.X : Box.Min.X, Corner & 2 ? Box.Max.Y : Box.Min.Y, Corner & 4 ? Box.Max.Z : Box.Min.Z};
+			if(!Contains(Location))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/** Struct containing an actor whose room membership is tracked. */
+struct FRoomTrackedActor
+{
+	TWeakObjectPtr<AActor> Actor;
+	int32 RoomId {INDEX_NONE};
+};
+
+/** World Subsystem that determines which room contains a location without relying on overlap events.
+ *	The oriented bounds of all rooms are indexed by a uniform 2D grid, so that a point query only tests the few rooms that overlap a single cell.
+ *	Registered actors are tracked at a fixed rate and their room transitions are forwarded to the room volumes, so that their overlap events can be disabled.
+ *	Room IDs are shared with the room graph subsystem.
+ *	@Brief World Subsystem that tracks room membership.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class URoomMembershipSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// DELEGATES
+	/** Delegate that is called when a tracked actor moves from one room to another. Either room can be null. */
+	UPROPERTY(BlueprintAssignable, Category = "RoomMembership", Meta = (DisplayName = "On Room Membership Changed"))
+	FRoomMembershipChangedDelegate OnRoomMembershipChanged;
+
+	/** Delegate that is called after the index has been rebuilt for a new room graph.
+	 *	Systems that look up rooms when the graph is built should bind to this instead of the graph, as the index is not valid before this is called. */
+	FRoomMembershipIndexBuiltDelegate OnIndexBuilt;
+
+	/** The maximum number of grid cells. The cell size is increased if the rooms would require more cells. */
+	static constexpr int32 MaxGridCells {65536};
+
+private:
+	/** Pointer to the room graph subsystem, which provides the room IDs. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	/** The bounds of every room, indexed by room ID. */
+	TArray<FRoomMembershipBounds> RoomBounds;
+
+	/** Whether a smaller room overlaps the bounds of every room, indexed by room ID. Only rooms without one can be returned from the hint directly. */
+	TBitArray<> HasSmallerOverlappingRoom;
+
+	/** The world space location of the corner of the grid, the size of a cell and the number of cells along each axis. */
+	FVector2D GridOrigin {FVector2D::ZeroVector};
+	float GridCellSize {500.0f};
+	FIntPoint GridResolution {FIntPoint::ZeroValue};
+
+	/** The offset of the first room of every cell in the cell room array. Contains one more entry than there are cells. */
+	TArray<int32> CellOffsets;
+
+	/** The IDs of the rooms that overlap every cell, sorted from the smallest to the largest room. */
+	TArray<int32> CellRooms;
+
+	/** The actors whose room membership is tracked. */
+	TArray<FRoomTrackedActor> TrackedActors;
+
+	/** The interval at which the room membership of tracked actors is updated. */
+	float TrackingInterval {0.1f};
+
+	/** Timer handle for the tracking update. */
+	FTimerHandle TrackingTimerHandle;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Returns the ID of the room that contains a location, or INDEX_NONE if the location is not inside any room.
+	 *	When rooms overlap, the smallest room is returned.
+	 *	@Location The world space location to look up.
+	 *	@HintRoomId A room that is likely to contain the location, such as the room of the previous lookup.
+	 *	This room is tested first, unless a smaller room overlaps it, such as a closet inside a hall.
+	 */
+	int32 FindRoomId(const FVector& Location, const int32 HintRoomId = INDEX_NONE) const;
+
+	/** Returns the oriented bounds of a room, or nullptr if the room ID is invalid. */
+	FORCEINLINE const FRoomMembershipBounds* GetRoomBounds(const int32 RoomId) const {return RoomBounds.IsValidIndex(RoomId) ? &RoomBounds[RoomId] : nullptr; }
+
+	/** Returns the room that contains a location, or nullptr if the location is not inside any room. */
+	UFUNCTION(BlueprintPure, Category = "RoomMembership", Meta = (DisplayName = "Get Room At Location"))
+	ARoomVolume* GetRoomAtLocation(const FVector& Location) const;
+
+	/** Starts tracking the room membership of an actor. Room transitions of tracked actors are no longer derived from overlap events.
+	 *	@Actor The actor to track.
+	 *	@DisableOverlapEvents Whether overlap events should be disabled on the root component of the actor.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "RoomMembership", Meta = (DisplayName = "Register Actor"))
+	void RegisterActor(AActor* Actor, const bool DisableOverlapEvents = false);
+
+	/** Stops tracking the room membership of an actor. */
+	UFUNCTION(BlueprintCallable, Category = "RoomMembership", Meta = (DisplayName = "Unregister Actor"))
+	void UnregisterActor(AActor* Actor);
+
+	/** Returns whether the room membership of an actor is tracked by this subsystem. */
+	bool IsActorTracked(const AActor* Actor) const;
+
+	/** Returns the ID of the room a tracked actor was in at the last update, or INDEX_NONE. */
+	int32 GetActorRoomId(const AActor* Actor) const;
+
+	/** Returns the room a tracked actor was in at the last update. */
+	UFUNCTION(BlueprintPure, Category = "RoomMembership", Meta = (DisplayName = "Get Actor Room"))
+	ARoomVolume* GetActorRoom(const AActor* Actor) const;
+
+	/** Sets the interval at which the room membership of tracked actors is updated. */
+	UFUNCTION(BlueprintCallable, Category = "RoomMembership", Meta = (DisplayName = "Set Tracking Interval"))
+	void SetTrackingInterval(const float Interval);
+
+private:
+	/** Called when the room graph has been built. Rebuilds the index and notifies the systems that depend on it. */
+	void HandleGraphBuilt();
+
+	/** Builds the room bounds and the grid from the rooms in the room graph. */
+	void BuildIndex();
+
+	/** Updates the room membership of all tracked actors. */
+	void UpdateTrackedActors();
+
+	/** Moves a tracked actor to a new room and notifies the rooms and listeners. */
+	void SetActorRoom(FRoomTrackedActor& TrackedActor, const int32 NewRoomId);
+
+	/** Returns the index of the grid cell that contains a location, or INDEX_NONE if the location is outside the grid. */
+	int32 GetCellIndex(const FVector& Location) const;
+};
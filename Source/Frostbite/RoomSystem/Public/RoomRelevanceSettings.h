@@ -0,0 +1,82 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "RoomRelevanceSettings.generated.h"
+
+/** Struct defining the policies that are applied to actors at a certain room distance from the player. */
+USTRUCT(BlueprintType)
+struct FRoomRelevanceTier
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The minimum number of rooms between the player and an actor for this tier to apply. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevanceTier", Meta = (DisplayName = "Min Room Distance", ClampMin = "0", UIMin = "0"))
+	int32 MinRoomDistance {0};
+
+	/** The minimum tick interval of actors and components in this tier. Zero keeps the interval of the actor. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevanceTier", Meta = (DisplayName = "Tick Interval", ClampMin = "0", UIMin = "0", Units = "s"))
+	float TickInterval {0.0f};
+
+	/** When enabled, actors and components in this tier do not tick at all. The nightstalker is excluded and keeps ticking at the tick interval of the tier. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevanceTier", Meta = (DisplayName = "Disable Tick"))
+	bool DisableTick {false};
+
+	/** When enabled, lights in this tier do not cast shadows. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevanceTier", Meta = (DisplayName = "Disable Light Shadows"))
+	bool DisableLightShadows {false};
+
+	/** When enabled, audio components in this tier are silenced, which allows the audio engine to virtualize them. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevanceTier", Meta = (DisplayName = "Virtualize Audio"))
+	bool VirtualizeAudio {false};
+
+	/** Constructor with default values. */
+	FRoomRelevanceTier()
+	{
+	}
+
+	FRoomRelevanceTier(const int32 InMinRoomDistance, const float InTickInterval, const bool InDisableTick, const bool InDisableLightShadows, const bool InVirtualizeAudio)
+		: MinRoomDistance(InMinRoomDistance), TickInterval(InTickInterval), DisableTick(InDisableTick), DisableLightShadows(InDisableLightShadows), VirtualizeAudio(InVirtualizeAudio)
+	{
+	}
+
+	/** Returns whether this tier changes anything about an actor. */
+	FORCEINLINE bool HasPolicy() const {return TickInterval > 0.0f || DisableTick || DisableLightShadows || VirtualizeAudio; }
+};
+
+/** Data asset that defines how actors are throttled based on their room distance from the player.
+ *	@Brief Settings for the room relevance subsystem.
+ */
+UCLASS(BlueprintType, ClassGroup = ("RoomSystem"))
+class URoomRelevanceSettings : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The relevance tiers, sorted by their minimum room distance. The tier with the highest minimum distance that does not exceed the room distance of an actor is applied.
+	 *	Rooms that cannot be reached from the room of the player use the last tier. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevance", Meta = (DisplayName = "Tiers"))
+	TArray<FRoomRelevanceTier> Tiers;
+
+	/** Actor classes that are never throttled. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomRelevance", Meta = (DisplayName = "Excluded Classes"))
+	TArray<TSubclassOf<AActor>> ExcludedClasses;
+
+	/** Constructor with default values. */
+	URoomRelevanceSettings()
+	{
+		Tiers.Add(FRoomRelevanceTier(0, 0.0f, false, false, false));
+		Tiers.Add(FRoomRelevanceTier(2, 0.1f, false, true, false));
+		Tiers.Add(FRoomRelevanceTier(4, 0.0f, true, true, true));
+	}
+
+	/** Returns the index of the tier that applies to a room distance. INDEX_NONE is treated as unreachable. */
+	int32 GetTierIndex(const int32 RoomDistance) const;
+
+	/** Returns whether an actor class is excluded from throttling. */
+	bool IsExcluded(const AActor* Actor) const;
+};
@@ -0,0 +1,138 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomRelevanceSettings.h"
+#include "RoomRelevanceSubsystem.generated.h"
+
+class ARoomVolume;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+class UActorComponent;
+class ULightComponent;
+class UAudioComponent;
+
+/** Struct containing the state of a tick function before a relevance policy was applied to it. A null component refers to the tick function of the actor.
+ *	The applied state is kept as well, so that changes made by gameplay while the policy was applied are not overwritten when it is restored. */
+struct FRoomRelevanceTickState
+{
+	TWeakObjectPtr<AActor> Actor;
+	TWeakObjectPtr<UActorComponent> Component;
+	float TickInterval {0.0f};
+	bool IsTickEnabled {true};
+	float AppliedTickInterval {0.0f};
+	bool HasDisabledTick {false};
+};
+
+/** Struct containing an actor whose relevance is managed. */
+struct FRoomRelevanceEntry
+{
+	/** The actor, and the controller of the actor if it is a pawn. Policies are applied to both. */
+	TWeakObjectPtr<AActor> Actor;
+	TWeakObjectPtr<AActor> Controller;
+
+	/** The room of the actor. Actors whose room membership is tracked take their room from the membership subsystem instead. */
+	int32 RoomId {INDEX_NONE};
+
+	/** The tier that is currently applied, or INDEX_NONE if no policy is applied. */
+	int32 TierIndex {INDEX_NONE};
+
+	/** The number of tick functions of the actor and its components that can tick. */
+	int32 TickFunctionCount {0};
+
+	/** The state of the actor before the current policy was applied. */
+	TArray<FRoomRelevanceTickState> TickStates;
+	TArray<TPair<TWeakObjectPtr<ULightComponent>, bool>> LightShadowStates;
+	TArray<TPair<TWeakObjectPtr<UAudioComponent>, float>> AudioVolumeStates;
+};
+
+/** World Subsystem that throttles actors based on the room distance between them and the player.
+ *	Actors that are placed in rooms are classified by the hop distance between their room and the room of the player,
+ *	and the policies of the matching relevance tier are applied: a minimum tick interval, disabling ticks, disabling light shadows and virtualizing audio.
+ *	Actors outside of any room and the player itself are never throttled. The tiers are defined by the relevance settings of the game mode.
+ *	@Brief World Subsystem that manages actor relevance by room distance.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class URoomRelevanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The relevance settings in use. */
+	UPROPERTY()
+	URoomRelevanceSettings* Settings {nullptr};
+
+	/** The actors whose relevance is managed. */
+	TArray<FRoomRelevanceEntry> Entries;
+
+	/** The room the player was in at the last update. */
+	int32 PlayerRoomId {INDEX_NONE};
+
+	/** The number of tick functions currently in every tier. Used to estimate the number of ticks saved per frame. */
+	TArray<int32> TierTickFunctionCounts;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Starts managing the relevance of an actor. Actors in rooms are registered automatically when the world begins play. Spawned actors have to register themselves. */
+	UFUNCTION(BlueprintCallable, Category = "RoomRelevance", Meta = (DisplayName = "Register Actor"))
+	void RegisterActor(AActor* Actor);
+
+	/** Stops managing the relevance of an actor and restores its original state. */
+	UFUNCTION(BlueprintCallable, Category = "RoomRelevance", Meta = (DisplayName = "Unregister Actor"))
+	void UnregisterActor(AActor* Actor);
+
+	/** Returns the room distance between an actor and the player, or -1 if it is unknown. */
+	UFUNCTION(BlueprintPure, Category = "RoomRelevance", Meta = (DisplayName = "Get Room Distance To Player"))
+	int32 GetRoomDistanceToPlayer(const AActor* Actor) const;
+
+private:
+	/** Loads the relevance settings of the game mode, or the default settings if the game mode does not define any. */
+	void LoadSettings();
+
+	/** Registers all actors that are placed in rooms. Called whenever the membership index has been rebuilt for a new room graph. */
+	void RegisterActorsInRooms();
+
+	/** Returns whether the relevance of an actor can be managed. */
+	bool CanManageActor(const AActor* Actor) const;
+
+	/** Returns the room of a managed actor. */
+	int32 GetEntryRoomId(const FRoomRelevanceEntry& Entry) const;
+
+	/** Called when a tracked actor changes room. */
+	UFUNCTION()
+	void HandleRoomMembershipChanged(AActor* Actor, ARoomVolume* PreviousRoom, ARoomVolume* NewRoom);
+
+	/** Reclassifies all managed actors. */
+	void UpdateAllEntries();
+
+	/** Reclassifies a single managed actor and applies the policies of its tier. */
+	void UpdateEntry(FRoomRelevanceEntry& Entry);
+
+	/** Restores the state of an actor from before any policy was applied. */
+	void RestoreEntry(FRoomRelevanceEntry& Entry);
+
+	/** Applies the policies of a tier to an actor. */
+	void ApplyTier(FRoomRelevanceEntry& Entry, const int32 TierIndex);
+
+	/** Captures the state of a tick function and throttles or disables it. */
+	static void ApplyTierToTickFunction(FRoomRelevanceEntry& Entry, AActor* Actor, UActorComponent* Component, const float TickInterval, const bool DisableTick);
+
+	/** Restores a tick function to its captured state, unless gameplay has changed it since the policy was applied. */
+	static void RestoreTickFunction(const FRoomRelevanceTickState& TickState);
+};
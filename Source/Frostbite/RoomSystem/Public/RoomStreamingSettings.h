@@ -0,0 +1,43 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "RoomStreamingSettings.generated.h"
+
+/** Data asset that defines how the streaming levels of rooms are loaded.
+ *	@Brief Settings for the room streaming subsystem.
+ */
+UCLASS(BlueprintType, ClassGroup = ("RoomSystem"))
+class URoomStreamingSettings : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The estimated memory all loaded room levels may use together. The levels of the room of the player and its adjacent rooms are always loaded, even if they exceed the budget. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomStreaming", Meta = (DisplayName = "Memory Budget", ClampMin = "0", UIMin = "0", Units = "MB"))
+	float MemoryBudget {1024.0f};
+
+	/** The interval at which the streaming policy is evaluated. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomStreaming", Meta = (DisplayName = "Update Interval", ClampMin = "0", UIMin = "0", Units = "s"))
+	float UpdateInterval {0.1f};
+
+	/** Rooms two connections away are prefetched if the player will reach the portal towards them within this time. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomStreaming|Prefetch", Meta = (DisplayName = "Prefetch Time", ClampMin = "0", UIMin = "0", Units = "s"))
+	float PrefetchTime {3.0f};
+
+	/** The minimum speed of the player for rooms to be prefetched. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomStreaming|Prefetch", Meta = (DisplayName = "Prefetch Min Speed", ClampMin = "0", UIMin = "0", Units = "cm/s"))
+	float PrefetchMinSpeed {100.0f};
+
+	/** The minimum cosine of the angle between the velocity of the player and the direction to a portal for the player to be considered moving towards it. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomStreaming|Prefetch", Meta = (DisplayName = "Prefetch Direction Threshold", ClampMin = "-1", ClampMax = "1", UIMin = "-1", UIMax = "1"))
+	float PrefetchDirectionThreshold {0.5f};
+
+	/** Frames that take longer than this while levels are streaming are counted as streaming hitches. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RoomStreaming|Telemetry", Meta = (DisplayName = "Hitch Threshold", ClampMin = "0", UIMin = "0", Units = "ms"))
+	float HitchThreshold {50.0f};
+};
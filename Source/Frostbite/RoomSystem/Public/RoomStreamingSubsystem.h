@@ -0,0 +1,153 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomStreamingSettings.h"
+#include "RoomStreamingSubsystem.generated.h"
+
+class ARoomVolume;
+class ULevelStreaming;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+
+/** Enum for the state a room streaming level should be in. */
+enum class ERoomStreamingState : uint8
+{
+	Unloaded,
+	Prefetched,
+	Resident,
+};
+
+/** Struct containing a streaming level that belongs to one or more rooms. */
+struct FRoomStreamingLevel
+{
+	TWeakObjectPtr<ULevelStreaming> Level;
+	float EstimatedMemory {0.0f};
+
+	/** The state that was last requested for the level. */
+	ERoomStreamingState State {ERoomStreamingState::Unloaded};
+
+	/** The time at which the level was last wanted by the policy. Levels that are no longer wanted are kept loaded as long as the budget allows, least recently wanted first out. */
+	double LastWantedTime {0.0};
+};
+
+/** Struct containing the streaming telemetry of the current session. */
+USTRUCT(BlueprintType)
+struct FRoomStreamingTelemetry
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The number of levels that are loaded and visible. */
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Resident Levels"))
+	int32 ResidentLevels {0};
+
+	/** The number of levels that are loaded but not visible. */
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Prefetched Levels"))
+	int32 PrefetchedLevels {0};
+
+	/** The estimated memory of all loaded levels. */
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Estimated Memory", Units = "MB"))
+	float EstimatedMemory {0.0f};
+
+	/** The number of frames that exceeded the hitch threshold while levels were streaming, and their combined and worst duration. */
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Hitch Count"))
+	int32 HitchCount {0};
+
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Total Hitch Time", Units = "ms"))
+	float TotalHitchTime {0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Worst Hitch Time", Units = "ms"))
+	float WorstHitchTime {0.0f};
+
+	/** The number of room entries for which all levels of the room were already loaded, and the number for which they were not. */
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Room Entry Hits"))
+	int32 RoomEntryHits {0};
+
+	UPROPERTY(BlueprintReadOnly, Category = "RoomStreamingTelemetry", Meta = (DisplayName = "Room Entry Misses"))
+	int32 RoomEntryMisses {0};
+
+	/** Constructor with default values. */
+	FRoomStreamingTelemetry()
+	{
+	}
+};
+
+/** World Subsystem that streams the levels of rooms based on the position of the player in the room graph.
+ *	The levels of the room of the player and its adjacent rooms are kept resident. Rooms two connections away are prefetched
+ *	when the player moves towards the portal that leads to them, so that they are loaded before they become adjacent.
+ *	Levels that are no longer needed stay loaded while the estimated memory of all loaded levels is within the budget.
+ *	@Brief World Subsystem that streams room levels.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class URoomStreamingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The streaming settings in use. */
+	UPROPERTY()
+	URoomStreamingSettings* Settings {nullptr};
+
+	/** All streaming levels that belong to rooms. */
+	TArray<FRoomStreamingLevel> Levels;
+
+	/** The indices of the streaming levels of every room, indexed by room ID. */
+	TArray<TArray<int32>> RoomLevels;
+
+	/** The room the player was in at the last update. */
+	int32 PlayerRoomId {INDEX_NONE};
+
+	/** The time since the streaming policy was last evaluated. */
+	float TimeSinceUpdate {0.0f};
+
+	/** The streaming telemetry of the current session. */
+	FRoomStreamingTelemetry Telemetry;
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Returns the streaming telemetry of the current session. */
+	UFUNCTION(BlueprintPure, Category = "RoomStreaming", Meta = (DisplayName = "Get Streaming Telemetry"))
+	FORCEINLINE FRoomStreamingTelemetry GetStreamingTelemetry() const {return Telemetry; }
+
+	/** Returns whether all streaming levels of a room are loaded and visible. */
+	UFUNCTION(BlueprintPure, Category = "RoomStreaming", Meta = (DisplayName = "Is Room Resident"))
+	bool IsRoomResident(const ARoomVolume* Room) const;
+
+private:
+	/** Loads the streaming settings of the game mode, or the default settings if the game mode does not define any. */
+	void LoadSettings();
+
+	/** Resolves the streaming levels of all rooms. Called whenever the membership index has been rebuilt for a new room graph. */
+	void BuildRoomLevels();
+
+	/** Evaluates the streaming policy and requests the resulting level states. */
+	void UpdateStreaming();
+
+	/** Returns the rooms two connections away from the room of the player that should be prefetched, ordered by how soon the player will reach them. */
+	void GetPrefetchRooms(const FVector& PlayerLocation, const FVector& PlayerVelocity, TArray<int32>& OutRoomIds) const;
+
+	/** Requests a state for a streaming level. */
+	static void RequestLevelState(FRoomStreamingLevel& Level, const ERoomStreamingState State);
+
+	/** Returns whether all streaming levels of a room are loaded and visible. */
+	bool AreRoomLevelsResident(const int32 RoomId) const;
+
+	/** Records a streaming hitch if the frame was slow while levels were streaming. */
+	void RecordHitch(const float DeltaTime);
+};
@@ -0,0 +1,50 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "RoomVisibilityBaker.generated.h"
+
+class URoomVisibilityData;
+
+/** Actor that bakes and registers the room level potentially visible set of a level.
+ *	The bake casts sampled visibility rays between random points in the bounds of every pair of rooms against static geometry.
+ *	Two rooms can see each other if any ray between them is unobstructed, and connected rooms can always see each other.
+ *	At runtime, the baker registers its data with the room visibility subsystem.
+ *	@Brief Actor for baking and registering room visibility.
+ */
+UCLASS(NotBlueprintable, Placeable, ClassGroup = ("RoomSystem"), HideCategories = (Rendering, Input, Collision, HLOD, Replication))
+class ARoomVisibilityBaker : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	/** The data asset to bake the room visibility into. */
+	UPROPERTY(EditInstanceOnly, Category = "RoomVisibilityBaker", Meta = (DisplayName = "Room Visibility"))
+	URoomVisibilityData* RoomVisibility;
+
+	/** The number of visibility rays cast between every pair of rooms. */
+	UPROPERTY(EditInstanceOnly, Category = "RoomVisibilityBaker", Meta = (DisplayName = "Rays Per Room Pair", ClampMin = "1", UIMin = "1", UIMax = "1024"))
+	int32 RaysPerRoomPair {256};
+
+	/** The seed of the random sample points, so that bakes are reproducible. */
+	UPROPERTY(EditInstanceOnly, Category = "RoomVisibilityBaker", Meta = (DisplayName = "Random Seed"))
+	int32 RandomSeed {0};
+
+public:
+	/** Sets default values for this actor's properties. */
+	ARoomVisibilityBaker();
+
+#if WITH_EDITOR
+	/** Computes which rooms can possibly see each other and stores the results in the room visibility data asset. */
+	UFUNCTION(CallInEditor, Category = "RoomVisibilityBaker", Meta = (DisplayName = "Bake Room Visibility"))
+	void BakeRoomVisibility();
+#endif
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
@@ -0,0 +1,47 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "RoomVisibilityData.generated.h"
+
+class ARoomVolume;
+
+/** Data asset that stores a baked room level potentially visible set.
+ *	Every room stores a bitset of the rooms that can possibly be seen from anywhere inside it. It is generated by a RoomVisibilityBaker.
+ *	@Brief Baked room to room visibility.
+ */
+UCLASS(BlueprintType, ClassGroup = ("RoomSystem"))
+class URoomVisibilityData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The rooms that were baked. The index of a room in this array is its index in the visibility bitsets. */
+	UPROPERTY(VisibleAnywhere, Category = "RoomVisibility", Meta = (DisplayName = "Rooms"))
+	TArray<TSoftObjectPtr<ARoomVolume>> Rooms;
+
+	/** The number of 64 bit words in the bitset of every room. */
+	UPROPERTY(VisibleAnywhere, Category = "RoomVisibility", Meta = (DisplayName = "Word Count"))
+	int32 WordCount {0};
+
+	/** The visibility bitset of every room, stored as [Room][Word]. */
+	UPROPERTY()
+	TArray<uint64> VisibilityBits;
+
+public:
+	/** Returns whether the data is consistent. */
+	FORCEINLINE bool IsValidData() const {return Rooms.Num() > 0 && WordCount == GetWordCount(Rooms.Num()) && VisibilityBits.Num() == Rooms.Num() * WordCount; }
+
+	/** Returns whether the room at one index can possibly see the room at another index. */
+	FORCEINLINE bool CanRoomSeeRoom(const int32 FromIndex, const int32 ToIndex) const
+	{
+		return (VisibilityBits[FromIndex * WordCount + ToIndex / 64] >> (ToIndex % 64)) & 1;
+	}
+
+	/** Returns the number of words required to store a bitset for a number of rooms. */
+	static FORCEINLINE int32 GetWordCount(const int32 RoomCount) {return (RoomCount + 63) / 64; }
+};
@@ -0,0 +1,92 @@
+// Copyright (c) 2022-present Barrelhouse
+// Written by Tim Verberne
+// This source code is part of the project Frostbite
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomVisibilitySubsystem.generated.h"
+
+class ARoomVolume;
+class UPrimitiveComponent;
+class URoomGraphSubsystem;
+class URoomMembershipSubsystem;
+class URoomVisibilityData;
+
+/** World Subsystem that provides the baked room level potentially visible set.
+ *	The baked visibility is remapped to room graph IDs, so that a room to room visibility query is a single bit test.
+ *	Rooms that were not baked are treated as visible from everywhere.
+ *	Primitives that lie entirely within a room are hidden for the player when that room cannot be seen from the room that contains the camera.
+ *	@Brief World Subsystem for room visibility.
+ */
+UCLASS(ClassGroup = ("RoomSystem"))
+class URoomVisibilitySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	/** Pointers to the room subsystems. */
+	UPROPERTY()
+	URoomGraphSubsystem* RoomGraph {nullptr};
+
+	UPROPERTY()
+	URoomMembershipSubsystem* RoomMembership {nullptr};
+
+	/** The registered room visibility data. */
+	UPROPERTY()
+	URoomVisibilityData* Data {nullptr};
+
+	/** The visibility bitset of every room, indexed by room ID and stored as [Room][Word]. */
+	TArray<uint64> VisibilityBits;
+
+	/** The number of 64 bit words in the bitset of every room. */
+	int32 WordCount {0};
+
+	/** The primitives that lie entirely within every room, indexed by room ID. */
+	TArray<TArray<TWeakObjectPtr<UPrimitiveComponent>>> RoomPrimitives;
+
+	/** The primitives that are currently hidden by this subsystem. */
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> HiddenPrimitives;
+
+	/** The room that contained the camera at the last update. */
+	int32 CameraRoomId {INDEX_NONE};
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Registers room visibility data. Only one data asset can be registered at a time. */
+	void RegisterData(URoomVisibilityData* InData);
+
+	/** Unregisters room visibility data. */
+	void UnregisterData(URoomVisibilityData* InData);
+
+	/** Returns whether room visibility data is registered. Without it, every room can see every other room. */
+	FORCEINLINE bool HasVisibilityData() const {return WordCount > 0; }
+
+	/** Returns whether any location in one room can possibly see any location in another room. Returns true if either room is unknown. */
+	FORCEINLINE bool CanRoomSeeRoom(const int32 FromId, const int32 ToId) const
+	{
+		if(WordCount == 0 || FromId < 0 || ToId < 0 || FromId * WordCount >= VisibilityBits.Num() || ToId / 64 >= WordCount) {return true; }
+		return (VisibilityBits[FromId * WordCount + ToId / 64] >> (ToId % 64)) & 1;
+	}
+
+	/** Returns whether any location in one room can possibly see any location in another room. Returns true if either room is unknown. */
+	UFUNCTION(BlueprintPure, Category = "RoomVisibility", Meta = (DisplayName = "Can Room See Room"))
+	bool CanRoomVolumeSeeRoomVolume(const ARoomVolume* From, const ARoomVolume* To) const;
+
+	/** Returns the number of primitives that are currently hidden because their room cannot be seen. */
+	UFUNCTION(BlueprintPure, Category = "RoomVisibility", Meta = (DisplayName = "Get Hidden Primitive Count"))
+	FORCEINLINE int32 GetHiddenPrimitiveCount() const {return HiddenPrimitives.Num(); }
+
+private:
+	/** Remaps the visibility data to room IDs and gathers the primitives of every room. Called when the membership index has been rebuilt for a new room graph or data is registered. */
+	void BuildVisibility();
+
+	/** Hides the primitives of all rooms that cannot be seen from the room of the camera. */
+	void UpdateHiddenPrimitives();
+};
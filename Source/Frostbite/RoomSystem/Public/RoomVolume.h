@@ -31,6 +31,26 @@ struct FRoomPathData
 	}
 };
 
+/** Struct for defining a streaming level that belongs to a room. */
+USTRUCT(BlueprintType)
+struct FRoomStreamingLevelData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Soft object pointer to the streaming level. The level has to be added to the persistent level with Blueprint controlled streaming. */
+	UPROPERTY(BlueprintReadOnly, EditInstanceOnly, Category = "RoomStreamingLevelData", Meta = (DisplayName = "Level"))
+	TSoftObjectPtr<UWorld> Level {nullptr};
+
+	/** The estimated memory the level uses when it is loaded. Used to keep the streamed levels within the memory budget. */
+	UPROPERTY(BlueprintReadOnly, EditInstanceOnly, Category = "RoomStreamingLevelData", Meta = (DisplayName = "Estimated Memory", ClampMin = "0", UIMin = "0", Units = "MB"))
+	float EstimatedMemory {64.0f};
+
+	/** Constructor with default values. */
+	FRoomStreamingLevelData()
+	{
+	}
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPlayerEnterDelegate, APlayerCharacter*, PlayerCharacter);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPlayerLeaveDelegate, APlayerCharacter*, PlayerCharacter);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FNightstalkerEnterDelegate, ANightstalker*, Nightstalker);
@@ -62,6 +82,15 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditInstanceOnly, Category = "Actors", Meta = (DisplayName = "Adjacent rooms"))
 	TArray<TSoftObjectPtr<ARoomVolume>> ConnectedRooms;
 
+	/** Per path settings for connections to adjacent rooms. Connections are undirected, and a path can only be taken by the nightstalker if neither room disallows it.
+	 *	Adjacent rooms without an entry can be taken by the nightstalker. Rooms listed here are connected even if they are not in the adjacent rooms list. */
+	UPROPERTY(BlueprintReadWrite, EditInstanceOnly, Category = "Actors", Meta = (DisplayName = "Path Data", TitleProperty = "Room"))
+	TArray<FRoomPathData> PathData;
+
+	/** The streaming levels that contain the content of this room. They are loaded when the player is in or next to this room. */
+	UPROPERTY(BlueprintReadOnly, EditInstanceOnly, Category = "Streaming", Meta = (DisplayName = "Streaming Levels", TitleProperty = "Level"))
+	TArray<FRoomStreamingLevelData> StreamingLevels;
+
 private:
 	/** Whether the room is currently lit or not. */
 	UPROPERTY(BlueprintGetter =GetIsLit, Category = "RoomVolume", Meta = (DisplayName = "Is Lit"))
@@ -71,10 +100,19 @@ public:
 	/** Set whether the room should be considered lit or not. */
 	UFUNCTION(BlueprintCallable, Category = "RoomVolume", Meta = (DisplayName = "Set Light Status"))
 	void SetLightStatus(const bool Value);
+
+	/** Notifies the room that an actor has entered it. This is called for overlapping actors, and by the room membership subsystem for tracked actors. */
+	void NotifyActorEnterRoom(AActor* Actor);
+
+	/** Notifies the room that an actor has left it. This is called for overlapping actors, and by the room membership subsystem for tracked actors. */
+	void NotifyActorLeaveRoom(AActor* Actor);
 	
 protected:
 	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
 	virtual void NotifyActorEndOverlap(AActor* OtherActor) override;
+
+	/** Returns whether the room membership of an actor is tracked by the room membership subsystem. */
+	bool IsTrackedByMembershipSubsystem(const AActor* Actor) const;
 	
 	/** Blueprint native event for when the player enters the room volume.
 	 *	@Param PlayerCharacter Pointer to the player character that entered the room volume.